@@ -1,14 +1,28 @@
 #include <argparse/argparse.hpp>
+#include <chrono>
+#include <cstdio>
 #include <exception>
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <replxx.hxx>
 #include <sstream>
 #include <string>
+#include <type_traits>
+#include <vector>
 
+#include "sonar/ast_binary.hpp"
+#include "sonar/ast_stats.hpp"
+#include "sonar/event_parser.hpp"
+#include "sonar/hash.hpp"
 #include "sonar/lexer.hpp"
+#include "sonar/metrics.hpp"
+#include "sonar/parse_cache.hpp"
 #include "sonar/parser.hpp"
+#include "sonar/perf_counters.hpp"
 #include "sonar/pretty_printer.hpp"
+#include "sonar/thread_pool.hpp"
+#include "sonar/trace.hpp"
 
 #ifndef SONAR_VERSION
 #define SONAR_VERSION "0.0.0"
@@ -22,16 +36,165 @@ void report_parse_error(const sonar::ParseError& error) {
               << ": error: " << error.what() << std::endl;
 }
 
-void print_ast(const std::string& source, const std::string& source_name) {
+void print_ast_stats(const sonar::Expression& ast) {
+    const auto stats = sonar::collect_ast_stats(ast);
+    std::cerr << "ast: " << stats.nodes() << " nodes (" << stats.expressions << " expressions, " << stats.statements
+              << " statements), " << stats.bytes << " bytes, " << stats.bytes_per_node() << " bytes/node" << std::endl;
+}
+
+struct OutputOptions {
+    bool show_stats{false};
+    std::optional<std::string> emit_ast_bin;
+};
+
+// Wall time and hardware counters of each phase of one file, for --time.
+class PhaseTimer {
+   public:
+    template <typename Body>
+    auto run(const char* name, Body&& body) {
+        const auto start = std::chrono::steady_clock::now();
+        counters_.start();
+        if constexpr (std::is_void_v<std::invoke_result_t<Body&>>) {
+            body();
+            finish(name, start);
+        } else {
+            auto result = body();
+            finish(name, start);
+            return result;
+        }
+    }
+
+    void set_tokens(std::size_t tokens) { tokens_ = tokens; }
+
+    void report(std::ostream& out) const {
+        out << "time: " << tokens_ << " tokens\n";
+        char line[160];
+        std::snprintf(line, sizeof(line), "%-8s %10s %10s %6s %12s %12s %12s\n", "phase", "ms", "instr/tok", "IPC",
+                      "br-miss/tok", "L1d-miss/tok", "LLC-miss/tok");
+        out << line;
+        const auto tokens = static_cast<double>(tokens_);
+        for (const Phase& phase : phases_) {
+            std::snprintf(line, sizeof(line), "%-8s %10.3f %10s %6s %12s %12s %12s\n", phase.name,
+                          std::chrono::duration<double, std::milli>(phase.elapsed).count(),
+                          format(phase.reading.per(sonar::PerfEvent::Instructions, tokens)).c_str(),
+                          format(phase.reading.ipc()).c_str(),
+                          format(phase.reading.per(sonar::PerfEvent::BranchMisses, tokens)).c_str(),
+                          format(phase.reading.per(sonar::PerfEvent::L1dMisses, tokens)).c_str(),
+                          format(phase.reading.per(sonar::PerfEvent::LlcMisses, tokens)).c_str());
+            out << line;
+        }
+        if (!counters_.unavailable_reason().empty()) {
+            out << "time: some counters are unavailable: " << counters_.unavailable_reason() << "\n";
+        }
+    }
+
+   private:
+    struct Phase {
+        const char* name;
+        std::chrono::nanoseconds elapsed;
+        sonar::PerfReading reading;
+    };
+
+    static std::string format(std::optional<double> value) {
+        if (!value) {
+            return "-";
+        }
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.3f", *value);
+        return text;
+    }
+
+    void finish(const char* name, std::chrono::steady_clock::time_point start) {
+        auto reading = counters_.stop();
+        phases_.push_back(Phase{name, std::chrono::steady_clock::now() - start, reading});
+    }
+
+    sonar::PerfCounters counters_;
+    std::vector<Phase> phases_;
+    std::size_t tokens_{0};
+};
+
+// What measures the phases of one file: --time, --trace, both or neither.
+struct PhaseHooks {
+    PhaseTimer* timer{nullptr};
+    sonar::TraceRecorder* trace{nullptr};
+};
+
+// Runs `body` as the phase `name` of the file `source_name`.
+template <typename Body>
+auto run_phase(const PhaseHooks& hooks, const char* name, const std::string& source_name, Body&& body) {
+    sonar::TraceSpan span(hooks.trace, name, hooks.trace ? source_name : std::string());
+    return hooks.timer ? hooks.timer->run(name, body) : body();
+}
+
+void print_ast(const std::string& source, const std::string& source_name, sonar::ThreadPool* pool = nullptr,
+               const OutputOptions& output = {}, const PhaseHooks& hooks = {}) {
     sonar::Lexer lexer;
-    auto lex_result = lexer.tokenize(source);
-    sonar::Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), source_name);
-    auto ast = parser.parse();
-    std::cout << sonar::pretty_print(*ast) << std::endl;
+    auto lex_result = run_phase(hooks, "lex", source_name, [&] { return lexer.tokenize(source); });
+    if (hooks.timer) {
+        hooks.timer->set_tokens(lex_result.tokens.size());
+    }
+    sonar::ParserOptions options;
+    options.trace = hooks.trace;
+    sonar::Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), source_name, options);
+    auto ast = run_phase(hooks, "parse", source_name,
+                         [&] { return pool ? parser.parse_parallel(*pool) : parser.parse(); });
+    const std::string printed = run_phase(hooks, "print", source_name, [&] { return sonar::pretty_print(*ast); });
+    std::cout << printed << std::endl;
+    if (output.show_stats) {
+        print_ast_stats(*ast);
+    }
+    if (output.emit_ast_bin) {
+        sonar::write_ast_file(*output.emit_ast_bin, *ast, sonar::hash_bytes(source));
+    }
+}
+
+// Prints each top-level statement as soon as it is parsed and frees it before parsing the next one. Reading
+// and lexing happen item by item inside the parse phase; each statement's print is traced inside it.
+void stream_ast(std::istream& input, const std::string& source_name, const PhaseHooks& hooks = {}) {
+    const auto print = [&](const auto& node) {
+        run_phase(hooks, "print", source_name, [&] { std::cout << sonar::pretty_print(node) << '\n'; });
+    };
+    run_phase(hooks, "parse", source_name, [&] {
+        auto value = sonar::Parser::parse_streaming(
+            input, source_name, [&](sonar::StatementPtr statement) { print(*statement); });
+        if (value) {
+            print(*value);
+        }
+    });
+    std::cout.flush();
+}
+
+// Prints what print_ast would, from parse events instead of a syntax tree. Parsing and printing are one
+// phase, since the printer drives the parser.
+void print_events(const std::string& source, const std::string& source_name, const PhaseHooks& hooks = {}) {
+    sonar::Lexer lexer;
+    const auto lex_result = run_phase(hooks, "lex", source_name, [&] { return lexer.tokenize(source); });
+    sonar::EventParser parser(lex_result.tokens, lex_result.line_offsets, source_name);
+    std::cout << run_phase(hooks, "parse+print", source_name, [&] { return sonar::pretty_print_events(parser); })
+              << std::endl;
+}
+
+// Prints a tree written by --emit-ast-bin without lexing or parsing.
+void print_binary_ast(const std::string& path, const OutputOptions& output, const PhaseHooks& hooks = {}) {
+    std::optional<sonar::BinaryAstFile> file;
+    auto ast = run_phase(hooks, "read", path, [&] {
+        file.emplace(path);
+        return sonar::materialize(file->ast().root());
+    });
+    std::cout << run_phase(hooks, "print", path, [&] { return sonar::pretty_print(*ast); }) << std::endl;
+    if (output.show_stats) {
+        print_ast_stats(*ast);
+    }
+    if (output.emit_ast_bin) {
+        sonar::write_ast_file(*output.emit_ast_bin, *ast, file->ast().source_hash());
+    }
 }
 
 void repl() {
     replxx::Replxx console;
+    // Snippets recalled from history are printed from the cache instead of being parsed again.
+    sonar::ParseCache cache;
     const std::string primary_prompt{"sonar> "};
     const std::string continuation_prompt{"... "};
 
@@ -65,7 +228,7 @@ void repl() {
         buffer.append(line);
 
         try {
-            print_ast(buffer, current_source_name);
+            std::cout << sonar::pretty_print(*cache.parse(buffer, current_source_name)) << std::endl;
             console.history_add(buffer);
             buffer.clear();
             prompt = primary_prompt;
@@ -100,6 +263,48 @@ int main(int argc, const char* const argv[]) {
         .metavar("FILE")
         .nargs(argparse::nargs_pattern::optional);
 
+    program.add_argument("-j", "--jobs")
+        .help("Parse top-level statements of FILE on N threads")
+        .metavar("N")
+        .default_value(std::size_t{1})
+        .scan<'u', std::size_t>();
+
+    program.add_argument("--stream")
+        .help("Print each top-level statement of FILE on its own line as soon as it is parsed")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--no-ast")
+        .help("Print FILE from parse events without building its syntax tree")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--emit-ast-bin")
+        .help("Also write the syntax tree of FILE to PATH in the binary AST format, which sonar reads back "
+              "without parsing")
+        .metavar("PATH");
+
+    program.add_argument("--ast-stats")
+        .help("Report the node count and memory footprint of the syntax tree of FILE on stderr")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--time")
+        .help("Report the time of reading, lexing, parsing and printing FILE on stderr, with instructions, IPC "
+              "and branch and cache misses per token where hardware counters are available")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--trace")
+        .help("Write a Chrome trace-event JSON file to PATH with a span for reading, lexing, parsing and printing "
+              "FILE on each thread, for chrome://tracing or Perfetto")
+        .metavar("PATH");
+
+    program.add_argument("--metrics")
+        .help("Write the lexer, parser and printer metrics in the Prometheus text format to PATH on exit, or to "
+              "stderr for -")
+        .metavar("PATH");
+
     try {
         program.parse_args(argc, argv);
     } catch (const std::exception& ex) {
@@ -113,6 +318,47 @@ int main(int argc, const char* const argv[]) {
     }
 
     auto positional_file = program.present<std::string>("file");
+    const auto jobs = program.get<std::size_t>("--jobs");
+    const OutputOptions output{program.get<bool>("--ast-stats"), program.present<std::string>("--emit-ast-bin")};
+    const bool stream = program.get<bool>("--stream");
+    if (stream && (jobs > 1 || output.show_stats || output.emit_ast_bin)) {
+        std::cerr << "error: --stream cannot be combined with --jobs, --ast-stats or --emit-ast-bin" << std::endl;
+        return 1;
+    }
+    const bool no_ast = program.get<bool>("--no-ast");
+    if (no_ast && (stream || jobs > 1 || output.show_stats || output.emit_ast_bin)) {
+        std::cerr << "error: --no-ast cannot be combined with --stream, --jobs, --ast-stats or --emit-ast-bin"
+                  << std::endl;
+        return 1;
+    }
+    // Hardware counters follow the calling thread, so phases are timed one at a time on the main thread.
+    const bool time_phases = program.get<bool>("--time");
+    if (time_phases && (stream || no_ast || jobs > 1)) {
+        std::cerr << "error: --time cannot be combined with --stream, --no-ast or --jobs" << std::endl;
+        return 1;
+    }
+    const auto trace_path = program.present<std::string>("--trace");
+    const auto metrics_path = program.present<std::string>("--metrics");
+    const auto write_metrics = [&]() -> int {
+        if (!metrics_path) {
+            return 0;
+        }
+        if (*metrics_path == "-") {
+            sonar::metrics::Registry::global().write_prometheus(std::cerr);
+            return 0;
+        }
+        std::ofstream out(*metrics_path);
+        sonar::metrics::Registry::global().write_prometheus(out);
+        if (!out.flush()) {
+            std::cerr << "error: failed to write '" << *metrics_path << "'" << std::endl;
+            return 1;
+        }
+        return 0;
+    };
+    std::optional<sonar::TraceRecorder> trace;
+    if (trace_path) {
+        trace.emplace();
+    }
 
     auto parse_file = [&](const std::string& path) -> int {
         std::ifstream input(path);
@@ -120,11 +366,49 @@ int main(int argc, const char* const argv[]) {
             std::cerr << "error: failed to open '" << path << "'" << std::endl;
             return 1;
         }
-        std::ostringstream contents;
-        contents << input.rdbuf();
-        std::string source = contents.str();
+        sonar::TraceSpan file_span(trace ? &*trace : nullptr, "file", path);
         try {
-            print_ast(source, path);
+            // Binary trees are mapped rather than read, so only the magic is looked at here.
+            std::string magic(8, '\0');
+            input.read(magic.data(), static_cast<std::streamsize>(magic.size()));
+            magic.resize(static_cast<std::size_t>(input.gcount()));
+            if (sonar::is_binary_ast(magic)) {
+                print_binary_ast(path, output, PhaseHooks{nullptr, trace ? &*trace : nullptr});
+                return 0;
+            }
+
+            std::optional<PhaseTimer> timer;
+            if (time_phases) {
+                timer.emplace();
+            }
+            const PhaseHooks hooks{timer ? &*timer : nullptr, trace ? &*trace : nullptr};
+            if (stream) {
+                // The parse reads the file itself, from the start.
+                input.clear();
+                input.seekg(0);
+                if (!input) {
+                    std::cerr << "error: failed to rewind '" << path << "'" << std::endl;
+                    return 1;
+                }
+                stream_ast(input, path, hooks);
+                return 0;
+            }
+            const std::string source = run_phase(hooks, "read", path, [&] {
+                std::ostringstream contents;
+                contents << magic << input.rdbuf();
+                return contents.str();
+            });
+            if (no_ast) {
+                print_events(source, path, hooks);
+            } else if (jobs > 1) {
+                sonar::ThreadPool pool(jobs);
+                print_ast(source, path, &pool, output, hooks);
+            } else {
+                print_ast(source, path, nullptr, output, hooks);
+            }
+            if (timer) {
+                timer->report(std::cerr);
+            }
         } catch (const sonar::ParseError& ex) {
             report_parse_error(ex);
             return 1;
@@ -136,12 +420,25 @@ int main(int argc, const char* const argv[]) {
     };
 
     if (positional_file) {
-        return parse_file(*positional_file);
+        int status = parse_file(*positional_file);
+        if (trace) {
+            // Written even when parsing failed, since the spans up to the error are still worth seeing.
+            std::ofstream out(*trace_path);
+            trace->write_chrome_json(out);
+            if (!out.flush()) {
+                std::cerr << "error: failed to write '" << *trace_path << "'" << std::endl;
+                status = 1;
+            }
+            if (const auto dropped = trace->dropped()) {
+                std::cerr << "trace: " << dropped << " spans dropped; the oldest were overwritten" << std::endl;
+            }
+        }
+        return write_metrics() != 0 ? 1 : status;
     }
 
     std::cout << "sonar " << SONAR_VERSION
               << " — enter an expression, or type 'quit' to exit."
               << std::endl;
     repl();
-    return 0;
+    return write_metrics();
 }
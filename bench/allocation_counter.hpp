@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+namespace sonar::bench {
+
+// Totals since program start, kept by the global operator new/delete replacements in allocation_counter.cpp.
+// Only executables that link that file count allocations.
+struct AllocationCounts {
+    std::size_t allocations{0};
+    std::size_t bytes{0};
+};
+
+AllocationCounts allocation_counts();
+
+// Peak resident set size of the process in bytes, or 0 where it is not available.
+std::size_t peak_rss_bytes();
+
+}  // namespace sonar::bench
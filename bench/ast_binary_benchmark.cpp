@@ -0,0 +1,93 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+
+#include "corpus.hpp"
+#include "sonar/ast_binary.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+
+namespace {
+
+const std::string& source() {
+    static const std::string program = sonar::bench::make_program(5000);
+    return program;
+}
+
+const std::string& encoded() {
+    static const std::string bytes = []() {
+        auto lexed = sonar::Lexer{}.tokenize(source());
+        sonar::Parser parser(std::move(lexed.tokens), std::move(lexed.line_offsets), "<bench>");
+        return sonar::serialize_ast(*parser.parse());
+    }();
+    return bytes;
+}
+
+// Touches every node the way a consumer of the tree would.
+std::size_t walk(sonar::BinaryNodeRef node) {
+    std::size_t count = 1;
+    benchmark::DoNotOptimize(node.span());
+    const std::size_t children = node.child_count();
+    for (std::size_t i = 0; i < children; ++i) {
+        if (auto child = node.child(i)) {
+            count += walk(child);
+        }
+    }
+    return count;
+}
+
+void BM_TokenizeAndParse(benchmark::State& state) {
+    for (auto _ : state) {
+        auto lexed = sonar::Lexer{}.tokenize(source());
+        sonar::Parser parser(std::move(lexed.tokens), std::move(lexed.line_offsets), "<bench>");
+        auto ast = parser.parse();
+        benchmark::DoNotOptimize(ast.get());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(source().size() * state.iterations()));
+}
+
+void BM_LoadBinary(benchmark::State& state) {
+    for (auto _ : state) {
+        sonar::BinaryAst ast(encoded());
+        benchmark::DoNotOptimize(ast.root());
+    }
+}
+
+void BM_LoadBinaryAndWalk(benchmark::State& state) {
+    for (auto _ : state) {
+        sonar::BinaryAst ast(encoded());
+        benchmark::DoNotOptimize(walk(ast.root()));
+    }
+}
+
+void BM_MapBinaryFileAndWalk(benchmark::State& state) {
+    const auto path = (std::filesystem::temp_directory_path() / "sonar_ast_binary_benchmark.bin").string();
+    {
+        auto lexed = sonar::Lexer{}.tokenize(source());
+        sonar::Parser parser(std::move(lexed.tokens), std::move(lexed.line_offsets), "<bench>");
+        sonar::write_ast_file(path, *parser.parse());
+    }
+    for (auto _ : state) {
+        sonar::BinaryAstFile file(path);
+        benchmark::DoNotOptimize(walk(file.ast().root()));
+    }
+    std::filesystem::remove(path);
+}
+
+void BM_LoadBinaryAndMaterialize(benchmark::State& state) {
+    for (auto _ : state) {
+        sonar::BinaryAst ast(encoded());
+        auto tree = sonar::materialize(ast.root());
+        benchmark::DoNotOptimize(tree.get());
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_TokenizeAndParse)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadBinary)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_LoadBinaryAndWalk)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_MapBinaryFileAndWalk)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadBinaryAndMaterialize)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,66 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "allocation_counter.hpp"
+#include "sonar/compilation_session.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+
+// Many small scripts, as a service parsing one per request sees them: BM_ScriptsFresh builds a Lexer result
+// and Parser per script, BM_ScriptsSession reuses one CompilationSession and resets it after every script.
+// allocs/script counts global heap allocations.
+
+namespace {
+
+const std::vector<std::string>& scripts() {
+    static const std::vector<std::string> scripts = [] {
+        std::vector<std::string> result;
+        for (int i = 0; i < 256; ++i) {
+            const std::string n = std::to_string(i);
+            result.push_back("let limit = " + n + ";\nfn step(x: number) -> number { if x { x - limit } else { x * 2 } }\n"
+                             "let total = 0;\nfor item in items { total = total + item; };\ntotal / " + n);
+        }
+        return result;
+    }();
+    return scripts;
+}
+
+void report(benchmark::State& state, sonar::bench::AllocationCounts before) {
+    const auto after = sonar::bench::allocation_counts();
+    const auto parsed = static_cast<double>(state.iterations() * static_cast<benchmark::IterationCount>(scripts().size()));
+    state.counters["allocs/script"] = static_cast<double>(after.allocations - before.allocations) / parsed;
+    state.counters["scripts/s"] = benchmark::Counter(parsed, benchmark::Counter::kIsRate);
+}
+
+void BM_ScriptsFresh(benchmark::State& state) {
+    const auto before = sonar::bench::allocation_counts();
+    for (auto _ : state) {
+        for (const auto& script : scripts()) {
+            auto lex_result = sonar::Lexer{}.tokenize(script);
+            sonar::Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), "<request>");
+            auto ast = parser.parse();
+            benchmark::DoNotOptimize(ast.get());
+        }
+    }
+    report(state, before);
+}
+BENCHMARK(BM_ScriptsFresh);
+
+void BM_ScriptsSession(benchmark::State& state) {
+    sonar::CompilationSession session;
+    const auto before = sonar::bench::allocation_counts();
+    for (auto _ : state) {
+        for (const auto& script : scripts()) {
+            auto ast = session.parse(script, "<request>");
+            benchmark::DoNotOptimize(ast.get());
+            ast.reset();
+            session.reset();
+        }
+    }
+    report(state, before);
+}
+BENCHMARK(BM_ScriptsSession);
+
+}  // namespace
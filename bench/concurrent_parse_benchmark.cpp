@@ -0,0 +1,63 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "concurrent_scripts.hpp"
+
+namespace {
+
+// Runs shorter than this, such as the few-iteration ones the library starts with to pick an iteration count,
+// are too noisy to judge and only report their efficiency.
+constexpr double kMinCheckedSeconds = 0.1;
+
+// Single-thread throughput, measured once per process before the first run starts timing, so every thread
+// count is compared with a baseline however runs are filtered or interleaved.
+double single_thread_scripts_per_second() {
+    static const double throughput = sonar::bench::concurrent_scripts_per_second(1, std::chrono::milliseconds(500));
+    return throughput;
+}
+
+// See concurrent_scripts.hpp. `efficiency` is throughput relative to N times the single-thread baseline; runs
+// below kMinScalingEfficiency on at most one thread per physical core are marked as errors here, and
+// ConcurrencyTimingTest fails on them in the opt-in timing tests.
+void BM_ConcurrentScripts(benchmark::State& state) {
+    const double baseline = single_thread_scripts_per_second();
+    const std::string& source = sonar::bench::concurrent_script();
+    const auto start = std::chrono::steady_clock::now();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sonar::bench::run_concurrent_script(source));
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    state.counters["scripts/s"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+    if (state.thread_index() != 0) {
+        return;
+    }
+
+    // Every thread runs as many iterations as thread 0 over about the same wall time.
+    const double throughput = static_cast<double>(state.iterations()) * state.threads() / seconds;
+    const double efficiency = throughput / (baseline * state.threads());
+    state.counters["efficiency"] = efficiency;
+    static const unsigned cores = sonar::bench::physical_cores();
+    if (seconds >= kMinCheckedSeconds && efficiency < sonar::bench::kMinScalingEfficiency &&
+        static_cast<unsigned>(state.threads()) <= cores) {
+        state.SkipWithError("throughput does not scale with the thread count");
+    }
+}
+
+void thread_counts(benchmark::internal::Benchmark* benchmark) {
+    const int max_threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        benchmark->Threads(threads);
+    }
+    if ((max_threads & (max_threads - 1)) != 0) {
+        benchmark->Threads(max_threads);
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_ConcurrentScripts)->Apply(thread_counts)->UseRealTime()->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "corpus.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/pretty_printer.hpp"
+
+namespace sonar::bench {
+
+// Independent scripts parsed on several threads at once, the way a server handles requests. Each thread lexes,
+// parses and prints its own copy, so the only things threads share are the allocator and the parser's constant
+// tables. Throughput on N threads below kMinScalingEfficiency times N single-thread runs points to lock or
+// cache-line contention; the check only holds up to one thread per physical core, since SMT siblings share one.
+inline constexpr double kMinScalingEfficiency = 0.7;
+
+inline const std::string& concurrent_script() {
+    static const std::string source = make_program(20);
+    return source;
+}
+
+inline std::size_t run_concurrent_script(const std::string& source) {
+    sonar::Lexer lexer;
+    auto lex_result = lexer.tokenize(source);
+    sonar::Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), "<bench>");
+    return sonar::pretty_print(*parser.parse()).size();
+}
+
+// Physical cores, counting SMT siblings once; std::thread::hardware_concurrency() where the topology is not
+// available.
+inline unsigned physical_cores() {
+    const unsigned logical = std::max(1u, std::thread::hardware_concurrency());
+#if defined(__linux__)
+    std::set<std::pair<std::string, std::string>> cores;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/cpu", error)) {
+        const auto topology = entry.path() / "topology";
+        std::ifstream package(topology / "physical_package_id");
+        std::ifstream core(topology / "core_id");
+        std::string package_id;
+        std::string core_id;
+        if (package >> package_id && core >> core_id) {
+            cores.emplace(package_id, core_id);
+        }
+    }
+    if (!cores.empty()) {
+        return std::min(logical, static_cast<unsigned>(cores.size()));
+    }
+#endif
+    return logical;
+}
+
+// Scripts per second over all `threads`, each running the script until `duration` has passed.
+inline double concurrent_scripts_per_second(unsigned threads, std::chrono::duration<double> duration) {
+    const std::string& source = concurrent_script();
+    std::atomic<unsigned> ready{0};
+    std::atomic<bool> go{false};
+    std::atomic<std::size_t> scripts{0};
+    std::atomic<std::size_t> sink{0};
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            ++ready;
+            while (!go) {
+                std::this_thread::yield();
+            }
+            const auto stop = std::chrono::steady_clock::now() + duration;
+            std::size_t done = 0;
+            std::size_t printed = 0;
+            while (std::chrono::steady_clock::now() < stop) {
+                printed += run_concurrent_script(source);
+                ++done;
+            }
+            scripts += done;
+            sink += printed;
+        });
+    }
+    while (ready < threads) {
+        std::this_thread::yield();
+    }
+    const auto start = std::chrono::steady_clock::now();
+    go = true;
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return static_cast<double>(scripts) / seconds;
+}
+
+}  // namespace sonar::bench
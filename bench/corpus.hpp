@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace sonar::bench {
+
+// A program of `items` top-level let, fn and while statements, each a few dozen tokens long.
+inline std::string make_program(std::size_t items) {
+    std::string source;
+    source.reserve(items * 160);
+    for (std::size_t i = 0; i < items; ++i) {
+        const std::string n = std::to_string(i);
+        source += "let v" + n + ": number = (" + n + " + 1) * { let t = " + n + "; t - 2 };\n";
+        source += "fn f" + n + "(a: number, b: bool) -> number { if b && true { a - " + n + " } else { a / 2 } }\n";
+        source += "while v" + n + " { v" + n + " = v" + n + " - 1; };\n";
+    }
+    return source;
+}
+
+enum class CorpusShape {
+    Wide,
+    Deep,
+    OperatorChain,
+    FnHeavy,
+    BlockHeavy,
+};
+
+inline constexpr CorpusShape kCorpusShapes[] = {CorpusShape::Wide, CorpusShape::Deep, CorpusShape::OperatorChain,
+                                                 CorpusShape::FnHeavy, CorpusShape::BlockHeavy};
+
+inline std::string_view to_string(CorpusShape shape) {
+    switch (shape) {
+        case CorpusShape::Wide:
+            return "wide";
+        case CorpusShape::Deep:
+            return "deep";
+        case CorpusShape::OperatorChain:
+            return "chain";
+        case CorpusShape::FnHeavy:
+            return "fn";
+        case CorpusShape::BlockHeavy:
+            return "block";
+    }
+    return "unknown";
+}
+
+// A program of `items` units of one shape:
+//   Wide           one short let statement per unit
+//   Deep           one nesting level of alternating groupings and blocks per unit, 256 levels per statement
+//   OperatorChain  one operand of a mixed-precedence chain per unit, 256 operands per statement
+//   FnHeavy        one fn item with a nested function literal per unit
+//   BlockHeavy     one statement of nested blocks per unit
+inline std::string make_corpus(CorpusShape shape, std::size_t items) {
+    constexpr std::size_t kRun = 256;
+    std::string source;
+    switch (shape) {
+        case CorpusShape::Wide:
+            for (std::size_t i = 0; i < items; ++i) {
+                source += "let w" + std::to_string(i) + " = " + std::to_string(i) + ";\n";
+            }
+            break;
+        case CorpusShape::Deep:
+            for (std::size_t done = 0; done < items; done += kRun) {
+                const std::size_t depth = items - done < kRun ? items - done : kRun;
+                std::string suffix;
+                for (std::size_t level = 0; level < depth; ++level) {
+                    source += level % 2 == 0 ? "(" : "{ let d = ";
+                    suffix.insert(0, level % 2 == 0 ? " + 1)" : "; -d }");
+                }
+                source += "x" + suffix + ";\n";
+            }
+            break;
+        case CorpusShape::OperatorChain: {
+            const char* operators[] = {" + ", " * ", " - ", " / ", " && ", " || ", " | ", " & "};
+            for (std::size_t i = 0; i < items; ++i) {
+                source += "c" + std::to_string(i % 97);
+                source += (i + 1) % kRun == 0 || i + 1 == items ? ";\n" : operators[i % 8];
+            }
+            break;
+        }
+        case CorpusShape::FnHeavy:
+            for (std::size_t i = 0; i < items; ++i) {
+                const std::string n = std::to_string(i);
+                source += "fn f" + n + "(a: number, b: number, c: bool) -> number { let g = fn(x: number) -> number x * " +
+                          n + "; g }\n";
+            }
+            break;
+        case CorpusShape::BlockHeavy:
+            for (std::size_t i = 0; i < items; ++i) {
+                source += "{ let b = { " + std::to_string(i) + " }; { b; { b } } };\n";
+            }
+            break;
+    }
+    return source;
+}
+
+}  // namespace sonar::bench
@@ -0,0 +1,41 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+
+#include "corpus.hpp"
+#include "sonar/event_parser.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+
+namespace {
+
+struct CountingVisitor {
+    void enter(const sonar::ParseEvent&) { ++nodes; }
+
+    void leave(const sonar::ParseEvent&) {}
+
+    std::size_t nodes{0};
+};
+
+void BM_ParseTree(benchmark::State& state) {
+    const auto lexed = sonar::Lexer{}.tokenize(sonar::bench::make_program(static_cast<std::size_t>(state.range(0))));
+    for (auto _ : state) {
+        sonar::Parser parser(lexed.tokens, lexed.line_offsets, "<bench>");
+        benchmark::DoNotOptimize(parser.parse());
+    }
+}
+
+void BM_ParseEvents(benchmark::State& state) {
+    const auto lexed = sonar::Lexer{}.tokenize(sonar::bench::make_program(static_cast<std::size_t>(state.range(0))));
+    for (auto _ : state) {
+        sonar::EventParser parser(lexed.tokens, lexed.line_offsets, "<bench>");
+        CountingVisitor visitor;
+        parser.parse(visitor);
+        benchmark::DoNotOptimize(visitor.nodes);
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_ParseTree)->Arg(20000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ParseEvents)->Arg(20000)->Unit(benchmark::kMillisecond);
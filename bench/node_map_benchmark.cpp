@@ -0,0 +1,77 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "corpus.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/node_map.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/visitor.hpp"
+
+namespace {
+
+class Collector : public sonar::AstWalker<Collector> {
+   public:
+    std::vector<const sonar::Expression*> expressions;
+
+    template <typename Node>
+    void enter(const sonar::Expression& expression, const Node&) {
+        expressions.push_back(&expression);
+    }
+};
+
+struct Input {
+    sonar::ExpressionPtr ast;
+    std::vector<const sonar::Expression*> expressions;
+};
+
+Input make_input(std::size_t items) {
+    Input input;
+    auto lexed = sonar::Lexer{}.tokenize(sonar::bench::make_program(items));
+    input.ast = sonar::Parser(std::move(lexed.tokens), std::move(lexed.line_offsets), "<bench>").parse();
+    Collector collector;
+    collector.walk(*input.ast);
+    input.expressions = std::move(collector.expressions);
+    return input;
+}
+
+// One pass that records a value per node, then one that reads every value back: the access pattern of an
+// analysis that attaches results for a later pass.
+void BM_SideTableUnorderedMap(benchmark::State& state) {
+    const Input input = make_input(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        std::unordered_map<const sonar::Expression*, std::uint64_t> table;
+        for (const auto* expression : input.expressions) {
+            table[expression] = expression->span.start;
+        }
+        std::uint64_t sum = 0;
+        for (const auto* expression : input.expressions) {
+            sum += table.find(expression)->second;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(input.expressions.size()));
+}
+
+void BM_SideTableNodeMap(benchmark::State& state) {
+    const Input input = make_input(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        sonar::NodeMap<std::uint64_t> table(*input.ast);
+        for (const auto* expression : input.expressions) {
+            table[*expression] = expression->span.start;
+        }
+        std::uint64_t sum = 0;
+        for (const auto* expression : input.expressions) {
+            sum += *table.find(*expression);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(input.expressions.size()));
+}
+
+}  // namespace
+
+BENCHMARK(BM_SideTableUnorderedMap)->Arg(100)->Arg(10000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_SideTableNodeMap)->Arg(100)->Arg(10000)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,70 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <thread>
+
+#include "corpus.hpp"
+#include "sonar/ast_stats.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/thread_pool.hpp"
+
+namespace {
+
+const sonar::LexResult& corpus() {
+    static const sonar::LexResult lexed = sonar::Lexer{}.tokenize(sonar::bench::make_program(20000));
+    return lexed;
+}
+
+void thread_counts(benchmark::internal::Benchmark* benchmark) {
+    const int max_threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        benchmark->Arg(threads);
+    }
+    if ((max_threads & (max_threads - 1)) != 0) {
+        benchmark->Arg(max_threads);
+    }
+}
+
+void BM_ParseSequential(benchmark::State& state) {
+    const auto& lexed = corpus();
+    for (auto _ : state) {
+        state.PauseTiming();
+        sonar::Parser parser(lexed.tokens, lexed.line_offsets, "<bench>");
+        state.ResumeTiming();
+
+        auto ast = parser.parse();
+        benchmark::DoNotOptimize(ast.get());
+
+        state.PauseTiming();
+        state.counters["bytes/node"] = sonar::collect_ast_stats(*ast).bytes_per_node();
+        ast.reset();
+        state.ResumeTiming();
+    }
+    state.counters["tokens/s"] = benchmark::Counter(static_cast<double>(lexed.tokens.size()) * static_cast<double>(state.iterations()),
+                                                    benchmark::Counter::kIsRate);
+}
+
+void BM_ParseParallel(benchmark::State& state) {
+    const auto& lexed = corpus();
+    sonar::ThreadPool pool(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        state.PauseTiming();
+        sonar::Parser parser(lexed.tokens, lexed.line_offsets, "<bench>");
+        state.ResumeTiming();
+
+        auto ast = parser.parse_parallel(pool);
+        benchmark::DoNotOptimize(ast.get());
+
+        state.PauseTiming();
+        ast.reset();
+        state.ResumeTiming();
+    }
+    state.counters["tokens/s"] = benchmark::Counter(static_cast<double>(lexed.tokens.size()) * static_cast<double>(state.iterations()),
+                                                    benchmark::Counter::kIsRate);
+}
+
+}  // namespace
+
+BENCHMARK(BM_ParseSequential)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ParseParallel)->Apply(thread_counts)->ArgName("threads")->UseRealTime()->Unit(benchmark::kMillisecond);
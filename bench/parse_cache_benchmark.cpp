@@ -0,0 +1,30 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "corpus.hpp"
+#include "sonar/parse_cache.hpp"
+
+namespace {
+
+void BM_ParseCacheMiss(benchmark::State& state) {
+    const std::string source = sonar::bench::make_program(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        sonar::ParseCache cache;
+        benchmark::DoNotOptimize(cache.parse(source, "<bench>"));
+    }
+}
+
+void BM_ParseCacheHit(benchmark::State& state) {
+    const std::string source = sonar::bench::make_program(static_cast<std::size_t>(state.range(0)));
+    sonar::ParseCache cache;
+    cache.parse(source, "<bench>");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.parse(source, "<bench>"));
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_ParseCacheMiss)->Arg(10)->Arg(1000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ParseCacheHit)->Arg(10)->Arg(1000)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,186 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <memory_resource>
+#include <string>
+
+#include "allocation_counter.hpp"
+#include "corpus.hpp"
+#include "sonar/ast_stats.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/pretty_printer.hpp"
+
+// Parser::parse and pretty_print over each corpus shape. Besides time, every case reports
+//   ns/token      time per lexed token
+//   nodes/s       expressions and statements produced or printed per second
+//   allocs/node   heap allocations per node, from the counting operator new
+//   bytes/node    heap bytes requested per node
+//   peak_rss_MiB  peak resident set of the whole process so far
+// BM_ParseMonotonic parses into a std::pmr::monotonic_buffer_resource, so its allocs/node counts only what
+// still comes from the global heap: block statement lists, and names and literals longer than the small-string
+// buffer. BM_Lex and BM_LexMonotonic lex the same corpora; their node counts are those of the parsed tree.
+// Run with --benchmark_out=FILE --benchmark_out_format=json (or build the bench_json target) to keep results
+// for comparison between commits.
+
+namespace {
+
+using sonar::bench::CorpusShape;
+
+struct Corpus {
+    std::string source;
+    sonar::LexResult lexed;
+    sonar::ExpressionPtr ast;
+    std::size_t nodes{0};
+};
+
+// Sized so that every shape lexes to roughly 100k tokens.
+std::size_t corpus_items(CorpusShape shape) {
+    switch (shape) {
+        case CorpusShape::Wide:
+            return 20000;
+        case CorpusShape::Deep:
+            return 16000;
+        case CorpusShape::OperatorChain:
+            return 50000;
+        case CorpusShape::FnHeavy:
+            return 3000;
+        case CorpusShape::BlockHeavy:
+            return 6000;
+    }
+    return 0;
+}
+
+const Corpus& corpus(CorpusShape shape) {
+    static std::map<CorpusShape, Corpus> corpora;
+    auto [it, inserted] = corpora.try_emplace(shape);
+    if (inserted) {
+        Corpus& corpus = it->second;
+        corpus.source = sonar::bench::make_corpus(shape, corpus_items(shape));
+        corpus.lexed = sonar::Lexer{}.tokenize(corpus.source);
+        corpus.ast = sonar::Parser(corpus.lexed.tokens, corpus.lexed.line_offsets, "<bench>").parse();
+        corpus.nodes = sonar::collect_ast_stats(*corpus.ast).nodes();
+    }
+    return it->second;
+}
+
+// Times `body` manually so per-iteration setup stays out of both the timings and the allocation counts.
+struct Measurement {
+    double seconds{0.0};
+    sonar::bench::AllocationCounts allocated{};
+
+    template <typename Body>
+    void run(benchmark::State& state, Body&& body) {
+        const auto before = sonar::bench::allocation_counts();
+        const auto start = std::chrono::steady_clock::now();
+        body();
+        const auto stop = std::chrono::steady_clock::now();
+        const auto after = sonar::bench::allocation_counts();
+
+        const double elapsed = std::chrono::duration<double>(stop - start).count();
+        state.SetIterationTime(elapsed);
+        seconds += elapsed;
+        allocated.allocations += after.allocations - before.allocations;
+        allocated.bytes += after.bytes - before.bytes;
+    }
+
+    void report(benchmark::State& state, const Corpus& corpus) const {
+        const auto iterations = static_cast<double>(state.iterations());
+        const auto tokens = static_cast<double>(corpus.lexed.tokens.size()) * iterations;
+        const auto nodes = static_cast<double>(corpus.nodes) * iterations;
+        state.counters["ns/token"] = seconds * 1e9 / tokens;
+        state.counters["nodes/s"] = nodes / seconds;
+        state.counters["allocs/node"] = static_cast<double>(allocated.allocations) / nodes;
+        state.counters["bytes/node"] = static_cast<double>(allocated.bytes) / nodes;
+        state.counters["peak_rss_MiB"] = static_cast<double>(sonar::bench::peak_rss_bytes()) / (1024.0 * 1024.0);
+    }
+};
+
+void BM_Parse(benchmark::State& state, CorpusShape shape) {
+    const Corpus& input = corpus(shape);
+    Measurement measurement;
+    for (auto _ : state) {
+        sonar::Parser parser(input.lexed.tokens, input.lexed.line_offsets, "<bench>");
+        sonar::ExpressionPtr ast;
+        measurement.run(state, [&]() { ast = parser.parse(); });
+        benchmark::DoNotOptimize(ast.get());
+    }
+    measurement.report(state, input);
+}
+
+void BM_ParseMonotonic(benchmark::State& state, CorpusShape shape) {
+    const Corpus& input = corpus(shape);
+    Measurement measurement;
+    for (auto _ : state) {
+        std::pmr::monotonic_buffer_resource buffer;
+        sonar::ParserOptions options;
+        options.memory_resource = &buffer;
+        sonar::Parser parser(input.lexed.tokens, input.lexed.line_offsets, "<bench>", options);
+        sonar::ExpressionPtr ast;
+        measurement.run(state, [&]() { ast = parser.parse(); });
+        benchmark::DoNotOptimize(ast.get());
+        ast.reset();
+    }
+    measurement.report(state, input);
+}
+
+void BM_Lex(benchmark::State& state, CorpusShape shape) {
+    const Corpus& input = corpus(shape);
+    Measurement measurement;
+    for (auto _ : state) {
+        sonar::LexResult lexed;
+        measurement.run(state, [&]() { lexed = sonar::Lexer{}.tokenize(input.source); });
+        benchmark::DoNotOptimize(lexed.tokens.data());
+    }
+    measurement.report(state, input);
+}
+
+void BM_LexMonotonic(benchmark::State& state, CorpusShape shape) {
+    const Corpus& input = corpus(shape);
+    Measurement measurement;
+    for (auto _ : state) {
+        std::pmr::monotonic_buffer_resource buffer;
+        measurement.run(state, [&]() {
+            auto lexed = sonar::Lexer{}.tokenize(input.source, &buffer);
+            benchmark::DoNotOptimize(lexed.tokens.data());
+        });
+    }
+    measurement.report(state, input);
+}
+
+void BM_PrettyPrint(benchmark::State& state, CorpusShape shape) {
+    const Corpus& input = corpus(shape);
+    Measurement measurement;
+    for (auto _ : state) {
+        std::string printed;
+        measurement.run(state, [&]() { printed = sonar::pretty_print(*input.ast); });
+        benchmark::DoNotOptimize(printed.data());
+    }
+    measurement.report(state, input);
+}
+
+[[maybe_unused]] const bool registered = [] {
+    for (const CorpusShape shape : sonar::bench::kCorpusShapes) {
+        const std::string suffix = "/" + std::string(sonar::bench::to_string(shape));
+        benchmark::RegisterBenchmark(("BM_Parse" + suffix).c_str(), BM_Parse, shape)
+            ->UseManualTime()
+            ->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("BM_ParseMonotonic" + suffix).c_str(), BM_ParseMonotonic, shape)
+            ->UseManualTime()
+            ->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("BM_Lex" + suffix).c_str(), BM_Lex, shape)
+            ->UseManualTime()
+            ->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("BM_LexMonotonic" + suffix).c_str(), BM_LexMonotonic, shape)
+            ->UseManualTime()
+            ->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("BM_PrettyPrint" + suffix).c_str(), BM_PrettyPrint, shape)
+            ->UseManualTime()
+            ->Unit(benchmark::kMillisecond);
+    }
+    return true;
+}();
+
+}  // namespace
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <string>
+
+#include "sonar/perf_counters.hpp"
+
+namespace sonar::bench {
+
+// Hardware counters for benchmarks on the calling thread, opened once.
+inline PerfCounters& perf_counters() {
+    thread_local PerfCounters counters;
+    return counters;
+}
+
+// Adds IPC and instructions and misses per token over all iterations to the counters of `state`. Events the
+// machine cannot count are left out, so the columns simply do not appear there.
+inline void report_perf(benchmark::State& state, const PerfReading& reading, std::size_t tokens_per_iteration) {
+    const double tokens = static_cast<double>(tokens_per_iteration) * static_cast<double>(state.iterations());
+    if (const auto ipc = reading.ipc()) {
+        state.counters["IPC"] = *ipc;
+    }
+    const PerfEvent per_token[] = {PerfEvent::Instructions, PerfEvent::BranchMisses, PerfEvent::L1dMisses,
+                                   PerfEvent::LlcMisses};
+    for (const PerfEvent event : per_token) {
+        if (const auto value = reading.per(event, tokens)) {
+            state.counters[std::string(to_string(event)) + "/token"] = *value;
+        }
+    }
+}
+
+}  // namespace sonar::bench
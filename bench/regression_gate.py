@@ -0,0 +1,268 @@
+#!/usr/bin/env python3
+"""Benchmark regression gate for lex, parse and print throughput.
+
+Runs the generated-program benchmarks in sonar_benchmarks with repetitions, stores the per-repetition
+throughput as DIR/<commit>.json, and compares it with a baseline result. A benchmark regresses when its
+median throughput dropped by more than --threshold and a one-sided Mann-Whitney U test over the repetitions
+says the drop is significant at --alpha; either alone is noise. Needs only the standard library.
+
+    regression_gate.py run --benchmark BIN --results-dir DIR        record the current commit
+    regression_gate.py compare BASELINE CANDIDATE                    compare two results (commits or paths)
+    regression_gate.py gate --benchmark BIN --results-dir DIR        record, then compare with the baseline
+
+Exits with 1 on a regression and 2 on a usage or benchmark error.
+"""
+
+import argparse
+import datetime
+import json
+import math
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+
+# Benchmark name prefix -> phase reported by the gate.
+PHASES = {
+    "BM_LexGenerated": "lex",
+    "BM_ParseGenerated": "parse",
+    "BM_PrintGenerated": "print",
+}
+DEFAULT_SIZE = 262144
+
+
+class GateError(Exception):
+    pass
+
+
+def git(source_dir, *args):
+    try:
+        return subprocess.run(["git", *args], cwd=source_dir, check=True, capture_output=True,
+                              text=True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def current_commit(source_dir):
+    commit = git(source_dir, "rev-parse", "HEAD")
+    if commit is None:
+        return "unknown"
+    if git(source_dir, "status", "--porcelain", "--untracked-files=no"):
+        commit += "-dirty"
+    return commit
+
+
+def run_benchmarks(binary, repetitions, size):
+    pattern = "^(" + "|".join(PHASES) + ")/" + str(size) + "$"
+    with tempfile.TemporaryDirectory() as scratch:
+        out = os.path.join(scratch, "results.json")
+        command = [binary, "--benchmark_filter=" + pattern, "--benchmark_repetitions=" + str(repetitions),
+                   "--benchmark_enable_random_interleaving=true", "--benchmark_out=" + out,
+                   "--benchmark_out_format=json"]
+        print("regression_gate: " + " ".join(command), file=sys.stderr)
+        if subprocess.run(command, stdout=sys.stderr).returncode != 0:
+            raise GateError(binary + " failed")
+        with open(out) as f:
+            report = json.load(f)
+
+    samples = {}
+    for entry in report["benchmarks"]:
+        if entry.get("run_type") != "iteration" or "bytes_per_second" not in entry:
+            continue
+        phase = PHASES.get(entry["name"].split("/")[0])
+        if phase is not None:
+            samples.setdefault(phase, []).append(entry["bytes_per_second"])
+    missing = sorted(set(PHASES.values()) - set(samples))
+    if missing:
+        raise GateError("no samples for " + ", ".join(missing) + "; is " + binary + " up to date?")
+    return report.get("context", {}), samples
+
+
+def record(args):
+    context, samples = run_benchmarks(args.benchmark, args.repetitions, args.size)
+    commit = current_commit(args.source_dir)
+    result = {
+        "commit": commit,
+        "recorded": datetime.datetime.now(datetime.timezone.utc).isoformat(),
+        "size": args.size,
+        "context": context,
+        "bytes_per_second": samples,
+    }
+    os.makedirs(args.results_dir, exist_ok=True)
+    path = os.path.join(args.results_dir, commit + ".json")
+    with open(path, "w") as f:
+        json.dump(result, f, indent=2)
+    print("regression_gate: recorded " + path, file=sys.stderr)
+    return result
+
+
+def load(reference, results_dir, source_dir):
+    if os.path.isfile(reference):
+        path = reference
+    else:
+        commit = git(source_dir, "rev-parse", reference) or reference
+        path = os.path.join(results_dir or ".", commit + ".json")
+        if not os.path.isfile(path):
+            raise GateError("no stored result for " + reference + " (looked for " + path + ")")
+    with open(path) as f:
+        return json.load(f)
+
+
+def newest_other(results_dir, commit):
+    """The most recently recorded result of another commit, or None."""
+    best = None
+    for name in os.listdir(results_dir) if os.path.isdir(results_dir) else []:
+        if not name.endswith(".json"):
+            continue
+        with open(os.path.join(results_dir, name)) as f:
+            result = json.load(f)
+        if result.get("commit") == commit:
+            continue
+        if best is None or result.get("recorded", "") > best.get("recorded", ""):
+            best = result
+    return best
+
+
+def ranks(values):
+    """Ranks starting at 1, with tied values sharing their mean rank, and the sizes of the tie groups."""
+    order = sorted(range(len(values)), key=lambda i: values[i])
+    result = [0.0] * len(values)
+    ties = []
+    start = 0
+    while start < len(order):
+        end = start
+        while end + 1 < len(order) and values[order[end + 1]] == values[order[start]]:
+            end += 1
+        for k in range(start, end + 1):
+            result[order[k]] = (start + end) / 2 + 1
+        ties.append(end - start + 1)
+        start = end + 1
+    return result, ties
+
+
+def exact_lower_tail(u, n, m):
+    """P(U <= u) for the Mann-Whitney statistic of samples of n and m distinct values under the null."""
+    # counts[i][j][k]: orderings of i values from the first sample and j from the second with U = k.
+    counts = [[None] * (m + 1) for _ in range(n + 1)]
+    for i in range(n + 1):
+        for j in range(m + 1):
+            if i == 0 or j == 0:
+                counts[i][j] = [1]
+                continue
+            # The largest value belongs to the first sample, beating all j others, or to the second.
+            first, second = counts[i - 1][j], counts[i][j - 1]
+            row = [0] * (i * j + 1)
+            for k, c in enumerate(first):
+                row[k + j] += c
+            for k, c in enumerate(second):
+                row[k] += c
+            counts[i][j] = row
+    total = math.comb(n + m, n)
+    return sum(counts[n][m][: int(math.floor(u)) + 1]) / total
+
+
+def mann_whitney_less(candidate, baseline):
+    """One-sided p-value for candidate samples being stochastically smaller than baseline samples."""
+    n, m = len(candidate), len(baseline)
+    if n == 0 or m == 0:
+        return 1.0
+    combined_ranks, ties = ranks(list(candidate) + list(baseline))
+    u = sum(combined_ranks[:n]) - n * (n + 1) / 2
+    if all(t == 1 for t in ties) and n + m <= 40:
+        return exact_lower_tail(u, n, m)
+    total = n + m
+    tie_term = sum(t ** 3 - t for t in ties) / (total * (total - 1))
+    variance = n * m / 12 * ((total + 1) - tie_term)
+    if variance == 0:
+        return 1.0
+    z = (u - n * m / 2 + 0.5) / math.sqrt(variance)
+    return 0.5 * math.erfc(-z / math.sqrt(2))
+
+
+def compare(baseline, candidate, threshold, alpha):
+    """Prints a comparison table and returns the phases that regressed."""
+    print("baseline  " + baseline.get("commit", "?"))
+    print("candidate " + candidate.get("commit", "?"))
+    print(f"{'phase':<8}{'baseline MB/s':>15}{'candidate MB/s':>16}{'change':>9}{'p':>9}  verdict")
+    regressions = []
+    for phase in sorted(set(PHASES.values())):
+        before = baseline["bytes_per_second"].get(phase, [])
+        after = candidate["bytes_per_second"].get(phase, [])
+        if not before or not after:
+            print(f"{phase:<8}{'':>15}{'':>16}{'':>9}{'':>9}  missing samples")
+            continue
+        before_median, after_median = statistics.median(before), statistics.median(after)
+        change = after_median / before_median - 1
+        p_slower = mann_whitney_less(after, before)
+        p_faster = mann_whitney_less(before, after)
+        if change < -threshold and p_slower < alpha:
+            verdict = "REGRESSION"
+            regressions.append(phase)
+        elif change > threshold and p_faster < alpha:
+            verdict = "improvement"
+        else:
+            verdict = "ok"
+        p = p_slower if change < 0 else p_faster
+        print(f"{phase:<8}{before_median / 1e6:>15.2f}{after_median / 1e6:>16.2f}{change:>+9.1%}{p:>9.4f}  {verdict}")
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--source-dir", default=os.path.dirname(os.path.dirname(os.path.abspath(__file__))),
+                        help="git checkout whose HEAD names recorded results")
+    parser.add_argument("--threshold", type=float, default=0.05,
+                        help="smallest drop in median throughput that counts, as a fraction (default 0.05)")
+    parser.add_argument("--alpha", type=float, default=0.01,
+                        help="significance level of the Mann-Whitney test (default 0.01)")
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    for name in ("run", "gate"):
+        command = commands.add_parser(name)
+        command.add_argument("--benchmark", required=True, help="path to sonar_benchmarks")
+        command.add_argument("--results-dir", required=True, help="where results are stored by commit")
+        command.add_argument("--repetitions", type=int, default=10,
+                             help="samples per benchmark; the exact test needs 5 or more to reach 0.01")
+        command.add_argument("--size", type=int, default=DEFAULT_SIZE, help="generated program size in bytes")
+        if name == "gate":
+            command.add_argument("--baseline",
+                                 help="commit, ref or result file to compare with (default: the most recently "
+                                      "recorded other commit)")
+
+    command = commands.add_parser("compare")
+    command.add_argument("baseline", help="commit, ref or result file")
+    command.add_argument("candidate", help="commit, ref or result file")
+    command.add_argument("--results-dir", help="where results are stored by commit")
+
+    args = parser.parse_args()
+    try:
+        if args.command == "run":
+            record(args)
+            return 0
+        if args.command == "compare":
+            baseline = load(args.baseline, args.results_dir, args.source_dir)
+            candidate = load(args.candidate, args.results_dir, args.source_dir)
+        else:
+            candidate = record(args)
+            if args.baseline:
+                baseline = load(args.baseline, args.results_dir, args.source_dir)
+            else:
+                baseline = newest_other(args.results_dir, candidate["commit"])
+                if baseline is None:
+                    print("regression_gate: no baseline recorded yet; this run is the first", file=sys.stderr)
+                    return 0
+        if baseline.get("size") != candidate.get("size"):
+            raise GateError("baseline and candidate measured different program sizes")
+        regressions = compare(baseline, candidate, args.threshold, args.alpha)
+    except GateError as error:
+        print("regression_gate: error: " + str(error), file=sys.stderr)
+        return 2
+    if regressions:
+        print("regression_gate: " + ", ".join(regressions) + " throughput regressed", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
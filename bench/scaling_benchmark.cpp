@@ -0,0 +1,97 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "perf_report.hpp"
+#include "sonar/event_parser.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/pretty_printer.hpp"
+#include "sonar/program_generator.hpp"
+
+// Lexing, parsing and printing generated programs from 1 KiB to 64 MiB, with the default GeneratorOptions and a fixed
+// seed, so bytes/s should stay flat across sizes until the tree no longer fits in cache. Larger inputs, up
+// to gigabytes, are written with sonar-gen and timed through the sonar binary. The lex, parse and print
+// cases also report IPC and instructions, branch misses and cache misses per token where the machine has
+// hardware counters, to tell whether a change saved instructions or improved locality.
+
+namespace {
+
+const std::string& program(std::size_t bytes) {
+    static std::map<std::size_t, std::string> programs;
+    auto [it, inserted] = programs.try_emplace(bytes);
+    if (inserted) {
+        sonar::GeneratorOptions options;
+        options.target_bytes = bytes;
+        it->second = sonar::generate_program(options);
+    }
+    return it->second;
+}
+
+struct CountingVisitor {
+    void enter(const sonar::ParseEvent&) { ++nodes; }
+
+    void leave(const sonar::ParseEvent&) {}
+
+    std::size_t nodes{0};
+};
+
+void BM_LexGenerated(benchmark::State& state) {
+    const std::string& source = program(static_cast<std::size_t>(state.range(0)));
+    const std::size_t tokens = sonar::Lexer{}.tokenize(source).tokens.size();
+    auto& counters = sonar::bench::perf_counters();
+    counters.start();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sonar::Lexer{}.tokenize(source));
+    }
+    sonar::bench::report_perf(state, counters.stop(), tokens);
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) * static_cast<std::int64_t>(source.size()));
+}
+
+void BM_ParseGenerated(benchmark::State& state) {
+    const std::string& source = program(static_cast<std::size_t>(state.range(0)));
+    const auto lexed = sonar::Lexer{}.tokenize(source);
+    auto& counters = sonar::bench::perf_counters();
+    counters.start();
+    for (auto _ : state) {
+        sonar::Parser parser(lexed.tokens, lexed.line_offsets, "<bench>");
+        benchmark::DoNotOptimize(parser.parse());
+    }
+    sonar::bench::report_perf(state, counters.stop(), lexed.tokens.size());
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) * static_cast<std::int64_t>(source.size()));
+}
+
+void BM_ParseEventsGenerated(benchmark::State& state) {
+    const std::string& source = program(static_cast<std::size_t>(state.range(0)));
+    const auto lexed = sonar::Lexer{}.tokenize(source);
+    for (auto _ : state) {
+        sonar::EventParser parser(lexed.tokens, lexed.line_offsets, "<bench>");
+        CountingVisitor visitor;
+        parser.parse(visitor);
+        benchmark::DoNotOptimize(visitor.nodes);
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) * static_cast<std::int64_t>(source.size()));
+}
+
+void BM_PrintGenerated(benchmark::State& state) {
+    const std::string& source = program(static_cast<std::size_t>(state.range(0)));
+    const auto lexed = sonar::Lexer{}.tokenize(source);
+    const auto ast = sonar::Parser(lexed.tokens, lexed.line_offsets, "<bench>").parse();
+    auto& counters = sonar::bench::perf_counters();
+    counters.start();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sonar::pretty_print(*ast));
+    }
+    sonar::bench::report_perf(state, counters.stop(), lexed.tokens.size());
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) * static_cast<std::int64_t>(source.size()));
+}
+
+}  // namespace
+
+BENCHMARK(BM_LexGenerated)->RangeMultiplier(8)->Range(1 << 10, 1 << 26)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ParseGenerated)->RangeMultiplier(8)->Range(1 << 10, 1 << 26)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ParseEventsGenerated)->RangeMultiplier(8)->Range(1 << 10, 1 << 26)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_PrintGenerated)->RangeMultiplier(8)->Range(1 << 10, 1 << 26)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "corpus.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/span_index.hpp"
+#include "sonar/visitor.hpp"
+
+namespace {
+
+struct Input {
+    std::string source;
+    sonar::ExpressionPtr ast;
+    std::vector<std::size_t> offsets;
+};
+
+Input make_input(std::size_t items) {
+    Input input;
+    input.source = sonar::bench::make_program(items);
+    auto lexed = sonar::Lexer{}.tokenize(input.source);
+    input.ast = sonar::Parser(std::move(lexed.tokens), std::move(lexed.line_offsets), "<bench>").parse();
+    std::mt19937 random(42);
+    std::uniform_int_distribution<std::size_t> offset(0, input.source.size() - 1);
+    for (int i = 0; i < 1024; ++i) {
+        input.offsets.push_back(offset(random));
+    }
+    return input;
+}
+
+// What a position query costs without an index: descend from the root, scanning each node's children. Child
+// spans count from their parent's start, so the descent carries it along.
+const void* innermost_by_descent(const sonar::Expression& root, std::size_t offset) {
+    const void* found = nullptr;
+    auto descend = [offset, &found](const auto& wrapper, std::size_t start, const auto& self) -> void {
+        found = &wrapper;
+        std::visit(
+            [&](const auto& node) {
+                sonar::for_each_child(node, [&](const auto& child) {
+                    const sonar::SourceSpan span = child.span.offset_by(start);
+                    if (span.start <= offset && offset < span.end) {
+                        self(child, span.start, self);
+                        return false;
+                    }
+                    return true;
+                });
+            },
+            wrapper.node);
+    };
+    if (root.span.start <= offset && offset < root.span.end) {
+        descend(root, root.span.start, descend);
+    }
+    return found;
+}
+
+void BM_InnermostByDescent(benchmark::State& state) {
+    const Input input = make_input(static_cast<std::size_t>(state.range(0)));
+    std::size_t query = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(innermost_by_descent(*input.ast, input.offsets[query++ % input.offsets.size()]));
+    }
+}
+
+void BM_SpanIndexInnermost(benchmark::State& state) {
+    const Input input = make_input(static_cast<std::size_t>(state.range(0)));
+    sonar::SpanIndex index(*input.ast);
+    index.size();
+    std::size_t query = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index.innermost_at(input.offsets[query++ % input.offsets.size()]));
+    }
+}
+
+void BM_SpanIndexBuild(benchmark::State& state) {
+    const Input input = make_input(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        sonar::SpanIndex index(*input.ast);
+        benchmark::DoNotOptimize(index.size());
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_InnermostByDescent)->Arg(100)->Arg(10000);
+BENCHMARK(BM_SpanIndexInnermost)->Arg(100)->Arg(10000);
+BENCHMARK(BM_SpanIndexBuild)->Arg(100)->Arg(10000)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,55 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <utility>
+
+#include "corpus.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/structural_hash.hpp"
+
+namespace {
+
+sonar::ExpressionPtr parse(const sonar::LexResult& lexed) {
+    sonar::Parser parser(lexed.tokens, lexed.line_offsets, "<bench>");
+    return parser.parse();
+}
+
+// Hashing a freshly parsed tree visits every node.
+void BM_StructuralHashCold(benchmark::State& state) {
+    const auto lexed = sonar::Lexer{}.tokenize(sonar::bench::make_program(static_cast<std::size_t>(state.range(0))));
+    sonar::ExpressionPtr ast;
+    for (auto _ : state) {
+        state.PauseTiming();
+        ast = parse(lexed);
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(sonar::structural_hash(*ast));
+    }
+}
+
+// Rehashing after a one-character edit inside a block only hashes the nodes reparse replaced or invalidated,
+// plus one cached lookup per child of each node on the path to the edit.
+void BM_StructuralHashAfterEdit(benchmark::State& state) {
+    std::string source = sonar::bench::make_program(static_cast<std::size_t>(state.range(0)));
+    const std::size_t at = source.find("t - 2", source.size() / 2) + 4;
+    sonar::Lexer lexer;
+    auto lexed = lexer.tokenize(source);
+    auto ast = parse(lexed);
+    sonar::StructuralHashCache hashes;
+    hashes.hash(*ast);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        const sonar::TextEdit edit{sonar::SourceSpan{at, at + 1}, source[at] == '2' ? "3" : "2"};
+        source[at] = edit.replacement.front();
+        lexer.retokenize(lexed, source, edit);
+        ast = sonar::Parser::reparse(std::move(ast), lexed, edit, "<bench>", {}, &hashes);
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(hashes.hash(*ast));
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_StructuralHashCold)->Arg(100)->Arg(10000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_StructuralHashAfterEdit)->Arg(100)->Arg(10000)->Unit(benchmark::kMicrosecond);
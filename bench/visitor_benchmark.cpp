@@ -0,0 +1,123 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <variant>
+
+#include "corpus.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/visitor.hpp"
+
+namespace {
+
+const sonar::Expression& corpus() {
+    static const auto ast = [] {
+        auto lexed = sonar::Lexer{}.tokenize(sonar::bench::make_program(20000));
+        return sonar::Parser(std::move(lexed.tokens), std::move(lexed.line_offsets), "<bench>").parse();
+    }();
+    return *ast;
+}
+
+// The same pass written both ways: the number of nodes plus the length of every name. The hand-written one
+// recurses the way Printer and StatementPrinter in pretty_printer.cpp do.
+std::size_t count(const sonar::Expression& expression);
+std::size_t count(const sonar::Statement& statement);
+
+std::size_t count_child(const sonar::ExpressionPtr& child) {
+    return child ? count(*child) : 0;
+}
+
+struct HandWrittenCounter {
+    std::size_t operator()(const sonar::Expression::Number&) const { return 1; }
+
+    std::size_t operator()(const sonar::Expression::Boolean&) const { return 1; }
+
+    std::size_t operator()(const sonar::Expression::String&) const { return 1; }
+
+    std::size_t operator()(const sonar::Expression::Unit&) const { return 1; }
+
+    std::size_t operator()(const sonar::Expression::Variable& variable) const { return 1 + variable.name.size(); }
+
+    std::size_t operator()(const sonar::Expression::Prefix& prefix) const { return 1 + count(*prefix.right); }
+
+    std::size_t operator()(const sonar::Expression::Infix& infix) const {
+        return 1 + count(*infix.left) + count(*infix.right);
+    }
+
+    std::size_t operator()(const sonar::Expression::Grouping& grouping) const { return 1 + count(*grouping.expression); }
+
+    std::size_t operator()(const sonar::Expression::Assign& assign) const {
+        return 1 + count(*assign.target) + count(*assign.value);
+    }
+
+    std::size_t operator()(const sonar::Expression::Block& block) const {
+        std::size_t total = 1;
+        for (const auto& statement : block.statements) {
+            total += count(*statement);
+        }
+        return total + count_child(block.value);
+    }
+
+    std::size_t operator()(const sonar::Expression::If& if_expr) const {
+        return 1 + count(*if_expr.condition) + count(*if_expr.then) + count_child(if_expr.else_branch);
+    }
+
+    std::size_t operator()(const sonar::Expression::While& while_expr) const {
+        return 1 + count(*while_expr.condition) + count(*while_expr.body);
+    }
+
+    std::size_t operator()(const sonar::Expression::For& for_expr) const {
+        return 1 + count(*for_expr.pattern) + count(*for_expr.iterable) + count(*for_expr.body);
+    }
+
+    std::size_t operator()(const sonar::Expression::Function& function) const {
+        return 1 + count(function.body_expression());
+    }
+
+    std::size_t operator()(const sonar::Statement::Let& let) const { return 1 + let.name.size() + count(*let.initializer); }
+
+    std::size_t operator()(const sonar::Statement::Expression& statement) const { return 1 + count(*statement.expression); }
+};
+
+std::size_t count(const sonar::Expression& expression) {
+    return std::visit(HandWrittenCounter{}, expression.node);
+}
+
+std::size_t count(const sonar::Statement& statement) {
+    return std::visit(HandWrittenCounter{}, statement.node);
+}
+
+class WalkerCounter : public sonar::AstWalker<WalkerCounter> {
+   public:
+    template <typename Wrapper, typename Node>
+    void enter(const Wrapper&, const Node&) {
+        ++total;
+    }
+
+    void enter(const sonar::Expression&, const sonar::Expression::Variable& variable) { total += 1 + variable.name.size(); }
+
+    void enter(const sonar::Statement&, const sonar::Statement::Let& let) { total += 1 + let.name.size(); }
+
+    std::size_t total{0};
+};
+
+void BM_HandWrittenVisit(benchmark::State& state) {
+    const auto& ast = corpus();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(count(ast));
+    }
+}
+
+void BM_AstWalker(benchmark::State& state) {
+    const auto& ast = corpus();
+    for (auto _ : state) {
+        WalkerCounter counter;
+        counter.walk(ast);
+        benchmark::DoNotOptimize(counter.total);
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_HandWrittenVisit)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_AstWalker)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,45 @@
+// libFuzzer target for the lexer, parser and pretty printer. Besides crashes and sanitizer reports it
+// aborts on an input that costs more than LinearBudget allows, or whose event printing disagrees with the
+// printed tree, so libFuzzer saves it as a crash artifact. Minimised findings belong in fuzz/corpus, which
+// sonar_tests replays against the same checks.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#include "pipeline.hpp"
+
+namespace {
+
+const sonar::fuzz::LinearBudget* budget = nullptr;
+
+[[noreturn]] void fail(const char* what, const std::string& detail) {
+    std::fprintf(stderr, "==sonar fuzz== %s: %s\n", what, detail.c_str());
+    std::abort();
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerInitialize(int*, char***) {
+    budget = new sonar::fuzz::LinearBudget();
+    std::fprintf(stderr, "==sonar fuzz== calibrated at %.1f ns/byte\n", budget->ns_per_byte());
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size) {
+    const std::string_view source(reinterpret_cast<const char*>(data), size);
+    const auto run = sonar::fuzz::run_pipeline(source);
+
+    const std::string verdict = budget->check(source, run);
+    if (!verdict.empty()) {
+        fail("super-linear input", verdict);
+    }
+    const std::string events = sonar::fuzz::print_events(source);
+    if (events != run.output) {
+        fail("event printer disagrees", "tree printed \"" + run.output + "\", events printed \"" + events + "\"");
+    }
+    return 0;
+}
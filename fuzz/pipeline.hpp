@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "sonar/event_parser.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/pretty_printer.hpp"
+
+namespace sonar::fuzz {
+
+// What running one input through the front end produced and cost.
+struct PipelineRun {
+    // The printed tree, or the message of the lexer or parser error the input was rejected with.
+    std::string output;
+    bool rejected{false};
+    std::chrono::nanoseconds elapsed{};
+};
+
+// Lexes, parses and pretty-prints `source`, destroying the tree before the clock stops. Lexer and parser
+// errors are ordinary outcomes; any other exception escapes.
+inline PipelineRun run_pipeline(std::string_view source) {
+    PipelineRun run;
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        auto lexed = Lexer{}.tokenize(source);
+        auto ast = Parser(std::move(lexed.tokens), std::move(lexed.line_offsets), "<fuzz>").parse();
+        run.output = pretty_print(*ast);
+    } catch (const std::runtime_error& error) {
+        run.output = error.what();
+        run.rejected = true;
+    }
+    run.elapsed = std::chrono::steady_clock::now() - start;
+    return run;
+}
+
+// The same input printed from parse events, which must match the printed tree exactly.
+inline std::string print_events(std::string_view source) {
+    try {
+        const auto lexed = Lexer{}.tokenize(source);
+        EventParser parser(lexed.tokens, lexed.line_offsets, "<fuzz>");
+        return pretty_print_events(parser);
+    } catch (const std::runtime_error& error) {
+        return error.what();
+    }
+}
+
+// Decides whether an input cost more than a linear function of its length. The slope is measured on
+// straight-line code in the running build, so the budget holds with sanitizers and without optimisation;
+// the constant term absorbs timer noise and per-parse setup on short inputs.
+class LinearBudget {
+   public:
+    // Any input may take this many times longer per byte than the calibration program.
+    static constexpr double kSlopeFactor = 25.0;
+    static constexpr std::chrono::nanoseconds kSlack = std::chrono::milliseconds(2);
+    // The printed tree is never more than this many bytes per input byte, plus "(unit)".
+    static constexpr std::size_t kOutputBytesPerByte = 8;
+
+    LinearBudget() {
+        std::string calibration;
+        while (calibration.size() < kCalibrationBytes) {
+            calibration += "let v = (1 + 2) * x - { let t = y; t / 4 };\n";
+        }
+        ns_per_byte_ = static_cast<double>(fastest(calibration).count()) / static_cast<double>(calibration.size());
+    }
+
+    double ns_per_byte() const { return ns_per_byte_; }
+
+    std::chrono::nanoseconds limit(std::size_t bytes) const {
+        return kSlack + std::chrono::nanoseconds(
+                            static_cast<std::chrono::nanoseconds::rep>(kSlopeFactor * ns_per_byte_ * static_cast<double>(bytes)));
+    }
+
+    // Describes how `run` of `source` broke the budget, or returns an empty string. Time is only reported
+    // once the best of several repeated runs is still over, since a single run may be descheduled.
+    std::string check(std::string_view source, const PipelineRun& run) const {
+        if (std::string verdict = check_output(source, run); !verdict.empty()) {
+            return verdict;
+        }
+        return check_time(source, run);
+    }
+
+    // The part of check that does not depend on timing, so it gives the same verdict on every machine.
+    static std::string check_output(std::string_view source, const PipelineRun& run) {
+        if (!run.rejected && run.output.size() > kOutputBytesPerByte * source.size() + 6) {
+            return "printed " + std::to_string(run.output.size()) + " bytes for a " + std::to_string(source.size()) +
+                   "-byte input";
+        }
+        return {};
+    }
+
+    // The part of check that times the input against the calibrated slope.
+    std::string check_time(std::string_view source, const PipelineRun& run) const {
+        if (run.elapsed <= limit(source.size())) {
+            return {};
+        }
+        const auto best = std::min(run.elapsed, fastest(source));
+        if (best <= limit(source.size())) {
+            return {};
+        }
+        return "took " + std::to_string(best.count()) + " ns for a " + std::to_string(source.size()) +
+               "-byte input; the linear budget is " + std::to_string(limit(source.size()).count()) + " ns";
+    }
+
+   private:
+    static constexpr std::size_t kCalibrationBytes = 64 * 1024;
+    static constexpr int kRepeats = 5;
+
+    static std::chrono::nanoseconds fastest(std::string_view source) {
+        auto best = std::chrono::nanoseconds::max();
+        for (int i = 0; i < kRepeats; ++i) {
+            best = std::min(best, run_pipeline(source).elapsed);
+        }
+        return best;
+    }
+
+    double ns_per_byte_{0.0};
+};
+
+}  // namespace sonar::fuzz
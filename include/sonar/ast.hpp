@@ -1,7 +1,12 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
 #include <memory>
-#include <optional>
+#include <memory_resource>
+#include <mutex>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -16,38 +21,119 @@ struct Statement;
 using ExpressionPtr = std::unique_ptr<Expression>;
 using StatementPtr = std::unique_ptr<Statement>;
 
+// Identifies a node within its tree; see node_map.hpp.
+using NodeId = std::uint32_t;
+inline constexpr NodeId kNoNodeId = std::numeric_limits<NodeId>::max();
+
+// An expression whose parsing is postponed until it is first read. `get` may be called from several
+// threads; the parse runs once, and a parse error is rethrown to every caller until a parse succeeds.
+class DeferredExpression {
+   public:
+    explicit DeferredExpression(std::function<ExpressionPtr()> parse) : parse_(std::move(parse)) {}
+
+    const Expression& get() const;
+
+    // The expression if it was already parsed, without parsing it. Requires exclusive access to the tree.
+    Expression* parsed() const noexcept { return value_.get(); }
+
+   private:
+    mutable std::once_flag once_;
+    mutable std::function<ExpressionPtr()> parse_;
+    mutable ExpressionPtr value_;
+};
+
+namespace detail {
+
+// Tree nodes are allocated from a std::pmr::memory_resource and remember it in a header just before the
+// object, so that ExpressionPtr and StatementPtr keep the default deleter and their size. A plain `new`
+// uses std::pmr::get_default_resource(); `new (resource) T(...)` uses `resource`, or the default when it is
+// null. The resource must outlive the node. With `TreeNode` (Expression and Statement) the header also
+// holds the node's id and, on a root, the tree's id bound (see node_map.hpp).
+template <typename T, bool TreeNode = false>
+struct NodeAllocation {
+    static constexpr std::size_t kFieldBytes =
+        (TreeNode ? 2 * sizeof(NodeId) : 0) + sizeof(void*);
+    static constexpr std::size_t kHeader = (kFieldBytes + alignof(T) - 1) / alignof(T) * alignof(T);
+
+    static void* allocate(std::size_t size, std::pmr::memory_resource* resource) {
+        if (resource == nullptr) {
+            resource = std::pmr::get_default_resource();
+        }
+        auto* block = static_cast<std::byte*>(resource->allocate(kHeader + size, alignof(T)));
+        *reinterpret_cast<std::pmr::memory_resource**>(block + kHeader - sizeof(void*)) = resource;
+        if constexpr (TreeNode) {
+            *id_slot(block + kHeader) = kNoNodeId;
+            *id_bound_slot(block + kHeader) = 0;
+        }
+        return block + kHeader;
+    }
+
+    static void deallocate(void* node, std::size_t size) noexcept {
+        auto* block = static_cast<std::byte*>(node) - kHeader;
+        auto* resource = *reinterpret_cast<std::pmr::memory_resource**>(block + kHeader - sizeof(void*));
+        resource->deallocate(block, kHeader + size, alignof(T));
+    }
+
+    static NodeId* id_slot(const void* node) noexcept
+        requires TreeNode
+    {
+        auto* bytes = static_cast<std::byte*>(const_cast<void*>(node));
+        return reinterpret_cast<NodeId*>(bytes - sizeof(void*)) - 2;
+    }
+
+    static NodeId* id_bound_slot(const void* node) noexcept
+        requires TreeNode
+    {
+        return id_slot(node) + 1;
+    }
+};
+
+}  // namespace detail
+
 struct TypeAnnotation {
     std::string name;
     SourceSpan span;
+
+    static void* operator new(std::size_t size) { return detail::NodeAllocation<TypeAnnotation>::allocate(size, nullptr); }
+    static void* operator new(std::size_t size, std::pmr::memory_resource* resource) {
+        return detail::NodeAllocation<TypeAnnotation>::allocate(size, resource);
+    }
+    static void operator delete(void* node, std::size_t size) noexcept {
+        detail::NodeAllocation<TypeAnnotation>::deallocate(node, size);
+    }
+    static void operator delete(void* node, std::pmr::memory_resource*) noexcept {
+        detail::NodeAllocation<TypeAnnotation>::deallocate(node, sizeof(TypeAnnotation));
+    }
 };
 
+// Each node's span lives once, on the Expression or Statement that wraps it. Spans are relative, so that an
+// edit moves a node's later siblings and its ancestors' ends rather than every node after it: a node's span
+// counts from the start of its parent's span, and the other positions a node holds (operators, names, type
+// annotations) count from the start of its own. Only a node without a parent, such as a root, holds source
+// offsets; AstWalker::parent_start gives them back during a walk. Alternatives that are both large and rare
+// keep their bulk behind a pointer so they do not set the size of every node.
 struct Expression {
     struct Number {
         double value;
-        SourceSpan span;
     };
 
     struct Boolean {
         bool value;
-        SourceSpan span;
     };
 
     struct String {
         std::string value;
-        SourceSpan span;
     };
 
+    // The span of a variable is the span of its name.
     struct Variable {
         std::string name;
-        SourceSpan name_span;
-        SourceSpan span;
     };
 
     struct Prefix {
         TokenType op;
         SourceSpan op_span;
         std::unique_ptr<Expression> right;
-        SourceSpan span;
     };
 
     struct Infix {
@@ -55,49 +141,42 @@ struct Expression {
         SourceSpan op_span;
         std::unique_ptr<Expression> left;
         std::unique_ptr<Expression> right;
-        SourceSpan span;
     };
 
     struct Grouping {
         std::unique_ptr<Expression> expression;
-        SourceSpan span;
     };
 
-    struct Unit {
-        SourceSpan span;
-    };
+    struct Unit {};
 
+    // `target` is always a Variable.
     struct Assign {
-        std::string name;
-        SourceSpan name_span;
+        std::unique_ptr<Expression> target;
         std::unique_ptr<Expression> value;
-        SourceSpan span;
+
+        const std::string& name() const;
     };
 
     struct Block {
         std::vector<StatementPtr> statements;
         ExpressionPtr value;
-        SourceSpan span;
     };
 
     struct If {
         std::unique_ptr<Expression> condition;
         std::unique_ptr<Expression> then;
         std::unique_ptr<Expression> else_branch;
-        SourceSpan span;
     };
 
     struct While {
         ExpressionPtr condition;
         ExpressionPtr body;
-        SourceSpan span;
     };
 
     struct For {
         ExpressionPtr pattern;
         ExpressionPtr iterable;
         ExpressionPtr body;
-        SourceSpan span;
     };
 
     struct Function {
@@ -107,31 +186,49 @@ struct Expression {
             TypeAnnotation type;
         };
 
-        std::vector<Parameter> parameters;
-        TypeAnnotation return_type;
+        // Allocated apart from the Expression, so its parameter list can come from the tree's memory resource
+        // without growing every node.
+        struct Signature {
+            std::pmr::vector<Parameter> parameters;
+            TypeAnnotation return_type;
+
+            static void* operator new(std::size_t size) { return detail::NodeAllocation<Signature>::allocate(size, nullptr); }
+            static void* operator new(std::size_t size, std::pmr::memory_resource* resource) {
+                return detail::NodeAllocation<Signature>::allocate(size, resource);
+            }
+            static void operator delete(void* node, std::size_t size) noexcept {
+                detail::NodeAllocation<Signature>::deallocate(node, size);
+            }
+            static void operator delete(void* node, std::pmr::memory_resource*) noexcept {
+                detail::NodeAllocation<Signature>::deallocate(node, sizeof(Signature));
+            }
+        };
+
+        std::unique_ptr<Signature> signature;
         ExpressionPtr body;
-        SourceSpan span;
+        // Set instead of `body` when the parser skipped the body; see ParserOptions::lazy_function_bodies.
+        std::unique_ptr<DeferredExpression> deferred_body{};
+
+        const Expression& body_expression() const { return body ? *body : deferred_body->get(); }
     };
 
     using Node = std::variant<Number, Boolean, String, Prefix, Infix, Grouping, Unit, Assign, Variable, Block, If, While, For, Function>;
 
-    explicit Expression(Number node) : span(node.span), node(std::move(node)) {}
-    explicit Expression(Boolean node) : span(node.span), node(std::move(node)) {}
-    explicit Expression(String node) : span(node.span), node(std::move(node)) {}
-    explicit Expression(Variable node) : span(node.span), node(std::move(node)) {}
-    explicit Expression(Prefix node) : span(node.span), node(std::move(node)) {}
-    explicit Expression(Infix node) : span(node.span), node(std::move(node)) {}
-    explicit Expression(Grouping node) : span(node.span), node(std::move(node)) {}
-    explicit Expression(Unit node) : span(node.span), node(std::move(node)) {}
-    explicit Expression(Assign node) : span(node.span), node(std::move(node)) {}
-    explicit Expression(Block node) : span(node.span), node(std::move(node)) {}
-    explicit Expression(If node) : span(node.span), node(std::move(node)) {}
-    explicit Expression(While node) : span(node.span), node(std::move(node)) {}
-    explicit Expression(For node) : span(node.span), node(std::move(node)) {}
-    explicit Expression(Function node) : span(node.span), node(std::move(node)) {}
+    Expression(Node node, SourceSpan span) : span(span), node(std::move(node)) {}
 
     ~Expression();
 
+    static void* operator new(std::size_t size) { return detail::NodeAllocation<Expression, true>::allocate(size, nullptr); }
+    static void* operator new(std::size_t size, std::pmr::memory_resource* resource) {
+        return detail::NodeAllocation<Expression, true>::allocate(size, resource);
+    }
+    static void operator delete(void* node, std::size_t size) noexcept {
+        detail::NodeAllocation<Expression, true>::deallocate(node, size);
+    }
+    static void operator delete(void* node, std::pmr::memory_resource*) noexcept {
+        detail::NodeAllocation<Expression, true>::deallocate(node, sizeof(Expression));
+    }
+
     SourceSpan span;
     Node node;
 };
@@ -140,28 +237,70 @@ struct Statement {
     struct Let {
         std::string name;
         SourceSpan name_span;
-        std::optional<TypeAnnotation> annotation;
+        std::unique_ptr<TypeAnnotation> annotation;
         ExpressionPtr initializer;
-        SourceSpan span;
     };
 
     struct Expression {
         ExpressionPtr expression;
-        SourceSpan span;
     };
 
     using Node = std::variant<Let, Expression>;
 
-    explicit Statement(Let node) : span(node.span), node(std::move(node)) {}
-    explicit Statement(Expression node) : span(node.span), node(std::move(node)) {}
+    Statement(Node node, SourceSpan span) : span(span), node(std::move(node)) {}
 
     ~Statement();
 
+    static void* operator new(std::size_t size) { return detail::NodeAllocation<Statement, true>::allocate(size, nullptr); }
+    static void* operator new(std::size_t size, std::pmr::memory_resource* resource) {
+        return detail::NodeAllocation<Statement, true>::allocate(size, resource);
+    }
+    static void operator delete(void* node, std::size_t size) noexcept {
+        detail::NodeAllocation<Statement, true>::deallocate(node, size);
+    }
+    static void operator delete(void* node, std::pmr::memory_resource*) noexcept {
+        detail::NodeAllocation<Statement, true>::deallocate(node, sizeof(Statement));
+    }
+
     SourceSpan span;
     Node node;
 };
 
-inline Expression::~Expression() = default;
+// An operator chain's tree is as deep as the chain is long (see kMaxNestingDepth), so its left operands are
+// released in a loop: each is detached from the one below it before being destroyed.
+inline Expression::~Expression() {
+    auto* infix = std::get_if<Infix>(&node);
+    if (infix == nullptr) {
+        return;
+    }
+    ExpressionPtr left = std::move(infix->left);
+    while (left) {
+        auto* next = std::get_if<Infix>(&left->node);
+        if (next == nullptr) {
+            break;
+        }
+        left = std::move(next->left);
+    }
+}
+
 inline Statement::~Statement() = default;
 
+inline const std::string& Expression::Assign::name() const {
+    return std::get<Variable>(target->node).name;
+}
+
+// Layout budget on 64-bit targets; see collect_ast_stats for the per-node cost including owned heap blocks.
+static_assert(sizeof(void*) != 8 || sizeof(SourceSpan) == 8);
+static_assert(sizeof(void*) != 8 || sizeof(Expression::Node) <= 40);
+static_assert(sizeof(void*) != 8 || sizeof(Expression) <= 48);
+static_assert(sizeof(void*) != 8 || sizeof(Statement) <= 72);
+
+inline const Expression& DeferredExpression::get() const {
+    std::call_once(once_, [this]() {
+        value_ = parse_();
+        parse_ = nullptr;
+    });
+    return *value_;
+}
+
 }  // namespace sonar
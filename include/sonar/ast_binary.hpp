@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "sonar/ast.hpp"
+
+namespace sonar {
+
+// A position-independent binary encoding of a syntax tree. Nodes are fixed-size records that refer to each
+// other by index, so a file can be mapped and read in place without building an Expression tree.
+//
+// Layout: a 40-byte header, then `node_count` node records of 28 bytes, then `list_words` 32-bit words of
+// out-of-line data (block statements, parameters, let names), then `string_bytes` bytes of text. All
+// integers are little-endian. Nodes are in preorder, so every child index is greater than its parent's.
+// Spans are stored as the tree holds them, relative to the parent node or to the node itself (see
+// Expression). Bump kBinaryAstVersion whenever the layout, the meaning of a field, BinaryNodeKind or TokenType
+// changes; loaders reject any other version.
+inline constexpr std::uint32_t kBinaryAstVersion = 2;
+
+// Stored in files; never renumber.
+enum class BinaryNodeKind : std::uint8_t {
+    Number = 0,
+    Boolean = 1,
+    String = 2,
+    Variable = 3,
+    Prefix = 4,
+    Infix = 5,
+    Grouping = 6,
+    Unit = 7,
+    Assign = 8,
+    Block = 9,
+    If = 10,
+    While = 11,
+    For = 12,
+    Function = 13,
+    Let = 14,
+    ExpressionStatement = 15,
+};
+
+// Encodes `root`; deferred function bodies are parsed. `source_hash` is stored verbatim so that callers can
+// tell whether a cached file still matches its source (see hash_bytes).
+std::string serialize_ast(const Expression& root, std::uint64_t source_hash = 0);
+
+// Writes serialize_ast(root, source_hash) to `path`. Throws std::runtime_error on I/O failure.
+void write_ast_file(const std::string& path, const Expression& root, std::uint64_t source_hash = 0);
+
+// True when `bytes` starts with the binary AST magic.
+bool is_binary_ast(std::string_view bytes) noexcept;
+
+class BinaryAst;
+
+namespace detail {
+struct BinaryNodeRecord;
+}  // namespace detail
+
+struct BinaryTypeRef {
+    std::string_view name;
+    SourceSpan span;
+};
+
+struct BinaryParameterRef {
+    std::string_view name;
+    SourceSpan name_span;
+    BinaryTypeRef type;
+};
+
+// A node inside a BinaryAst. Copies are cheap and valid as long as the underlying bytes are. A default
+// constructed reference stands for an absent child. Accessors throw std::runtime_error when they find an
+// index outside the buffer, so a corrupt file cannot make them read out of bounds.
+class BinaryNodeRef {
+   public:
+    BinaryNodeRef() = default;
+
+    explicit operator bool() const noexcept { return ast_ != nullptr; }
+
+    BinaryNodeKind kind() const;
+    SourceSpan span() const;
+
+    // Prefix and Infix.
+    TokenType op() const;
+    SourceSpan op_span() const;
+
+    double number() const;
+    bool boolean() const;
+
+    // The value of a String, or the name of a Variable or Let.
+    std::string_view text() const;
+
+    // Let only.
+    SourceSpan name_span() const;
+    bool has_annotation() const;
+    BinaryTypeRef annotation() const;
+
+    // Function only.
+    std::size_t parameter_count() const;
+    BinaryParameterRef parameter(std::size_t index) const;
+    BinaryTypeRef return_type() const;
+
+    // Children in source order; absent optional children are null references.
+    //   Prefix: right. Infix: left, right. Grouping, ExpressionStatement: expression. Assign: target, value.
+    //   Block: statements..., value. If: condition, then, else. While: condition, body.
+    //   For: pattern, iterable, body. Function: body. Let: initializer.
+    std::size_t child_count() const;
+    BinaryNodeRef child(std::size_t index) const;
+
+   private:
+    friend class BinaryAst;
+
+    BinaryNodeRef(const BinaryAst* ast, std::uint32_t index) : ast_(ast), index_(index) {}
+
+    detail::BinaryNodeRecord record() const;
+    std::uint32_t list_word(std::uint32_t index) const;
+    BinaryTypeRef type_at(std::uint32_t list_index) const;
+
+    const BinaryAst* ast_{nullptr};
+    std::uint32_t index_{0};
+};
+
+// Read-only view over an encoded tree. Only the header is checked up front; node records are decoded as they
+// are visited.
+class BinaryAst {
+   public:
+    // Throws std::runtime_error when `bytes` is not a complete tree in this version of the format.
+    explicit BinaryAst(std::string_view bytes);
+
+    BinaryNodeRef root() const { return BinaryNodeRef(this, root_); }
+    std::size_t node_count() const noexcept { return node_count_; }
+    std::uint64_t source_hash() const noexcept { return source_hash_; }
+
+   private:
+    friend class BinaryNodeRef;
+
+    BinaryNodeRef node(std::uint32_t index) const;
+
+    std::string_view bytes_;
+    std::uint32_t node_count_{0};
+    std::uint32_t root_{0};
+    std::uint32_t list_words_{0};
+    std::uint32_t string_bytes_{0};
+    std::uint64_t source_hash_{0};
+};
+
+// Maps a file written by write_ast_file into memory. On platforms without mmap the file is read instead.
+class BinaryAstFile {
+   public:
+    // Throws std::runtime_error when the file cannot be opened or is not a valid binary AST.
+    explicit BinaryAstFile(const std::string& path);
+
+    BinaryAstFile(const BinaryAstFile&) = delete;
+    BinaryAstFile& operator=(const BinaryAstFile&) = delete;
+
+    const BinaryAst& ast() const noexcept { return ast_; }
+
+   private:
+    class Mapping {
+       public:
+        explicit Mapping(const std::string& path);
+        ~Mapping();
+
+        Mapping(const Mapping&) = delete;
+        Mapping& operator=(const Mapping&) = delete;
+
+        std::string_view bytes() const noexcept;
+
+       private:
+        void* address_{nullptr};
+        std::size_t size_{0};
+        std::string fallback_;
+    };
+
+    Mapping mapping_;
+    BinaryAst ast_;
+};
+
+// Builds the owning tree that `node` encodes. Throws std::runtime_error if `node` is a statement, or if the
+// tree nests more deeply than the parser allows (see kMaxNestingDepth).
+ExpressionPtr materialize(BinaryNodeRef node);
+
+}  // namespace sonar
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+#include "sonar/ast.hpp"
+
+namespace sonar {
+
+// Memory held by a syntax tree: every node with its allocation header, plus the heap blocks it owns (strings
+// that do not fit inline, vector storage, boxed signatures and annotations). Function bodies that were never
+// parsed are not counted.
+struct AstStats {
+    std::size_t expressions{0};
+    std::size_t statements{0};
+    std::size_t bytes{0};
+
+    std::size_t nodes() const noexcept { return expressions + statements; }
+    double bytes_per_node() const noexcept {
+        return nodes() == 0 ? 0.0 : static_cast<double>(bytes) / static_cast<double>(nodes());
+    }
+};
+
+AstStats collect_ast_stats(const Expression& root);
+
+}  // namespace sonar
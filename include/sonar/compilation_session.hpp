@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sonar/ast.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/token.hpp"
+
+namespace sonar {
+
+// A bump allocator over a list of blocks. Deallocation is a no-op; reset() makes every block available again
+// without returning any memory to the system, so a workload that repeats settles on a fixed set of blocks.
+// Not thread-safe.
+class ArenaResource final : public std::pmr::memory_resource {
+   public:
+    static constexpr std::size_t kDefaultBlockBytes = std::size_t{64} << 10;
+
+    explicit ArenaResource(std::size_t block_bytes = kDefaultBlockBytes);
+
+    ArenaResource(const ArenaResource&) = delete;
+    ArenaResource& operator=(const ArenaResource&) = delete;
+
+    // Invalidates everything allocated so far.
+    void reset() noexcept;
+
+    // Bytes handed out since the last reset, including alignment padding.
+    std::size_t used() const noexcept { return used_; }
+
+    // Bytes held in blocks.
+    std::size_t capacity() const noexcept { return capacity_; }
+
+   private:
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        std::size_t size;
+    };
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    std::size_t block_bytes_;
+    std::vector<Block> blocks_;
+    // The block being filled and the first free byte in it.
+    std::size_t current_{0};
+    std::size_t offset_{0};
+    std::size_t used_{0};
+    std::size_t capacity_{0};
+};
+
+using SourceId = std::uint32_t;
+
+struct SourceFile {
+    std::string name;
+    std::string text;
+    // Offset of the first byte of every line, as the lexer reported them.
+    std::vector<std::size_t> line_offsets;
+};
+
+// The sources a session has parsed, numbered in the order they were added.
+class SourceRegistry {
+   public:
+    SourceId add(std::string_view name, std::string_view text, const std::vector<std::size_t>& line_offsets);
+
+    const SourceFile& operator[](SourceId id) const { return files_[id]; }
+    std::size_t size() const noexcept { return size_; }
+
+    // The line and column of byte `offset` of source `id`.
+    SourceLocation location(SourceId id, std::size_t offset) const;
+
+    // Forgets every source but keeps the strings and vectors of the old entries for the next ones.
+    void clear() noexcept { size_ = 0; }
+
+   private:
+    std::vector<SourceFile> files_;
+    std::size_t size_{0};
+};
+
+// Owns the buffers that lexing and parsing a source needs and reuses them from one source to the next, for
+// batch tools and REPLs that parse many small inputs:
+//
+//   sonar::CompilationSession session;
+//   for (const auto& [name, text] : inputs) {
+//       auto ast = session.parse(text, name);
+//       ...
+//       ast.reset();
+//       session.reset();
+//   }
+//
+// Tokens are lexed into one reused buffer. Tree nodes come from the session's arena (see
+// ParserOptions::memory_resource) and every parsed source is recorded in sources(). A tree stays valid until reset() or the session's destruction and must be
+// destroyed before either. Function bodies are always parsed eagerly, since deferred bodies would keep
+// pointing into the token buffer. Not thread-safe; use one session per thread.
+class CompilationSession {
+   public:
+    explicit CompilationSession(std::size_t arena_block_bytes = ArenaResource::kDefaultBlockBytes);
+
+    // Lexes and parses `source` and records it as the next source id. Throws ParseError, or
+    // std::runtime_error for lexical errors, like Lexer and Parser do; a source that fails to lex is not
+    // recorded.
+    ExpressionPtr parse(std::string_view source, std::string_view source_name);
+
+    const SourceRegistry& sources() const noexcept { return sources_; }
+    const ArenaResource& arena() const noexcept { return arena_; }
+
+    // Forgets every source and tree but keeps the capacity of the arena and buffers.
+    void reset() noexcept;
+
+   private:
+    ArenaResource arena_;
+    LexResult lexed_;
+    SourceRegistry sources_;
+};
+
+}  // namespace sonar
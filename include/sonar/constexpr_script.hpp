@@ -0,0 +1,1269 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sonar/parser.hpp"
+#include "sonar/token.hpp"
+
+// A front end for sonar snippets embedded in C++ as string literals, usable in constant expressions:
+//
+//     constexpr auto answer = sonar::ct::evaluate("let a = 6; a * 7");
+//     static_assert(answer.number == 42);
+//     constexpr const auto& ast = sonar::ct::static_ast<"let a = 6; a * 7">;
+//
+// It accepts the grammar Lexer and Parser accept and reports their errors at the same offsets, but keeps the
+// tree in one flat vector, since the runtime tree's allocation scheme cannot run at compile time. In a
+// constant expression an error is a compile error whose notes show the message; at run time the same
+// functions throw what Lexer and Parser throw.
+namespace sonar::ct {
+
+struct Token {
+    TokenType type{TokenType::End};
+    // The token's text in the source; string literals keep their quotes and escapes.
+    std::string_view lexeme{};
+    SourceSpan span{};
+};
+
+enum class NodeKind : std::uint8_t {
+    Number,
+    Boolean,
+    String,
+    Variable,
+    Prefix,
+    Infix,
+    Grouping,
+    Unit,
+    Assign,
+    Block,
+    If,
+    While,
+    For,
+    Function,
+    Let,
+    ExpressionStatement,
+};
+
+inline constexpr std::uint32_t kNoNode = std::numeric_limits<std::uint32_t>::max();
+
+// One node of a flat tree. Children are linked through first_child and next_sibling in the order the
+// runtime tree stores them: a Block's statements and then its value, an If's else branch last, a Let's
+// initializer, a Function's body. Parameters are checked but not kept.
+struct Node {
+    NodeKind kind{NodeKind::Unit};
+    // Prefix and Infix operator.
+    TokenType op{TokenType::End};
+    // In source offsets, where the runtime tree's spans are relative to their parents.
+    SourceSpan span{};
+    // Number and String lexeme, Variable and Let name.
+    std::string_view text{};
+    // Let annotation and Function return type, empty when absent.
+    std::string_view type{};
+    double number{0};
+    // Boolean value; whether a Block has a trailing value.
+    bool boolean{false};
+    std::uint32_t first_child{kNoNode};
+    std::uint32_t next_sibling{kNoNode};
+};
+
+enum class ValueKind : std::uint8_t {
+    Unit,
+    Number,
+    Boolean,
+    Function,
+};
+
+struct Value {
+    ValueKind kind{ValueKind::Unit};
+    double number{0};
+    bool boolean{false};
+
+    friend constexpr bool operator==(const Value&, const Value&) = default;
+};
+
+namespace detail {
+
+constexpr SourceLocation location_in(std::string_view source, std::size_t offset) {
+    SourceLocation location;
+    std::size_t line_start = 0;
+    for (std::size_t i = 0; i < offset && i < source.size(); ++i) {
+        if (source[i] == '\n') {
+            ++location.line;
+            line_start = i + 1;
+        }
+    }
+    location.column = offset - line_start + 1;
+    return location;
+}
+
+// Not constexpr: reaching one of these in a constant expression is the compile error, and the compiler shows
+// the call with its message.
+[[noreturn]] inline void lex_error(std::string_view message, std::string_view source, std::size_t offset) {
+    const auto location = location_in(source, offset);
+    throw std::runtime_error(std::string(message) + " at line " + std::to_string(location.line) + ", column " +
+                             std::to_string(location.column));
+}
+
+[[noreturn]] inline void syntax_error(std::string_view message, std::string_view source, SourceSpan span,
+                                     bool incomplete) {
+    throw ParseError(std::string(message), incomplete, span, location_in(source, span.start), "<embedded>");
+}
+
+[[noreturn]] inline void evaluation_error(std::string_view message, std::string_view source, SourceSpan span) {
+    lex_error(message, source, span.start);
+}
+
+constexpr bool is_digit(char ch) {
+    return ch >= '0' && ch <= '9';
+}
+
+constexpr bool is_alpha(char ch) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+}
+
+constexpr bool is_space(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\v' || ch == '\f' || ch == '\r';
+}
+
+constexpr TokenType keyword_or_identifier(std::string_view lexeme) {
+    constexpr std::array<std::pair<std::string_view, TokenType>, 9> keywords = {{
+        {"let", TokenType::Let},
+        {"fn", TokenType::Fn},
+        {"if", TokenType::If},
+        {"else", TokenType::Else},
+        {"for", TokenType::For},
+        {"while", TokenType::While},
+        {"in", TokenType::In},
+        {"true", TokenType::True},
+        {"false", TokenType::False},
+    }};
+    for (const auto& [text, type] : keywords) {
+        if (text == lexeme) {
+            return type;
+        }
+    }
+    return TokenType::Identifier;
+}
+
+// Unsigned integers of up to 32 * Limbs bits, for the exact arithmetic behind parse_number.
+template <std::size_t Limbs>
+struct BigInt {
+    std::array<std::uint32_t, Limbs> limbs{};
+    std::size_t size{0};
+
+    constexpr explicit BigInt(std::uint64_t value = 0) {
+        for (; value != 0; value >>= 32) {
+            limbs[size++] = static_cast<std::uint32_t>(value);
+        }
+    }
+
+    // *this = *this * factor + addend.
+    constexpr void multiply(std::uint32_t factor, std::uint32_t addend = 0) {
+        std::uint64_t carry = addend;
+        for (std::size_t i = 0; i < size; ++i) {
+            const std::uint64_t product = std::uint64_t{limbs[i]} * factor + carry;
+            limbs[i] = static_cast<std::uint32_t>(product);
+            carry = product >> 32;
+        }
+        if (carry != 0) {
+            limbs[size++] = static_cast<std::uint32_t>(carry);
+        }
+    }
+
+    constexpr void multiply_by_power_of_ten(int exponent) {
+        for (int remaining = exponent; remaining > 0; remaining -= 13) {
+            std::uint32_t power = 1;
+            for (int i = 0; i < std::min(remaining, 13); ++i) {
+                power *= 5;
+            }
+            multiply(power);
+        }
+        shift_left(static_cast<std::size_t>(exponent));
+    }
+
+    constexpr void shift_left(std::size_t bits) {
+        if (size == 0) {
+            return;
+        }
+        const std::size_t whole = bits / 32;
+        const std::size_t part = bits % 32;
+        if (part != 0) {
+            limbs[size] = 0;
+            for (std::size_t i = size; i-- > 0;) {
+                limbs[i + 1] |= limbs[i] >> (32 - part);
+                limbs[i] = limbs[i] << part;
+            }
+            size += limbs[size] != 0 ? 1u : 0u;
+        }
+        if (whole != 0) {
+            for (std::size_t i = size; i-- > 0;) {
+                limbs[i + whole] = limbs[i];
+            }
+            std::fill_n(limbs.begin(), whole, 0u);
+            size += whole;
+        }
+    }
+
+    constexpr void shift_right_one() {
+        for (std::size_t i = 0; i < size; ++i) {
+            limbs[i] = (limbs[i] >> 1) | (i + 1 < size ? limbs[i + 1] << 31 : 0u);
+        }
+        size -= size != 0 && limbs[size - 1] == 0 ? 1u : 0u;
+    }
+
+    // *this = floor(*this / divisor).
+    constexpr void divide(std::uint32_t divisor) {
+        std::uint64_t remainder = 0;
+        for (std::size_t i = size; i-- > 0;) {
+            const std::uint64_t dividend = (remainder << 32) | limbs[i];
+            limbs[i] = static_cast<std::uint32_t>(dividend / divisor);
+            remainder = dividend % divisor;
+        }
+        while (size != 0 && limbs[size - 1] == 0) {
+            --size;
+        }
+    }
+
+    // *this -= other, which must not be larger.
+    constexpr void subtract(const BigInt& other) {
+        std::uint64_t borrow = 0;
+        for (std::size_t i = 0; i < size; ++i) {
+            const std::uint64_t subtrahend = (i < other.size ? other.limbs[i] : 0u) + borrow;
+            borrow = limbs[i] < subtrahend ? 1 : 0;
+            limbs[i] = static_cast<std::uint32_t>((std::uint64_t{limbs[i]} | (borrow << 32)) - subtrahend);
+        }
+        while (size != 0 && limbs[size - 1] == 0) {
+            --size;
+        }
+    }
+
+    constexpr std::size_t bit_length() const {
+        return size == 0 ? 0 : 32 * size - static_cast<std::size_t>(std::countl_zero(limbs[size - 1]));
+    }
+
+    // The 64 bits starting at bit `start`.
+    constexpr std::uint64_t bits_from(std::size_t start) const {
+        const auto limb = [&](std::size_t index) -> std::uint64_t { return index < size ? limbs[index] : 0u; };
+        const std::size_t index = start / 32;
+        const std::size_t offset = start % 32;
+        const std::uint64_t low = ((limb(index + 1) << 32) | limb(index)) >> offset;
+        return offset == 0 ? low : low | (limb(index + 2) << (64 - offset));
+    }
+
+    friend constexpr int compare(const BigInt& a, const BigInt& b) {
+        if (a.size != b.size) {
+            return a.size < b.size ? -1 : 1;
+        }
+        for (std::size_t i = a.size; i-- > 0;) {
+            if (a.limbs[i] != b.limbs[i]) {
+                return a.limbs[i] < b.limbs[i] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+};
+
+// floor(numerator / denominator), which must be below 2^64, leaving the remainder in `numerator`.
+template <std::size_t Limbs>
+constexpr std::uint64_t divide(BigInt<Limbs>& numerator, BigInt<Limbs> denominator) {
+    if (compare(numerator, denominator) < 0) {
+        return 0;
+    }
+    const std::size_t top = numerator.bit_length() - denominator.bit_length();
+    denominator.shift_left(top);
+    std::uint64_t quotient = 0;
+    for (std::size_t bit = top + 1; bit-- > 0;) {
+        quotient <<= 1;
+        if (compare(numerator, denominator) >= 0) {
+            numerator.subtract(denominator);
+            quotient |= 1;
+        }
+        denominator.shift_right_one();
+    }
+    return quotient;
+}
+
+struct Uint128 {
+    std::uint64_t high{0};
+    std::uint64_t low{0};
+};
+
+constexpr Uint128 wide_multiply(std::uint64_t a, std::uint64_t b) {
+    const std::uint64_t a_low = a & 0xFFFFFFFF;
+    const std::uint64_t a_high = a >> 32;
+    const std::uint64_t b_low = b & 0xFFFFFFFF;
+    const std::uint64_t b_high = b >> 32;
+    const std::uint64_t low = a_low * b_low;
+    const std::uint64_t cross = (low >> 32) + (a_high * b_low & 0xFFFFFFFF) + (a_low * b_high & 0xFFFFFFFF);
+    return Uint128{a_high * b_high + (a_high * b_low >> 32) + (a_low * b_high >> 32) + (cross >> 32),
+                   (cross << 32) | (low & 0xFFFFFFFF)};
+}
+
+inline constexpr int kSmallestPowerOfTen = -342;
+inline constexpr int kLargestPowerOfTen = 308;
+
+// 5^q for q from kSmallestPowerOfTen to kLargestPowerOfTen, normalized to 128 bits: truncated, except that the
+// reciprocals for q from -27 to -1 are rounded up. These are the values the Eisel-Lemire algorithm was
+// proven correctly rounded with, for any 64-bit decimal mantissa (Mushtak and Lemire, 2023).
+constexpr std::array<Uint128, kLargestPowerOfTen - kSmallestPowerOfTen + 1> make_powers_of_five() {
+    std::array<Uint128, kLargestPowerOfTen - kSmallestPowerOfTen + 1> table{};
+    // floor(2^kScale / 5^q), each from the last by one short division, since floor(floor(a / b) / c) is
+    // floor(a / (b * c)). kScale leaves more than 128 bits at the smallest power.
+    constexpr std::size_t kScale = 960;
+    BigInt<32> power(1);
+    BigInt<32> reciprocal(1);
+    reciprocal.shift_left(kScale);
+    for (int q = 0; q <= -kSmallestPowerOfTen; ++q) {
+        const std::size_t length = power.bit_length();
+        if (q <= kLargestPowerOfTen) {
+            BigInt<32> normalized = power;
+            normalized.shift_left(length < 128 ? 128 - length : 0);
+            const std::size_t start = length < 128 ? 0 : length - 128;
+            table[static_cast<std::size_t>(q - kSmallestPowerOfTen)] =
+                Uint128{normalized.bits_from(start + 64), normalized.bits_from(start)};
+        }
+        if (q > 0) {
+            // floor(2^(length + 127) / 5^q), which lies between 2^127 and 2^128.
+            const std::size_t start = kScale - length - 127;
+            const std::uint64_t high = reciprocal.bits_from(start + 64);
+            const std::uint64_t low = reciprocal.bits_from(start);
+            table[static_cast<std::size_t>(-q - kSmallestPowerOfTen)] =
+                q <= 27 ? Uint128{high + (low == ~std::uint64_t{0} ? 1u : 0u), low + 1} : Uint128{high, low};
+        }
+        power.multiply(5);
+        reciprocal.divide(5);
+    }
+    return table;
+}
+
+inline constexpr auto kPowersOfFive = make_powers_of_five();
+
+inline constexpr std::uint64_t kInfinityBits = std::uint64_t{0x7FF} << 52;
+
+// The bits of mantissa * 10^exponent rounded to the nearest double, infinity when it overflows, or nothing
+// when the result is below 2^-1021, where whether std::stod reports an underflow needs the exact value.
+// `mantissa` must not be zero and `exponent` lies within the power table.
+constexpr std::optional<std::uint64_t> eisel_lemire(std::uint64_t mantissa, int exponent) {
+    const int leading_zeros = std::countl_zero(mantissa);
+    mantissa <<= leading_zeros;
+    const Uint128 power = kPowersOfFive[static_cast<std::size_t>(exponent - kSmallestPowerOfTen)];
+    Uint128 product = wide_multiply(mantissa, power.high);
+    if ((product.high & 0x1FF) == 0x1FF) {
+        const Uint128 second = wide_multiply(mantissa, power.low);
+        product.low += second.high;
+        product.high += second.high > product.low ? 1 : 0;
+    }
+    const int upper_bit = static_cast<int>(product.high >> 63);
+    const int shift = upper_bit + 9;
+    std::uint64_t bits = product.high >> shift;
+    // 217706 / 2^16 approximates log2(10); the biased exponent of the product before rounding.
+    int biased = ((217706 * exponent) >> 16) + 63 + upper_bit - leading_zeros + 1023;
+    if (biased <= 1) {
+        return std::nullopt;
+    }
+    // A product exactly halfway between two doubles is only possible for small exponents; round it to even.
+    if (product.low <= 1 && exponent >= -4 && exponent <= 23 && (bits & 3) == 1 && (bits << shift) == product.high) {
+        bits &= ~std::uint64_t{1};
+    }
+    bits = (bits + (bits & 1)) >> 1;
+    if (bits >= std::uint64_t{2} << 52) {
+        bits = std::uint64_t{1} << 52;
+        ++biased;
+    }
+    if (biased >= 0x7FF) {
+        return kInfinityBits;
+    }
+    return (static_cast<std::uint64_t>(biased) << 52) | (bits & ((std::uint64_t{1} << 52) - 1));
+}
+
+// Digits past the 800th only matter through whether any is non-zero: a double, or a point halfway between
+// two, never needs more than 767 significant digits.
+inline constexpr int kMaxExactDigits = 800;
+
+// The double nearest to the literal, computed with big integers from all its digits; see parse_number.
+constexpr std::optional<double> parse_number_exactly(std::string_view lexeme, int written_exponent) {
+    BigInt<128> numerator;
+    int digits = 0;
+    int exponent = written_exponent;
+    bool fraction = false;
+    bool sticky = false;
+    for (std::size_t i = 0; i < lexeme.size() && lexeme[i] != 'e' && lexeme[i] != 'E'; ++i) {
+        if (lexeme[i] == '.') {
+            fraction = true;
+        } else if (digits < kMaxExactDigits && (digits != 0 || lexeme[i] != '0')) {
+            numerator.multiply(10, static_cast<std::uint32_t>(lexeme[i] - '0'));
+            ++digits;
+            exponent -= fraction ? 1 : 0;
+        } else {
+            sticky = sticky || lexeme[i] != '0';
+            exponent += digits != 0 && !fraction ? 1 : 0;
+            exponent -= digits == 0 && fraction ? 1 : 0;
+        }
+    }
+    if (sticky) {
+        numerator.multiply(10, 1);
+        ++digits;
+        --exponent;
+    }
+    // The value lies in [10^(digits + exponent - 1), 10^(digits + exponent)): from 10^309 up it overflows, and
+    // below 10^-324 it rounds to zero.
+    if (digits + exponent >= 310 || digits + exponent <= -324) {
+        return std::nullopt;
+    }
+
+    BigInt<128> denominator(1);
+    if (exponent >= 0) {
+        numerator.multiply_by_power_of_ten(exponent);
+    } else {
+        denominator.multiply_by_power_of_ten(-exponent);
+    }
+    // floor(log2(value)) is this or one less. Scaled by 2^-scale the value has at least 55 integer bits, or
+    // is scaled as if its exponent were -1076 when it is below 2^-1022.
+    const int log2 = static_cast<int>(numerator.bit_length()) - static_cast<int>(denominator.bit_length());
+    if (log2 > 1024) {
+        return std::nullopt;
+    }
+    const int scale = std::max(log2 - 55, -1076);
+    if (scale < 0) {
+        numerator.shift_left(static_cast<std::size_t>(-scale));
+    } else {
+        denominator.shift_left(static_cast<std::size_t>(scale));
+    }
+    const std::uint64_t scaled = divide(numerator, denominator);
+    const bool exact = numerator.size == 0;
+
+    // Keep 53 bits, or fewer where the result is subnormal, and round half to even.
+    const int length = 64 - std::countl_zero(scaled);
+    const int dropped = std::max(length - 53, -1074 - scale);
+    const std::uint64_t half = std::uint64_t{1} << (dropped - 1);
+    const std::uint64_t rest = scaled & ((half << 1) - 1);
+    std::uint64_t bits = scaled >> dropped;
+    if (rest > half || (rest == half && (!exact || (bits & 1) != 0))) {
+        ++bits;
+    }
+    // std::stod reports an inexact result as out of range when, rounded to 53 bits with an unbounded exponent,
+    // it would still be below 2^-1022.
+    if (scale == -1076 && scaled < (std::uint64_t{1} << 54) - 1 && (rest != 0 || !exact)) {
+        return std::nullopt;
+    }
+    int power = scale + dropped;
+    if (bits == std::uint64_t{1} << 53) {
+        bits >>= 1;
+        ++power;
+    }
+    if (bits < std::uint64_t{1} << 52) {
+        return std::bit_cast<double>(bits);
+    }
+    const int biased = power + 52 + 1023;
+    if (biased >= 0x7FF) {
+        return std::nullopt;
+    }
+    return std::bit_cast<double>((static_cast<std::uint64_t>(biased) << 52) | (bits & ((std::uint64_t{1} << 52) - 1)));
+}
+
+// The double nearest to a Number lexeme, rounded as std::stod rounds, or nothing where std::stod reports the
+// value out of range: when it overflows, or when it is inexact and below the smallest normal double. Literals
+// with at most 19 significant digits take Clinger's fast path when both factors are exact doubles and
+// otherwise the Eisel-Lemire algorithm; longer ones take Eisel-Lemire when their first 19 digits and those
+// digits rounded up give the same double. Everything else, including results near the subnormal range, is
+// computed exactly with big integers.
+constexpr std::optional<double> parse_number(std::string_view lexeme) {
+    std::uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool truncated = false;
+    bool fraction = false;
+    std::size_t i = 0;
+    for (; i < lexeme.size() && lexeme[i] != 'e' && lexeme[i] != 'E'; ++i) {
+        if (lexeme[i] == '.') {
+            fraction = true;
+            continue;
+        }
+        const auto digit = static_cast<std::uint64_t>(lexeme[i] - '0');
+        if (digits < 19 && (mantissa != 0 || digit != 0)) {
+            mantissa = mantissa * 10 + digit;
+            ++digits;
+            exponent -= fraction ? 1 : 0;
+        } else if (digits < 19) {
+            exponent -= fraction ? 1 : 0;
+        } else {
+            truncated = truncated || digit != 0;
+            exponent += fraction ? 0 : 1;
+        }
+    }
+    int written = 0;
+    if (i < lexeme.size()) {
+        ++i;
+        const bool negative = lexeme[i] == '-';
+        if (lexeme[i] == '-' || lexeme[i] == '+') {
+            ++i;
+        }
+        for (; i < lexeme.size(); ++i) {
+            written = std::min(written * 10 + (lexeme[i] - '0'), 100000);
+        }
+        written = negative ? -written : written;
+    }
+    exponent += written;
+    if (mantissa == 0) {
+        return 0.0;
+    }
+
+    constexpr std::array<double, 23> kPowers = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                                1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                                1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    if (!truncated && mantissa < (std::uint64_t{1} << 53) && exponent >= -22 && exponent <= 22) {
+        const auto value = static_cast<double>(mantissa);
+        return exponent < 0 ? value / kPowers[static_cast<std::size_t>(-exponent)]
+                            : value * kPowers[static_cast<std::size_t>(exponent)];
+    }
+    // Past either end of the table even the widest mantissa overflows, or rounds to zero.
+    if (exponent > kLargestPowerOfTen || exponent < kSmallestPowerOfTen) {
+        return std::nullopt;
+    }
+    const auto bits = eisel_lemire(mantissa, exponent);
+    if (bits && (!truncated || eisel_lemire(mantissa + 1, exponent) == bits)) {
+        if (*bits == kInfinityBits) {
+            return std::nullopt;
+        }
+        return std::bit_cast<double>(*bits);
+    }
+    return parse_number_exactly(lexeme, written);
+}
+
+}  // namespace detail
+
+// Same tokens as Lexer::tokenize, ending with End.
+constexpr std::vector<Token> tokenize(std::string_view source) {
+    using detail::is_alpha;
+    using detail::is_digit;
+    using detail::lex_error;
+
+    std::vector<Token> tokens;
+    std::size_t index = 0;
+    auto peek = [&](std::size_t lookahead = 0) {
+        return index + lookahead < source.size() ? source[index + lookahead] : '\0';
+    };
+    auto push = [&](TokenType type, std::size_t start) {
+        tokens.push_back(Token{type, source.substr(start, index - start), SourceSpan{start, index}});
+    };
+    auto push_operator = [&](TokenType type, std::size_t length) {
+        index += length;
+        push(type, index - length);
+    };
+
+    while (index < source.size()) {
+        const char ch = source[index];
+        const std::size_t start = index;
+        if (detail::is_space(ch)) {
+            ++index;
+            continue;
+        }
+        if (ch == '/' && peek(1) == '/') {
+            while (index < source.size() && peek() != '\n') {
+                ++index;
+            }
+            continue;
+        }
+        if (ch == '/' && peek(1) == '*') {
+            index += 2;
+            while (index < source.size() && !(peek() == '*' && peek(1) == '/')) {
+                ++index;
+            }
+            if (index >= source.size()) {
+                lex_error("Unterminated block comment", source, index);
+            }
+            index += 2;
+            continue;
+        }
+
+        switch (ch) {
+            case '+':
+                push_operator(TokenType::Plus, 1);
+                continue;
+            case '-':
+                peek(1) == '>' ? push_operator(TokenType::Arrow, 2) : push_operator(TokenType::Minus, 1);
+                continue;
+            case '*':
+                push_operator(TokenType::Star, 1);
+                continue;
+            case '/':
+                push_operator(TokenType::Slash, 1);
+                continue;
+            case '&':
+                peek(1) == '&' ? push_operator(TokenType::AndAnd, 2) : push_operator(TokenType::Ampersand, 1);
+                continue;
+            case '|':
+                peek(1) == '|' ? push_operator(TokenType::OrOr, 2) : push_operator(TokenType::Pipe, 1);
+                continue;
+            case '(':
+                push_operator(TokenType::LeftParen, 1);
+                continue;
+            case ')':
+                push_operator(TokenType::RightParen, 1);
+                continue;
+            case ',':
+                push_operator(TokenType::Comma, 1);
+                continue;
+            case '=':
+                push_operator(TokenType::Equals, 1);
+                continue;
+            case ':':
+                push_operator(TokenType::Colon, 1);
+                continue;
+            case '{':
+                push_operator(TokenType::LeftBrace, 1);
+                continue;
+            case '}':
+                push_operator(TokenType::RightBrace, 1);
+                continue;
+            case ';':
+                push_operator(TokenType::Semicolon, 1);
+                continue;
+            default:
+                break;
+        }
+
+        if (is_digit(ch) || ch == '.') {
+            bool seen_dot = ch == '.';
+            ++index;
+            if (seen_dot && !is_digit(peek())) {
+                lex_error("Standalone '.' is not a valid number", source, start);
+            }
+            while (is_digit(peek()) || (!seen_dot && peek() == '.')) {
+                seen_dot = seen_dot || peek() == '.';
+                ++index;
+            }
+            if (peek() == 'e' || peek() == 'E') {
+                ++index;
+                if (peek() == '+' || peek() == '-') {
+                    ++index;
+                }
+                if (!is_digit(peek())) {
+                    lex_error("Invalid exponent in number literal", source, index);
+                }
+                while (is_digit(peek())) {
+                    ++index;
+                }
+            }
+            push(TokenType::Number, start);
+            continue;
+        }
+
+        if (ch == '"') {
+            ++index;
+            while (true) {
+                if (index >= source.size()) {
+                    lex_error("Unterminated string literal", source, start);
+                }
+                const char next = source[index++];
+                if (next == '"') {
+                    break;
+                }
+                if (next == '\n') {
+                    lex_error("Unterminated string literal", source, index - 1);
+                }
+                if (next == '\\') {
+                    if (index >= source.size()) {
+                        lex_error("Unterminated escape sequence in string literal", source, start);
+                    }
+                    const char escape = source[index++];
+                    if (escape != 'n' && escape != 't' && escape != 'r' && escape != '\\' && escape != '"') {
+                        lex_error("Unknown escape sequence '\\" + std::string(1, escape) + "'", source, index - 2);
+                    }
+                }
+            }
+            push(TokenType::String, start);
+            continue;
+        }
+
+        if (ch == 'r' && (peek(1) == '"' || peek(1) == '#')) {
+            ++index;
+            std::size_t hashes = 0;
+            while (peek() == '#') {
+                ++hashes;
+                ++index;
+            }
+            if (peek() != '"') {
+                lex_error("Invalid raw string literal", source, index);
+            }
+            ++index;
+            while (true) {
+                if (index >= source.size()) {
+                    lex_error("Unterminated raw string literal", source, start);
+                }
+                if (source[index++] != '"') {
+                    continue;
+                }
+                std::size_t matched = 0;
+                while (matched < hashes && peek() == '#') {
+                    ++matched;
+                    ++index;
+                }
+                if (matched == hashes) {
+                    break;
+                }
+                index -= matched;
+            }
+            push(TokenType::String, start);
+            continue;
+        }
+
+        if (is_alpha(ch) || ch == '_') {
+            ++index;
+            while (is_alpha(peek()) || is_digit(peek()) || peek() == '_') {
+                ++index;
+            }
+            push(detail::keyword_or_identifier(source.substr(start, index - start)), start);
+            continue;
+        }
+
+        lex_error("Unexpected character '" + std::string(1, ch) + "'", source, index);
+    }
+    tokens.push_back(Token{TokenType::End, {}, SourceSpan{source.size(), source.size()}});
+    return tokens;
+}
+
+namespace detail {
+
+// Mirrors Parser, producing nodes in the order Parser creates them.
+class FlatParser {
+   public:
+    constexpr FlatParser(std::string_view source) : source_(source), tokens_(tokenize(source)) {}
+
+    constexpr std::vector<Node> parse() {
+        auto sequence = parse_sequence(TokenType::End);
+        consume(TokenType::End, "Expected end of input");
+        if (sequence.statements.empty()) {
+            if (sequence.value == kNoNode) {
+                add(Node{.kind = NodeKind::Unit, .span = tokens_.back().span}, {});
+            }
+        } else {
+            const SourceSpan span{nodes_[sequence.statements.front()].span.start,
+                                  nodes_[sequence.value != kNoNode ? sequence.value : sequence.statements.back()].span.end};
+            add_block(span, sequence);
+        }
+        return std::move(nodes_);
+    }
+
+   private:
+    struct Sequence {
+        std::vector<std::uint32_t> statements;
+        std::uint32_t value{kNoNode};
+    };
+
+    // Binding power of an infix operator, or zero when `type` is not one.
+    static constexpr int precedence(TokenType type) {
+        switch (type) {
+            case TokenType::Equals:
+                return 1;
+            case TokenType::OrOr:
+                return 2;
+            case TokenType::AndAnd:
+                return 3;
+            case TokenType::Pipe:
+                return 4;
+            case TokenType::Ampersand:
+                return 5;
+            case TokenType::Plus:
+            case TokenType::Minus:
+                return 6;
+            case TokenType::Star:
+            case TokenType::Slash:
+                return 7;
+            default:
+                return 0;
+        }
+    }
+    static constexpr int kPrefixPrecedence = 8;
+
+    constexpr std::uint32_t add(Node node, std::initializer_list<std::uint32_t> children) {
+        return add(node, children.begin(), children.size());
+    }
+
+    constexpr std::uint32_t add(Node node, const std::uint32_t* children, std::size_t count) {
+        std::uint32_t* link = &node.first_child;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (children[i] != kNoNode) {
+                *link = children[i];
+                link = &nodes_[children[i]].next_sibling;
+            }
+        }
+        nodes_.push_back(node);
+        return static_cast<std::uint32_t>(nodes_.size() - 1);
+    }
+
+    constexpr std::uint32_t add_block(SourceSpan span, Sequence& sequence) {
+        const bool has_value = sequence.value != kNoNode;
+        sequence.statements.push_back(sequence.value);
+        return add(Node{.kind = NodeKind::Block, .span = span, .boolean = has_value}, sequence.statements.data(),
+                   sequence.statements.size());
+    }
+
+    constexpr const Token& peek(std::size_t offset = 0) const {
+        return tokens_[std::min(current_ + offset, tokens_.size() - 1)];
+    }
+
+    constexpr const Token& previous() const { return tokens_[current_ - 1]; }
+
+    constexpr bool is_at_end() const { return peek().type == TokenType::End; }
+
+    constexpr bool check(TokenType type) const { return peek().type == type; }
+
+    constexpr const Token& advance() {
+        if (!is_at_end()) {
+            ++current_;
+            return previous();
+        }
+        return tokens_.back();
+    }
+
+    constexpr bool match(TokenType type) {
+        if (!check(type)) {
+            return false;
+        }
+        advance();
+        return true;
+    }
+
+    constexpr const Token& consume(TokenType type, std::string_view message) {
+        if (check(type)) {
+            return advance();
+        }
+        syntax_error(message, source_, is_at_end() ? tokens_.back().span : peek().span, is_at_end());
+    }
+
+    constexpr Sequence parse_sequence(TokenType terminator) {
+        Sequence sequence;
+        while (!check(terminator) && !is_at_end()) {
+            if (match(TokenType::Semicolon)) {
+                continue;
+            }
+            std::uint32_t value = kNoNode;
+            const std::uint32_t statement = parse_sequence_item(value);
+            if (statement == kNoNode) {
+                sequence.value = value;
+                break;
+            }
+            sequence.statements.push_back(statement);
+        }
+        return sequence;
+    }
+
+    // Returns the statement, or kNoNode with the trailing expression in `value`.
+    constexpr std::uint32_t parse_sequence_item(std::uint32_t& value) {
+        if (check(TokenType::Let)) {
+            const std::uint32_t statement = parse_let_statement();
+            consume(TokenType::Semicolon, "Expected ';' after let statement");
+            return statement;
+        }
+        if (check(TokenType::Fn) && peek(1).type == TokenType::Identifier) {
+            const std::uint32_t statement = parse_fn_statement();
+            if (check(TokenType::Semicolon)) {
+                syntax_error("Unexpected ';' after function definition", source_, peek().span, false);
+            }
+            return statement;
+        }
+        const std::uint32_t expression = parse_expression(0);
+        if (match(TokenType::Semicolon)) {
+            return add(Node{.kind = NodeKind::ExpressionStatement, .span = nodes_[expression].span}, {expression});
+        }
+        value = expression;
+        return kNoNode;
+    }
+
+    constexpr std::uint32_t parse_let_statement() {
+        const SourceSpan let_span = consume(TokenType::Let, "Expected 'let'").span;
+        const Token& name = consume(TokenType::Identifier, "Expected identifier after 'let'");
+        std::string_view type;
+        if (match(TokenType::Colon)) {
+            type = consume(TokenType::Identifier, "Expected type name").lexeme;
+        }
+        consume(TokenType::Equals, "Expected '=' after identifier (or type annotation)");
+        const std::uint32_t initializer = parse_expression(0);
+        const SourceSpan span{let_span.start, nodes_[initializer].span.end};
+        return add(Node{.kind = NodeKind::Let, .span = span, .text = name.lexeme, .type = type}, {initializer});
+    }
+
+    constexpr std::uint32_t parse_fn_statement() {
+        const Token& fn_token = consume(TokenType::Fn, "Expected 'fn'");
+        const Token& name = consume(TokenType::Identifier, "Expected function name after 'fn'");
+        const std::uint32_t function = parse_function_literal(fn_token.span);
+        const SourceSpan span{fn_token.span.start, nodes_[function].span.end};
+        return add(Node{.kind = NodeKind::Let, .span = span, .text = name.lexeme}, {function});
+    }
+
+    constexpr std::uint32_t parse_expression(int precedence_floor) {
+        if (is_at_end()) {
+            syntax_error("Unexpected end of input while parsing expression", source_, peek().span, true);
+        }
+        if (depth_ == kMaxNestingDepth) {
+            syntax_error("Expression is nested too deeply", source_, peek().span, false);
+        }
+        const std::size_t depth = depth_++;
+        const Token& token = advance();
+        std::uint32_t left = parse_prefix(token);
+        while (!is_at_end()) {
+            const int infix = precedence(peek().type);
+            if (infix == 0 || infix < precedence_floor) {
+                break;
+            }
+            const Token& op = advance();
+            if (op.type == TokenType::Equals) {
+                if (nodes_[left].kind != NodeKind::Variable) {
+                    syntax_error("Left-hand side of assignment must be a variable", source_, op.span, false);
+                }
+                const std::uint32_t right = parse_expression(infix);
+                const SourceSpan span{nodes_[left].span.start, nodes_[right].span.end};
+                left = add(Node{.kind = NodeKind::Assign, .span = span}, {left, right});
+            } else {
+                const std::uint32_t right = parse_expression(infix + 1);
+                const SourceSpan span{nodes_[left].span.start, nodes_[right].span.end};
+                left = add(Node{.kind = NodeKind::Infix, .op = op.type, .span = span}, {left, right});
+            }
+        }
+        depth_ = depth;
+        return left;
+    }
+
+    constexpr std::uint32_t parse_prefix(const Token& token) {
+        switch (token.type) {
+            case TokenType::Number: {
+                const auto value = parse_number(token.lexeme);
+                if (!value) {
+                    lex_error("Failed to parse number", source_, token.span.start);
+                }
+                return add(Node{.kind = NodeKind::Number, .span = token.span, .text = token.lexeme, .number = *value},
+                           {});
+            }
+            case TokenType::String:
+                return add(Node{.kind = NodeKind::String, .span = token.span, .text = token.lexeme}, {});
+            case TokenType::True:
+            case TokenType::False:
+                return add(Node{.kind = NodeKind::Boolean, .span = token.span, .boolean = token.type == TokenType::True}, {});
+            case TokenType::Identifier:
+                return add(Node{.kind = NodeKind::Variable, .span = token.span, .text = token.lexeme}, {});
+            case TokenType::Minus: {
+                const std::uint32_t right = parse_expression(kPrefixPrecedence);
+                const SourceSpan span{token.span.start, nodes_[right].span.end};
+                return add(Node{.kind = NodeKind::Prefix, .op = token.type, .span = span}, {right});
+            }
+            case TokenType::LeftParen: {
+                if (check(TokenType::RightParen)) {
+                    return add(Node{.kind = NodeKind::Unit, .span = SourceSpan{token.span.start, advance().span.end}}, {});
+                }
+                const std::uint32_t expression = parse_expression(0);
+                const SourceSpan span{token.span.start,
+                                      consume(TokenType::RightParen, "Expected ')' after expression").span.end};
+                return add(Node{.kind = NodeKind::Grouping, .span = span}, {expression});
+            }
+            case TokenType::LeftBrace: {
+                auto sequence = parse_sequence(TokenType::RightBrace);
+                const SourceSpan span{token.span.start, consume(TokenType::RightBrace, "Expected '}' after block").span.end};
+                return add_block(span, sequence);
+            }
+            case TokenType::If: {
+                const std::uint32_t condition = parse_expression(0);
+                const std::uint32_t then = parse_expression(0);
+                const std::uint32_t else_branch = match(TokenType::Else) ? parse_expression(0) : kNoNode;
+                const SourceSpan span{token.span.start, nodes_[else_branch != kNoNode ? else_branch : then].span.end};
+                return add(Node{.kind = NodeKind::If, .span = span}, {condition, then, else_branch});
+            }
+            case TokenType::While: {
+                const std::uint32_t condition = parse_expression(0);
+                const std::uint32_t body = parse_expression(0);
+                const SourceSpan span{token.span.start, nodes_[body].span.end};
+                return add(Node{.kind = NodeKind::While, .span = span}, {condition, body});
+            }
+            case TokenType::For: {
+                const Token& name = consume(TokenType::Identifier, "Expected identifier after 'for'");
+                const std::uint32_t pattern = add(Node{.kind = NodeKind::Variable, .span = name.span, .text = name.lexeme}, {});
+                consume(TokenType::In, "Expected 'in' after loop variable");
+                const std::uint32_t iterable = parse_expression(0);
+                const std::uint32_t body = parse_expression(0);
+                const SourceSpan span{token.span.start, nodes_[body].span.end};
+                return add(Node{.kind = NodeKind::For, .span = span}, {pattern, iterable, body});
+            }
+            case TokenType::Fn:
+                return parse_function_literal(token.span);
+            case TokenType::Let:
+                syntax_error("Unexpected 'let' while parsing expression", source_, token.span, false);
+            case TokenType::End:
+                syntax_error("Unexpected end of input while parsing expression", source_, token.span, true);
+            default:
+                syntax_error("Unexpected token '" + std::string(token.lexeme) + "' while parsing expression", source_,
+                             token.span, false);
+        }
+    }
+
+    constexpr std::uint32_t parse_function_literal(SourceSpan fn_span) {
+        consume(TokenType::LeftParen, "Expected '(' after 'fn'");
+        if (!check(TokenType::RightParen)) {
+            do {
+                consume(TokenType::Identifier, "Expected parameter name");
+                consume(TokenType::Colon, "Expected ':' after parameter name");
+                consume(TokenType::Identifier, "Expected type name");
+            } while (match(TokenType::Comma));
+        }
+        consume(TokenType::RightParen, "Expected ')' after parameter list");
+        consume(TokenType::Arrow, "Expected '->' after parameter list");
+        const std::string_view return_type = consume(TokenType::Identifier, "Expected type name").lexeme;
+        const std::uint32_t body = parse_expression(0);
+        const SourceSpan span{fn_span.start, nodes_[body].span.end};
+        return add(Node{.kind = NodeKind::Function, .span = span, .type = return_type}, {body});
+    }
+
+    std::string_view source_;
+    std::vector<Token> tokens_;
+    std::size_t current_{0};
+    std::size_t depth_{0};
+    std::vector<Node> nodes_;
+};
+
+class Evaluator {
+   public:
+    // Bounds loops, which the compiler would otherwise stop with a less helpful error.
+    static constexpr std::size_t kMaxSteps = 1'000'000;
+
+    constexpr Evaluator(std::string_view source, const std::vector<Node>& nodes) : source_(source), nodes_(nodes) {}
+
+    constexpr Value evaluate(std::uint32_t index) {
+        const Node& node = nodes_[index];
+        if (++steps_ > kMaxSteps) {
+            evaluation_error("Evaluation step limit exceeded", source_, node.span);
+        }
+        switch (node.kind) {
+            case NodeKind::Number:
+                return Value{ValueKind::Number, node.number};
+            case NodeKind::Boolean:
+                return Value{ValueKind::Boolean, 0, node.boolean};
+            case NodeKind::Unit:
+                return Value{};
+            case NodeKind::Function:
+                return Value{ValueKind::Function};
+            case NodeKind::Grouping:
+                return evaluate(node.first_child);
+            case NodeKind::Variable:
+                return binding(node).value;
+            case NodeKind::Assign: {
+                const std::uint32_t target = node.first_child;
+                const Value value = evaluate(nodes_[target].next_sibling);
+                return binding(nodes_[target]).value = value;
+            }
+            case NodeKind::Prefix:
+                return Value{ValueKind::Number, -number(node.first_child)};
+            case NodeKind::Infix:
+                return evaluate_infix(node);
+            case NodeKind::Block: {
+                const std::size_t scope = bindings_.size();
+                Value value;
+                for (std::uint32_t child = node.first_child; child != kNoNode; child = nodes_[child].next_sibling) {
+                    value = evaluate(child);
+                }
+                bindings_.resize(scope);
+                return node.boolean ? value : Value{};
+            }
+            case NodeKind::If: {
+                const std::uint32_t then = nodes_[node.first_child].next_sibling;
+                if (boolean(node.first_child)) {
+                    return evaluate(then);
+                }
+                return nodes_[then].next_sibling != kNoNode ? evaluate(nodes_[then].next_sibling) : Value{};
+            }
+            case NodeKind::While:
+                while (boolean(node.first_child)) {
+                    evaluate(nodes_[node.first_child].next_sibling);
+                }
+                return Value{};
+            case NodeKind::Let: {
+                const Value value = evaluate(node.first_child);
+                const bool matches = node.type.empty() || (node.type == "number" && value.kind == ValueKind::Number) ||
+                                     (node.type == "bool" && value.kind == ValueKind::Boolean);
+                if (!matches) {
+                    evaluation_error("Value does not match the type annotation", source_, node.span);
+                }
+                bindings_.push_back(Binding{node.text, value});
+                return Value{};
+            }
+            case NodeKind::ExpressionStatement:
+                evaluate(node.first_child);
+                return Value{};
+            case NodeKind::String:
+                evaluation_error("Strings are not constant-folded", source_, node.span);
+            case NodeKind::For:
+                evaluation_error("'for' needs a runtime iterable", source_, node.span);
+        }
+        evaluation_error("Unknown node", source_, node.span);
+    }
+
+   private:
+    struct Binding {
+        std::string_view name;
+        Value value;
+    };
+
+    constexpr Binding& binding(const Node& variable) {
+        for (auto it = bindings_.rbegin(); it != bindings_.rend(); ++it) {
+            if (it->name == variable.text) {
+                return *it;
+            }
+        }
+        evaluation_error("Unknown variable", source_, variable.span);
+    }
+
+    constexpr double number(std::uint32_t index) {
+        const Value value = evaluate(index);
+        if (value.kind != ValueKind::Number) {
+            evaluation_error("Expected a number", source_, nodes_[index].span);
+        }
+        return value.number;
+    }
+
+    constexpr bool boolean(std::uint32_t index) {
+        const Value value = evaluate(index);
+        if (value.kind != ValueKind::Boolean) {
+            evaluation_error("Expected a boolean", source_, nodes_[index].span);
+        }
+        return value.boolean;
+    }
+
+    constexpr std::int64_t integer(std::uint32_t index, double value) {
+        constexpr double kLimit = 9223372036854775808.0;  // 2^63
+        if (!(value >= -kLimit && value < kLimit) || static_cast<double>(static_cast<std::int64_t>(value)) != value) {
+            evaluation_error("Expected an integer", source_, nodes_[index].span);
+        }
+        return static_cast<std::int64_t>(value);
+    }
+
+    // An operator chain nests its left operands as deeply as it is long, so it is folded from the operator at
+    // the bottom of its left spine upwards in a loop rather than by recursion.
+    constexpr Value evaluate_infix(const Node& node) {
+        std::vector<const Node*> chain{&node};
+        while (nodes_[chain.back()->first_child].kind == NodeKind::Infix) {
+            chain.push_back(&nodes_[chain.back()->first_child]);
+        }
+        std::uint32_t left = chain.back()->first_child;
+        Value value = evaluate(left);
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            if (it != chain.rbegin() && ++steps_ > kMaxSteps) {
+                evaluation_error("Evaluation step limit exceeded", source_, (*it)->span);
+            }
+            value = apply_infix(**it, left, value);
+            left = static_cast<std::uint32_t>(*it - nodes_.data());
+        }
+        return value;
+    }
+
+    // `lhs` is the value of the operator's left operand, `left`.
+    constexpr Value apply_infix(const Node& node, std::uint32_t left, const Value& lhs) {
+        const std::uint32_t right = nodes_[left].next_sibling;
+        const auto expect_boolean = [&]() {
+            if (lhs.kind != ValueKind::Boolean) {
+                evaluation_error("Expected a boolean", source_, nodes_[left].span);
+            }
+            return lhs.boolean;
+        };
+        switch (node.op) {
+            case TokenType::AndAnd:
+                return Value{ValueKind::Boolean, 0, expect_boolean() && boolean(right)};
+            case TokenType::OrOr:
+                return Value{ValueKind::Boolean, 0, expect_boolean() || boolean(right)};
+            case TokenType::Ampersand:
+            case TokenType::Pipe: {
+                // Booleans without short-circuiting, or the bits of integers.
+                if (lhs.kind == ValueKind::Boolean) {
+                    const bool rhs = boolean(right);
+                    return Value{ValueKind::Boolean, 0, node.op == TokenType::Ampersand ? lhs.boolean && rhs : lhs.boolean || rhs};
+                }
+                if (lhs.kind != ValueKind::Number) {
+                    evaluation_error("Expected a number or a boolean", source_, nodes_[left].span);
+                }
+                const std::int64_t a = integer(left, lhs.number);
+                const std::int64_t b = integer(right, number(right));
+                return Value{ValueKind::Number, static_cast<double>(node.op == TokenType::Ampersand ? a & b : a | b)};
+            }
+            default:
+                break;
+        }
+        if (lhs.kind != ValueKind::Number) {
+            evaluation_error("Expected a number", source_, nodes_[left].span);
+        }
+        const double a = lhs.number;
+        const double b = number(right);
+        switch (node.op) {
+            case TokenType::Plus:
+                return Value{ValueKind::Number, a + b};
+            case TokenType::Minus:
+                return Value{ValueKind::Number, a - b};
+            case TokenType::Star:
+                return Value{ValueKind::Number, a * b};
+            default:
+                if (b == 0) {
+                    evaluation_error("Division by zero", source_, node.span);
+                }
+                return Value{ValueKind::Number, a / b};
+        }
+    }
+
+    std::string_view source_;
+    const std::vector<Node>& nodes_;
+    std::vector<Binding> bindings_;
+    std::size_t steps_{0};
+};
+
+}  // namespace detail
+
+// The nodes Parser::parse would create for `source`, in the same order, so the root is last.
+constexpr std::vector<Node> parse(std::string_view source) {
+    return detail::FlatParser(source).parse();
+}
+
+// Folds the program to its value. Numbers support + - * / and unary minus, booleans && || & |, and integers
+// & | bitwise; `let` checks `number` and `bool` annotations; blocks scope their bindings. A function is an
+// opaque value. Strings, `for` loops and unknown variables are errors, as is running more than
+// Evaluator::kMaxSteps nodes.
+constexpr Value evaluate(std::string_view source) {
+    const auto nodes = parse(source);
+    return detail::Evaluator(source, nodes).evaluate(static_cast<std::uint32_t>(nodes.size() - 1));
+}
+
+// A string literal as a template argument.
+template <std::size_t N>
+struct FixedString {
+    consteval FixedString(const char (&text)[N]) { std::copy_n(text, N, data); }
+
+    constexpr std::string_view view() const { return std::string_view(data, N - 1); }
+
+    char data[N]{};
+};
+
+template <std::size_t N>
+struct StaticAst {
+    std::array<Node, N> nodes;
+
+    constexpr const Node& root() const { return nodes.back(); }
+};
+
+// The tree of `Source`, built during compilation. Node text refers to the template argument.
+template <FixedString Source>
+inline constexpr auto static_ast = [] {
+    StaticAst<parse(Source.view()).size()> ast{};
+    const auto nodes = parse(Source.view());
+    std::copy(nodes.begin(), nodes.end(), ast.nodes.begin());
+    return ast;
+}();
+
+// The value of `Source`, computed during compilation.
+template <FixedString Source>
+inline constexpr Value constant_value = evaluate(Source.view());
+
+}  // namespace sonar::ct
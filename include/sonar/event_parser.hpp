@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sonar/parser.hpp"
+#include "sonar/token.hpp"
+
+namespace sonar {
+
+enum class ParseEventKind : std::uint8_t {
+    Program,
+    Number,
+    Boolean,
+    String,
+    Variable,
+    Prefix,
+    Infix,
+    Grouping,
+    Unit,
+    Assign,
+    Block,
+    If,
+    While,
+    For,
+    Function,
+    Parameter,
+    Type,
+    Let,
+    ExpressionStatement,
+};
+
+// One node of the tree Parser would build, as seen on entering and on leaving it. Children arrive between
+// the two calls in the order Parser stores them:
+//   Program      the statements and trailing value of the input; `span` covers the whole input
+//   Let          [Type] initializer; `text` is the name and `detail_span` its span
+//   Function     Parameter... Type body, where Type is the return type
+//   Parameter    Type; `text` is the name and `span` its span
+//   Assign       Variable value
+// Prefix and Infix carry `op` and the operator's `detail_span`; Number, Boolean, String, Variable and Type are
+// leaves with their payload in `number`, `boolean` or `text`. `text` points into the parser's tokens.
+struct ParseEvent {
+    ParseEventKind kind{ParseEventKind::Unit};
+    TokenType op{TokenType::End};
+    bool boolean{false};
+    SourceSpan span{};
+    SourceSpan detail_span{};
+    std::string_view text{};
+    double number{0.0};
+};
+
+// Parses the same grammar as Parser but reports each node to a visitor instead of allocating it:
+//
+//   struct Visitor {
+//       void enter(const ParseEvent& event);
+//       void leave(const ParseEvent& event);
+//   };
+//
+// Events are produced one top-level statement at a time into a reused buffer and then replayed to the
+// visitor, so a statement is delivered only once it parsed completely and memory does not grow with the
+// input. Errors are the ParseErrors Parser::parse would throw, raised after the statements before them were
+// delivered. `tokens` and `line_offsets` are borrowed and must outlive the parser. Function bodies are
+// always parsed eagerly.
+class EventParser {
+   public:
+    EventParser(const std::vector<Token>& tokens, const std::vector<std::size_t>& line_offsets, std::string source_name);
+
+    template <typename Visitor>
+    void parse(Visitor& visitor);
+
+   private:
+    struct Event {
+        ParseEvent data;
+        // For an enter event: distance to a later enter event of the node that wraps this one.
+        std::uint32_t forward_parent{0};
+        bool leave{false};
+        bool replayed{false};
+    };
+
+    // A node whose events are complete.
+    struct Completed {
+        std::uint32_t marker;
+        ParseEventKind kind;
+        SourceSpan span;
+    };
+
+    bool parse_item();
+    bool parse_sequence_item(bool& is_value);
+    Completed parse_let_statement();
+    Completed parse_fn_statement();
+    Completed parse_expression(int precedence_floor = 0);
+    Completed parse_prefix(const Token& token);
+    Completed parse_grouping(const Token& open);
+    Completed parse_block(const Token& open);
+    Completed parse_if(const Token& if_token);
+    Completed parse_while(const Token& while_token);
+    Completed parse_for(const Token& for_token);
+    Completed parse_function_literal(const Token& fn_token);
+    void parse_type();
+
+    std::uint32_t start(ParseEventKind kind);
+    Completed finish(std::uint32_t marker, SourceSpan span);
+    std::uint32_t precede(const Completed& child, ParseEventKind kind);
+    Completed leaf(ParseEventKind kind, const Token& token);
+
+    bool match(TokenType type);
+    const Token& advance();
+    bool check(TokenType type) const;
+    bool is_at_end() const;
+    const Token& peek(std::size_t offset = 0) const;
+    const Token& previous() const;
+    const Token& consume(TokenType type, std::string_view message);
+    ParseError make_error(const std::string& message, SourceSpan span, bool incomplete) const;
+
+    template <typename Visitor>
+    void replay(Visitor& visitor);
+
+    const std::vector<Token>& tokens_;
+    const std::vector<std::size_t>& line_offsets_;
+    std::string source_name_;
+    std::size_t current_{0};
+    std::size_t depth_{0};
+    bool finished_{false};
+    std::vector<Event> events_;
+    std::vector<std::uint32_t> chain_;
+};
+
+template <typename Visitor>
+void EventParser::parse(Visitor& visitor) {
+    current_ = 0;
+    depth_ = 0;
+    finished_ = false;
+    ParseEvent program{};
+    program.kind = ParseEventKind::Program;
+    program.span = SourceSpan{0, tokens_.back().span.end};
+
+    visitor.enter(program);
+    while (parse_item()) {
+        replay(visitor);
+    }
+    visitor.leave(program);
+}
+
+template <typename Visitor>
+void EventParser::replay(Visitor& visitor) {
+    for (std::uint32_t index = 0; index < events_.size(); ++index) {
+        Event& event = events_[index];
+        if (event.leave) {
+            visitor.leave(event.data);
+            continue;
+        }
+        if (event.replayed) {
+            continue;
+        }
+
+        // Nodes started after their first child (infix operators, assignments, expression statements) are
+        // linked from that child's enter event; enter them outermost first.
+        chain_.clear();
+        for (std::uint32_t link = index;; link += events_[link].forward_parent) {
+            chain_.push_back(link);
+            events_[link].replayed = true;
+            if (events_[link].forward_parent == 0) {
+                break;
+            }
+        }
+        for (auto it = chain_.rbegin(); it != chain_.rend(); ++it) {
+            visitor.enter(events_[*it].data);
+        }
+    }
+}
+
+}  // namespace sonar
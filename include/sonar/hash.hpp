@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace sonar {
+
+// Finalizer from splitmix64; spreads every input bit over the whole result.
+constexpr std::uint64_t hash_mix(std::uint64_t value) noexcept {
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return value;
+}
+
+constexpr std::uint64_t hash_combine(std::uint64_t seed, std::uint64_t value) noexcept {
+    return hash_mix(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+}
+
+// Hashes `bytes` eight at a time. The result depends on the host byte order.
+inline std::uint64_t hash_bytes(std::string_view bytes, std::uint64_t seed = 0) noexcept {
+    std::uint64_t hash = hash_combine(seed, bytes.size());
+    std::size_t index = 0;
+    for (; index + sizeof(std::uint64_t) <= bytes.size(); index += sizeof(std::uint64_t)) {
+        std::uint64_t chunk;
+        std::memcpy(&chunk, bytes.data() + index, sizeof(chunk));
+        hash = hash_combine(hash, chunk);
+    }
+    if (index < bytes.size()) {
+        std::uint64_t tail = 0;
+        std::memcpy(&tail, bytes.data() + index, bytes.size() - index);
+        hash = hash_combine(hash, tail);
+    }
+    return hash;
+}
+
+}  // namespace sonar
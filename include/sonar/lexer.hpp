@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <iosfwd>
+#include <memory_resource>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -12,9 +16,65 @@ struct LexResult {
     std::vector<std::size_t> line_offsets;
 };
 
+// A LexResult whose vectors allocate from a std::pmr::memory_resource. Lexemes longer than the small-string
+// buffer still use the global heap.
+struct PmrLexResult {
+    std::pmr::vector<Token> tokens;
+    std::pmr::vector<std::size_t> line_offsets;
+};
+
 class Lexer {
    public:
     LexResult tokenize(std::string_view source) const;
+
+    // Lexes `source` into `result`, replacing its contents but keeping the capacity of its vectors.
+    void tokenize(std::string_view source, LexResult& result) const;
+
+    // Lexes `source` into vectors allocated from `resource`, or std::pmr::get_default_resource() when it is
+    // null. The resource must outlive the result.
+    PmrLexResult tokenize(std::string_view source, std::pmr::memory_resource* resource) const;
+
+    // Updates `lexed`, the result of lexing some text, to that of `source`: the text after `edit`. Only the
+    // tokens from the last one before the edit until the new stream lines up with the old one again are
+    // rescanned and replaced in place; the tokens after them keep their lexemes and have their spans moved.
+    // Throws like tokenize on a lexical error, leaving `lexed` as it was.
+    void retokenize(LexResult& lexed, std::string_view source, const TextEdit& edit) const;
+};
+
+// Lexes text read from a stream one token at a time, producing the tokens and errors tokenize would for the
+// whole text. It holds the text from the start of the line holding the oldest position not yet released, so
+// its memory is bounded by what the caller keeps unreleased rather than by the length of the input.
+class TokenReader {
+   public:
+    explicit TokenReader(std::istream& input);
+
+    // Lexes the next token, or returns the End token once the input is exhausted.
+    Token next();
+
+    // Lets go of the text and line starts before the line holding `offset`, which must not be before an
+    // earlier release. Text is freed in batches, so some of it may stay until a later call.
+    void release(std::size_t offset);
+
+    // Starts of the lines still held, from one at or before the first unreleased offset up to the last token
+    // read, as offsets into the whole input, and the number of lines before them.
+    std::vector<std::size_t> line_offsets() const;
+    std::size_t lines_before() const noexcept { return lines_before_; }
+
+   private:
+    // Appends at least one more block of the input to text_; returns false at the end of the input.
+    bool read_more();
+
+    std::istream& input_;
+    bool at_end_of_input_{false};
+    // The input from offset `base_`, which is always the start of a line.
+    std::string text_;
+    std::size_t base_{0};
+    // Where scanning resumes, in text_.
+    std::size_t scanned_{0};
+    // The token being scanned, and the starts of the lines in text_ relative to it; the first is 0.
+    LexResult lexed_;
+    std::size_t lines_before_{0};
+    std::size_t tokens_read_{0};
 };
 
 }  // namespace sonar
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sonar::metrics {
+
+// Counters and histograms keep one cell per shard, each on its own cache line, and a thread always adds to
+// the same shard, so threads updating one metric rarely share a line. Reads sum the shards.
+inline constexpr std::size_t kShards = 16;
+
+// The shard of the calling thread, assigned round robin on first use.
+std::size_t this_thread_shard() noexcept;
+
+// A monotonically increasing count.
+class Counter {
+   public:
+    void add(std::uint64_t amount = 1) noexcept {
+        cells_[this_thread_shard()].value.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    std::uint64_t value() const noexcept;
+
+   private:
+    struct alignas(64) Cell {
+        std::atomic<std::uint64_t> value{0};
+    };
+
+    std::array<Cell, kShards> cells_;
+};
+
+// Adds to a Counter in a plain integer and hands the total over when flushed or destroyed, for increments
+// too frequent to pay for an atomic each, such as one per syntax tree node. Moving hands the pending total
+// to the new batch.
+class CounterBatch {
+   public:
+    explicit CounterBatch(Counter& counter) noexcept : counter_(&counter) {}
+    ~CounterBatch() { flush(); }
+
+    CounterBatch(CounterBatch&& other) noexcept : counter_(other.counter_), pending_(std::exchange(other.pending_, 0)) {}
+    CounterBatch& operator=(CounterBatch&& other) noexcept {
+        flush();
+        counter_ = other.counter_;
+        pending_ = std::exchange(other.pending_, 0);
+        return *this;
+    }
+
+    void add(std::uint64_t amount = 1) noexcept { pending_ += amount; }
+
+    void flush() noexcept {
+        if (pending_ != 0) {
+            counter_->add(std::exchange(pending_, 0));
+        }
+    }
+
+   private:
+    Counter* counter_;
+    std::uint64_t pending_{0};
+};
+
+// Durations counted into fixed buckets, exposed in seconds like Prometheus histograms.
+class LatencyHistogram {
+   public:
+    using Duration = std::chrono::nanoseconds;
+
+    // From 10 microseconds to 10 seconds.
+    static std::vector<Duration> default_buckets();
+
+    // Bucket upper bounds, strictly increasing; an implicit last bucket takes everything above them.
+    // Throws std::invalid_argument when the bounds are empty or not increasing.
+    explicit LatencyHistogram(std::vector<Duration> upper_bounds = default_buckets());
+
+    void observe(Duration duration) noexcept;
+
+    struct Snapshot {
+        // Observations at or below each upper bound, then the total count.
+        std::vector<std::uint64_t> cumulative;
+        Duration sum{0};
+
+        std::uint64_t count() const noexcept { return cumulative.empty() ? 0 : cumulative.back(); }
+    };
+
+    const std::vector<Duration>& upper_bounds() const noexcept { return upper_bounds_; }
+
+    Snapshot snapshot() const;
+
+   private:
+    struct alignas(64) Shard {
+        std::unique_ptr<std::atomic<std::uint64_t>[]> buckets;
+        std::atomic<std::int64_t> sum_nanoseconds{0};
+    };
+
+    std::vector<Duration> upper_bounds_;
+    std::array<Shard, kShards> shards_;
+};
+
+// Observes the time from its construction to its destruction into `histogram`.
+class ScopedLatency {
+   public:
+    explicit ScopedLatency(LatencyHistogram& histogram) noexcept
+        : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedLatency() { histogram_.observe(std::chrono::steady_clock::now() - start_); }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+   private:
+    LatencyHistogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+// Named metrics, grouped into families that share a name and differ by labels. Metrics are created once and
+// live as long as the registry, so callers look them up once and keep the reference:
+//
+//   static auto& requests = sonar::metrics::Registry::global().counter("app_requests_total", "Requests.");
+//   requests.add();
+class Registry {
+   public:
+    Registry() = default;
+
+    Registry(const Registry&) = delete;
+    Registry& operator=(const Registry&) = delete;
+
+    // The registry the library reports to.
+    static Registry& global();
+
+    // The metric with `name` and `labels`, created on first use. Throws std::invalid_argument when a name or
+    // label name is not a valid Prometheus name, or when `name` already names a metric of another type.
+    Counter& counter(const std::string& name, const std::string& help, const Labels& labels = {});
+    LatencyHistogram& latency_histogram(const std::string& name, const std::string& help, const Labels& labels = {},
+                                        std::vector<LatencyHistogram::Duration> upper_bounds =
+                                            LatencyHistogram::default_buckets());
+
+    // Writes every metric in the Prometheus text exposition format, families sorted by name.
+    void write_prometheus(std::ostream& out) const;
+
+   private:
+    enum class Type { Counter, Histogram };
+
+    struct Family {
+        Type type;
+        std::string help;
+        std::vector<std::pair<Labels, std::unique_ptr<Counter>>> counters;
+        std::vector<std::pair<Labels, std::unique_ptr<LatencyHistogram>>> histograms;
+    };
+
+    Family& family(const std::string& name, const std::string& help, Type type, const Labels& labels);
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+};
+
+// What the lexer, parser and printer report to Registry::global(). Each is updated once per call rather
+// than once per token or node, so instrumenting them costs a few atomic adds per call.
+struct FrontendMetrics {
+    // Tokens and source bytes produced by Lexer::tokenize.
+    Counter& lexed_tokens;
+    Counter& lexed_bytes;
+    LatencyHistogram& lex_latency;
+    // Expression and statement nodes created by Parser, including deferred and parallel parses.
+    Counter& ast_nodes;
+    // Parser::parse, parse_streaming and parse_parallel, whether they succeed or not.
+    LatencyHistogram& parse_latency;
+    // Bytes returned by pretty_print.
+    Counter& printed_bytes;
+    LatencyHistogram& print_latency;
+    // Errors thrown by Lexer::tokenize and the Parser calls above, by kind.
+    Counter& lex_errors;
+    Counter& syntax_errors;
+    Counter& incomplete_errors;
+};
+
+const FrontendMetrics& frontend();
+
+}  // namespace sonar::metrics
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "sonar/ast.hpp"
+
+namespace sonar {
+
+// Every Expression and Statement a Parser creates gets an id, counting from zero in the order the nodes are
+// created, which puts children before their parents. The id lives in the node's allocation header, so it
+// costs the node structs nothing, and stays with the node for its lifetime.
+//
+// Ids are dense: a tree's nodes have the ids from zero to node_id_bound(root) - 1. parse_parallel numbers
+// each chunk after the ones before it, so its ids are those of a sequential parse. A body skipped by
+// ParserOptions::lazy_function_bodies takes the next ids of its tree when it is parsed, raising the bound, so
+// its ids depend on the order bodies are read in and a NodeMap built before then grows to fit them. The root
+// must still be alive at that point. Parser::reparse keeps the ids of the nodes it moves over and gives the
+// new nodes the ids of the ones they replace, then ids from the bound; when it leaves fewer nodes than it
+// replaced, the nodes holding the highest ids take over the ids left free. A full parse it falls back to
+// numbers from zero again.
+//
+// Trees built some other way (materialize, SyntaxInterner::rebuild, by hand) have kNoNodeId on every node
+// until number_nodes is called. Nodes must have been allocated with `new`, as every tree the library
+// produces is.
+inline NodeId node_id(const Expression& expression) noexcept {
+    return *detail::NodeAllocation<Expression, true>::id_slot(&expression);
+}
+
+inline NodeId node_id(const Statement& statement) noexcept {
+    return *detail::NodeAllocation<Statement, true>::id_slot(&statement);
+}
+
+// One more than the largest id in the tree, as recorded on its root; zero for an unnumbered tree. May be read
+// while deferred bodies are parsed on other threads.
+inline NodeId node_id_bound(const Expression& root) noexcept {
+    return std::atomic_ref<NodeId>(*detail::NodeAllocation<Expression, true>::id_bound_slot(&root))
+        .load(std::memory_order_relaxed);
+}
+
+// Numbers the nodes of `root` from zero in postorder, which is the order a parse creates them in, and
+// records the bound on `root`. Parses deferred function bodies. Returns the bound.
+NodeId number_nodes(Expression& root);
+
+// Data attached to the nodes of one tree, in a vector indexed by node id: a lookup is one bounds check and
+// one index, with no hashing. The map grows to fit the ids it is indexed with; construct it from the root
+// to allocate once up front. Every node in range has a value, default-constructed until it is assigned.
+template <typename T>
+class NodeMap {
+    static_assert(!std::is_same_v<T, bool>, "std::vector<bool> has no T&; use NodeMap<char>");
+
+   public:
+    NodeMap() = default;
+
+    explicit NodeMap(const Expression& root, const T& value = T{}) : values_(node_id_bound(root), value) {}
+
+    T& operator[](const Expression& expression) { return at_id(node_id(expression)); }
+    T& operator[](const Statement& statement) { return at_id(node_id(statement)); }
+
+    // The node's value, or nullptr when its id is beyond the map.
+    const T* find(const Expression& expression) const { return find_id(node_id(expression)); }
+    const T* find(const Statement& statement) const { return find_id(node_id(statement)); }
+
+    T& at_id(NodeId id) {
+        if (id >= values_.size()) {
+            grow(id);
+        }
+        return values_[id];
+    }
+
+    const T* find_id(NodeId id) const { return id < values_.size() ? &values_[id] : nullptr; }
+
+    std::size_t size() const noexcept { return values_.size(); }
+
+    void clear() noexcept { values_.clear(); }
+
+   private:
+    void grow(NodeId id) {
+        if (id == kNoNodeId) {
+            throw std::invalid_argument("Node has no id; call number_nodes on its tree first");
+        }
+        values_.resize(static_cast<std::size_t>(id) + 1);
+    }
+
+    std::vector<T> values_;
+};
+
+}  // namespace sonar
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "sonar/ast.hpp"
+#include "sonar/parser.hpp"
+
+namespace sonar {
+
+// Part of every ParseCache key. Bump it whenever the lexer or parser changes the trees or errors they produce.
+inline constexpr std::uint32_t kFrontEndVersion = 1;
+
+// Remembers the result of lexing and parsing a source so that parsing the same bytes again is a hash lookup
+// and a comparison. Trees are shared and immutable; errors are cached too and rethrown. Entries are evicted
+// least recently used first once their estimated size, which counts their copy of the source, exceeds the
+// byte budget. Safe to use from several threads; sources are parsed outside the lock.
+class ParseCache {
+   public:
+    static constexpr std::size_t kDefaultByteBudget = std::size_t{64} << 20;
+
+    explicit ParseCache(std::size_t byte_budget = kDefaultByteBudget);
+
+    // Returns the tree for `source`, or rethrows the error parsing it raised. Entries are found by a 64-bit
+    // hash of the source bytes, kFrontEndVersion and `options`, and keep a copy of the source that must
+    // match byte for byte, so a hash collision is a miss rather than another source's tree. An eagerly
+    // parsed tree does not depend on `source_name`, so it is shared across names. The name must match too
+    // for lazily parsed trees, whose deferred bodies report errors under it, and a cached error is only
+    // reused for the name it was raised under. `options.memory_resource` is ignored: cached trees always use
+    // the default resource.
+    std::shared_ptr<const Expression> parse(std::string_view source, const std::string& source_name,
+                                            ParserOptions options = {});
+
+    struct Stats {
+        std::size_t hits{0};
+        std::size_t misses{0};
+        std::size_t entries{0};
+        std::size_t bytes{0};
+    };
+
+    Stats stats() const;
+
+    void clear();
+
+   private:
+    struct Key {
+        std::uint64_t hash;
+        std::size_t size;
+
+        friend bool operator==(const Key&, const Key&) = default;
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key& key) const noexcept { return static_cast<std::size_t>(key.hash); }
+    };
+
+    struct Entry {
+        Key key;
+        std::string source;
+        bool lazy{false};
+        // The name a lazily parsed tree or an error was produced under; empty otherwise.
+        std::string source_name;
+        std::shared_ptr<const Expression> tree;
+        std::exception_ptr error;
+        std::size_t bytes{0};
+
+        bool matches(std::string_view source, const std::string& source_name, ParserOptions options) const;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    static Key make_key(std::string_view source, const std::string& source_name, ParserOptions options);
+    void insert(Entry entry);
+    void evict_to(std::size_t budget);
+
+    mutable std::mutex mutex_;
+    std::size_t byte_budget_;
+    std::size_t bytes_{0};
+    std::size_t hits_{0};
+    std::size_t misses_{0};
+    // Most recently used first.
+    EntryList entries_;
+    std::unordered_map<Key, EntryList::iterator, KeyHash> index_;
+};
+
+}  // namespace sonar
@@ -1,17 +1,31 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
+#include <iosfwd>
 #include <memory>
+#include <memory_resource>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 #include "sonar/ast.hpp"
+#include "sonar/metrics.hpp"
 #include "sonar/token.hpp"
 
 namespace sonar {
 
+class CompilationSession;
+class StructuralHashCache;
+class SyntaxInterner;
+class ThreadPool;
+class TraceRecorder;
+struct InternedTree;
+struct LexResult;
+
 class ParseError : public std::runtime_error {
    public:
     ParseError(std::string message, bool incomplete, SourceSpan span, SourceLocation location, std::string source_name)
@@ -36,13 +50,85 @@ class ParseError : public std::runtime_error {
     std::string source_name_{};
 };
 
+// How deeply expressions may nest before parsing fails with a ParseError instead of running out of stack,
+// in the parser or in anything that walks its trees recursively. Parentheses, blocks, prefix operators and
+// the right operand of an operator or assignment each nest one level. An operator chain such as `a + b + c`
+// does not: the parser builds it in a loop, and code walking the tree follows an Infix node's left operands
+// in a loop as well, so chains may be arbitrarily long.
+inline constexpr std::size_t kMaxNestingDepth = 1000;
+
+struct ParserOptions {
+    // Skip `fn` bodies that are plain blocks by brace matching and parse them on first access instead
+    // (see Expression::Function::deferred_body). Syntax errors inside a skipped body surface only when it
+    // is read.
+    bool lazy_function_bodies{false};
+
+    // Where the nodes of the tree (and the parser's shared copies of tokens and line offsets) are allocated;
+    // null means std::pmr::get_default_resource(). The resource must outlive the tree, and must be
+    // thread-safe for parse_parallel or when deferred bodies are read from several threads. Function
+    // parameter lists come from it too. Block statement lists, and names and literals too long for the
+    // small-string buffer, still use the global heap: a std::pmr::vector in Expression::Block would make
+    // every Expression 8 bytes larger (see parser_benchmark.cpp).
+    std::pmr::memory_resource* memory_resource{nullptr};
+
+    // Where parse_parallel records a "parse chunk" span for each chunk, on the thread that parsed it; null
+    // records nothing. Must outlive the parse.
+    TraceRecorder* trace{nullptr};
+};
+
 class Parser {
    public:
-    Parser(std::vector<Token> tokens, std::vector<std::size_t> line_offsets, std::string source_name);
+    Parser(std::vector<Token> tokens, std::vector<std::size_t> line_offsets, std::string source_name,
+           ParserOptions options = {});
 
     ExpressionPtr parse();
 
+    using StatementCallback = std::function<void(StatementPtr)>;
+
+    // Parses the program one top-level item at a time, handing each statement to `on_statement` as soon as
+    // it is complete, and returns the trailing expression or nullptr. The statements and value are the
+    // ones `parse()` would put in the program's block; an error is thrown after the statements before it
+    // have been delivered.
+    ExpressionPtr parse_streaming(const StatementCallback& on_statement);
+
+    // Delivers what parse_streaming would for the whole of `input`, but lexes it as it goes: it reads up to the
+    // end of the next top-level item, found with the scan parse_parallel uses, parses the item and lets go of
+    // its text and tokens. Memory is bounded by the longest item rather than the input, and the first
+    // statement arrives once its item has been read. Lexer errors are thrown as Lexer::tokenize throws them,
+    // but only once reading reaches them, so statements before them are delivered and an earlier syntax
+    // error is thrown instead.
+    static ExpressionPtr parse_streaming(std::istream& input, std::string source_name,
+                                         const StatementCallback& on_statement, ParserOptions options = {});
+
+    // Produces the same tree, or throws the same error, as `parse()`. Top-level statement boundaries are
+    // found with a bracket-depth scan over the tokens and the statements between them are parsed on `pool`.
+    ExpressionPtr parse_parallel(ThreadPool& pool);
+
+    // Parses into `interner` one top-level statement at a time, so only the largest statement is ever held
+    // as an owning tree. `interner.rebuild` on the result yields what `parse()` returns.
+    InternedTree parse_interned(SyntaxInterner& interner);
+
+    // Parses `previous`'s source after `edit`, given its tokens as Lexer::retokenize leaves them in `lexed`.
+    // Only the innermost block or top-level statement enclosing the edit is reparsed. The rest of `previous` is
+    // moved into the result, and since spans are relative (see Expression) only the spans of that node's
+    // ancestors and of their children after it change. Falls back to a full parse when the edit crosses those
+    // boundaries, so the result always matches one. `lexed` is borrowed for the call alone, so the function
+    // bodies it parses are never deferred. `hashes`, when given, holds structural hashes of `previous` and is
+    // updated to hold only hashes that are still right for the result.
+    static ExpressionPtr reparse(ExpressionPtr previous, const LexResult& lexed, const TextEdit& edit,
+                                 std::string source_name, ParserOptions options = {},
+                                 StructuralHashCache* hashes = nullptr);
+
    private:
+    // Lends its reused token buffers to the private constructor.
+    friend class CompilationSession;
+
+    using SharedTokens = std::shared_ptr<const std::vector<Token>>;
+    using SharedLineOffsets = std::shared_ptr<const std::vector<std::size_t>>;
+
+    Parser(SharedTokens tokens, SharedLineOffsets line_offsets, std::string source_name, ParserOptions options,
+           std::size_t start);
+
     enum class Precedence : int {
         Lowest = 0,
         Assignment,
@@ -55,15 +141,16 @@ class Parser {
         Prefix,
     };
 
-    using PrefixParselet = std::function<ExpressionPtr(Parser&, Token)>;
-    using InfixParselet = std::function<ExpressionPtr(Parser&, ExpressionPtr, Token, Precedence, bool)>;
+    using PrefixParselet = ExpressionPtr (Parser::*)(Token);
+    using InfixParselet = ExpressionPtr (Parser::*)(ExpressionPtr, Token, Precedence, bool);
 
     struct InfixRule {
-        Precedence precedence;
-        bool right_associative;
-        InfixParselet parselet;
+        Precedence precedence{Precedence::Lowest};
+        bool right_associative{false};
+        InfixParselet parselet{nullptr};
     };
 
+    // The rule tables are constant-initialised and never written, so any number of parsers may run at once.
     static const PrefixParselet* find_prefix_rule(TokenType type);
     static const InfixRule* find_infix_rule(TokenType type);
 
@@ -74,7 +161,35 @@ class Parser {
         ExpressionPtr value;
     };
 
+    // A statement, or the trailing expression of a sequence when it is not followed by ';'.
+    struct SequenceItem {
+        StatementPtr statement;
+        ExpressionPtr value;
+    };
+
     StatementSequence parse_sequence(TokenType terminator);
+    SequenceItem parse_sequence_item();
+    ExpressionPtr finish_program(StatementSequence sequence);
+    ExpressionPtr record_id_bound(ExpressionPtr root);
+    void assign_ids();
+    std::vector<std::size_t> find_top_level_boundaries() const;
+
+    // Finds where top-level items end, one token at a time; see find_top_level_boundaries.
+    class TopLevelScan {
+       public:
+        // Takes the next token's type and the type of the one after it, and returns whether an item ends
+        // with the token.
+        bool ends_item(TokenType type, TokenType next);
+
+       private:
+        std::size_t depth_{0};
+        bool at_item_start_{true};
+        bool in_fn_item_{false};
+        bool in_fn_body_{false};
+        TokenType previous_{TokenType::End};
+        TokenType before_previous_{TokenType::End};
+    };
+
     StatementPtr parse_statement();
     StatementPtr parse_let_statement();
     StatementPtr parse_fn_statement();
@@ -87,10 +202,10 @@ class Parser {
     const Token& peek() const;
     const Token& peek(std::size_t offset) const;
     const Token& previous() const;
-    const Token& consume(TokenType type, const std::string& message);
+    const Token& consume(TokenType type, std::string_view message);
 
     ExpressionPtr parse_number(Token literal);
-    ExpressionPtr parse_assignment(ExpressionPtr left, Token op, Precedence precedence);
+    ExpressionPtr parse_assignment(ExpressionPtr left, Token op, Precedence precedence, bool right_associative);
     ExpressionPtr parse_boolean(Token literal);
     ExpressionPtr parse_string(Token literal);
     ExpressionPtr parse_grouping(Token open);
@@ -102,15 +217,78 @@ class Parser {
     ExpressionPtr parse_for(Token for_token);
     ExpressionPtr parse_identifier(Token name);
     ExpressionPtr parse_function_literal(Token fn_token);
+    std::unique_ptr<DeferredExpression> defer_function_body(std::size_t function_start);
     TypeAnnotation parse_type();
 
+    // Expressions and Statements are numbered in creation order; see node_map.hpp.
+    template <typename Node, typename... Args>
+    std::unique_ptr<Node> make_node(Args&&... args) {
+        std::unique_ptr<Node> node(new (options_.memory_resource) Node(std::forward<Args>(args)...));
+        if constexpr (std::is_same_v<Node, Expression> || std::is_same_v<Node, Statement>) {
+            NodeId* id = detail::NodeAllocation<Node, true>::id_slot(node.get());
+            *id = next_id_++;
+            if (record_ids_) {
+                created_ids_.push_back(id);
+            }
+            nodes_made_.add();
+            make_spans_relative(*node);
+        }
+        return node;
+    }
+
+    // Makes the spans of a node just made, given in source offsets like those of its children, relative; see
+    // Expression.
+    static void make_spans_relative(Expression& expression);
+    static void make_spans_relative(Statement& statement);
+
+    // Runs one of the public parse calls, reporting its latency and any error to metrics::frontend().
+    template <typename Body>
+    static auto measured(Body&& body) {
+        const auto& metrics = metrics::frontend();
+        metrics::ScopedLatency latency(metrics.parse_latency);
+        try {
+            return body();
+        } catch (const ParseError& error) {
+            (error.incomplete() ? metrics.incomplete_errors : metrics.syntax_errors).add();
+            throw;
+        }
+    }
+
+    ExpressionPtr parse_program();
+    ExpressionPtr parse_chunks(ThreadPool& pool);
+    ExpressionPtr reparse(ExpressionPtr previous, const TextEdit& edit, StructuralHashCache* hashes);
+
     ParseError make_error(const std::string& message, SourceSpan span, bool incomplete) const;
     SourceLocation location_for(std::size_t offset) const;
 
-    std::vector<Token> tokens_;
+    SharedTokens tokens_;
     std::size_t current_{0};
-    std::vector<std::size_t> line_offsets_;
+    SharedLineOffsets line_offsets_;
+    // Lines before the first of line_offsets_, when it only holds the lines of part of the input.
+    std::size_t line_base_{0};
     std::string source_name_;
+    ParserOptions options_;
+    NodeId next_id_{0};
+
+    // Where nodes parsed apart from the main parse take their ids, shared by every parser working on one tree.
+    // Once the main parse has returned its root, that is the root's id bound, which deferred bodies raise as
+    // they are parsed; a streaming parse has no root and counts in `next`.
+    struct IdSource {
+        Expression* root{nullptr};
+        std::atomic<NodeId> next{0};
+
+        NodeId take(NodeId count);
+    };
+    std::shared_ptr<IdSource> id_source_{std::make_shared<IdSource>()};
+    // With record_ids_, the id slot of every node made, for assign_ids to number once the count is known.
+    bool record_ids_{false};
+    std::vector<NodeId*> created_ids_;
+    // Whether defer_function_body looked for a closing brace all the way to the End token, which the streaming
+    // parse needs to know when that End only stands in for input not read yet.
+    bool scanned_to_end_{false};
+    // Nesting of the expression being parsed; see kMaxNestingDepth.
+    std::size_t depth_{0};
+    metrics::CounterBatch nodes_made_{metrics::frontend().ast_nodes};
 };
 
 }  // namespace sonar
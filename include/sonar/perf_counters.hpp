@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace sonar {
+
+// Hardware events counted by PerfCounters.
+enum class PerfEvent : std::uint8_t {
+    Cycles,
+    Instructions,
+    BranchMisses,
+    // Level 1 data cache read misses.
+    L1dMisses,
+    // Last level cache misses.
+    LlcMisses,
+};
+
+inline constexpr std::size_t kPerfEventCount = 5;
+
+std::string_view to_string(PerfEvent event);
+
+// Counts over one measured interval. An event is missing when its counter could not be opened or never got
+// scheduled; counts of multiplexed counters are scaled up to the whole interval.
+struct PerfReading {
+    std::array<std::optional<std::uint64_t>, kPerfEventCount> counts{};
+
+    std::optional<std::uint64_t> operator[](PerfEvent event) const { return counts[static_cast<std::size_t>(event)]; }
+
+    // Instructions per cycle.
+    std::optional<double> ipc() const;
+
+    // `event` per unit of work, such as branch misses per token; missing when the event is missing or
+    // `units` is 0.
+    std::optional<double> per(PerfEvent event, double units) const;
+
+    // Adds counts event by event; an event stays missing only while it is missing on both sides.
+    PerfReading& operator+=(const PerfReading& other);
+};
+
+// Hardware counters for the calling thread, counting user-space code only, read with perf_event_open on
+// Linux. Counters the kernel, a container or the hardware refuse are left out rather than failing, so
+// callers can always measure and print whatever is available:
+//
+//   sonar::PerfCounters counters;
+//   const auto reading = counters.measure([&] { parser.parse(); });
+//   if (const auto ipc = reading.ipc()) { ... }
+class PerfCounters {
+   public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available(PerfEvent event) const { return fds_[static_cast<std::size_t>(event)] >= 0; }
+
+    bool any_available() const;
+
+    // Why the first counter that is not available could not be opened, or an empty string.
+    const std::string& unavailable_reason() const { return unavailable_reason_; }
+
+    // Zeroes and starts the counters; `stop` stops them and reads them.
+    void start();
+    PerfReading stop();
+
+    template <typename Body>
+    PerfReading measure(Body&& body) {
+        start();
+        body();
+        return stop();
+    }
+
+   private:
+    std::array<int, kPerfEventCount> fds_{};
+    std::string unavailable_reason_;
+};
+
+}  // namespace sonar
@@ -1,11 +1,24 @@
 #pragma once
 
+#include <memory_resource>
 #include <string>
 
 #include "sonar/ast.hpp"
 
 namespace sonar {
 
+class EventParser;
+
 std::string pretty_print(const Expression& expression);
+std::string pretty_print(const Statement& statement);
+
+// Prints into a string allocated from `resource`. The tree is appended to a single buffer, so with a
+// monotonic resource printing makes no calls to the global heap.
+std::pmr::string pretty_print(const Expression& expression, std::pmr::memory_resource* resource);
+std::pmr::string pretty_print(const Statement& statement, std::pmr::memory_resource* resource);
+
+// Prints the program `parser` reads exactly as `pretty_print` prints the tree Parser::parse builds for it,
+// without building that tree.
+std::string pretty_print_events(EventParser& parser);
 
 }  // namespace sonar
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace sonar {
+
+// Relative weights of the operators in generated expressions. A weight of zero leaves the operators out.
+struct OperatorMix {
+    // + - * /
+    unsigned arithmetic{4};
+    // && ||
+    unsigned logical{1};
+    // & |
+    unsigned bitwise{1};
+    // Unary minus in front of an operand.
+    unsigned prefix{1};
+    // `name = value`, nested inside other expressions.
+    unsigned assignment{1};
+};
+
+struct GeneratorOptions {
+    // Equal options give byte-identical programs on every platform and standard library.
+    std::uint64_t seed{1};
+
+    // Top-level statements are generated until the program is at least this long; the last one overshoots
+    // by at most its own length.
+    std::size_t target_bytes{64 * 1024};
+
+    // The most statements in a block and the most operands in an operator chain.
+    std::size_t width{6};
+
+    // How many blocks, groupings, operator chains and other compound expressions may enclose each other.
+    // A level of depth adds at most three levels of the parser's nesting, so `3 * (depth + 1)` must stay below
+    // kMaxNestingDepth for every program to parse.
+    std::size_t depth{5};
+
+    OperatorMix operators{};
+
+    // The share of statements that are fn items, and of the rest that are let statements; the others are
+    // expression statements, including if, while and for.
+    double fn_density{0.15};
+    double let_density{0.4};
+
+    // The share of literal operands that are strings with escapes and raw strings, and the share of
+    // statements that get a line or block comment.
+    double string_ratio{0.1};
+    double raw_string_ratio{0.05};
+    double comment_ratio{0.1};
+};
+
+// Produces a syntactically valid program shaped by `options`, using every kind of node in ast.hpp, and
+// hands it to `write` in chunks of whole top-level statements, so a program far larger than memory can be
+// written out. Throws std::invalid_argument for options that could not produce a valid program.
+void generate_program(const GeneratorOptions& options, const std::function<void(std::string_view chunk)>& write);
+
+std::string generate_program(const GeneratorOptions& options);
+
+}  // namespace sonar
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sonar/token.hpp"
+
+namespace sonar {
+
+// Decides whether a candidate still shows the behaviour being reduced, such as parsing slower per byte than
+// some threshold. Candidates need not lex or parse.
+using ReducePredicate = std::function<bool(std::string_view source)>;
+
+struct ReduceStats {
+    // Calls to the predicate, and how many of them accepted their candidate.
+    std::size_t attempts{0};
+    std::size_t reductions{0};
+};
+
+// The edits `reduce` tries on `source`, largest reduction first. For a program that parses:
+//   - delete a run of consecutive statements of one block, with their ';', halving the run length down to
+//     single statements, and delete a block's trailing value
+//   - replace an expression or statement by one of its child expressions
+//   - rename a variable or let binding to `x`, and replace a number by `0` and a string by `""`, so the
+//     names and literals of the original do not survive
+//   - delete a ';', and delete the whitespace and comments between two tokens or shrink them to one space
+// A program that does not parse gets the same halving runs over its tokens, or over its lines and then its
+// bytes when it does not lex either.
+std::vector<TextEdit> reduction_candidates(std::string_view source);
+
+// Shrinks `source` while `interesting` holds, and returns the result: an input on which no candidate edit
+// keeps the predicate true. Every edit either shrinks the input or puts a name or literal into its canonical
+// form, so reduction terminates. After an accepted edit the candidates are recomputed and the sweep resumes
+// at the same position instead of starting over; sweeps repeat until one accepts nothing.
+// Throws std::invalid_argument when `source` itself is not interesting.
+std::string reduce(std::string source, const ReducePredicate& interesting, ReduceStats* stats = nullptr);
+
+}  // namespace sonar
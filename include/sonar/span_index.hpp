@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+#include "sonar/ast.hpp"
+
+namespace sonar {
+
+// Answers position queries over a tree in O(log n) instead of a descent from the root. The index is built
+// on the first query, in one walk that also parses deferred function bodies, and may then be queried from
+// several threads. The tree must outlive the index and must not change once it is built.
+//
+// Spans are half-open: a node is at `offset` when span.start <= offset < span.end.
+class SpanIndex {
+   public:
+    static constexpr std::uint32_t kNoParent = std::numeric_limits<std::uint32_t>::max();
+
+    // One Expression or Statement, with its span in source offsets; exactly one of the two pointers is set.
+    struct Entry {
+        SourceSpan span;
+        const Expression* expression{nullptr};
+        const Statement* statement{nullptr};
+        std::uint32_t parent{kNoParent};
+    };
+
+    explicit SpanIndex(const Expression& root) : root_(&root) {}
+
+    // The deepest node whose span contains `offset`, or nullptr when none does.
+    const Entry* innermost_at(std::size_t offset) const;
+
+    // Every node whose span shares at least one offset with `range`, in preorder. An empty range selects the
+    // nodes containing `range.start`.
+    std::vector<const Entry*> overlapping(SourceSpan range) const;
+
+    const Entry* parent(const Entry& entry) const;
+
+    // Nodes in the tree.
+    std::size_t size() const;
+
+   private:
+    // Offsets from `start` up to the next segment's start have `entry` as their innermost node.
+    struct Segment {
+        std::uint32_t start;
+        std::uint32_t entry;
+    };
+
+    class Builder;
+
+    void build() const;
+
+    const Expression* root_;
+    mutable std::once_flag built_;
+    // In preorder, which for nested spans is also ascending by start.
+    mutable std::vector<Entry> entries_;
+    mutable std::vector<Segment> segments_;
+};
+
+}  // namespace sonar
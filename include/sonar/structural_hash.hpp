@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+#include "sonar/ast.hpp"
+#include "sonar/node_map.hpp"
+
+namespace sonar {
+
+// Merkle hash of a subtree: the node's kind and payload (values, names, operators, type names) combined with
+// the hashes of its children in order. Positions are ignored, so structurally equal subtrees hash equal
+// wherever they appear. Deferred function bodies are parsed, so a syntax error in one is thrown as a
+// ParseError.
+//
+// Hashes every node of the subtree. Safe to call from several threads on a shared tree, and on any node,
+// however it was allocated.
+std::uint64_t structural_hash(const Expression& expression);
+std::uint64_t structural_hash(const Statement& statement);
+
+// Structural hashes of the nodes of one tree, kept by node id (see node_map.hpp) so that asking again, or
+// for the root after a small edit, only hashes the nodes that are new or were invalidated. Nodes without an
+// id are hashed but not cached; like node_id, the cache requires nodes allocated with `new`. Pass the cache
+// to Parser::reparse to keep it in step with the tree. Not thread-safe; the hashes are the ones
+// structural_hash returns, and hashing throws as it does.
+class StructuralHashCache {
+   public:
+    std::uint64_t hash(const Expression& expression);
+    std::uint64_t hash(const Statement& statement);
+
+    // Drops the cached hash of one node. Code that changes a node's payload or replaces one of its children
+    // must call this for that node and each of its ancestors.
+    void invalidate(const Expression& expression) noexcept { invalidate_id(node_id(expression)); }
+    void invalidate(const Statement& statement) noexcept { invalidate_id(node_id(statement)); }
+
+    // Drops the cached hash of whatever node has `id`, for code that hands an id to another node.
+    void invalidate_id(NodeId id) noexcept;
+
+    void clear() noexcept { hashes_.clear(); }
+
+   private:
+    // Zero marks a hash that has not been computed.
+    NodeMap<std::uint64_t> hashes_;
+};
+
+}  // namespace sonar
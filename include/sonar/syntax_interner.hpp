@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "sonar/ast.hpp"
+
+namespace sonar {
+
+enum class SyntaxKind : std::uint8_t {
+    Number,
+    Boolean,
+    String,
+    Prefix,
+    Infix,
+    Grouping,
+    Unit,
+    Assign,
+    Variable,
+    Block,
+    If,
+    While,
+    For,
+    Function,
+    Let,
+    ExpressionStatement,
+};
+
+// Identifies a distinct subtree within one SyntaxInterner. Two subtrees interned by the same interner have
+// the same id exactly when they are structurally equal, ignoring positions.
+using SyntaxId = std::uint32_t;
+
+// Stands for an absent optional child or annotation in an operand list.
+inline constexpr std::uint32_t kNoSyntax = std::numeric_limits<std::uint32_t>::max();
+
+// A tree stored as a shared structure plus the positions of this particular occurrence of it.
+//
+// `spans` lists one entry per Expression and Statement in preorder, each followed by the positions that node
+// keeps besides its own span: the operator of a Prefix or Infix; the name and, if present, the annotation of
+// a Let; the name and type of every parameter and then the return type of a Function. The entries of a
+// subtree are contiguous and SyntaxInterner::span_count gives their number, so a child's entries start
+// after the parent's own entries and the entries of the children before it. Positions are relative, as the
+// tree holds them (see Expression).
+struct InternedTree {
+    SyntaxId root{kNoSyntax};
+    std::vector<SourceSpan> spans;
+};
+
+// Hash-conses syntax trees: structurally identical subtrees are stored once and share one id, so memory
+// grows with the amount of distinct structure rather than with the size of the source.
+//
+// Operands per kind, where "symbol" is an id for symbol() and absent children are kNoSyntax:
+//   String, Variable       symbol
+//   Prefix                 right
+//   Infix                  left, right
+//   Grouping               expression
+//   Assign                 target, value
+//   Block                  statements..., value
+//   If                     condition, then, else
+//   While                  condition, body
+//   For                    pattern, iterable, body
+//   Function               return type symbol, (parameter name symbol, parameter type symbol)..., body
+//   Let                    name symbol, annotation symbol, initializer
+//   ExpressionStatement    expression
+// Number and Boolean keep their value in number(); Unit has no operands.
+class SyntaxInterner {
+   public:
+    SyntaxInterner();
+
+    // Interns `expression` and returns it with its positions. Deferred function bodies are parsed.
+    InternedTree intern(const Expression& expression);
+
+    // Lower-level forms that append the positions of the subtree to `spans`.
+    SyntaxId intern(const Expression& expression, std::vector<SourceSpan>& spans);
+    SyntaxId intern(const Statement& statement, std::vector<SourceSpan>& spans);
+
+    // Interns a block over already interned children. The caller records the block's own span in front of
+    // the children's entries.
+    SyntaxId intern_block(std::span<const SyntaxId> statements, SyntaxId value);
+
+    // Rebuilds an owning tree equal to the one `tree` was interned from. Throws std::invalid_argument when
+    // `tree.spans` does not fit the shape of `tree.root` or the root is a statement.
+    ExpressionPtr rebuild(const InternedTree& tree) const;
+
+    SyntaxKind kind(SyntaxId id) const { return nodes_[id].kind; }
+    TokenType op(SyntaxId id) const { return nodes_[id].op; }
+    double number(SyntaxId id) const { return nodes_[id].number; }
+    std::span<const std::uint32_t> operands(SyntaxId id) const;
+    std::size_t span_count(SyntaxId id) const { return nodes_[id].span_count; }
+    std::string_view symbol(std::uint32_t id) const { return symbol_views_[id]; }
+
+    // Number of distinct subtrees.
+    std::size_t size() const noexcept { return nodes_.size(); }
+
+    // Bytes held by the shared structure, including the lookup tables.
+    std::size_t memory_bytes() const noexcept;
+
+   private:
+    struct Node {
+        SyntaxKind kind;
+        TokenType op;
+        std::uint32_t first_operand;
+        std::uint32_t operand_count;
+        std::uint32_t span_count;
+        double number;
+        std::uint64_t hash;
+    };
+
+    SyntaxId intern_chain(const Expression& top, std::vector<SourceSpan>& spans);
+    std::uint32_t intern_symbol(std::string_view text);
+    SyntaxId finish(SyntaxKind kind, TokenType op, double number, std::size_t operand_base, std::size_t span_count);
+    bool same_node(const Node& node, SyntaxKind kind, TokenType op, double number, std::span<const std::uint32_t> operands) const;
+    void grow_table();
+
+    std::vector<Node> nodes_;
+    std::vector<std::uint32_t> operands_;
+    // Open-addressing table of node ids; kNoSyntax marks an empty slot.
+    std::vector<SyntaxId> table_;
+    // Operands of the nodes being interned; nested calls push above their parent's entries.
+    std::vector<std::uint32_t> scratch_;
+    std::deque<std::string> symbol_storage_;
+    std::vector<std::string_view> symbol_views_;
+    std::unordered_map<std::string_view, std::uint32_t> symbols_;
+};
+
+}  // namespace sonar
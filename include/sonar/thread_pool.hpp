@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sonar {
+
+// A fixed set of worker threads that run index-based loops together with the calling thread.
+class ThreadPool {
+   public:
+    // `threads` counts the calling thread, so a pool of 1 runs everything inline.
+    explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t size() const noexcept { return workers_.size() + 1; }
+
+    // Runs `task(i)` for every i in [0, count) and returns once all calls finished. If any call throws, the
+    // first exception is rethrown after the loop drains.
+    void parallel_for(std::size_t count, const std::function<void(std::size_t)>& task);
+
+   private:
+    void worker_loop();
+    void run_tasks();
+
+    std::vector<std::thread> workers_;
+    std::mutex run_mutex_;
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable work_done_;
+    const std::function<void(std::size_t)>* task_{nullptr};
+    std::size_t count_{0};
+    std::atomic<std::size_t> next_{0};
+    std::size_t busy_workers_{0};
+    std::uint64_t generation_{0};
+    std::exception_ptr error_;
+    bool stopping_{false};
+};
+
+}  // namespace sonar
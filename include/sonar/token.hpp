@@ -1,15 +1,34 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 
 namespace sonar {
 
+// Byte offsets into the source, stored in 32 bits; Lexer rejects sources of 4 GiB or more.
 struct SourceSpan {
-    std::size_t start{0};
-    std::size_t end{0};
+    constexpr SourceSpan() = default;
+    constexpr SourceSpan(std::size_t start_offset, std::size_t end_offset)
+        : start(static_cast<std::uint32_t>(start_offset)), end(static_cast<std::uint32_t>(end_offset)) {}
+
+    std::uint32_t start{0};
+    std::uint32_t end{0};
+
+    // Converts between offsets from `base` and offsets from wherever `base` is counted from; a tree stores
+    // its spans relative to the nodes holding them (see Expression in ast.hpp).
+    constexpr SourceSpan offset_by(std::size_t base) const { return SourceSpan{start + base, end + base}; }
+    constexpr SourceSpan relative_to(std::size_t base) const { return SourceSpan{start - base, end - base}; }
+
+    friend constexpr bool operator==(const SourceSpan&, const SourceSpan&) = default;
+};
+
+// Replaces the text covered by `range` with `replacement`.
+struct TextEdit {
+    SourceSpan range{};
+    std::string replacement;
 };
 
 struct SourceLocation {
@@ -17,7 +36,7 @@ struct SourceLocation {
     std::size_t column{1};
 };
 
-enum class TokenType {
+enum class TokenType : std::uint8_t {
     Number,
     String,
     Identifier,
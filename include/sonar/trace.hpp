@@ -0,0 +1,100 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace sonar {
+
+// One completed span: `name` ran on `thread` from `start` for `duration` nanoseconds, measured from the
+// recorder's creation. `detail` is shown as the span's argument, such as the file or chunk it covered.
+struct TraceEvent {
+    const char* name{nullptr};
+    std::string detail;
+    std::uint32_t thread{0};
+    std::int64_t start{0};
+    std::int64_t duration{0};
+};
+
+// Collects spans from any number of threads into one ring buffer per thread, so recording takes no lock after
+// a thread's first span. A ring grows with the spans its thread records up to `events_per_thread`, so memory
+// follows use rather than the thread count, and stops growing there; when a ring is full the oldest spans are
+// overwritten and counted as dropped. Spans are written out as Chrome trace-event JSON,
+// which chrome://tracing and Perfetto load:
+//
+//   sonar::TraceRecorder trace;
+//   { sonar::TraceSpan span(&trace, "parse", path); parser.parse(); }
+//   trace.write_chrome_json(out);
+//
+// Span names must be string literals or otherwise outlive the recorder.
+class TraceRecorder {
+   public:
+    static constexpr std::size_t kDefaultEventsPerThread = std::size_t{1} << 16;
+
+    // `events_per_thread` is rounded up to a power of two.
+    explicit TraceRecorder(std::size_t events_per_thread = kDefaultEventsPerThread);
+    ~TraceRecorder();
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    // Nanoseconds since the recorder was created.
+    std::int64_t now() const noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch_)
+            .count();
+    }
+
+    // Records a span of the calling thread that started at `start`, as returned by now(), and ends now.
+    void record(const char* name, std::int64_t start, std::string detail = {});
+
+    // Spans overwritten because a thread's ring was full.
+    std::size_t dropped() const;
+
+    // Every recorded span, ordered by thread and then start time. Must not race with record().
+    std::vector<TraceEvent> events() const;
+
+    // Writes the spans as a JSON object with a "traceEvents" array of complete ("X") events, plus the name
+    // of each thread. Must not race with record().
+    void write_chrome_json(std::ostream& out) const;
+
+   private:
+    struct ThreadBuffer;
+
+    ThreadBuffer& buffer_for_this_thread();
+
+    const std::uint64_t id_;
+    const std::size_t capacity_;
+    const std::chrono::steady_clock::time_point epoch_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+};
+
+// Records the span from its construction to its destruction, or nothing when `recorder` is null.
+class TraceSpan {
+   public:
+    TraceSpan(TraceRecorder* recorder, const char* name, std::string detail = {})
+        : recorder_(recorder), name_(name), detail_(recorder ? std::move(detail) : std::string()),
+          start_(recorder ? recorder->now() : 0) {}
+
+    ~TraceSpan() {
+        if (recorder_) {
+            recorder_->record(name_, start_, std::move(detail_));
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+   private:
+    TraceRecorder* recorder_;
+    const char* name_;
+    std::string detail_;
+    std::int64_t start_;
+};
+
+}  // namespace sonar
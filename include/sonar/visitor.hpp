@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "sonar/ast.hpp"
+
+namespace sonar {
+
+// Calls `visit` on each direct child of `node`, an Expression or Statement alternative, in source order and
+// returns false as soon as a call does. Children are `const Expression&` or `const Statement&`. A function
+// body the parser deferred is parsed and visited only when `parse_deferred_bodies` is set.
+template <typename Node, typename Visit>
+bool for_each_child(const Node& node, Visit&& visit, bool parse_deferred_bodies = true) {
+    auto child = [&visit](const auto& pointer) { return !pointer || visit(*pointer); };
+
+    if constexpr (std::is_same_v<Node, Expression::Prefix>) {
+        return child(node.right);
+    } else if constexpr (std::is_same_v<Node, Expression::Infix>) {
+        return child(node.left) && child(node.right);
+    } else if constexpr (std::is_same_v<Node, Expression::Grouping>) {
+        return child(node.expression);
+    } else if constexpr (std::is_same_v<Node, Expression::Assign>) {
+        return child(node.target) && child(node.value);
+    } else if constexpr (std::is_same_v<Node, Expression::Block>) {
+        for (const auto& statement : node.statements) {
+            if (!visit(*statement)) {
+                return false;
+            }
+        }
+        return child(node.value);
+    } else if constexpr (std::is_same_v<Node, Expression::If>) {
+        return child(node.condition) && child(node.then) && child(node.else_branch);
+    } else if constexpr (std::is_same_v<Node, Expression::While>) {
+        return child(node.condition) && child(node.body);
+    } else if constexpr (std::is_same_v<Node, Expression::For>) {
+        return child(node.pattern) && child(node.iterable) && child(node.body);
+    } else if constexpr (std::is_same_v<Node, Expression::Function>) {
+        if (node.body || parse_deferred_bodies) {
+            return visit(node.body_expression());
+        }
+        return true;
+    } else if constexpr (std::is_same_v<Node, Statement::Let>) {
+        return child(node.initializer);
+    } else if constexpr (std::is_same_v<Node, Statement::Expression>) {
+        return child(node.expression);
+    } else {
+        static_assert(std::is_empty_v<Node> || std::is_same_v<Node, Expression::Number> ||
+                          std::is_same_v<Node, Expression::Boolean> || std::is_same_v<Node, Expression::String> ||
+                          std::is_same_v<Node, Expression::Variable>,
+                      "for_each_child does not know the children of this node");
+        return true;
+    }
+}
+
+// What a walker does after an `enter` hook.
+enum class WalkAction : std::uint8_t {
+    Continue,
+    SkipChildren,
+    Stop,
+};
+
+// Depth-first walk over a tree, dispatched at compile time to hooks on `Derived`. Every hook is optional and
+// found by overload resolution, so a pass declares only the ones it needs as public members, per node type
+// or as a template:
+//
+//   void enter(const Expression& expression, const Expression::Infix& infix);
+//   template <typename Node> void leave(const Statement& statement, const Node& node);
+//
+// `enter` runs before the node's children and `leave` after them. A hook may return WalkAction instead of
+// void: SkipChildren from `enter` goes straight to `leave`, and Stop from either ends the walk. Deferred
+// function bodies are parsed when reached unless Derived declares
+// `static constexpr bool parse_deferred_bodies = false;`. The walk recurses once per level of nesting as
+// kMaxNestingDepth counts it; the left operands of an operator chain are walked in a loop.
+template <typename Derived>
+class AstWalker {
+   public:
+    // Returns false if a hook stopped the walk.
+    bool walk(const Expression& expression) {
+        return std::visit([&](const auto& node) { return walk_node(expression, node); }, expression.node);
+    }
+
+    bool walk(const Statement& statement) {
+        return std::visit([&](const auto& node) { return walk_node(statement, node); }, statement.node);
+    }
+
+    // In a hook, the source offset the node's span counts from: where its parent starts, or 0 for the node
+    // the walk started at. `node.span.offset_by(parent_start())` is the node's span in the source.
+    std::uint32_t parent_start() const noexcept { return parent_start_; }
+
+   protected:
+    AstWalker() = default;
+
+   private:
+    static constexpr bool parses_deferred_bodies() {
+        if constexpr (requires { Derived::parse_deferred_bodies; }) {
+            return Derived::parse_deferred_bodies;
+        } else {
+            return true;
+        }
+    }
+
+    template <typename Hook>
+    static WalkAction run_hook(Hook&& hook) {
+        if constexpr (std::is_void_v<decltype(hook())>) {
+            hook();
+            return WalkAction::Continue;
+        } else {
+            return hook();
+        }
+    }
+
+    // Named apart from the hooks, so that a Derived without a hook does not find these instead.
+    template <typename Wrapper, typename Node>
+    WalkAction enter_node(const Wrapper& wrapper, const Node& node) {
+        auto& self = static_cast<Derived&>(*this);
+        if constexpr (requires { self.enter(wrapper, node); }) {
+            return run_hook([&]() { return self.enter(wrapper, node); });
+        }
+        return WalkAction::Continue;
+    }
+
+    template <typename Wrapper, typename Node>
+    bool leave_node(const Wrapper& wrapper, const Node& node) {
+        auto& self = static_cast<Derived&>(*this);
+        if constexpr (requires { self.leave(wrapper, node); }) {
+            return run_hook([&]() { return self.leave(wrapper, node); }) != WalkAction::Stop;
+        }
+        return true;
+    }
+
+    template <typename Wrapper, typename Node>
+    bool walk_node(const Wrapper& wrapper, const Node& node) {
+        if constexpr (std::is_same_v<Node, Expression::Infix>) {
+            return walk_chain(wrapper);
+        } else {
+            const WalkAction action = enter_node(wrapper, node);
+            if (action == WalkAction::Stop) {
+                return false;
+            }
+            if (action == WalkAction::Continue) {
+                parent_start_ += wrapper.span.start;
+                const bool finished =
+                    for_each_child(node, [this](const auto& child) { return walk(child); }, parses_deferred_bodies());
+                parent_start_ -= wrapper.span.start;
+                if (!finished) {
+                    return false;
+                }
+            }
+            return leave_node(wrapper, node);
+        }
+    }
+
+    // Enters the operators down the chain's left spine, walks the operand at its bottom, then walks each
+    // operator's right operand and leaves it on the way back up: the order recursion would give.
+    bool walk_chain(const Expression& top) {
+        const std::size_t base = chain_.size();
+        const std::uint32_t start = parent_start_;
+        auto stop = [&]() {
+            chain_.resize(base);
+            parent_start_ = start;
+            return false;
+        };
+
+        const Expression* operand = &top;
+        while (const auto* infix = operand ? std::get_if<Expression::Infix>(&operand->node) : nullptr) {
+            const WalkAction action = enter_node(*operand, *infix);
+            if (action == WalkAction::Stop) {
+                return stop();
+            }
+            if (action == WalkAction::SkipChildren) {
+                if (!leave_node(*operand, *infix)) {
+                    return stop();
+                }
+                operand = nullptr;
+                break;
+            }
+            chain_.push_back(operand);
+            parent_start_ += operand->span.start;
+            operand = infix->left.get();
+        }
+        if (operand && !walk(*operand)) {
+            return stop();
+        }
+        while (chain_.size() > base) {
+            const Expression& expression = *chain_.back();
+            const auto& infix = std::get<Expression::Infix>(expression.node);
+            if (infix.right && !walk(*infix.right)) {
+                return stop();
+            }
+            parent_start_ -= expression.span.start;
+            if (!leave_node(expression, infix)) {
+                return stop();
+            }
+            chain_.pop_back();
+        }
+        return true;
+    }
+
+    // Operators entered on the left spines of the chains being walked; see walk_chain.
+    std::vector<const Expression*> chain_;
+    std::uint32_t parent_start_{0};
+};
+
+}  // namespace sonar
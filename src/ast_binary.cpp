@@ -0,0 +1,700 @@
+#include "sonar/ast_binary.hpp"
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "sonar/parser.hpp"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace sonar {
+
+namespace {
+
+constexpr std::array<char, 8> kMagic{'S', 'O', 'N', 'A', 'R', 'A', 'S', 'T'};
+constexpr std::uint32_t kAbsent = std::numeric_limits<std::uint32_t>::max();
+
+struct Header {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t node_count;
+    std::uint32_t root;
+    std::uint32_t list_words;
+    std::uint32_t string_bytes;
+    std::uint32_t reserved;
+    std::uint64_t source_hash;
+};
+
+static_assert(sizeof(Header) == 40);
+static_assert(std::is_trivially_copyable_v<Header>);
+
+void require_little_endian() {
+    if constexpr (std::endian::native != std::endian::little) {
+        throw std::runtime_error("The binary AST format is only supported on little-endian hosts");
+    }
+}
+
+[[noreturn]] void throw_corrupt() {
+    throw std::runtime_error("Corrupt binary AST");
+}
+
+}  // namespace
+
+// Field use by kind:
+//   Number       fields[0..1] hold the bits of the double
+//   Boolean      flags holds the value
+//   String       fields[0] string offset, fields[1] length (also Variable)
+//   Prefix       fields[0] right, fields[1..2] operator span
+//   Infix        fields[0] left, fields[1] right, fields[2..3] operator span
+//   Grouping     fields[0] expression (also ExpressionStatement)
+//   Assign       fields[0] target, fields[1] value
+//   Block        fields[0] list index of statement indices, fields[1] statement count, fields[2] value
+//   If, For      fields[0..2] children; While fields[0..1]
+//   Function     fields[0] list index, fields[1] parameter count, fields[2] body. The list holds 8 words per
+//                parameter (name offset, length, span start, end, type offset, length, span start, end)
+//                and then 4 words for the return type.
+//   Let          fields[0] list index, fields[1] initializer, flags 1 when annotated. The list holds the name
+//                (offset, length, span start, end) and then the annotation in the same form.
+namespace detail {
+
+struct BinaryNodeRecord {
+    std::uint8_t kind;
+    std::uint8_t op;
+    std::uint16_t flags;
+    std::uint32_t start;
+    std::uint32_t end;
+    std::array<std::uint32_t, 4> fields;
+};
+
+}  // namespace detail
+
+using Record = detail::BinaryNodeRecord;
+
+static_assert(sizeof(Record) == 28);
+static_assert(std::is_trivially_copyable_v<Record>);
+
+namespace {
+
+class Writer {
+   public:
+    std::uint32_t add(const Expression& expression) {
+        if (std::holds_alternative<Expression::Infix>(expression.node)) {
+            return add_chain(expression);
+        }
+        const auto index = reserve();
+        Record record{};
+        record.start = expression.span.start;
+        record.end = expression.span.end;
+        std::visit([&](const auto& node) { encode(node, record); }, expression.node);
+        nodes_[index] = record;
+        return index;
+    }
+
+    std::uint32_t add(const Statement& statement) {
+        const auto index = reserve();
+        Record record{};
+        record.start = statement.span.start;
+        record.end = statement.span.end;
+        if (const auto* let = std::get_if<Statement::Let>(&statement.node)) {
+            record.kind = static_cast<std::uint8_t>(BinaryNodeKind::Let);
+            record.fields[1] = add(*let->initializer);
+            record.fields[0] = list_size();
+            push_text(let->name, let->name_span);
+            if (let->annotation) {
+                record.flags = 1;
+                push_text(let->annotation->name, let->annotation->span);
+            }
+        } else {
+            record.kind = static_cast<std::uint8_t>(BinaryNodeKind::ExpressionStatement);
+            record.fields[0] = add(*std::get<Statement::Expression>(statement.node).expression);
+        }
+        nodes_[index] = record;
+        return index;
+    }
+
+    std::string finish(std::uint32_t root, std::uint64_t source_hash) const {
+        const Header header{kMagic,
+                            kBinaryAstVersion,
+                            static_cast<std::uint32_t>(nodes_.size()),
+                            root,
+                            static_cast<std::uint32_t>(lists_.size()),
+                            static_cast<std::uint32_t>(strings_.size()),
+                            0,
+                            source_hash};
+        std::string out;
+        out.reserve(sizeof(header) + nodes_.size() * sizeof(Record) + lists_.size() * sizeof(std::uint32_t) +
+                    strings_.size());
+        append(out, &header, sizeof(header));
+        append(out, nodes_.data(), nodes_.size() * sizeof(Record));
+        append(out, lists_.data(), lists_.size() * sizeof(std::uint32_t));
+        out += strings_;
+        return out;
+    }
+
+   private:
+    static void append(std::string& out, const void* data, std::size_t size) {
+        out.append(static_cast<const char*>(data), size);
+    }
+
+    std::uint32_t reserve() {
+        if (nodes_.size() >= kAbsent) {
+            throw std::length_error("Tree is too large for the binary AST format");
+        }
+        nodes_.emplace_back();
+        return static_cast<std::uint32_t>(nodes_.size() - 1);
+    }
+
+    // Records are in preorder, so a chain's operators take consecutive indices down its left spine, followed
+    // by the operand at the bottom and then each right operand from the bottom up. The chain nests its left
+    // operands as deeply as it is long, so it is added in loops rather than by recursion.
+    std::uint32_t add_chain(const Expression& top) {
+        std::vector<const Expression*> chain;
+        const Expression* operand = &top;
+        while (operand && std::holds_alternative<Expression::Infix>(operand->node)) {
+            chain.push_back(operand);
+            reserve();
+            operand = std::get<Expression::Infix>(operand->node).left.get();
+        }
+        const auto first = static_cast<std::uint32_t>(nodes_.size() - chain.size());
+        std::uint32_t left = operand ? add(*operand) : kAbsent;
+        for (std::size_t i = chain.size(); i-- > 0;) {
+            const auto& infix = std::get<Expression::Infix>(chain[i]->node);
+            Record record{};
+            record.kind = static_cast<std::uint8_t>(BinaryNodeKind::Infix);
+            record.op = static_cast<std::uint8_t>(infix.op);
+            record.start = chain[i]->span.start;
+            record.end = chain[i]->span.end;
+            record.fields[0] = left;
+            record.fields[1] = child(infix.right);
+            record.fields[2] = infix.op_span.start;
+            record.fields[3] = infix.op_span.end;
+            left = first + static_cast<std::uint32_t>(i);
+            nodes_[left] = record;
+        }
+        return first;
+    }
+
+    std::uint32_t list_size() const { return static_cast<std::uint32_t>(lists_.size()); }
+
+    std::uint32_t child(const ExpressionPtr& node) { return node ? add(*node) : kAbsent; }
+
+    void push_text(std::string_view text, SourceSpan span) {
+        auto [it, inserted] = string_offsets_.try_emplace(std::string(text), static_cast<std::uint32_t>(strings_.size()));
+        if (inserted) {
+            strings_.append(text);
+        }
+        lists_.insert(lists_.end(), {it->second, static_cast<std::uint32_t>(text.size()), span.start, span.end});
+    }
+
+    // Strings referenced straight from a node record: offset and length.
+    void set_text(std::string_view text, Record& record) {
+        auto [it, inserted] = string_offsets_.try_emplace(std::string(text), static_cast<std::uint32_t>(strings_.size()));
+        if (inserted) {
+            strings_.append(text);
+        }
+        record.fields[0] = it->second;
+        record.fields[1] = static_cast<std::uint32_t>(text.size());
+    }
+
+    template <typename Node>
+    void encode(const Node& node, Record& record) {
+        auto kind = [&](BinaryNodeKind value) { record.kind = static_cast<std::uint8_t>(value); };
+        if constexpr (std::is_same_v<Node, Expression::Number>) {
+            kind(BinaryNodeKind::Number);
+            const auto bits = std::bit_cast<std::uint64_t>(node.value);
+            record.fields[0] = static_cast<std::uint32_t>(bits);
+            record.fields[1] = static_cast<std::uint32_t>(bits >> 32);
+        } else if constexpr (std::is_same_v<Node, Expression::Boolean>) {
+            kind(BinaryNodeKind::Boolean);
+            record.flags = node.value ? 1 : 0;
+        } else if constexpr (std::is_same_v<Node, Expression::String>) {
+            kind(BinaryNodeKind::String);
+            set_text(node.value, record);
+        } else if constexpr (std::is_same_v<Node, Expression::Variable>) {
+            kind(BinaryNodeKind::Variable);
+            set_text(node.name, record);
+        } else if constexpr (std::is_same_v<Node, Expression::Prefix>) {
+            kind(BinaryNodeKind::Prefix);
+            record.op = static_cast<std::uint8_t>(node.op);
+            record.fields[0] = child(node.right);
+            record.fields[1] = node.op_span.start;
+            record.fields[2] = node.op_span.end;
+        } else if constexpr (std::is_same_v<Node, Expression::Grouping>) {
+            kind(BinaryNodeKind::Grouping);
+            record.fields[0] = child(node.expression);
+        } else if constexpr (std::is_same_v<Node, Expression::Unit>) {
+            kind(BinaryNodeKind::Unit);
+        } else if constexpr (std::is_same_v<Node, Expression::Assign>) {
+            kind(BinaryNodeKind::Assign);
+            record.fields[0] = child(node.target);
+            record.fields[1] = child(node.value);
+        } else if constexpr (std::is_same_v<Node, Expression::Block>) {
+            kind(BinaryNodeKind::Block);
+            std::vector<std::uint32_t> statements;
+            statements.reserve(node.statements.size());
+            for (const auto& statement : node.statements) {
+                statements.push_back(add(*statement));
+            }
+            record.fields[2] = child(node.value);
+            record.fields[0] = list_size();
+            record.fields[1] = static_cast<std::uint32_t>(statements.size());
+            lists_.insert(lists_.end(), statements.begin(), statements.end());
+        } else if constexpr (std::is_same_v<Node, Expression::If>) {
+            kind(BinaryNodeKind::If);
+            record.fields[0] = child(node.condition);
+            record.fields[1] = child(node.then);
+            record.fields[2] = child(node.else_branch);
+        } else if constexpr (std::is_same_v<Node, Expression::While>) {
+            kind(BinaryNodeKind::While);
+            record.fields[0] = child(node.condition);
+            record.fields[1] = child(node.body);
+        } else if constexpr (std::is_same_v<Node, Expression::For>) {
+            kind(BinaryNodeKind::For);
+            record.fields[0] = child(node.pattern);
+            record.fields[1] = child(node.iterable);
+            record.fields[2] = child(node.body);
+        } else if constexpr (std::is_same_v<Node, Expression::Function>) {
+            kind(BinaryNodeKind::Function);
+            record.fields[2] = add(node.body_expression());
+            const auto& signature = *node.signature;
+            record.fields[0] = list_size();
+            record.fields[1] = static_cast<std::uint32_t>(signature.parameters.size());
+            for (const auto& parameter : signature.parameters) {
+                push_text(parameter.name, parameter.name_span);
+                push_text(parameter.type.name, parameter.type.span);
+            }
+            push_text(signature.return_type.name, signature.return_type.span);
+        }
+    }
+
+    std::vector<Record> nodes_;
+    std::vector<std::uint32_t> lists_;
+    std::string strings_;
+    std::unordered_map<std::string, std::uint32_t> string_offsets_;
+};
+
+}  // namespace
+
+std::string serialize_ast(const Expression& root, std::uint64_t source_hash) {
+    require_little_endian();
+    Writer writer;
+    const auto index = writer.add(root);
+    return writer.finish(index, source_hash);
+}
+
+void write_ast_file(const std::string& path, const Expression& root, std::uint64_t source_hash) {
+    const std::string bytes = serialize_ast(root, source_hash);
+    std::ofstream output(path, std::ios::binary | std::ios::trunc);
+    if (!output) {
+        throw std::runtime_error("Failed to open '" + path + "' for writing");
+    }
+    output.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!output) {
+        throw std::runtime_error("Failed to write '" + path + "'");
+    }
+}
+
+bool is_binary_ast(std::string_view bytes) noexcept {
+    return bytes.size() >= kMagic.size() && std::memcmp(bytes.data(), kMagic.data(), kMagic.size()) == 0;
+}
+
+BinaryAst::BinaryAst(std::string_view bytes) : bytes_(bytes) {
+    require_little_endian();
+    Header header;
+    if (bytes.size() < sizeof(header) || !is_binary_ast(bytes)) {
+        throw std::runtime_error("Not a binary AST");
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.version != kBinaryAstVersion) {
+        throw std::runtime_error("Unsupported binary AST version " + std::to_string(header.version));
+    }
+    const std::uint64_t expected = sizeof(Header) + std::uint64_t{header.node_count} * sizeof(Record) +
+                                   std::uint64_t{header.list_words} * sizeof(std::uint32_t) + header.string_bytes;
+    if (expected != bytes.size() || header.root >= header.node_count) {
+        throw_corrupt();
+    }
+    node_count_ = header.node_count;
+    root_ = header.root;
+    list_words_ = header.list_words;
+    string_bytes_ = header.string_bytes;
+    source_hash_ = header.source_hash;
+}
+
+BinaryNodeRef BinaryAst::node(std::uint32_t index) const {
+    if (index == kAbsent) {
+        return {};
+    }
+    if (index >= node_count_) {
+        throw_corrupt();
+    }
+    return BinaryNodeRef(this, index);
+}
+
+Record BinaryNodeRef::record() const {
+    Record record;
+    std::memcpy(&record, ast_->bytes_.data() + sizeof(Header) + std::size_t{index_} * sizeof(Record), sizeof(record));
+    return record;
+}
+
+std::uint32_t BinaryNodeRef::list_word(std::uint32_t index) const {
+    if (index >= ast_->list_words_) {
+        throw_corrupt();
+    }
+    std::uint32_t word;
+    const std::size_t offset = sizeof(Header) + std::size_t{ast_->node_count_} * sizeof(Record) + std::size_t{index} * sizeof(word);
+    std::memcpy(&word, ast_->bytes_.data() + offset, sizeof(word));
+    return word;
+}
+
+namespace {
+
+std::string_view string_at(std::string_view bytes, std::size_t strings_offset, std::uint32_t string_bytes,
+                           std::uint32_t offset, std::uint32_t length) {
+    if (std::uint64_t{offset} + length > string_bytes) {
+        throw_corrupt();
+    }
+    return bytes.substr(strings_offset + offset, length);
+}
+
+}  // namespace
+
+BinaryTypeRef BinaryNodeRef::type_at(std::uint32_t list_index) const {
+    const std::size_t strings_offset = sizeof(Header) + std::size_t{ast_->node_count_} * sizeof(Record) +
+                                       std::size_t{ast_->list_words_} * sizeof(std::uint32_t);
+    const auto name = string_at(ast_->bytes_, strings_offset, ast_->string_bytes_, list_word(list_index), list_word(list_index + 1));
+    return BinaryTypeRef{name, SourceSpan{list_word(list_index + 2), list_word(list_index + 3)}};
+}
+
+BinaryNodeKind BinaryNodeRef::kind() const {
+    const auto kind = record().kind;
+    if (kind > static_cast<std::uint8_t>(BinaryNodeKind::ExpressionStatement)) {
+        throw_corrupt();
+    }
+    return static_cast<BinaryNodeKind>(kind);
+}
+
+SourceSpan BinaryNodeRef::span() const {
+    const Record node = record();
+    return SourceSpan{node.start, node.end};
+}
+
+TokenType BinaryNodeRef::op() const {
+    return static_cast<TokenType>(record().op);
+}
+
+SourceSpan BinaryNodeRef::op_span() const {
+    const Record node = record();
+    if (kind() == BinaryNodeKind::Prefix) {
+        return SourceSpan{node.fields[1], node.fields[2]};
+    }
+    return SourceSpan{node.fields[2], node.fields[3]};
+}
+
+double BinaryNodeRef::number() const {
+    const Record node = record();
+    return std::bit_cast<double>(std::uint64_t{node.fields[1]} << 32 | node.fields[0]);
+}
+
+bool BinaryNodeRef::boolean() const {
+    return record().flags != 0;
+}
+
+std::string_view BinaryNodeRef::text() const {
+    if (kind() == BinaryNodeKind::Let) {
+        return type_at(record().fields[0]).name;
+    }
+    const Record node = record();
+    const std::size_t strings_offset = sizeof(Header) + std::size_t{ast_->node_count_} * sizeof(Record) +
+                                       std::size_t{ast_->list_words_} * sizeof(std::uint32_t);
+    return string_at(ast_->bytes_, strings_offset, ast_->string_bytes_, node.fields[0], node.fields[1]);
+}
+
+SourceSpan BinaryNodeRef::name_span() const {
+    return type_at(record().fields[0]).span;
+}
+
+bool BinaryNodeRef::has_annotation() const {
+    return record().flags != 0;
+}
+
+BinaryTypeRef BinaryNodeRef::annotation() const {
+    return type_at(record().fields[0] + 4);
+}
+
+std::size_t BinaryNodeRef::parameter_count() const {
+    return record().fields[1];
+}
+
+BinaryParameterRef BinaryNodeRef::parameter(std::size_t index) const {
+    const auto base = static_cast<std::uint32_t>(record().fields[0] + index * 8);
+    const auto name = type_at(base);
+    return BinaryParameterRef{name.name, name.span, type_at(base + 4)};
+}
+
+BinaryTypeRef BinaryNodeRef::return_type() const {
+    const Record node = record();
+    return type_at(node.fields[0] + node.fields[1] * 8);
+}
+
+std::size_t BinaryNodeRef::child_count() const {
+    switch (kind()) {
+        case BinaryNodeKind::Prefix:
+        case BinaryNodeKind::Grouping:
+        case BinaryNodeKind::ExpressionStatement:
+        case BinaryNodeKind::Function:
+        case BinaryNodeKind::Let:
+            return 1;
+        case BinaryNodeKind::Infix:
+        case BinaryNodeKind::Assign:
+        case BinaryNodeKind::While:
+            return 2;
+        case BinaryNodeKind::If:
+        case BinaryNodeKind::For:
+            return 3;
+        case BinaryNodeKind::Block: {
+            const std::uint32_t statements = record().fields[1];
+            if (statements > ast_->list_words_) {
+                throw_corrupt();
+            }
+            return std::size_t{statements} + 1;
+        }
+        default:
+            return 0;
+    }
+}
+
+BinaryNodeRef BinaryNodeRef::child(std::size_t index) const {
+    if (index >= child_count()) {
+        throw std::out_of_range("Binary AST child index out of range");
+    }
+    const Record node = record();
+    std::uint32_t child_index = 0;
+    switch (kind()) {
+        case BinaryNodeKind::Block:
+            child_index = index < node.fields[1] ? list_word(static_cast<std::uint32_t>(node.fields[0] + index)) : node.fields[2];
+            break;
+        case BinaryNodeKind::Function:
+            child_index = node.fields[2];
+            break;
+        case BinaryNodeKind::Let:
+            child_index = node.fields[1];
+            break;
+        default:
+            child_index = node.fields[index];
+            break;
+    }
+    // Children always follow their parent, which rules out cycles in a corrupt file.
+    if (child_index != kAbsent && child_index <= index_) {
+        throw_corrupt();
+    }
+    return ast_->node(child_index);
+}
+
+BinaryAstFile::Mapping::Mapping(const std::string& path) {
+#if defined(_WIN32)
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("Failed to open '" + path + "'");
+    }
+    fallback_.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open '" + path + "'");
+    }
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to stat '" + path + "'");
+    }
+    size_ = static_cast<std::size_t>(info.st_size);
+    if (size_ > 0) {
+        void* address = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Failed to map '" + path + "'");
+        }
+        address_ = address;
+    }
+    ::close(fd);
+#endif
+}
+
+BinaryAstFile::Mapping::~Mapping() {
+#if !defined(_WIN32)
+    if (address_) {
+        ::munmap(address_, size_);
+    }
+#endif
+}
+
+std::string_view BinaryAstFile::Mapping::bytes() const noexcept {
+    if (address_) {
+        return {static_cast<const char*>(address_), size_};
+    }
+    return fallback_;
+}
+
+BinaryAstFile::BinaryAstFile(const std::string& path) : mapping_(path), ast_(mapping_.bytes()) {}
+
+namespace {
+
+TypeAnnotation to_annotation(const BinaryTypeRef& type) {
+    return TypeAnnotation{std::string(type.name), type.span};
+}
+
+template <typename Node>
+ExpressionPtr make(Node node, SourceSpan span) {
+    return std::make_unique<Expression>(std::move(node), span);
+}
+
+ExpressionPtr materialize_at(BinaryNodeRef node, std::size_t depth);
+
+// A child nests one level below its parent, as it does for the parser (see kMaxNestingDepth), except an
+// operator's left operand, an assignment's target and a for loop's pattern, which the parser reads in its
+// parent's call, and the expressions of a statement, whose level its block already counted. A file nested
+// deeper than a parse could produce is rejected before the recursion below can run out of stack.
+ExpressionPtr materialize_nested(BinaryNodeRef node, std::size_t depth) {
+    if (depth >= kMaxNestingDepth) {
+        throw std::runtime_error("Binary AST is nested too deeply");
+    }
+    return materialize_at(node, depth + 1);
+}
+
+ExpressionPtr materialize_child(BinaryNodeRef node, std::size_t depth) {
+    return node ? materialize_nested(node, depth) : nullptr;
+}
+
+// `depth` is that of the block holding the statement.
+StatementPtr materialize_statement(BinaryNodeRef node, std::size_t depth) {
+    if (!node) {
+        throw_corrupt();
+    }
+    if (depth >= kMaxNestingDepth) {
+        throw std::runtime_error("Binary AST is nested too deeply");
+    }
+    if (node.kind() == BinaryNodeKind::Let) {
+        std::unique_ptr<TypeAnnotation> annotation;
+        if (node.has_annotation()) {
+            annotation = std::make_unique<TypeAnnotation>(to_annotation(node.annotation()));
+        }
+        Statement::Let let{std::string(node.text()), node.name_span(), std::move(annotation),
+                           materialize_at(node.child(0), depth + 1)};
+        return std::make_unique<Statement>(std::move(let), node.span());
+    }
+    if (node.kind() == BinaryNodeKind::ExpressionStatement) {
+        return std::make_unique<Statement>(Statement::Expression{materialize_at(node.child(0), depth + 1)}, node.span());
+    }
+    throw_corrupt();
+}
+
+// Builds a chain from the operand at the bottom of its left spine upwards, in a loop for the same reason
+// Writer::add_chain uses one.
+ExpressionPtr materialize_chain(BinaryNodeRef top, std::size_t depth) {
+    std::vector<BinaryNodeRef> chain;
+    BinaryNodeRef operand = top;
+    while (operand && operand.kind() == BinaryNodeKind::Infix) {
+        chain.push_back(operand);
+        operand = operand.child(0);
+    }
+    auto left = materialize_at(operand, depth);
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        left = make(Expression::Infix{it->op(), it->op_span(), std::move(left), materialize_nested(it->child(1), depth)},
+                    it->span());
+    }
+    return left;
+}
+
+ExpressionPtr materialize_at(BinaryNodeRef node, std::size_t depth) {
+    if (!node) {
+        throw_corrupt();
+    }
+    const SourceSpan span = node.span();
+    switch (node.kind()) {
+        case BinaryNodeKind::Number:
+            return make(Expression::Number{node.number()}, span);
+        case BinaryNodeKind::Boolean:
+            return make(Expression::Boolean{node.boolean()}, span);
+        case BinaryNodeKind::String:
+            return make(Expression::String{std::string(node.text())}, span);
+        case BinaryNodeKind::Variable:
+            return make(Expression::Variable{std::string(node.text())}, span);
+        case BinaryNodeKind::Prefix:
+            return make(Expression::Prefix{node.op(), node.op_span(), materialize_nested(node.child(0), depth)}, span);
+        case BinaryNodeKind::Infix:
+            return materialize_chain(node, depth);
+        case BinaryNodeKind::Grouping:
+            return make(Expression::Grouping{materialize_nested(node.child(0), depth)}, span);
+        case BinaryNodeKind::Unit:
+            return make(Expression::Unit{}, span);
+        case BinaryNodeKind::Assign: {
+            auto target = materialize_at(node.child(0), depth);
+            return make(Expression::Assign{std::move(target), materialize_nested(node.child(1), depth)}, span);
+        }
+        case BinaryNodeKind::Block: {
+            Expression::Block block;
+            const std::size_t count = node.child_count() - 1;
+            block.statements.reserve(count);
+            for (std::size_t i = 0; i < count; ++i) {
+                block.statements.push_back(materialize_statement(node.child(i), depth));
+            }
+            block.value = materialize_child(node.child(count), depth);
+            return make(std::move(block), span);
+        }
+        case BinaryNodeKind::If: {
+            auto condition = materialize_nested(node.child(0), depth);
+            auto then = materialize_nested(node.child(1), depth);
+            return make(Expression::If{std::move(condition), std::move(then), materialize_child(node.child(2), depth)},
+                        span);
+        }
+        case BinaryNodeKind::While: {
+            auto condition = materialize_nested(node.child(0), depth);
+            return make(Expression::While{std::move(condition), materialize_nested(node.child(1), depth)}, span);
+        }
+        case BinaryNodeKind::For: {
+            auto pattern = materialize_at(node.child(0), depth);
+            auto iterable = materialize_nested(node.child(1), depth);
+            return make(Expression::For{std::move(pattern), std::move(iterable), materialize_nested(node.child(2), depth)},
+                        span);
+        }
+        case BinaryNodeKind::Function: {
+            auto signature = std::make_unique<Expression::Function::Signature>();
+            const std::size_t count = node.parameter_count();
+            for (std::size_t i = 0; i < count; ++i) {
+                const auto parameter = node.parameter(i);
+                signature->parameters.push_back(Expression::Function::Parameter{
+                    std::string(parameter.name), parameter.name_span, to_annotation(parameter.type)});
+            }
+            signature->return_type = to_annotation(node.return_type());
+            return make(Expression::Function{std::move(signature), materialize_nested(node.child(0), depth), nullptr},
+                        span);
+        }
+        case BinaryNodeKind::Let:
+        case BinaryNodeKind::ExpressionStatement:
+            break;
+    }
+    throw std::runtime_error("Binary AST node is a statement, not an expression");
+}
+
+}  // namespace
+
+ExpressionPtr materialize(BinaryNodeRef node) {
+    return materialize_at(node, 0);
+}
+
+}  // namespace sonar
@@ -0,0 +1,81 @@
+#include "sonar/ast_stats.hpp"
+
+#include <string>
+#include <type_traits>
+
+#include "sonar/visitor.hpp"
+
+namespace sonar {
+
+namespace {
+
+// Heap bytes owned by `value`; zero when the characters live in the small-string buffer.
+std::size_t heap_bytes(const std::string& value) {
+    const auto* object = reinterpret_cast<const char*>(&value);
+    const char* data = value.data();
+    if (data >= object && data < object + sizeof(value)) {
+        return 0;
+    }
+    return value.capacity() + 1;
+}
+
+// A node together with the allocation header in front of it.
+template <typename Node, bool TreeNode = false>
+constexpr std::size_t kNodeBytes = sizeof(Node) + detail::NodeAllocation<Node, TreeNode>::kHeader;
+
+class StatsCollector : public AstWalker<StatsCollector> {
+   public:
+    // Unparsed bodies are counted as what they are.
+    static constexpr bool parse_deferred_bodies = false;
+
+    template <typename Node>
+    void enter(const Expression&, const Node& node) {
+        ++stats_.expressions;
+        stats_.bytes += kNodeBytes<Expression, true>;
+        if constexpr (std::is_same_v<Node, Expression::String>) {
+            stats_.bytes += heap_bytes(node.value);
+        } else if constexpr (std::is_same_v<Node, Expression::Variable>) {
+            stats_.bytes += heap_bytes(node.name);
+        } else if constexpr (std::is_same_v<Node, Expression::Block>) {
+            stats_.bytes += node.statements.capacity() * sizeof(StatementPtr);
+        } else if constexpr (std::is_same_v<Node, Expression::Function>) {
+            const auto& signature = *node.signature;
+            stats_.bytes += kNodeBytes<Expression::Function::Signature> +
+                            signature.parameters.capacity() * sizeof(Expression::Function::Parameter);
+            for (const auto& parameter : signature.parameters) {
+                stats_.bytes += heap_bytes(parameter.name) + heap_bytes(parameter.type.name);
+            }
+            stats_.bytes += heap_bytes(signature.return_type.name);
+            if (!node.body) {
+                stats_.bytes += sizeof(DeferredExpression);
+            }
+        }
+    }
+
+    template <typename Node>
+    void enter(const Statement&, const Node& node) {
+        ++stats_.statements;
+        stats_.bytes += kNodeBytes<Statement, true>;
+        if constexpr (std::is_same_v<Node, Statement::Let>) {
+            stats_.bytes += heap_bytes(node.name);
+            if (node.annotation) {
+                stats_.bytes += kNodeBytes<TypeAnnotation> + heap_bytes(node.annotation->name);
+            }
+        }
+    }
+
+    AstStats result() const { return stats_; }
+
+   private:
+    AstStats stats_;
+};
+
+}  // namespace
+
+AstStats collect_ast_stats(const Expression& root) {
+    StatsCollector collector;
+    collector.walk(root);
+    return collector.result();
+}
+
+}  // namespace sonar
@@ -0,0 +1,82 @@
+#include "sonar/compilation_session.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "sonar/parser.hpp"
+
+namespace sonar {
+
+ArenaResource::ArenaResource(std::size_t block_bytes) : block_bytes_(std::max<std::size_t>(block_bytes, 64)) {}
+
+void ArenaResource::reset() noexcept {
+    current_ = 0;
+    offset_ = 0;
+    used_ = 0;
+}
+
+void* ArenaResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+    while (true) {
+        for (; current_ < blocks_.size(); ++current_, offset_ = 0) {
+            Block& block = blocks_[current_];
+            void* pointer = block.data.get() + offset_;
+            std::size_t space = block.size - offset_;
+            if (std::align(alignment, bytes, pointer, space)) {
+                const std::size_t end = block.size - space + bytes;
+                used_ += end - offset_;
+                offset_ = end;
+                return pointer;
+            }
+        }
+
+        // Each block is at least twice the one before, so the block count stays logarithmic in the peak.
+        const std::size_t size =
+            std::max(bytes + alignment, blocks_.empty() ? block_bytes_ : blocks_.back().size * 2);
+        blocks_.push_back(Block{std::unique_ptr<std::byte[]>(new std::byte[size]), size});
+        capacity_ += size;
+        current_ = blocks_.size() - 1;
+        offset_ = 0;
+    }
+}
+
+SourceId SourceRegistry::add(std::string_view name, std::string_view text, const std::vector<std::size_t>& line_offsets) {
+    if (size_ == files_.size()) {
+        files_.emplace_back();
+    }
+    SourceFile& file = files_[size_];
+    file.name.assign(name);
+    file.text.assign(text);
+    file.line_offsets.assign(line_offsets.begin(), line_offsets.end());
+    return static_cast<SourceId>(size_++);
+}
+
+SourceLocation SourceRegistry::location(SourceId id, std::size_t offset) const {
+    const auto& offsets = files_[id].line_offsets;
+    auto it = std::upper_bound(offsets.begin(), offsets.end(), offset);
+    std::size_t line_index = (it == offsets.begin()) ? 0 : static_cast<std::size_t>(std::distance(offsets.begin(), it) - 1);
+    std::size_t line_start = offsets.empty() ? 0 : offsets[line_index];
+    return SourceLocation{line_index + 1, offset - line_start + 1};
+}
+
+CompilationSession::CompilationSession(std::size_t arena_block_bytes) : arena_(arena_block_bytes) {}
+
+ExpressionPtr CompilationSession::parse(std::string_view source, std::string_view source_name) {
+    Lexer{}.tokenize(source, lexed_);
+    sources_.add(source_name, source, lexed_.line_offsets);
+
+    // The parser borrows the buffers: aliasing an empty owner gives shared pointers that never delete.
+    ParserOptions options;
+    options.memory_resource = &arena_;
+    Parser parser(Parser::SharedTokens(Parser::SharedTokens{}, &lexed_.tokens),
+                  Parser::SharedLineOffsets(Parser::SharedLineOffsets{}, &lexed_.line_offsets),
+                  std::string(source_name), options, 0);
+    return parser.parse();
+}
+
+void CompilationSession::reset() noexcept {
+    sources_.clear();
+    arena_.reset();
+}
+
+}  // namespace sonar
@@ -0,0 +1,369 @@
+#include "sonar/event_parser.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace sonar {
+
+namespace {
+
+// Mirrors Parser::Precedence and its infix rule table.
+constexpr int kAssignmentPrecedence = 1;
+constexpr int kPrefixPrecedence = 8;
+
+struct InfixRule {
+    int precedence;
+    bool right_associative;
+};
+
+bool find_infix_rule(TokenType type, InfixRule& rule) {
+    switch (type) {
+        case TokenType::Equals:
+            rule = {kAssignmentPrecedence, true};
+            return true;
+        case TokenType::OrOr:
+            rule = {2, false};
+            return true;
+        case TokenType::AndAnd:
+            rule = {3, false};
+            return true;
+        case TokenType::Pipe:
+            rule = {4, false};
+            return true;
+        case TokenType::Ampersand:
+            rule = {5, false};
+            return true;
+        case TokenType::Plus:
+        case TokenType::Minus:
+            rule = {6, false};
+            return true;
+        case TokenType::Star:
+        case TokenType::Slash:
+            rule = {7, false};
+            return true;
+        default:
+            return false;
+    }
+}
+
+}  // namespace
+
+EventParser::EventParser(const std::vector<Token>& tokens, const std::vector<std::size_t>& line_offsets,
+                         std::string source_name)
+    : tokens_(tokens), line_offsets_(line_offsets), source_name_(std::move(source_name)) {}
+
+bool EventParser::parse_item() {
+    events_.clear();
+    while (!finished_ && !is_at_end()) {
+        if (check(TokenType::Semicolon)) {
+            advance();
+            continue;
+        }
+        bool is_value = false;
+        parse_sequence_item(is_value);
+        if (is_value) {
+            finished_ = true;
+            consume(TokenType::End, "Expected end of input");
+        }
+        return true;
+    }
+    consume(TokenType::End, "Expected end of input");
+    return false;
+}
+
+bool EventParser::parse_sequence_item(bool& is_value) {
+    if (check(TokenType::Let)) {
+        parse_let_statement();
+        consume(TokenType::Semicolon, "Expected ';' after let statement");
+        return true;
+    }
+
+    if (check(TokenType::Fn) && peek(1).type == TokenType::Identifier) {
+        parse_fn_statement();
+        if (check(TokenType::Semicolon)) {
+            throw make_error("Unexpected ';' after function definition", peek().span, false);
+        }
+        return true;
+    }
+
+    auto expression = parse_expression();
+    if (match(TokenType::Semicolon)) {
+        finish(precede(expression, ParseEventKind::ExpressionStatement), expression.span);
+        return true;
+    }
+    is_value = true;
+    return false;
+}
+
+EventParser::Completed EventParser::parse_let_statement() {
+    const Token& let_token = consume(TokenType::Let, "Expected 'let'");
+    const Token& name = consume(TokenType::Identifier, "Expected identifier after 'let'");
+    const auto marker = start(ParseEventKind::Let);
+    events_[marker].data.text = name.lexeme;
+    events_[marker].data.detail_span = name.span;
+    if (match(TokenType::Colon)) {
+        parse_type();
+    }
+
+    consume(TokenType::Equals, "Expected '=' after identifier (or type annotation)");
+    const auto initializer = parse_expression();
+    return finish(marker, SourceSpan{let_token.span.start, initializer.span.end});
+}
+
+EventParser::Completed EventParser::parse_fn_statement() {
+    const Token& fn_token = consume(TokenType::Fn, "Expected 'fn'");
+    const Token& name = consume(TokenType::Identifier, "Expected function name after 'fn'");
+    const auto marker = start(ParseEventKind::Let);
+    events_[marker].data.text = name.lexeme;
+    events_[marker].data.detail_span = name.span;
+    const auto function = parse_function_literal(fn_token);
+    return finish(marker, SourceSpan{fn_token.span.start, function.span.end});
+}
+
+EventParser::Completed EventParser::parse_expression(int precedence_floor) {
+    if (is_at_end()) {
+        throw make_error("Unexpected end of input while parsing expression", peek().span, true);
+    }
+    if (depth_ == kMaxNestingDepth) {
+        throw make_error("Expression is nested too deeply", peek().span, false);
+    }
+    const std::size_t depth = depth_++;
+
+    auto left = parse_prefix(advance());
+
+    InfixRule rule{};
+    while (!is_at_end() && find_infix_rule(peek().type, rule) && rule.precedence >= precedence_floor) {
+        const Token& op = advance();
+        if (op.type == TokenType::Equals) {
+            if (left.kind != ParseEventKind::Variable) {
+                throw make_error("Left-hand side of assignment must be a variable", op.span, false);
+            }
+            const auto marker = precede(left, ParseEventKind::Assign);
+            const auto right = parse_expression(rule.precedence);
+            left = finish(marker, SourceSpan{left.span.start, right.span.end});
+            continue;
+        }
+
+        const auto marker = precede(left, ParseEventKind::Infix);
+        events_[marker].data.op = op.type;
+        events_[marker].data.detail_span = op.span;
+        const auto right = parse_expression(rule.precedence + (rule.right_associative ? 0 : 1));
+        left = finish(marker, SourceSpan{left.span.start, right.span.end});
+    }
+    depth_ = depth;
+    return left;
+}
+
+EventParser::Completed EventParser::parse_prefix(const Token& token) {
+    switch (token.type) {
+        case TokenType::Number: {
+            auto number = leaf(ParseEventKind::Number, token);
+            events_[number.marker].data.number = events_.back().data.number = token.as_number();
+            return number;
+        }
+        case TokenType::String:
+            return leaf(ParseEventKind::String, token);
+        case TokenType::True:
+        case TokenType::False: {
+            auto boolean = leaf(ParseEventKind::Boolean, token);
+            events_[boolean.marker].data.boolean = events_.back().data.boolean = token.type == TokenType::True;
+            return boolean;
+        }
+        case TokenType::Identifier:
+            return leaf(ParseEventKind::Variable, token);
+        case TokenType::Minus: {
+            const auto marker = start(ParseEventKind::Prefix);
+            events_[marker].data.op = token.type;
+            events_[marker].data.detail_span = token.span;
+            const auto right = parse_expression(kPrefixPrecedence);
+            return finish(marker, SourceSpan{token.span.start, right.span.end});
+        }
+        case TokenType::LeftParen:
+            return parse_grouping(token);
+        case TokenType::LeftBrace:
+            return parse_block(token);
+        case TokenType::If:
+            return parse_if(token);
+        case TokenType::While:
+            return parse_while(token);
+        case TokenType::For:
+            return parse_for(token);
+        case TokenType::Fn:
+            return parse_function_literal(token);
+        case TokenType::Let:
+            throw make_error("Unexpected 'let' while parsing expression", token.span, false);
+        case TokenType::End:
+            throw make_error("Unexpected end of input while parsing expression", token.span, true);
+        default:
+            throw make_error("Unexpected token '" + token.lexeme + "' while parsing expression", token.span, false);
+    }
+}
+
+EventParser::Completed EventParser::parse_grouping(const Token& open) {
+    if (check(TokenType::RightParen)) {
+        const Token& close = advance();
+        return finish(start(ParseEventKind::Unit), SourceSpan{open.span.start, close.span.end});
+    }
+
+    const auto marker = start(ParseEventKind::Grouping);
+    parse_expression();
+    const Token& close = consume(TokenType::RightParen, "Expected ')' after expression");
+    return finish(marker, SourceSpan{open.span.start, close.span.end});
+}
+
+EventParser::Completed EventParser::parse_block(const Token& open) {
+    const auto marker = start(ParseEventKind::Block);
+    while (!check(TokenType::RightBrace) && !is_at_end()) {
+        if (check(TokenType::Semicolon)) {
+            advance();
+            continue;
+        }
+        bool is_value = false;
+        parse_sequence_item(is_value);
+        if (is_value) {
+            break;
+        }
+    }
+    const Token& close = consume(TokenType::RightBrace, "Expected '}' after block");
+    return finish(marker, SourceSpan{open.span.start, close.span.end});
+}
+
+EventParser::Completed EventParser::parse_if(const Token& if_token) {
+    const auto marker = start(ParseEventKind::If);
+    parse_expression();
+    auto last = parse_expression();
+    if (match(TokenType::Else)) {
+        last = parse_expression();
+    }
+    return finish(marker, SourceSpan{if_token.span.start, last.span.end});
+}
+
+EventParser::Completed EventParser::parse_while(const Token& while_token) {
+    const auto marker = start(ParseEventKind::While);
+    parse_expression();
+    const auto body = parse_expression();
+    return finish(marker, SourceSpan{while_token.span.start, body.span.end});
+}
+
+EventParser::Completed EventParser::parse_for(const Token& for_token) {
+    const auto marker = start(ParseEventKind::For);
+    leaf(ParseEventKind::Variable, consume(TokenType::Identifier, "Expected identifier after 'for'"));
+    consume(TokenType::In, "Expected 'in' after loop variable");
+    parse_expression();
+    const auto body = parse_expression();
+    return finish(marker, SourceSpan{for_token.span.start, body.span.end});
+}
+
+EventParser::Completed EventParser::parse_function_literal(const Token& fn_token) {
+    const auto marker = start(ParseEventKind::Function);
+    consume(TokenType::LeftParen, "Expected '(' after 'fn'");
+
+    if (!check(TokenType::RightParen)) {
+        while (true) {
+            const Token& name = consume(TokenType::Identifier, "Expected parameter name");
+            const auto parameter = start(ParseEventKind::Parameter);
+            events_[parameter].data.text = name.lexeme;
+            consume(TokenType::Colon, "Expected ':' after parameter name");
+            parse_type();
+            finish(parameter, name.span);
+            if (!match(TokenType::Comma)) {
+                break;
+            }
+        }
+    }
+
+    consume(TokenType::RightParen, "Expected ')' after parameter list");
+    consume(TokenType::Arrow, "Expected '->' after parameter list");
+    parse_type();
+
+    const auto body = parse_expression();
+    return finish(marker, SourceSpan{fn_token.span.start, body.span.end});
+}
+
+void EventParser::parse_type() {
+    leaf(ParseEventKind::Type, consume(TokenType::Identifier, "Expected type name"));
+}
+
+std::uint32_t EventParser::start(ParseEventKind kind) {
+    Event event;
+    event.data.kind = kind;
+    events_.push_back(event);
+    return static_cast<std::uint32_t>(events_.size() - 1);
+}
+
+EventParser::Completed EventParser::finish(std::uint32_t marker, SourceSpan span) {
+    Event& event = events_[marker];
+    event.data.span = span;
+    Event leave;
+    leave.data = event.data;
+    leave.leave = true;
+    events_.push_back(leave);
+    return Completed{marker, leave.data.kind, span};
+}
+
+std::uint32_t EventParser::precede(const Completed& child, ParseEventKind kind) {
+    const auto marker = start(kind);
+    // A completed child may already be wrapped (`a + b` before `+ c`); link from its outermost wrapper.
+    std::uint32_t link = child.marker;
+    while (events_[link].forward_parent != 0) {
+        link += events_[link].forward_parent;
+    }
+    events_[link].forward_parent = marker - link;
+    return marker;
+}
+
+EventParser::Completed EventParser::leaf(ParseEventKind kind, const Token& token) {
+    const auto marker = start(kind);
+    events_[marker].data.text = token.lexeme;
+    return finish(marker, token.span);
+}
+
+bool EventParser::match(TokenType type) {
+    if (!check(type)) {
+        return false;
+    }
+    advance();
+    return true;
+}
+
+const Token& EventParser::advance() {
+    if (!is_at_end()) {
+        ++current_;
+        return previous();
+    }
+    return tokens_.back();
+}
+
+bool EventParser::check(TokenType type) const {
+    return tokens_.at(current_).type == type;
+}
+
+bool EventParser::is_at_end() const {
+    return peek().type == TokenType::End;
+}
+
+const Token& EventParser::peek(std::size_t offset) const {
+    return tokens_.at(std::min(current_ + offset, tokens_.size() - 1));
+}
+
+const Token& EventParser::previous() const {
+    return tokens_.at(current_ - 1);
+}
+
+const Token& EventParser::consume(TokenType type, std::string_view message) {
+    if (check(type)) {
+        return advance();
+    }
+    SourceSpan error_span = is_at_end() ? tokens_.back().span : peek().span;
+    throw make_error(std::string(message), error_span, is_at_end());
+}
+
+ParseError EventParser::make_error(const std::string& message, SourceSpan span, bool incomplete) const {
+    auto it = std::upper_bound(line_offsets_.begin(), line_offsets_.end(), std::size_t{span.start});
+    const std::size_t line_index = (it == line_offsets_.begin()) ? 0 : static_cast<std::size_t>(std::distance(line_offsets_.begin(), it) - 1);
+    const std::size_t line_start = line_offsets_.empty() ? 0 : line_offsets_[line_index];
+    return ParseError(message, incomplete, span, SourceLocation{line_index + 1, span.start - line_start + 1}, source_name_);
+}
+
+}  // namespace sonar
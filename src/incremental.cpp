@@ -0,0 +1,449 @@
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "sonar/lexer.hpp"
+#include "sonar/node_map.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/structural_hash.hpp"
+#include "sonar/visitor.hpp"
+
+namespace sonar {
+
+namespace {
+
+struct EditMap {
+    std::size_t start;
+    std::size_t end;
+    std::size_t inserted;
+
+    // Maps an offset at or after the edited range into the edited source.
+    std::size_t shift(std::size_t offset) const { return offset - (end - start) + inserted; }
+
+    bool keeps_length() const { return end - start == inserted; }
+
+    bool within(std::size_t start_offset, std::size_t end_offset) const {
+        return start_offset <= start && end <= end_offset;
+    }
+};
+
+std::optional<std::size_t> find_token_at(const std::vector<Token>& tokens, std::size_t offset) {
+    auto it = std::lower_bound(tokens.begin(), tokens.end(), offset,
+                               [](const Token& token, std::size_t value) { return token.span.start < value; });
+    if (it == tokens.end() || it->span.start != offset) {
+        return std::nullopt;
+    }
+    return static_cast<std::size_t>(std::distance(tokens.begin(), it));
+}
+
+std::size_t first_token_from(const std::vector<Token>& tokens, std::size_t offset) {
+    auto it = std::lower_bound(tokens.begin(), tokens.end(), offset,
+                               [](const Token& token, std::size_t value) { return token.span.start < value; });
+    return std::min(static_cast<std::size_t>(std::distance(tokens.begin(), it)), tokens.size() - 1);
+}
+
+// The first of a block's statements that starts at or after `offset`, where the block starts at `base`.
+auto first_statement_from(std::vector<StatementPtr>& statements, std::size_t base, std::size_t offset) {
+    return std::partition_point(statements.begin(), statements.end(),
+                                [&](const StatementPtr& statement) { return base + statement->span.start < offset; });
+}
+
+// Calls `visit` on the slot of each direct child of `expression` or `statement`, an ExpressionPtr or a
+// StatementPtr, in source order.
+template <typename Visit>
+void for_each_child_slot(Statement& statement, Visit&& visit) {
+    if (auto* let = std::get_if<Statement::Let>(&statement.node)) {
+        visit(let->initializer);
+    } else if (auto* expr = std::get_if<Statement::Expression>(&statement.node)) {
+        visit(expr->expression);
+    }
+}
+
+template <typename Visit>
+void for_each_child_slot(Expression& expression, Visit&& visit) {
+    std::visit(
+        [&](auto& node) {
+            using Node = std::decay_t<decltype(node)>;
+            if constexpr (std::is_same_v<Node, Expression::Prefix>) {
+                visit(node.right);
+            } else if constexpr (std::is_same_v<Node, Expression::Infix>) {
+                visit(node.left);
+                visit(node.right);
+            } else if constexpr (std::is_same_v<Node, Expression::Grouping>) {
+                visit(node.expression);
+            } else if constexpr (std::is_same_v<Node, Expression::Assign>) {
+                visit(node.target);
+                visit(node.value);
+            } else if constexpr (std::is_same_v<Node, Expression::Block>) {
+                for (auto& statement : node.statements) {
+                    visit(statement);
+                }
+                visit(node.value);
+            } else if constexpr (std::is_same_v<Node, Expression::If>) {
+                visit(node.condition);
+                visit(node.then);
+                visit(node.else_branch);
+            } else if constexpr (std::is_same_v<Node, Expression::While>) {
+                visit(node.condition);
+                visit(node.body);
+            } else if constexpr (std::is_same_v<Node, Expression::For>) {
+                visit(node.pattern);
+                visit(node.iterable);
+                visit(node.body);
+            } else if constexpr (std::is_same_v<Node, Expression::Function>) {
+                visit(node.body);
+            }
+        },
+        expression.node);
+}
+
+using NodeSlot = std::variant<ExpressionPtr*, StatementPtr*>;
+
+// A node on the way from the root down to the edit, with where it starts in the source before the edit and
+// the nesting depth a full parse reaches on it.
+struct PathStep {
+    NodeSlot slot;
+    std::size_t start;
+    std::size_t depth;
+};
+
+// Whether Parser nests one level deeper than `parent` while parsing `child`, one of its children: it does for
+// every child but a statement of a block, an operator's left operand or an assignment's target, which are
+// parsed before the operator in the parent's own call, and the function of a `fn` item. See kMaxNestingDepth.
+bool nests_deeper(const Expression& parent, const Expression& child) {
+    if (const auto* infix = std::get_if<Expression::Infix>(&parent.node)) {
+        return infix->left.get() != &child;
+    }
+    if (const auto* assign = std::get_if<Expression::Assign>(&parent.node)) {
+        return assign->target.get() != &child;
+    }
+    return true;
+}
+
+bool nests_deeper(const Expression&, const Statement&) {
+    return false;
+}
+
+bool nests_deeper(const Statement& parent, const Expression& child) {
+    return !std::holds_alternative<Statement::Let>(parent.node) || child.span.start != 0;
+}
+
+// The nodes from `root` down to the innermost one whose span holds the edited range, each the first child of
+// the one before that holds it. A block's statements are searched by their starts.
+std::vector<PathStep> path_to_edit(ExpressionPtr& root, const EditMap& edit, bool top_level) {
+    std::vector<PathStep> path{PathStep{&root, root->span.start, top_level ? 0u : 1u}};
+    while (true) {
+        const PathStep step = path.back();
+        std::optional<PathStep> next;
+        std::visit(
+            [&](auto* slot) {
+                auto& node = **slot;
+                auto consider = [&](auto& child) {
+                    if (next || !child) {
+                        return;
+                    }
+                    const std::size_t start = step.start + child->span.start;
+                    if (edit.within(start, step.start + child->span.end)) {
+                        next = PathStep{&child, start, step.depth + (nests_deeper(node, *child) ? 1u : 0u)};
+                    }
+                };
+                if constexpr (std::is_same_v<std::decay_t<decltype(node)>, Expression>) {
+                    if (auto* block = std::get_if<Expression::Block>(&node.node)) {
+                        auto after = first_statement_from(block->statements, step.start, edit.start + 1);
+                        if (after != block->statements.begin()) {
+                            consider(*std::prev(after));
+                        }
+                        consider(block->value);
+                        return;
+                    }
+                }
+                for_each_child_slot(node, consider);
+            },
+            step.slot);
+        if (!next) {
+            return path;
+        }
+        path.push_back(*next);
+    }
+}
+
+// Moves the end of `node`, which starts at `start` in a parent starting at `parent_start` and holds the edited
+// range, and every position in it that starts after that range: spans of its children and of operators,
+// names and types. The subtrees of those children stay as they are, since their spans are relative.
+template <typename Node>
+void move_past_edit(Node& node, std::size_t start, std::size_t parent_start, const EditMap& edit) {
+    auto move = [&](SourceSpan& span) {
+        if (start + span.start >= edit.end) {
+            span = SourceSpan{edit.shift(start + span.start), edit.shift(start + span.end)}.relative_to(start);
+        }
+    };
+    auto move_child = [&](auto& child) {
+        if (child) {
+            move(child->span);
+        }
+    };
+    node.span.end = static_cast<std::uint32_t>(edit.shift(parent_start + node.span.end) - parent_start);
+
+    if constexpr (std::is_same_v<Node, Statement>) {
+        if (auto* let = std::get_if<Statement::Let>(&node.node)) {
+            move(let->name_span);
+            if (let->annotation) {
+                move(let->annotation->span);
+            }
+        }
+        for_each_child_slot(node, move_child);
+    } else {
+        std::visit(
+            [&](auto& alternative) {
+                using Alternative = std::decay_t<decltype(alternative)>;
+                if constexpr (std::is_same_v<Alternative, Expression::Block>) {
+                    auto& statements = alternative.statements;
+                    for (auto it = first_statement_from(statements, start, edit.end); it != statements.end(); ++it) {
+                        move((*it)->span);
+                    }
+                    move_child(alternative.value);
+                    return;
+                } else if constexpr (std::is_same_v<Alternative, Expression::Prefix> ||
+                                     std::is_same_v<Alternative, Expression::Infix>) {
+                    move(alternative.op_span);
+                } else if constexpr (std::is_same_v<Alternative, Expression::Function>) {
+                    for (auto& parameter : alternative.signature->parameters) {
+                        move(parameter.name_span);
+                        move(parameter.type.span);
+                    }
+                    move(alternative.signature->return_type.span);
+                }
+                for_each_child_slot(node, move_child);
+            },
+            node.node);
+    }
+}
+
+// Calls `visit` with the id of every Expression and Statement under `root`, including deferred bodies that
+// were parsed but parsing none, until it returns false. A node comes before its children and later children
+// before earlier ones, so the nodes of a subtree the parser built come in the reverse of their creation order.
+// The nodes are kept on an explicit stack, as operator chains nest as deeply as they are long.
+template <typename Root, typename Visit>
+void for_each_id(const Root& root, Visit&& visit) {
+    std::vector<std::variant<const Expression*, const Statement*>> pending{&root};
+    bool more = true;
+    while (more && !pending.empty()) {
+        const auto wrapper = pending.back();
+        pending.pop_back();
+        std::visit(
+            [&](const auto* node) {
+                using Wrapper = std::remove_cvref_t<decltype(*node)>;
+                more = visit(*detail::NodeAllocation<Wrapper, true>::id_slot(node));
+                std::visit(
+                    [&](const auto& alternative) {
+                        if constexpr (std::is_same_v<std::decay_t<decltype(alternative)>, Expression::Function>) {
+                            if (alternative.deferred_body && alternative.deferred_body->parsed()) {
+                                pending.emplace_back(alternative.deferred_body->parsed());
+                            }
+                        }
+                        for_each_child(
+                            alternative,
+                            [&](const auto& child) {
+                                pending.emplace_back(&child);
+                                return true;
+                            },
+                            false);
+                    },
+                    node->node);
+            },
+            wrapper);
+    }
+}
+
+// Numbers the nodes a reparse created, given in creation order, with the ids of the nodes they replaced and
+// then from `bound`. When fewer nodes were created than replaced, the nodes holding the highest ids take the
+// ids left over, so the ids of `root` stay dense. Returns the new bound.
+//
+// Finding those nodes stops once they all have been renumbered. In a tree straight from the parser they come
+// first (see for_each_id), but nodes an earlier reparse numbered from the bound can be anywhere in it.
+NodeId reuse_ids(const Expression& root, NodeId bound, std::vector<NodeId> freed, const std::vector<NodeId*>& created) {
+    std::sort(freed.begin(), freed.end());
+    for (std::size_t i = 0; i < created.size(); ++i) {
+        *created[i] = i < freed.size() ? freed[i] : bound + static_cast<NodeId>(i - freed.size());
+    }
+    if (created.size() >= freed.size()) {
+        return bound + static_cast<NodeId>(created.size() - freed.size());
+    }
+
+    const NodeId new_bound = bound - static_cast<NodeId>(freed.size() - created.size());
+    std::vector<NodeId> holes;
+    for (std::size_t i = created.size(); i < freed.size() && freed[i] < new_bound; ++i) {
+        holes.push_back(freed[i]);
+    }
+    std::size_t next = 0;
+    for_each_id(root, [&](NodeId& id) {
+        if (id >= new_bound) {
+            id = holes[next++];
+        }
+        return next < holes.size();
+    });
+    return new_bound;
+}
+
+bool is_top_level_sequence(const Expression& root) {
+    const auto* block = std::get_if<Expression::Block>(&root.node);
+    return block && !block->statements.empty() && block->statements.front()->span.start == 0;
+}
+
+}  // namespace
+
+ExpressionPtr Parser::reparse(ExpressionPtr previous, const LexResult& lexed, const TextEdit& edit,
+                              std::string source_name, ParserOptions options, StructuralHashCache* hashes) {
+    // The parser borrows the buffers as CompilationSession's does, so no body may be left to parse after the call.
+    options.lazy_function_bodies = false;
+    Parser parser(SharedTokens(SharedTokens{}, &lexed.tokens),
+                  SharedLineOffsets(SharedLineOffsets{}, &lexed.line_offsets), std::move(source_name), options, 0);
+    return parser.reparse(std::move(previous), edit, hashes);
+}
+
+ExpressionPtr Parser::reparse(ExpressionPtr previous, const TextEdit& edit, StructuralHashCache* hashes) {
+    if (!previous || tokens_->empty() || edit.range.start > edit.range.end) {
+        if (hashes) {
+            hashes->clear();
+        }
+        return parse();
+    }
+
+    const EditMap map{edit.range.start, edit.range.end, edit.replacement.size()};
+    const std::vector<Token>& tokens = *tokens_;
+
+    // A block whose braces both lie outside the edit can be reparsed on its own: the tokens before '{' are
+    // unchanged, and a '}' found at the shifted offset means the lexer resynchronised before the block ended.
+    auto reparse_block = [&](const PathStep& step) -> ExpressionPtr {
+        const SourceSpan span = (*std::get<ExpressionPtr*>(step.slot))->span;
+        const std::size_t end = step.start + span.end - span.start;
+        if (!(step.start < map.start && map.end < end)) {
+            return nullptr;
+        }
+        auto open = find_token_at(tokens, step.start);
+        auto close = find_token_at(tokens, map.shift(end - 1));
+        if (!open || !close || tokens[*open].type != TokenType::LeftBrace ||
+            tokens[*close].type != TokenType::RightBrace) {
+            return nullptr;
+        }
+        try {
+            current_ = *open + 1;
+            depth_ = step.depth;
+            created_ids_.clear();
+            auto reparsed = parse_block(tokens[*open]);
+            return current_ == *close + 1 ? std::move(reparsed) : nullptr;
+        } catch (const std::runtime_error&) {
+            return nullptr;
+        }
+    };
+
+    // A top-level item can be reparsed on its own when the reparse ends where the item's end moved to. The text
+    // after that is unchanged and the lexer restarts cleanly at a token boundary, so the tokens from there on,
+    // and the items they make up, are the ones before the edit.
+    auto reparse_item = [&](const PathStep& step, SourceSpan span, bool is_value) -> std::optional<SequenceItem> {
+        const std::size_t end = step.start + span.end - span.start;
+        if (!(step.start < map.start && map.end <= end)) {
+            return std::nullopt;
+        }
+        auto first = find_token_at(tokens, step.start);
+        const std::size_t next = first_token_from(tokens, map.shift(end));
+        if (!first) {
+            return std::nullopt;
+        }
+        try {
+            current_ = *first;
+            depth_ = 0;
+            created_ids_.clear();
+            auto item = parse_sequence_item();
+            const SourceSpan reparsed = item.statement ? item.statement->span : item.value->span;
+            const bool same_end =
+                current_ == next || (current_ == next + 1 && tokens[next].type == TokenType::Semicolon);
+            if ((item.value != nullptr) != is_value || reparsed.end != map.shift(end) || !same_end) {
+                return std::nullopt;
+            }
+            return item;
+        } catch (const std::runtime_error&) {
+            return std::nullopt;
+        }
+    };
+
+    const bool top_level = is_top_level_sequence(*previous);
+    const std::vector<PathStep> path = path_to_edit(previous, map, top_level);
+    // Only the nodes on the path can have a different subtree after the reparse; spans are not hashed.
+    if (hashes) {
+        for (const PathStep& step : path) {
+            std::visit([&](auto* slot) { hashes->invalidate(**slot); }, step.slot);
+        }
+    }
+
+    // The nodes of the reparsed subtree take over the ids of the ones they replace; see reuse_ids. The nodes
+    // above it on the path grow or shrink, and so do the positions in them after the edit.
+    const NodeId bound = node_id_bound(*previous);
+    record_ids_ = true;
+    auto replace = [&](std::size_t replaced, auto replacement) {
+        for (std::size_t i = 0; i < replaced && !map.keeps_length(); ++i) {
+            const std::size_t parent_start = i == 0 ? 0 : path[i - 1].start;
+            std::visit([&](auto* slot) { move_past_edit(**slot, path[i].start, parent_start, map); }, path[i].slot);
+        }
+        auto& slot = *std::get<decltype(replacement)*>(path[replaced].slot);
+        std::vector<NodeId> freed;
+        for_each_id(*slot, [&](NodeId id) {
+            freed.push_back(id);
+            return true;
+        });
+        replacement->span = replacement->span.relative_to(replaced == 0 ? 0 : path[replaced - 1].start);
+        slot = std::move(replacement);
+        record_ids_ = false;
+        next_id_ = reuse_ids(*previous, bound, freed, created_ids_);
+        created_ids_.clear();
+        // Every id that changed hands, or was dropped or added with the bound, names a different node now.
+        if (hashes) {
+            for (const NodeId id : freed) {
+                hashes->invalidate_id(id);
+            }
+            for (NodeId id = std::min(bound, next_id_); id < std::max(bound, next_id_); ++id) {
+                hashes->invalidate_id(id);
+            }
+        }
+        return record_id_bound(std::move(previous));
+    };
+
+    // The innermost braced block enclosing the edit first; the program's own block has no braces.
+    for (std::size_t i = path.size(); i-- > (top_level ? 1 : 0);) {
+        auto* const* slot = std::get_if<ExpressionPtr*>(&path[i].slot);
+        if (slot && std::holds_alternative<Expression::Block>((**slot)->node)) {
+            if (auto reparsed = reparse_block(path[i])) {
+                return replace(i, std::move(reparsed));
+            }
+        }
+    }
+
+    if (top_level && path.size() > 1) {
+        if (auto* const* value = std::get_if<ExpressionPtr*>(&path[1].slot)) {
+            if (auto item = reparse_item(path[1], (**value)->span, true)) {
+                return replace(1, std::move(item->value));
+            }
+        } else if (auto item = reparse_item(path[1], (*std::get<StatementPtr*>(path[1].slot))->span, false)) {
+            return replace(1, std::move(item->statement));
+        }
+    }
+
+    current_ = 0;
+    next_id_ = 0;
+    depth_ = 0;
+    record_ids_ = false;
+    created_ids_.clear();
+    if (hashes) {
+        hashes->clear();
+    }
+    return parse();
+}
+
+}  // namespace sonar
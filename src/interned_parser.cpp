@@ -0,0 +1,60 @@
+#include <utility>
+#include <vector>
+
+#include "sonar/parser.hpp"
+#include "sonar/syntax_interner.hpp"
+
+namespace sonar {
+
+InternedTree Parser::parse_interned(SyntaxInterner& interner) {
+    InternedTree tree;
+    // Reserved for the span of the enclosing block; dropped when the program is a single expression.
+    tree.spans.emplace_back();
+
+    std::vector<SyntaxId> statements;
+    SyntaxId value = kNoSyntax;
+    SourceSpan span{};
+    // Where each item's own span is in tree.spans, to be made relative to the block once it is known.
+    std::vector<std::size_t> item_spans;
+    while (!check(TokenType::End) && !is_at_end()) {
+        if (check(TokenType::Semicolon)) {
+            advance();
+            continue;
+        }
+
+        auto item = parse_sequence_item();
+        if (item.statement) {
+            span.start = statements.empty() ? item.statement->span.start : span.start;
+            span.end = item.statement->span.end;
+            item_spans.push_back(tree.spans.size());
+            statements.push_back(interner.intern(*item.statement, tree.spans));
+            continue;
+        }
+
+        span.start = statements.empty() ? item.value->span.start : span.start;
+        span.end = item.value->span.end;
+        item_spans.push_back(tree.spans.size());
+        value = interner.intern(*item.value, tree.spans);
+        break;
+    }
+    consume(TokenType::End, "Expected end of input");
+
+    // Mirrors finish_program.
+    if (statements.empty()) {
+        tree.spans.erase(tree.spans.begin());
+        if (value == kNoSyntax) {
+            return interner.intern(Expression(Expression::Unit{}, tokens_->back().span));
+        }
+        tree.root = value;
+        return tree;
+    }
+
+    tree.spans.front() = span;
+    for (const std::size_t index : item_spans) {
+        tree.spans[index] = tree.spans[index].relative_to(span.start);
+    }
+    tree.root = interner.intern_block(statements, value);
+    return tree;
+}
+
+}  // namespace sonar
@@ -1,13 +1,20 @@
 #include "sonar/lexer.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cctype>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <memory_resource>
 #include <sstream>
 #include <stdexcept>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
+#include "sonar/metrics.hpp"
+
 namespace sonar {
 
 namespace {
@@ -16,21 +23,31 @@ bool is_digit(char ch) {
     return static_cast<bool>(std::isdigit(static_cast<unsigned char>(ch)));
 }
 
-inline TokenType keyword_or_identifier(std::string_view lexeme) {
-    static const std::unordered_map<std::string_view, TokenType> keywords = {
-        {"let", TokenType::Let},
-        {"fn", TokenType::Fn},
-        {"if", TokenType::If},
-        {"else", TokenType::Else},
-        {"for", TokenType::For},
-        {"while", TokenType::While},
-        {"in", TokenType::In},
-        {"true", TokenType::True},
-        {"false", TokenType::False},
-    };
+struct Keyword {
+    std::string_view text;
+    TokenType type;
+};
+
+// Constant-initialised, so concurrent lexers share nothing they could race on.
+constexpr std::array<Keyword, 9> kKeywords = {{
+    {"let", TokenType::Let},
+    {"fn", TokenType::Fn},
+    {"if", TokenType::If},
+    {"else", TokenType::Else},
+    {"for", TokenType::For},
+    {"while", TokenType::While},
+    {"in", TokenType::In},
+    {"true", TokenType::True},
+    {"false", TokenType::False},
+}};
 
-    auto it = keywords.find(lexeme);
-    return (it != keywords.end()) ? it->second : TokenType::Identifier;
+inline TokenType keyword_or_identifier(std::string_view lexeme) {
+    for (const Keyword& keyword : kKeywords) {
+        if (keyword.text == lexeme) {
+            return keyword.type;
+        }
+    }
+    return TokenType::Identifier;
 }
 
 Token scan_ident(std::string_view source, std::size_t& index) {
@@ -96,9 +113,9 @@ Token scan_number(std::string_view source, std::size_t& index, auto&& make_error
     return {TokenType::Number, std::string(source.substr(start, length)), SourceSpan{start, start + length}};
 }
 
-template <typename ErrorMaker>
+template <typename ErrorMaker, typename LineOffsets>
 Token scan_string_literal(std::string_view source, std::size_t& index, ErrorMaker&& make_error,
-                          [[maybe_unused]] std::vector<std::size_t>& line_offsets) {
+                          [[maybe_unused]] LineOffsets& line_offsets) {
     const std::size_t start = index;
     ++index;  // consume opening quote
     std::string value;
@@ -150,9 +167,9 @@ Token scan_string_literal(std::string_view source, std::size_t& index, ErrorMake
     throw make_error("Unterminated string literal", start);
 }
 
-template <typename ErrorMaker>
+template <typename ErrorMaker, typename LineOffsets>
 Token scan_raw_string_literal(std::string_view source, std::size_t& index, ErrorMaker&& make_error,
-                              std::vector<std::size_t>& line_offsets) {
+                              LineOffsets& line_offsets) {
     const std::size_t start = index;
     ++index;  // consume 'r'
 
@@ -201,184 +218,415 @@ Token scan_raw_string_literal(std::string_view source, std::size_t& index, Error
     throw make_error("Unterminated raw string literal", start);
 }
 
-}  // namespace
+// Scans into a LexResult or a PmrLexResult.
+template <typename Result>
+class Scanner {
+   public:
+    // `line_base` counts the lines before `source`, for error locations in a part of a larger input.
+    Scanner(std::string_view source, Result& result, std::size_t index = 0, std::size_t line_base = 0)
+        : source_(source), result_(result), index_(index), line_base_(line_base) {}
+
+    std::size_t index() const noexcept { return index_; }
+
+    // Skips whitespace and comments, then appends the next token. Returns false once the input is exhausted.
+    bool scan_token() {
+        while (index_ < source_.size()) {
+            const char ch = source_[index_];
+            if (ch == '\n') {
+                ++index_;
+                result_.line_offsets.push_back(index_);
+                continue;
+            }
+            if (std::isspace(static_cast<unsigned char>(ch))) {
+                ++index_;
+                continue;
+            }
+            if (ch == '/' && peek(1) == '/') {
+                index_ += 2;
+                while (index_ < source_.size() && peek() != '\n') {
+                    ++index_;
+                }
+                continue;
+            }
+            if (ch == '/' && peek(1) == '*') {
+                skip_block_comment();
+                continue;
+            }
 
-LexResult Lexer::tokenize(std::string_view source) const {
-    LexResult result;
-    result.tokens.reserve(source.size());
-    result.line_offsets.reserve(16);
-    result.line_offsets.push_back(0);
-
-    auto location_for = [&](std::size_t offset) {
-        auto it = std::upper_bound(result.line_offsets.begin(), result.line_offsets.end(), offset);
-        std::size_t line_index = (it == result.line_offsets.begin()) ? 0 : static_cast<std::size_t>(std::distance(result.line_offsets.begin(), it) - 1);
-        std::size_t line = line_index + 1;
-        std::size_t column = offset - result.line_offsets[line_index] + 1;
+            scan_non_trivia(ch);
+            return true;
+        }
+        return false;
+    }
+
+    void push_end() {
+        result_.tokens.push_back({TokenType::End, "", SourceSpan{source_.size(), source_.size()}});
+    }
+
+   private:
+    char peek(std::size_t lookahead = 0) const {
+        return (index_ + lookahead < source_.size()) ? source_[index_ + lookahead] : '\0';
+    }
+
+    SourceLocation location_for(std::size_t offset) const {
+        const auto& offsets = result_.line_offsets;
+        auto it = std::upper_bound(offsets.begin(), offsets.end(), offset);
+        std::size_t line_index = (it == offsets.begin()) ? 0 : static_cast<std::size_t>(std::distance(offsets.begin(), it) - 1);
+        std::size_t line = line_base_ + line_index + 1;
+        std::size_t column = offset - offsets[line_index] + 1;
         return SourceLocation{line, column};
-    };
+    }
 
-    auto make_error = [&](const std::string& message, std::size_t offset) {
+    std::runtime_error make_error(const std::string& message, std::size_t offset) const {
         auto location = location_for(offset);
         std::ostringstream oss;
         oss << message << " at line " << location.line << ", column " << location.column;
         return std::runtime_error(oss.str());
-    };
-
-    std::size_t index = 0;
-
-    auto peek = [&](std::size_t lookahead = 0) -> char {
-        return (index + lookahead < source.size()) ? source[index + lookahead] : '\0';
-    };
+    }
 
-    while (index < source.size()) {
-        const char ch = source[index];
-        if (ch == '\n') {
-            ++index;
-            result.line_offsets.push_back(index);
-            continue;
+    void skip_block_comment() {
+        index_ += 2;
+        bool terminated = false;
+        while (index_ < source_.size()) {
+            char current = peek();
+            if (current == '\n') {
+                ++index_;
+                result_.line_offsets.push_back(index_);
+                continue;
+            }
+            if (current == '*' && peek(1) == '/') {
+                index_ += 2;  // consume */
+                terminated = true;
+                break;
+            }
+            ++index_;
         }
-        if (std::isspace(static_cast<unsigned char>(ch))) {
-            ++index;
-            continue;
+        if (!terminated) {
+            throw make_error("Unterminated block comment", index_);
         }
+    }
+
+    void push_operator(TokenType type, const char* lexeme, std::size_t length) {
+        result_.tokens.push_back({type, lexeme, SourceSpan{index_, index_ + length}});
+        index_ += length;
+    }
+
+    void scan_non_trivia(char ch) {
+        auto error = [this](const std::string& message, std::size_t offset) { return make_error(message, offset); };
 
         switch (ch) {
             case '+':
-                result.tokens.push_back({TokenType::Plus, "+", SourceSpan{index, index + 1}});
-                ++index;
-                continue;
-            case '-': {
+                return push_operator(TokenType::Plus, "+", 1);
+            case '-':
                 if (peek(1) == '>') {
-                    result.tokens.push_back({TokenType::Arrow, "->", SourceSpan{index, index + 2}});
-                    index += 2;
-                } else {
-                    result.tokens.push_back({TokenType::Minus, "-", SourceSpan{index, index + 1}});
-                    ++index;
+                    return push_operator(TokenType::Arrow, "->", 2);
                 }
-                continue;
-            }
+                return push_operator(TokenType::Minus, "-", 1);
             case '*':
-                result.tokens.push_back({TokenType::Star, "*", SourceSpan{index, index + 1}});
-                ++index;
-                continue;
-            case '/': {
-                if (peek(1) == '/') {
-                    index += 2;
-                    while (index < source.size() && peek() != '\n') {
-                        ++index;
-                    }
-                    continue;
-                } else if (peek(1) == '*') {
-                    index += 2;
-                    bool terminated = false;
-                    while (index < source.size()) {
-                        char current = peek();
-                        if (current == '\n') {
-                            ++index;
-                            result.line_offsets.push_back(index);
-                            continue;
-                        }
-                        if (current == '*' && peek(1) == '/') {
-                            index += 2;  // consume */
-                            terminated = true;
-                            break;
-                        }
-                        ++index;
-                    }
-                    if (!terminated) {
-                        throw make_error("Unterminated block comment", index);
-                    }
-                    continue;
-                }
-
-                result.tokens.push_back({TokenType::Slash, "/", SourceSpan{index, index + 1}});
-                ++index;
-                continue;
-            }
-            case '&': {
+                return push_operator(TokenType::Star, "*", 1);
+            case '/':
+                return push_operator(TokenType::Slash, "/", 1);
+            case '&':
                 if (peek(1) == '&') {
-                    result.tokens.push_back({TokenType::AndAnd, "&&", SourceSpan{index, index + 2}});
-                    index += 2;
-                } else {
-                    result.tokens.push_back({TokenType::Ampersand, "&", SourceSpan{index, index + 1}});
-                    ++index;
+                    return push_operator(TokenType::AndAnd, "&&", 2);
                 }
-                continue;
-            }
-            case '|': {
+                return push_operator(TokenType::Ampersand, "&", 1);
+            case '|':
                 if (peek(1) == '|') {
-                    result.tokens.push_back({TokenType::OrOr, "||", SourceSpan{index, index + 2}});
-                    index += 2;
-                } else {
-                    result.tokens.push_back({TokenType::Pipe, "|", SourceSpan{index, index + 1}});
-                    ++index;
+                    return push_operator(TokenType::OrOr, "||", 2);
                 }
-                continue;
-            }
+                return push_operator(TokenType::Pipe, "|", 1);
             case '(':
-                result.tokens.push_back({TokenType::LeftParen, "(", SourceSpan{index, index + 1}});
-                ++index;
-                continue;
+                return push_operator(TokenType::LeftParen, "(", 1);
             case ')':
-                result.tokens.push_back({TokenType::RightParen, ")", SourceSpan{index, index + 1}});
-                ++index;
-                continue;
+                return push_operator(TokenType::RightParen, ")", 1);
             case ',':
-                result.tokens.push_back({TokenType::Comma, ",", SourceSpan{index, index + 1}});
-                ++index;
-                continue;
+                return push_operator(TokenType::Comma, ",", 1);
             case '=':
-                result.tokens.push_back({TokenType::Equals, "=", SourceSpan{index, index + 1}});
-                ++index;
-                continue;
+                return push_operator(TokenType::Equals, "=", 1);
             case ':':
-                result.tokens.push_back({TokenType::Colon, ":", SourceSpan{index, index + 1}});
-                ++index;
-                continue;
+                return push_operator(TokenType::Colon, ":", 1);
             case '{':
-                result.tokens.push_back({TokenType::LeftBrace, "{", SourceSpan{index, index + 1}});
-                ++index;
-                continue;
+                return push_operator(TokenType::LeftBrace, "{", 1);
             case '}':
-                result.tokens.push_back({TokenType::RightBrace, "}", SourceSpan{index, index + 1}});
-                ++index;
-                continue;
+                return push_operator(TokenType::RightBrace, "}", 1);
             case ';':
-                result.tokens.push_back({TokenType::Semicolon, ";", SourceSpan{index, index + 1}});
-                ++index;
-                continue;
+                return push_operator(TokenType::Semicolon, ";", 1);
             default:
                 break;
         }
 
         if (is_digit(ch) || ch == '.') {
-            result.tokens.push_back(scan_number(source, index, make_error));
-            continue;
+            result_.tokens.push_back(scan_number(source_, index_, error));
+            return;
         }
 
         if (ch == '"') {
-            result.tokens.push_back(scan_string_literal(source, index, make_error, result.line_offsets));
-            continue;
+            result_.tokens.push_back(scan_string_literal(source_, index_, error, result_.line_offsets));
+            return;
         }
 
         if (ch == 'r') {
             char next = peek(1);
             if (next == '"' || next == '#') {
-                result.tokens.push_back(scan_raw_string_literal(source, index, make_error, result.line_offsets));
-                continue;
+                result_.tokens.push_back(scan_raw_string_literal(source_, index_, error, result_.line_offsets));
+                return;
             }
         }
 
         if (std::isalpha(static_cast<unsigned char>(ch)) || ch == '_') {
-            result.tokens.push_back(scan_ident(source, index));
-            continue;
+            result_.tokens.push_back(scan_ident(source_, index_));
+            return;
         }
 
-        throw make_error("Unexpected character '" + std::string(1, ch) + "'", index);
+        throw make_error("Unexpected character '" + std::string(1, ch) + "'", index_);
+    }
+
+    std::string_view source_;
+    Result& result_;
+    std::size_t index_;
+    std::size_t line_base_;
+};
+
+// SourceSpan stores offsets in 32 bits.
+void check_source_size(std::size_t size) {
+    if (size >= std::numeric_limits<std::uint32_t>::max()) {
+        throw std::runtime_error("Source is too large to tokenize (4 GiB or more)");
     }
+}
+
+void check_source_size(std::string_view source) {
+    check_source_size(source.size());
+}
+
+// How much TokenReader reads at a time, at least; it reads as much as it holds when that is more, so a token
+// longer than this is rescanned a logarithmic number of times.
+constexpr std::size_t kReadBlockSize = 64 * 1024;
+
+// Lexes `source` into `result`, whose vectors must be empty but may have capacity.
+template <typename Result>
+void tokenize_into(std::string_view source, Result& result) {
+    const auto& metrics = metrics::frontend();
+    metrics::ScopedLatency latency(metrics.lex_latency);
+    try {
+        check_source_size(source);
+        result.tokens.reserve(source.size());
+        result.line_offsets.reserve(16);
+        result.line_offsets.push_back(0);
+
+        Scanner scanner(source, result);
+        while (scanner.scan_token()) {
+        }
+        scanner.push_end();
+    } catch (const std::runtime_error&) {
+        metrics.lex_errors.add();
+        throw;
+    }
+    metrics.lexed_tokens.add(result.tokens.size());
+    metrics.lexed_bytes.add(source.size());
+}
+
+// Replaces `into`[first, last) with `from` after its first `skip` elements, assigning over the replaced
+// elements before inserting or erasing the difference, so `into` moves its tail at most once. Returns where
+// the elements that followed the replaced ones are now.
+template <typename T>
+std::size_t replace_range(std::vector<T>& into, std::size_t first, std::size_t last, std::vector<T>& from,
+                          std::size_t skip) {
+    const auto from_first = from.begin() + static_cast<std::ptrdiff_t>(skip);
+    const std::size_t count = from.size() - skip;
+    const std::size_t assigned = std::min(count, last - first);
+    const auto tail = std::move(from_first, from_first + static_cast<std::ptrdiff_t>(assigned),
+                                into.begin() + static_cast<std::ptrdiff_t>(first));
+    if (count > assigned) {
+        into.insert(tail, std::make_move_iterator(from_first + static_cast<std::ptrdiff_t>(assigned)),
+                    std::make_move_iterator(from.end()));
+    } else {
+        into.erase(tail, tail + static_cast<std::ptrdiff_t>(last - first - assigned));
+    }
+    return first + count;
+}
+
+}  // namespace
 
-    result.tokens.push_back({TokenType::End, "", SourceSpan{source.size(), source.size()}});
+LexResult Lexer::tokenize(std::string_view source) const {
+    LexResult result;
+    tokenize(source, result);
+    return result;
+}
+
+void Lexer::tokenize(std::string_view source, LexResult& result) const {
+    result.tokens.clear();
+    result.line_offsets.clear();
+    tokenize_into(source, result);
+}
+
+PmrLexResult Lexer::tokenize(std::string_view source, std::pmr::memory_resource* resource) const {
+    if (resource == nullptr) {
+        resource = std::pmr::get_default_resource();
+    }
+    PmrLexResult result{std::pmr::vector<Token>(resource), std::pmr::vector<std::size_t>(resource)};
+    tokenize_into(source, result);
     return result;
 }
 
+void Lexer::retokenize(LexResult& lexed, std::string_view source, const TextEdit& edit) const {
+    check_source_size(source);
+    const std::size_t removed = edit.range.end - edit.range.start;
+    const std::size_t inserted = edit.replacement.size();
+    const std::size_t edit_end = edit.range.start + inserted;
+    auto& tokens = lexed.tokens;
+    auto& lines = lexed.line_offsets;
+    if (lines.empty()) {
+        lines.push_back(0);
+    }
+
+    // The lexer restarts cleanly at every token boundary, so tokens that end before the edit are kept verbatim.
+    const auto first_dirty =
+        std::lower_bound(tokens.begin(), tokens.end(), edit.range.start,
+                         [](const Token& token, std::size_t offset) { return token.span.end < offset; });
+    const std::size_t first = static_cast<std::size_t>(first_dirty - tokens.begin());
+    const std::size_t resume = (first_dirty == tokens.begin()) ? 0 : std::prev(first_dirty)->span.end;
+
+    // The new tokens are lexed apart, so that a lexical error leaves `lexed` untouched, starting from the line
+    // that holds `resume` so that errors are located as tokenize would locate them.
+    const auto resume_line = std::upper_bound(lines.begin(), lines.end(), resume);
+    LexResult fresh;
+    fresh.line_offsets.push_back(*std::prev(resume_line));
+    Scanner scanner(source, fresh, resume, static_cast<std::size_t>(resume_line - lines.begin()) - 1);
+
+    // Replaces the old tokens [first, last) and the old line offsets after `resume` up to `lines_last` with
+    // the fresh ones, then moves everything after them by the edit's length delta.
+    auto splice = [&](std::size_t last, std::vector<std::size_t>::iterator lines_last) {
+        const std::size_t lines_first = static_cast<std::size_t>(resume_line - lines.begin());
+        const std::size_t moved_tokens = replace_range(tokens, first, last, fresh.tokens, 0);
+        const auto lines_end = static_cast<std::size_t>(lines_last - lines.begin());
+        const std::size_t moved_lines = replace_range(lines, lines_first, lines_end, fresh.line_offsets, 1);
+        if (removed == inserted) {
+            return;
+        }
+        const auto delta = static_cast<std::uint32_t>(inserted - removed);
+        for (auto it = tokens.begin() + static_cast<std::ptrdiff_t>(moved_tokens); it != tokens.end(); ++it) {
+            it->span.start += delta;
+            it->span.end += delta;
+        }
+        for (auto it = lines.begin() + static_cast<std::ptrdiff_t>(moved_lines); it != lines.end(); ++it) {
+            *it = *it - removed + inserted;
+        }
+    };
+
+    while (scanner.scan_token()) {
+        const std::size_t token_start = fresh.tokens.back().span.start;
+        if (token_start < edit_end) {
+            continue;
+        }
+
+        // Once a fresh token lines up with an old one past the edit, the rest of the old stream is still valid.
+        const std::size_t old_start = token_start - inserted + removed;
+        auto match = std::lower_bound(first_dirty, tokens.end(), old_start,
+                                      [](const Token& old, std::size_t offset) { return old.span.start < offset; });
+        if (match == tokens.end() || match->span.start != old_start || match->type != fresh.tokens.back().type) {
+            continue;
+        }
+
+        fresh.tokens.pop_back();
+        while (fresh.line_offsets.size() > 1 && fresh.line_offsets.back() > token_start) {
+            fresh.line_offsets.pop_back();
+        }
+        splice(static_cast<std::size_t>(match - tokens.begin()),
+               std::upper_bound(lines.begin(), lines.end(), old_start));
+        return;
+    }
+
+    scanner.push_end();
+    splice(tokens.size(), lines.end());
+}
+
+TokenReader::TokenReader(std::istream& input) : input_(input) {
+    lexed_.line_offsets.push_back(0);
+}
+
+bool TokenReader::read_more() {
+    if (at_end_of_input_) {
+        return false;
+    }
+    const std::size_t size = text_.size();
+    const std::size_t block = std::max(kReadBlockSize, size);
+    text_.resize(size + block);
+    input_.read(text_.data() + size, static_cast<std::streamsize>(block));
+    const auto read = static_cast<std::size_t>(input_.gcount());
+    text_.resize(size + read);
+    if (read < block) {
+        at_end_of_input_ = true;
+    }
+    check_source_size(base_ + text_.size());
+    return read > 0 || !at_end_of_input_;
+}
+
+Token TokenReader::next() {
+    const auto& metrics = metrics::frontend();
+    // A token, or an error, is only final once the text after it has been read: until then `-` may become
+    // `->`, a number may grow an exponent and a string or comment may still be closed.
+    const std::size_t lines = lexed_.line_offsets.size();
+    while (true) {
+        lexed_.tokens.clear();
+        lexed_.line_offsets.resize(lines);
+        Scanner scanner(std::string_view(text_), lexed_, scanned_, lines_before_);
+        bool scanned = false;
+        try {
+            scanned = scanner.scan_token();
+        } catch (const std::runtime_error&) {
+            // The scanner looks at most one character past where it stopped.
+            if (scanner.index() + 1 >= text_.size() && read_more()) {
+                continue;
+            }
+            metrics.lex_errors.add();
+            throw;
+        }
+        if ((!scanned || scanner.index() == text_.size()) && read_more()) {
+            continue;
+        }
+
+        scanned_ = scanner.index();
+        if (!scanned) {
+            const std::size_t end = base_ + text_.size();
+            metrics.lexed_tokens.add(tokens_read_ + 1);
+            metrics.lexed_bytes.add(end);
+            return {TokenType::End, "", SourceSpan{end, end}};
+        }
+        Token token = std::move(lexed_.tokens.back());
+        token.span = SourceSpan{base_ + token.span.start, base_ + token.span.end};
+        ++tokens_read_;
+        return token;
+    }
+}
+
+void TokenReader::release(std::size_t offset) {
+    // Keep the line holding `offset`, so columns can still be counted from its start.
+    const auto& lines = lexed_.line_offsets;
+    const auto kept = std::prev(std::upper_bound(lines.begin(), lines.end(), std::min(offset - base_, scanned_)));
+    const std::size_t dropped_lines = static_cast<std::size_t>(kept - lines.begin());
+    const std::size_t dropped = *kept;
+    // Text is only moved once at least half of it can go, so releasing after every token stays linear.
+    if (dropped_lines == 0 || dropped < text_.size() / 2) {
+        return;
+    }
+    text_.erase(0, dropped);
+    base_ += dropped;
+    scanned_ -= dropped;
+    lines_before_ += dropped_lines;
+    lexed_.line_offsets.erase(lexed_.line_offsets.begin(), kept);
+    for (auto& line : lexed_.line_offsets) {
+        line -= dropped;
+    }
+}
+
+std::vector<std::size_t> TokenReader::line_offsets() const {
+    std::vector<std::size_t> lines;
+    lines.reserve(lexed_.line_offsets.size());
+    for (const std::size_t line : lexed_.line_offsets) {
+        lines.push_back(base_ + line);
+    }
+    return lines;
+}
+
 }  // namespace sonar
@@ -0,0 +1,223 @@
+#include "sonar/metrics.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+
+namespace sonar::metrics {
+
+namespace {
+
+std::atomic<std::size_t> next_shard{0};
+
+bool valid_name(std::string_view name, bool allow_colon) {
+    if (name.empty()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < name.size(); ++i) {
+        const char c = name[i];
+        const bool letter = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || (allow_colon && c == ':');
+        if (!letter && !(i > 0 && c >= '0' && c <= '9')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void write_escaped(std::ostream& out, std::string_view text, bool quote) {
+    for (const char c : text) {
+        if (c == '\\') {
+            out << "\\\\";
+        } else if (c == '\n') {
+            out << "\\n";
+        } else if (quote && c == '"') {
+            out << "\\\"";
+        } else {
+            out << c;
+        }
+    }
+}
+
+// `{a="1",b="2"}`, with `extra` appended as one more label, or nothing when there are no labels.
+void write_labels(std::ostream& out, const Labels& labels, const std::pair<std::string, std::string>* extra = nullptr) {
+    if (labels.empty() && extra == nullptr) {
+        return;
+    }
+    out << '{';
+    bool first = true;
+    const auto write = [&](const std::pair<std::string, std::string>& label) {
+        out << (first ? "" : ",") << label.first << "=\"";
+        write_escaped(out, label.second, true);
+        out << '"';
+        first = false;
+    };
+    std::for_each(labels.begin(), labels.end(), write);
+    if (extra != nullptr) {
+        write(*extra);
+    }
+    out << '}';
+}
+
+std::string seconds(LatencyHistogram::Duration duration) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.9g", std::chrono::duration<double>(duration).count());
+    return text;
+}
+
+}  // namespace
+
+std::size_t this_thread_shard() noexcept {
+    thread_local const std::size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return shard;
+}
+
+std::uint64_t Counter::value() const noexcept {
+    std::uint64_t total = 0;
+    for (const Cell& cell : cells_) {
+        total += cell.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::vector<LatencyHistogram::Duration> LatencyHistogram::default_buckets() {
+    using namespace std::chrono_literals;
+    return {10us, 25us, 50us, 100us, 250us, 500us, 1ms, 2500us, 5ms, 10ms, 25ms, 50ms, 100ms, 250ms, 500ms,
+            1s,   2500ms, 5s, 10s};
+}
+
+LatencyHistogram::LatencyHistogram(std::vector<Duration> upper_bounds) : upper_bounds_(std::move(upper_bounds)) {
+    if (upper_bounds_.empty() || std::adjacent_find(upper_bounds_.begin(), upper_bounds_.end(),
+                                                    std::greater_equal<>()) != upper_bounds_.end()) {
+        throw std::invalid_argument("histogram bucket bounds must be non-empty and strictly increasing");
+    }
+    for (Shard& shard : shards_) {
+        shard.buckets = std::make_unique<std::atomic<std::uint64_t>[]>(upper_bounds_.size() + 1);
+    }
+}
+
+void LatencyHistogram::observe(Duration duration) noexcept {
+    const auto bucket = static_cast<std::size_t>(
+        std::lower_bound(upper_bounds_.begin(), upper_bounds_.end(), duration) - upper_bounds_.begin());
+    Shard& shard = shards_[this_thread_shard()];
+    shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.sum_nanoseconds.fetch_add(duration.count(), std::memory_order_relaxed);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot snapshot;
+    snapshot.cumulative.assign(upper_bounds_.size() + 1, 0);
+    std::int64_t sum = 0;
+    for (const Shard& shard : shards_) {
+        for (std::size_t i = 0; i <= upper_bounds_.size(); ++i) {
+            snapshot.cumulative[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        }
+        sum += shard.sum_nanoseconds.load(std::memory_order_relaxed);
+    }
+    for (std::size_t i = 1; i < snapshot.cumulative.size(); ++i) {
+        snapshot.cumulative[i] += snapshot.cumulative[i - 1];
+    }
+    snapshot.sum = Duration(sum);
+    return snapshot;
+}
+
+Registry& Registry::global() {
+    // Never destroyed, so metrics can still be updated from static destructors.
+    static Registry* registry = new Registry();
+    return *registry;
+}
+
+Registry::Family& Registry::family(const std::string& name, const std::string& help, Type type, const Labels& labels) {
+    if (!valid_name(name, true)) {
+        throw std::invalid_argument("invalid metric name '" + name + "'");
+    }
+    for (const auto& label : labels) {
+        if (!valid_name(label.first, false) || label.first.starts_with("__") || label.first == "le") {
+            throw std::invalid_argument("invalid label name '" + label.first + "' for metric '" + name + "'");
+        }
+    }
+    auto [it, inserted] = families_.try_emplace(name, Family{type, help, {}, {}});
+    if (!inserted && it->second.type != type) {
+        throw std::invalid_argument("metric '" + name + "' is already registered with another type");
+    }
+    return it->second;
+}
+
+Counter& Registry::counter(const std::string& name, const std::string& help, const Labels& labels) {
+    std::lock_guard lock(mutex_);
+    auto& counters = family(name, help, Type::Counter, labels).counters;
+    for (auto& [existing, counter] : counters) {
+        if (existing == labels) {
+            return *counter;
+        }
+    }
+    return *counters.emplace_back(labels, std::make_unique<Counter>()).second;
+}
+
+LatencyHistogram& Registry::latency_histogram(const std::string& name, const std::string& help, const Labels& labels,
+                                              std::vector<LatencyHistogram::Duration> upper_bounds) {
+    std::lock_guard lock(mutex_);
+    auto& histograms = family(name, help, Type::Histogram, labels).histograms;
+    for (auto& [existing, histogram] : histograms) {
+        if (existing == labels) {
+            return *histogram;
+        }
+    }
+    return *histograms.emplace_back(labels, std::make_unique<LatencyHistogram>(std::move(upper_bounds))).second;
+}
+
+void Registry::write_prometheus(std::ostream& out) const {
+    std::lock_guard lock(mutex_);
+    for (const auto& [name, family] : families_) {
+        out << "# HELP " << name << ' ';
+        write_escaped(out, family.help, false);
+        out << "\n# TYPE " << name << (family.type == Type::Counter ? " counter\n" : " histogram\n");
+        for (const auto& [labels, counter] : family.counters) {
+            out << name;
+            write_labels(out, labels);
+            out << ' ' << counter->value() << '\n';
+        }
+        for (const auto& [labels, histogram] : family.histograms) {
+            const auto snapshot = histogram->snapshot();
+            const auto& bounds = histogram->upper_bounds();
+            for (std::size_t i = 0; i <= bounds.size(); ++i) {
+                const std::pair<std::string, std::string> le{"le", i < bounds.size() ? seconds(bounds[i]) : "+Inf"};
+                out << name << "_bucket";
+                write_labels(out, labels, &le);
+                out << ' ' << snapshot.cumulative[i] << '\n';
+            }
+            out << name << "_sum";
+            write_labels(out, labels);
+            out << ' ' << seconds(snapshot.sum) << '\n';
+            out << name << "_count";
+            write_labels(out, labels);
+            out << ' ' << snapshot.count() << '\n';
+        }
+    }
+}
+
+const FrontendMetrics& frontend() {
+    static const FrontendMetrics metrics = [] {
+        Registry& registry = Registry::global();
+        const auto errors = [&](const char* kind) -> Counter& {
+            return registry.counter("sonar_errors_total", "Errors thrown while lexing and parsing, by kind.",
+                                    {{"kind", kind}});
+        };
+        return FrontendMetrics{
+            registry.counter("sonar_lexed_tokens_total", "Tokens produced by the lexer."),
+            registry.counter("sonar_lexed_bytes_total", "Source bytes read by the lexer."),
+            registry.latency_histogram("sonar_lex_duration_seconds", "Time to lex one source."),
+            registry.counter("sonar_ast_nodes_total", "Syntax tree expressions and statements allocated by the parser."),
+            registry.latency_histogram("sonar_parse_duration_seconds", "Time to parse one program."),
+            registry.counter("sonar_printed_bytes_total", "Bytes produced by the pretty printer."),
+            registry.latency_histogram("sonar_print_duration_seconds", "Time to pretty print one tree."),
+            errors("lex"),
+            errors("syntax"),
+            errors("incomplete"),
+        };
+    }();
+    return metrics;
+}
+
+}  // namespace sonar::metrics
@@ -0,0 +1,28 @@
+#include "sonar/node_map.hpp"
+
+#include "sonar/visitor.hpp"
+
+namespace sonar {
+
+namespace {
+
+class Numbering : public AstWalker<Numbering> {
+   public:
+    template <typename Wrapper, typename Node>
+    void leave(const Wrapper& wrapper, const Node&) {
+        *detail::NodeAllocation<Wrapper, true>::id_slot(&wrapper) = next++;
+    }
+
+    NodeId next{0};
+};
+
+}  // namespace
+
+NodeId number_nodes(Expression& root) {
+    Numbering numbering;
+    numbering.walk(root);
+    *detail::NodeAllocation<Expression, true>::id_bound_slot(&root) = numbering.next;
+    return numbering.next;
+}
+
+}  // namespace sonar
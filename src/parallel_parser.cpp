@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <exception>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sonar/parser.hpp"
+#include "sonar/thread_pool.hpp"
+#include "sonar/trace.hpp"
+
+namespace sonar {
+
+namespace {
+
+// Chunks per thread; more than one evens out uneven statement sizes.
+constexpr std::size_t kChunksPerThread = 4;
+
+}  // namespace
+
+bool Parser::TopLevelScan::ends_item(TokenType type, TokenType next) {
+    // Mirrors the item ends of parse_sequence_item: a ';' at depth zero, or the closing brace of a
+    // `fn name(...) -> type { ... }` item that no infix operator continues. Anything the scan misjudges is
+    // caught when the parse of an item does not stop exactly where the scan ended it.
+    if (depth_ == 0 && at_item_start_ && type == TokenType::Fn && next == TokenType::Identifier) {
+        in_fn_item_ = true;
+    }
+    at_item_start_ = false;
+
+    bool ends = false;
+    switch (type) {
+        case TokenType::LeftParen:
+        case TokenType::LeftBrace:
+            if (depth_ == 0 && in_fn_item_ && type == TokenType::LeftBrace && previous_ == TokenType::Identifier &&
+                before_previous_ == TokenType::Arrow) {
+                in_fn_body_ = true;
+            }
+            ++depth_;
+            break;
+        case TokenType::RightParen:
+        case TokenType::RightBrace:
+            depth_ = depth_ > 0 ? depth_ - 1 : 0;
+            if (depth_ == 0 && in_fn_body_ && type == TokenType::RightBrace) {
+                in_fn_item_ = false;
+                in_fn_body_ = false;
+                ends = !find_infix_rule(next);
+            }
+            break;
+        case TokenType::Semicolon:
+            if (depth_ == 0) {
+                in_fn_item_ = false;
+                in_fn_body_ = false;
+                ends = true;
+            }
+            break;
+        default:
+            break;
+    }
+
+    at_item_start_ = ends;
+    before_previous_ = previous_;
+    previous_ = type;
+    return ends;
+}
+
+std::vector<std::size_t> Parser::find_top_level_boundaries() const {
+    const auto& tokens = *tokens_;
+    std::vector<std::size_t> boundaries{0};
+    TopLevelScan scan;
+    std::size_t index = 0;
+    for (; tokens[index].type != TokenType::End; ++index) {
+        if (scan.ends_item(tokens[index].type, tokens[index + 1].type)) {
+            boundaries.push_back(index + 1);
+        }
+    }
+
+    if (boundaries.back() != index) {
+        boundaries.push_back(index);
+    }
+    return boundaries;
+}
+
+ExpressionPtr Parser::parse_parallel(ThreadPool& pool) {
+    return measured([&] { return parse_chunks(pool); });
+}
+
+ExpressionPtr Parser::parse_chunks(ThreadPool& pool) {
+    current_ = 0;
+    const auto boundaries = find_top_level_boundaries();
+    if (pool.size() < 2 || boundaries.size() < 3) {
+        return parse_program();
+    }
+
+    // Group items into chunks of roughly equal token counts.
+    const std::size_t end = boundaries.back();
+    const std::size_t target = std::max<std::size_t>(end / (pool.size() * kChunksPerThread), 1);
+    std::vector<std::size_t> cuts{0};
+    for (std::size_t boundary : boundaries) {
+        if (boundary - cuts.back() >= target && boundary != end) {
+            cuts.push_back(boundary);
+        }
+    }
+    cuts.push_back(end);
+
+    struct ChunkResult {
+        StatementSequence sequence;
+        std::size_t end{0};
+        std::exception_ptr error;
+        // The chunk's nodes in creation order, numbered once the counts of the chunks before it are known.
+        std::vector<NodeId*> created;
+    };
+    std::vector<ChunkResult> results(cuts.size() - 1);
+
+    pool.parallel_for(results.size(), [&](std::size_t chunk) {
+        TraceSpan span(options_.trace, "parse chunk",
+                       options_.trace ? "tokens " + std::to_string(cuts[chunk]) + "-" + std::to_string(cuts[chunk + 1])
+                                      : std::string());
+        Parser parser(tokens_, line_offsets_, source_name_, options_, cuts[chunk]);
+        parser.id_source_ = id_source_;
+        parser.record_ids_ = true;
+        auto& result = results[chunk];
+        try {
+            while (parser.current_ < cuts[chunk + 1] && !parser.is_at_end()) {
+                if (parser.check(TokenType::Semicolon)) {
+                    parser.advance();
+                    continue;
+                }
+                auto item = parser.parse_sequence_item();
+                if (!item.statement) {
+                    result.sequence.value = std::move(item.value);
+                    break;
+                }
+                result.sequence.statements.push_back(std::move(item.statement));
+            }
+        } catch (...) {
+            result.error = std::current_exception();
+        }
+        result.end = parser.current_;
+        result.created = std::move(parser.created_ids_);
+    });
+
+    // Each chunk only saw the state a sequential parse would have had at its start if every earlier chunk
+    // stopped exactly at its cut, so the first error among such chunks is the sequential error.
+    StatementSequence merged;
+    for (std::size_t chunk = 0; chunk < results.size(); ++chunk) {
+        auto& result = results[chunk];
+        if (result.error) {
+            std::rethrow_exception(result.error);
+        }
+        const bool last = chunk + 1 == results.size();
+        if (result.end != cuts[chunk + 1] || (result.sequence.value && !last)) {
+            current_ = 0;
+            next_id_ = 0;
+            return parse_program();
+        }
+        if (merged.statements.empty()) {
+            merged.statements = std::move(result.sequence.statements);
+        } else {
+            for (auto& statement : result.sequence.statements) {
+                merged.statements.push_back(std::move(statement));
+            }
+        }
+        merged.value = std::move(result.sequence.value);
+    }
+
+    // Numbering each chunk after the ones before it gives the ids a sequential parse would.
+    std::vector<NodeId> first_ids(results.size() + 1, 0);
+    for (std::size_t chunk = 0; chunk < results.size(); ++chunk) {
+        first_ids[chunk + 1] = first_ids[chunk] + static_cast<NodeId>(results[chunk].created.size());
+    }
+    pool.parallel_for(results.size(), [&](std::size_t chunk) {
+        const auto& created = results[chunk].created;
+        for (std::size_t i = 0; i < created.size(); ++i) {
+            *created[i] = first_ids[chunk] + static_cast<NodeId>(i);
+        }
+    });
+
+    current_ = end;
+    next_id_ = first_ids.back();
+    consume(TokenType::End, "Expected end of input");
+    return record_id_bound(finish_program(std::move(merged)));
+}
+
+}  // namespace sonar
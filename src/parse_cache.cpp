@@ -0,0 +1,130 @@
+#include "sonar/parse_cache.hpp"
+
+#include <new>
+#include <utility>
+
+#include "sonar/ast_stats.hpp"
+#include "sonar/hash.hpp"
+#include "sonar/lexer.hpp"
+
+namespace sonar {
+
+namespace {
+
+// Bookkeeping per entry: the list node, its index slot and the shared_ptr control block.
+constexpr std::size_t kEntryOverhead = 128;
+
+// Messages are short; this only has to keep a flood of cached errors within the budget.
+constexpr std::size_t kErrorBytes = 256;
+
+}  // namespace
+
+ParseCache::ParseCache(std::size_t byte_budget) : byte_budget_(byte_budget) {}
+
+ParseCache::Key ParseCache::make_key(std::string_view source, const std::string& source_name, ParserOptions options) {
+    std::uint64_t seed = hash_combine(kFrontEndVersion, options.lazy_function_bodies ? 1 : 0);
+    if (options.lazy_function_bodies) {
+        seed = hash_bytes(source_name, seed);
+    }
+    return Key{hash_bytes(source, seed), source.size()};
+}
+
+bool ParseCache::Entry::matches(std::string_view other_source, const std::string& other_name,
+                                ParserOptions options) const {
+    if (lazy != options.lazy_function_bodies || source != other_source) {
+        return false;
+    }
+    return (tree && !lazy) || source_name == other_name;
+}
+
+std::shared_ptr<const Expression> ParseCache::parse(std::string_view source, const std::string& source_name,
+                                                    ParserOptions options) {
+    const Key key = make_key(source, source_name, options);
+    {
+        std::lock_guard lock(mutex_);
+        if (auto it = index_.find(key); it != index_.end()) {
+            Entry& entry = *it->second;
+            if (entry.matches(source, source_name, options)) {
+                ++hits_;
+                entries_.splice(entries_.begin(), entries_, it->second);
+                if (entry.error) {
+                    std::rethrow_exception(entry.error);
+                }
+                return entry.tree;
+            }
+        }
+        ++misses_;
+    }
+
+    // Cached trees outlive any per-request resource, so they always come from the default one.
+    options.memory_resource = nullptr;
+    Entry entry{key, std::string(source), options.lazy_function_bodies, {}, nullptr, nullptr,
+                kEntryOverhead + source.size()};
+    if (entry.lazy) {
+        entry.source_name = source_name;
+        entry.bytes += source_name.size();
+    }
+    try {
+        Lexer lexer;
+        auto lex_result = lexer.tokenize(source);
+        Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), source_name, options);
+        entry.tree = parser.parse();
+        entry.bytes += collect_ast_stats(*entry.tree).bytes;
+    } catch (const std::bad_alloc&) {
+        throw;
+    } catch (...) {
+        entry.error = std::current_exception();
+        if (!entry.lazy) {
+            entry.source_name = source_name;
+            entry.bytes += source_name.size();
+        }
+        entry.bytes += kErrorBytes;
+    }
+
+    auto tree = entry.tree;
+    auto error = entry.error;
+    insert(std::move(entry));
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return tree;
+}
+
+void ParseCache::insert(Entry entry) {
+    std::lock_guard lock(mutex_);
+    if (entry.bytes > byte_budget_) {
+        return;
+    }
+    if (auto it = index_.find(entry.key); it != index_.end()) {
+        bytes_ -= it->second->bytes;
+        entries_.erase(it->second);
+        index_.erase(it);
+    }
+    evict_to(byte_budget_ - entry.bytes);
+    bytes_ += entry.bytes;
+    entries_.push_front(std::move(entry));
+    index_.emplace(entries_.front().key, entries_.begin());
+}
+
+void ParseCache::evict_to(std::size_t budget) {
+    while (bytes_ > budget && !entries_.empty()) {
+        const Entry& victim = entries_.back();
+        bytes_ -= victim.bytes;
+        index_.erase(victim.key);
+        entries_.pop_back();
+    }
+}
+
+ParseCache::Stats ParseCache::stats() const {
+    std::lock_guard lock(mutex_);
+    return Stats{hits_, misses_, entries_.size(), bytes_};
+}
+
+void ParseCache::clear() {
+    std::lock_guard lock(mutex_);
+    entries_.clear();
+    index_.clear();
+    bytes_ = 0;
+}
+
+}  // namespace sonar
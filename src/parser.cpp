@@ -1,140 +1,166 @@
 #include "sonar/parser.hpp"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory_resource>
 #include <stdexcept>
-#include <unordered_map>
+#include <type_traits>
 #include <utility>
-#include <optional>
+#include <variant>
 
 namespace sonar {
 
 namespace {
-struct TokenTypeHash {
-    std::size_t operator()(TokenType type) const noexcept {
-        return static_cast<std::size_t>(type);
-    }
-};
+
+constexpr std::size_t kTokenTypeCount = static_cast<std::size_t>(TokenType::End) + 1;
+
+constexpr std::size_t index_of(TokenType type) {
+    return static_cast<std::size_t>(type);
+}
+
+std::pmr::polymorphic_allocator<> allocator_for(const ParserOptions& options) {
+    return std::pmr::polymorphic_allocator<>(options.memory_resource ? options.memory_resource
+                                                                     : std::pmr::get_default_resource());
+}
 
 }  // namespace
 
 const Parser::PrefixParselet* Parser::find_prefix_rule(TokenType type) {
-    using PrefixRuleMap = std::unordered_map<TokenType, PrefixParselet, TokenTypeHash>;
-
-    static const PrefixRuleMap rules = []() {
-        PrefixRuleMap map;
-        map.emplace(TokenType::Number, PrefixParselet{[](Parser& parser, Token token) {
-                        return parser.parse_number(std::move(token));
-                    }});
-        map.emplace(TokenType::String, PrefixParselet{[](Parser& parser, Token token) {
-                        return parser.parse_string(std::move(token));
-                    }});
-        map.emplace(TokenType::True, PrefixParselet{[](Parser& parser, Token token) {
-                        return parser.parse_boolean(std::move(token));
-                    }});
-        map.emplace(TokenType::False, PrefixParselet{[](Parser& parser, Token token) {
-                        return parser.parse_boolean(std::move(token));
-                    }});
-        map.emplace(TokenType::Minus, PrefixParselet{[](Parser& parser, Token token) {
-                        return parser.parse_prefix_operator(std::move(token));
-                    }});
-        map.emplace(TokenType::LeftParen, PrefixParselet{[](Parser& parser, Token token) {
-                        return parser.parse_grouping(std::move(token));
-                    }});
-        map.emplace(TokenType::Identifier, PrefixParselet{[](Parser& parser, Token token) {
-                        return parser.parse_identifier(std::move(token));
-                    }});
-        map.emplace(TokenType::Fn, PrefixParselet{[](Parser& parser, Token token) {
-                        return parser.parse_function_literal(std::move(token));
-                    }});
-        map.emplace(TokenType::LeftBrace, PrefixParselet{[](Parser& parser, Token token) {
-                        return parser.parse_block(std::move(token));
-                    }});
-        map.emplace(TokenType::If, PrefixParselet{[](Parser& parser, Token token) {
-                        return parser.parse_if(std::move(token));
-                    }});
-        map.emplace(TokenType::While, PrefixParselet{[](Parser& parser, Token token) {
-                        return parser.parse_while(std::move(token));
-                    }});
-        map.emplace(TokenType::For, PrefixParselet{[](Parser& parser, Token token) {
-                        return parser.parse_for(std::move(token));
-                    }});
-        return map;
+    static constexpr auto rules = [] {
+        std::array<PrefixParselet, kTokenTypeCount> table{};
+        table[index_of(TokenType::Number)] = &Parser::parse_number;
+        table[index_of(TokenType::String)] = &Parser::parse_string;
+        table[index_of(TokenType::True)] = &Parser::parse_boolean;
+        table[index_of(TokenType::False)] = &Parser::parse_boolean;
+        table[index_of(TokenType::Minus)] = &Parser::parse_prefix_operator;
+        table[index_of(TokenType::LeftParen)] = &Parser::parse_grouping;
+        table[index_of(TokenType::Identifier)] = &Parser::parse_identifier;
+        table[index_of(TokenType::Fn)] = &Parser::parse_function_literal;
+        table[index_of(TokenType::LeftBrace)] = &Parser::parse_block;
+        table[index_of(TokenType::If)] = &Parser::parse_if;
+        table[index_of(TokenType::While)] = &Parser::parse_while;
+        table[index_of(TokenType::For)] = &Parser::parse_for;
+        return table;
     }();
 
-    auto it = rules.find(type);
-    if (it == rules.end()) {
-        return nullptr;
-    }
-    return &it->second;
+    const PrefixParselet& rule = rules[index_of(type)];
+    return rule ? &rule : nullptr;
 }
 
 const Parser::InfixRule* Parser::find_infix_rule(TokenType type) {
-    using InfixRuleMap = std::unordered_map<TokenType, InfixRule, TokenTypeHash>;
-
-    static const InfixRuleMap rules = []() {
-        InfixRuleMap map;
-        auto make_rule = [](Precedence precedence, bool right_associative) {
-            return InfixRule{precedence,
-                             right_associative,
-                             InfixParselet{[](Parser& parser, ExpressionPtr left, Token op, Precedence precedence_value,
-                                              bool is_right_associative) {
-                                 return parser.parse_binary_operator(std::move(left), std::move(op), precedence_value, is_right_associative);
-                             }}};
+    static constexpr auto rules = [] {
+        std::array<InfixRule, kTokenTypeCount> table{};
+        auto binary = [](Precedence precedence) {
+            return InfixRule{precedence, false, &Parser::parse_binary_operator};
         };
-
-        map.emplace(TokenType::Equals,
-                    InfixRule{
-                        Precedence::Assignment,
-                        true,
-                        InfixParselet{
-                            [](Parser& parser, ExpressionPtr left, Token op,
-                               Precedence precedence_value, bool /*unused*/) {
-                                return parser.parse_assignment(std::move(left), std::move(op), precedence_value);
-                            }}});
-        map.emplace(TokenType::OrOr, make_rule(Precedence::LogicalOr, false));
-        map.emplace(TokenType::AndAnd, make_rule(Precedence::LogicalAnd, false));
-        map.emplace(TokenType::Pipe, make_rule(Precedence::BitwiseOr, false));
-        map.emplace(TokenType::Ampersand, make_rule(Precedence::BitwiseAnd, false));
-        map.emplace(TokenType::Plus, make_rule(Precedence::Sum, false));
-        map.emplace(TokenType::Minus, make_rule(Precedence::Sum, false));
-        map.emplace(TokenType::Star, make_rule(Precedence::Product, false));
-        map.emplace(TokenType::Slash, make_rule(Precedence::Product, false));
-        return map;
+        table[index_of(TokenType::Equals)] = InfixRule{Precedence::Assignment, true, &Parser::parse_assignment};
+        table[index_of(TokenType::OrOr)] = binary(Precedence::LogicalOr);
+        table[index_of(TokenType::AndAnd)] = binary(Precedence::LogicalAnd);
+        table[index_of(TokenType::Pipe)] = binary(Precedence::BitwiseOr);
+        table[index_of(TokenType::Ampersand)] = binary(Precedence::BitwiseAnd);
+        table[index_of(TokenType::Plus)] = binary(Precedence::Sum);
+        table[index_of(TokenType::Minus)] = binary(Precedence::Sum);
+        table[index_of(TokenType::Star)] = binary(Precedence::Product);
+        table[index_of(TokenType::Slash)] = binary(Precedence::Product);
+        return table;
     }();
 
-    auto it = rules.find(type);
-    if (it == rules.end()) {
-        return nullptr;
+    const InfixRule& rule = rules[index_of(type)];
+    return rule.parselet ? &rule : nullptr;
+}
+
+Parser::Parser(std::vector<Token> tokens, std::vector<std::size_t> line_offsets, std::string source_name,
+               ParserOptions options)
+    : tokens_(std::allocate_shared<const std::vector<Token>>(allocator_for(options), std::move(tokens))),
+      source_name_(std::move(source_name)),
+      options_(options) {
+    if (line_offsets.empty()) {
+        line_offsets.push_back(0);
     }
-    return &it->second;
+    line_offsets_ = std::allocate_shared<const std::vector<std::size_t>>(allocator_for(options), std::move(line_offsets));
 }
 
-Parser::Parser(std::vector<Token> tokens, std::vector<std::size_t> line_offsets, std::string source_name)
+Parser::Parser(SharedTokens tokens, SharedLineOffsets line_offsets, std::string source_name, ParserOptions options,
+               std::size_t start)
     : tokens_(std::move(tokens)),
+      current_(start),
       line_offsets_(std::move(line_offsets)),
-      source_name_(std::move(source_name)) {
-    if (line_offsets_.empty()) {
-        line_offsets_.push_back(0);
-    }
-}
+      source_name_(std::move(source_name)),
+      options_(options) {}
 
 ExpressionPtr Parser::parse() {
+    return measured([this] { return parse_program(); });
+}
+
+ExpressionPtr Parser::parse_program() {
     auto sequence = parse_sequence(TokenType::End);
     consume(TokenType::End, "Expected end of input");
+    return record_id_bound(finish_program(std::move(sequence)));
+}
+
+ExpressionPtr Parser::parse_streaming(const StatementCallback& on_statement) {
+    return measured([&] {
+        // Deferred bodies of delivered statements may be parsed while this parse goes on, so each item takes
+        // its ids from the shared count.
+        record_ids_ = true;
+        created_ids_.clear();
+        ExpressionPtr value;
+        while (!is_at_end()) {
+            if (check(TokenType::Semicolon)) {
+                advance();
+                continue;
+            }
 
+            auto item = parse_sequence_item();
+            assign_ids();
+            if (!item.statement) {
+                value = std::move(item.value);
+                break;
+            }
+            on_statement(std::move(item.statement));
+        }
+        consume(TokenType::End, "Expected end of input");
+        record_ids_ = false;
+        return value;
+    });
+}
+
+ExpressionPtr Parser::finish_program(StatementSequence sequence) {
     if (sequence.statements.empty()) {
         if (!sequence.value) {
-            const Token& end_token = tokens_.back();
-            Expression::Unit node{end_token.span};
-            return std::make_unique<Expression>(std::move(node));
+            const Token& end_token = tokens_->back();
+            Expression::Unit node{};
+            return make_node<Expression>(std::move(node), end_token.span);
         }
         return std::move(sequence.value);
     }
 
     SourceSpan span{sequence.statements.front()->span.start,
                     sequence.value ? sequence.value->span.end : sequence.statements.back()->span.end};
-    Expression::Block node{std::move(sequence.statements), std::move(sequence.value), span};
-    return std::make_unique<Expression>(std::move(node));
+    Expression::Block node{std::move(sequence.statements), std::move(sequence.value)};
+    return make_node<Expression>(std::move(node), span);
+}
+
+ExpressionPtr Parser::record_id_bound(ExpressionPtr root) {
+    *detail::NodeAllocation<Expression, true>::id_bound_slot(root.get()) = next_id_;
+    id_source_->root = root.get();
+    return root;
+}
+
+NodeId Parser::IdSource::take(NodeId count) {
+    if (root != nullptr) {
+        return std::atomic_ref<NodeId>(*detail::NodeAllocation<Expression, true>::id_bound_slot(root)).fetch_add(count);
+    }
+    return next.fetch_add(count);
+}
+
+void Parser::assign_ids() {
+    const NodeId first = id_source_->take(static_cast<NodeId>(created_ids_.size()));
+    for (std::size_t i = 0; i < created_ids_.size(); ++i) {
+        *created_ids_[i] = first + static_cast<NodeId>(i);
+    }
+    created_ids_.clear();
 }
 
 ExpressionPtr Parser::parse_expression(Precedence precedence_floor) {
@@ -142,6 +168,10 @@ ExpressionPtr Parser::parse_expression(Precedence precedence_floor) {
         const Token& end_token = peek();
         throw make_error("Unexpected end of input while parsing expression", end_token.span, true);
     }
+    if (depth_ == kMaxNestingDepth) {
+        throw make_error("Expression is nested too deeply", peek().span, false);
+    }
+    const std::size_t depth = depth_++;
 
     Token token = advance();
     const PrefixParselet* prefix_rule = find_prefix_rule(token.type);
@@ -156,7 +186,7 @@ ExpressionPtr Parser::parse_expression(Precedence precedence_floor) {
         throw make_error("Unexpected token '" + token.lexeme + "' while parsing expression", token.span, false);
     }
 
-    auto left = (*prefix_rule)(*this, std::move(token));
+    auto left = (this->*(*prefix_rule))(std::move(token));
 
     while (!is_at_end()) {
         const Token& next = peek();
@@ -166,9 +196,11 @@ ExpressionPtr Parser::parse_expression(Precedence precedence_floor) {
         }
 
         Token op = advance();
-        left = infix_rule->parselet(*this, std::move(left), std::move(op), infix_rule->precedence, infix_rule->right_associative);
+        left = (this->*infix_rule->parselet)(std::move(left), std::move(op), infix_rule->precedence,
+                                             infix_rule->right_associative);
     }
 
+    depth_ = depth;
     return left;
 }
 
@@ -185,11 +217,11 @@ const Token& Parser::advance() {
         ++current_;
         return previous();
     }
-    return tokens_.back();
+    return tokens_->back();
 }
 
 bool Parser::check(TokenType type) const {
-    return tokens_.at(current_).type == type;
+    return tokens_->at(current_).type == type;
 }
 
 bool Parser::is_at_end() const {
@@ -197,24 +229,24 @@ bool Parser::is_at_end() const {
 }
 
 const Token& Parser::peek() const {
-    return tokens_.at(current_);
+    return tokens_->at(current_);
 }
 
 const Token& Parser::peek(std::size_t offset) const {
-    std::size_t index = std::min(current_ + offset, tokens_.size() - 1);
-    return tokens_.at(index);
+    std::size_t index = std::min(current_ + offset, tokens_->size() - 1);
+    return tokens_->at(index);
 }
 
 const Token& Parser::previous() const {
-    return tokens_.at(current_ - 1);
+    return tokens_->at(current_ - 1);
 }
 
-const Token& Parser::consume(TokenType type, const std::string& message) {
+const Token& Parser::consume(TokenType type, std::string_view message) {
     if (check(type)) {
         return advance();
     }
-    SourceSpan error_span = is_at_end() ? tokens_.back().span : peek().span;
-    throw make_error(message, error_span, is_at_end());
+    SourceSpan error_span = is_at_end() ? tokens_->back().span : peek().span;
+    throw make_error(std::string(message), error_span, is_at_end());
 }
 
 Parser::StatementSequence Parser::parse_sequence(TokenType terminator) {
@@ -226,38 +258,45 @@ Parser::StatementSequence Parser::parse_sequence(TokenType terminator) {
             continue;
         }
 
-        if (check(TokenType::Let)) {
-            auto stmt = parse_let_statement();
-            consume(TokenType::Semicolon, "Expected ';' after let statement");
-            sequence.statements.push_back(std::move(stmt));
+        auto item = parse_sequence_item();
+        if (item.statement) {
+            sequence.statements.push_back(std::move(item.statement));
             continue;
         }
 
-        if (check(TokenType::Fn) && peek(1).type == TokenType::Identifier) {
-            auto stmt = parse_fn_statement();
-            if (check(TokenType::Semicolon)) {
-                throw make_error("Unexpected ';' after function definition", peek().span, false);
-            }
-            sequence.statements.push_back(std::move(stmt));
-            continue;
+        if (sequence.value) {
+            throw make_error("Unexpected expression after final expression", item.value->span, false);
         }
 
-        auto expr = parse_expression();
+        sequence.value = std::move(item.value);
+        break;
+    }
 
-        if (match(TokenType::Semicolon)) {
-            sequence.statements.push_back(make_expression_statement(std::move(expr)));
-            continue;
-        }
+    return sequence;
+}
 
-        if (sequence.value) {
-            throw make_error("Unexpected expression after final expression", expr->span, false);
+Parser::SequenceItem Parser::parse_sequence_item() {
+    if (check(TokenType::Let)) {
+        auto stmt = parse_let_statement();
+        consume(TokenType::Semicolon, "Expected ';' after let statement");
+        return SequenceItem{std::move(stmt), nullptr};
+    }
+
+    if (check(TokenType::Fn) && peek(1).type == TokenType::Identifier) {
+        auto stmt = parse_fn_statement();
+        if (check(TokenType::Semicolon)) {
+            throw make_error("Unexpected ';' after function definition", peek().span, false);
         }
+        return SequenceItem{std::move(stmt), nullptr};
+    }
 
-        sequence.value = std::move(expr);
-        break;
+    auto expr = parse_expression();
+
+    if (match(TokenType::Semicolon)) {
+        return SequenceItem{make_expression_statement(std::move(expr)), nullptr};
     }
 
-    return sequence;
+    return SequenceItem{nullptr, std::move(expr)};
 }
 
 StatementPtr Parser::parse_statement() {
@@ -279,23 +318,23 @@ StatementPtr Parser::parse_statement() {
 
 StatementPtr Parser::make_expression_statement(ExpressionPtr expression) {
     SourceSpan span = expression ? expression->span : SourceSpan{};
-    Statement::Expression node{std::move(expression), span};
-    return std::make_unique<Statement>(std::move(node));
+    Statement::Expression node{std::move(expression)};
+    return make_node<Statement>(std::move(node), span);
 }
 
 StatementPtr Parser::parse_let_statement() {
     Token let_token = consume(TokenType::Let, "Expected 'let'");
     const Token& name = consume(TokenType::Identifier, "Expected identifier after 'let'");
-    std::optional<TypeAnnotation> annotation;
+    std::unique_ptr<TypeAnnotation> annotation;
     if (match(TokenType::Colon)) {
-        annotation = parse_type();
+        annotation = make_node<TypeAnnotation>(parse_type());
     }
 
     consume(TokenType::Equals, "Expected '=' after identifier (or type annotation)");
     auto initializer = parse_expression();
     SourceSpan span{let_token.span.start, initializer->span.end};
-    Statement::Let node{name.lexeme, name.span, std::move(annotation), std::move(initializer), span};
-    return std::make_unique<Statement>(std::move(node));
+    Statement::Let node{name.lexeme, name.span, std::move(annotation), std::move(initializer)};
+    return make_node<Statement>(std::move(node), span);
 }
 
 StatementPtr Parser::parse_fn_statement() {
@@ -303,46 +342,46 @@ StatementPtr Parser::parse_fn_statement() {
     const Token& name = consume(TokenType::Identifier, "Expected function name after 'fn'");
     auto function = parse_function_literal(fn_token);
     SourceSpan span{fn_token.span.start, function->span.end};
-    Statement::Let node{name.lexeme, name.span, std::nullopt, std::move(function), span};
-    return std::make_unique<Statement>(std::move(node));
+    Statement::Let node{name.lexeme, name.span, nullptr, std::move(function)};
+    return make_node<Statement>(std::move(node), span);
 }
 
 ExpressionPtr Parser::parse_number(Token literal) {
-    Expression::Number node{literal.as_number(), literal.span};
-    return std::make_unique<Expression>(std::move(node));
+    Expression::Number node{literal.as_number()};
+    return make_node<Expression>(std::move(node), literal.span);
 }
 
 ExpressionPtr Parser::parse_boolean(Token literal) {
-    Expression::Boolean node{literal.type == TokenType::True, literal.span};
-    return std::make_unique<Expression>(std::move(node));
+    Expression::Boolean node{literal.type == TokenType::True};
+    return make_node<Expression>(std::move(node), literal.span);
 }
 
 ExpressionPtr Parser::parse_string(Token literal) {
-    Expression::String node{std::move(literal.lexeme), literal.span};
-    return std::make_unique<Expression>(std::move(node));
+    Expression::String node{std::move(literal.lexeme)};
+    return make_node<Expression>(std::move(node), literal.span);
 }
 
 ExpressionPtr Parser::parse_grouping(Token open) {
     if (check(TokenType::RightParen)) {
         const Token& close = advance();
         SourceSpan span{open.span.start, close.span.end};
-        Expression::Unit node{span};
-        return std::make_unique<Expression>(std::move(node));
+        Expression::Unit node{};
+        return make_node<Expression>(std::move(node), span);
     }
 
     auto expression = parse_expression();
     const Token& close = consume(TokenType::RightParen, "Expected ')' after expression");
     SourceSpan span{open.span.start, close.span.end};
-    Expression::Grouping node{std::move(expression), span};
-    return std::make_unique<Expression>(std::move(node));
+    Expression::Grouping node{std::move(expression)};
+    return make_node<Expression>(std::move(node), span);
 }
 
 ExpressionPtr Parser::parse_prefix_operator(Token op) {
     auto right = parse_expression(Precedence::Prefix);
     SourceSpan right_span = right->span;
     SourceSpan span{op.span.start, right_span.end};
-    Expression::Prefix node{op.type, op.span, std::move(right), span};
-    return std::make_unique<Expression>(std::move(node));
+    Expression::Prefix node{op.type, op.span, std::move(right)};
+    return make_node<Expression>(std::move(node), span);
 }
 
 ExpressionPtr Parser::parse_binary_operator(ExpressionPtr left, Token op, Precedence operator_precedence, bool right_associative) {
@@ -352,19 +391,84 @@ ExpressionPtr Parser::parse_binary_operator(ExpressionPtr left, Token op, Preced
     SourceSpan left_span = left->span;
     SourceSpan right_span = right->span;
     SourceSpan span{left_span.start, right_span.end};
-    Expression::Infix node{op.type, op.span, std::move(left), std::move(right), span};
-    return std::make_unique<Expression>(std::move(node));
+    Expression::Infix node{op.type, op.span, std::move(left), std::move(right)};
+    return make_node<Expression>(std::move(node), span);
 }
 
-ExpressionPtr Parser::parse_assignment(ExpressionPtr left, Token op, Precedence precedence) {
-    auto* var = std::get_if<Expression::Variable>(&left->node);
-    if (!var) {
+ExpressionPtr Parser::parse_assignment(ExpressionPtr left, Token op, Precedence precedence, bool /*right_associative*/) {
+    if (!std::holds_alternative<Expression::Variable>(left->node)) {
         throw make_error("Left-hand side of assignment must be a variable", op.span, false);
     }
     auto right = parse_expression(precedence);
     SourceSpan span{left->span.start, right->span.end};
-    Expression::Assign node{var->name, var->name_span, std::move(right), span};
-    return std::make_unique<Expression>(std::move(node));
+    Expression::Assign node{std::move(left), std::move(right)};
+    return make_node<Expression>(std::move(node), span);
+}
+
+void Parser::make_spans_relative(Expression& expression) {
+    const std::uint32_t base = expression.span.start;
+    auto relative = [base](SourceSpan& span) { span = span.relative_to(base); };
+    auto child = [&relative](const auto& pointer) {
+        if (pointer) {
+            relative(pointer->span);
+        }
+    };
+    std::visit(
+        [&](auto& node) {
+            using Node = std::decay_t<decltype(node)>;
+            if constexpr (std::is_same_v<Node, Expression::Prefix>) {
+                relative(node.op_span);
+                child(node.right);
+            } else if constexpr (std::is_same_v<Node, Expression::Infix>) {
+                relative(node.op_span);
+                child(node.left);
+                child(node.right);
+            } else if constexpr (std::is_same_v<Node, Expression::Grouping>) {
+                child(node.expression);
+            } else if constexpr (std::is_same_v<Node, Expression::Assign>) {
+                child(node.target);
+                child(node.value);
+            } else if constexpr (std::is_same_v<Node, Expression::Block>) {
+                for (const auto& statement : node.statements) {
+                    child(statement);
+                }
+                child(node.value);
+            } else if constexpr (std::is_same_v<Node, Expression::If>) {
+                child(node.condition);
+                child(node.then);
+                child(node.else_branch);
+            } else if constexpr (std::is_same_v<Node, Expression::While>) {
+                child(node.condition);
+                child(node.body);
+            } else if constexpr (std::is_same_v<Node, Expression::For>) {
+                child(node.pattern);
+                child(node.iterable);
+                child(node.body);
+            } else if constexpr (std::is_same_v<Node, Expression::Function>) {
+                for (auto& parameter : node.signature->parameters) {
+                    relative(parameter.name_span);
+                    relative(parameter.type.span);
+                }
+                relative(node.signature->return_type.span);
+                child(node.body);
+            }
+        },
+        expression.node);
+}
+
+void Parser::make_spans_relative(Statement& statement) {
+    const std::uint32_t base = statement.span.start;
+    if (auto* let = std::get_if<Statement::Let>(&statement.node)) {
+        let->name_span = let->name_span.relative_to(base);
+        if (let->annotation) {
+            let->annotation->span = let->annotation->span.relative_to(base);
+        }
+        let->initializer->span = let->initializer->span.relative_to(base);
+    } else {
+        if (auto& expression = std::get<Statement::Expression>(statement.node).expression) {
+            expression->span = expression->span.relative_to(base);
+        }
+    }
 }
 
 ParseError Parser::make_error(const std::string& message, SourceSpan span, bool incomplete) const {
@@ -373,10 +477,11 @@ ParseError Parser::make_error(const std::string& message, SourceSpan span, bool
 }
 
 SourceLocation Parser::location_for(std::size_t offset) const {
-    auto it = std::upper_bound(line_offsets_.begin(), line_offsets_.end(), offset);
-    std::size_t line_index = (it == line_offsets_.begin()) ? 0 : static_cast<std::size_t>(std::distance(line_offsets_.begin(), it) - 1);
-    std::size_t line = line_index + 1;
-    std::size_t column = offset - line_offsets_[line_index] + 1;
+    const auto& line_offsets = *line_offsets_;
+    auto it = std::upper_bound(line_offsets.begin(), line_offsets.end(), offset);
+    std::size_t line_index = (it == line_offsets.begin()) ? 0 : static_cast<std::size_t>(std::distance(line_offsets.begin(), it) - 1);
+    std::size_t line = line_base_ + line_index + 1;
+    std::size_t column = offset - line_offsets[line_index] + 1;
     return SourceLocation{line, column};
 }
 
@@ -386,8 +491,8 @@ ExpressionPtr Parser::parse_block(Token open) {
     const Token& close = consume(TokenType::RightBrace, "Expected '}' after block");
 
     SourceSpan span{open.span.start, close.span.end};
-    Expression::Block node{std::move(sequence.statements), std::move(sequence.value), span};
-    return std::make_unique<Expression>(std::move(node));
+    Expression::Block node{std::move(sequence.statements), std::move(sequence.value)};
+    return make_node<Expression>(std::move(node), span);
 }
 
 ExpressionPtr Parser::parse_if(Token if_token) {
@@ -402,19 +507,21 @@ ExpressionPtr Parser::parse_if(Token if_token) {
     SourceSpan span{if_token.span.start,
                     (else_branch ? else_branch->span.end : then_branch->span.end)};
 
-    Expression::If node{std::move(condition), std::move(then_branch), std::move(else_branch), span};
-    return std::make_unique<Expression>(std::move(node));
+    Expression::If node{std::move(condition), std::move(then_branch), std::move(else_branch)};
+    return make_node<Expression>(std::move(node), span);
 }
 
 ExpressionPtr Parser::parse_identifier(Token name) {
-    Expression::Variable node{name.lexeme, name.span, name.span};
-    return std::make_unique<Expression>(std::move(node));
+    Expression::Variable node{name.lexeme};
+    return make_node<Expression>(std::move(node), name.span);
 }
 
 ExpressionPtr Parser::parse_function_literal(Token fn_token) {
     consume(TokenType::LeftParen, "Expected '(' after 'fn'");
 
-    std::vector<Expression::Function::Parameter> parameters;
+    auto signature = make_node<Expression::Function::Signature>(Expression::Function::Signature{
+        std::pmr::vector<Expression::Function::Parameter>(allocator_for(options_).resource()), TypeAnnotation{}});
+    auto& parameters = signature->parameters;
 
     if (!check(TokenType::RightParen)) {
         while (true) {
@@ -431,13 +538,61 @@ ExpressionPtr Parser::parse_function_literal(Token fn_token) {
     consume(TokenType::RightParen, "Expected ')' after parameter list");
 
     consume(TokenType::Arrow, "Expected '->' after parameter list");
-    TypeAnnotation return_type = parse_type();
+    signature->return_type = parse_type();
+
+    if (auto deferred = defer_function_body(fn_token.span.start)) {
+        SourceSpan span{fn_token.span.start, previous().span.end};
+        Expression::Function node{std::move(signature), nullptr, std::move(deferred)};
+        return make_node<Expression>(std::move(node), span);
+    }
 
     auto body = parse_expression();
 
     SourceSpan span{fn_token.span.start, body->span.end};
-    Expression::Function node{std::move(parameters), std::move(return_type), std::move(body), span};
-    return std::make_unique<Expression>(std::move(node));
+    Expression::Function node{std::move(signature), std::move(body), nullptr};
+    return make_node<Expression>(std::move(node), span);
+}
+
+std::unique_ptr<DeferredExpression> Parser::defer_function_body(std::size_t function_start) {
+    if (!options_.lazy_function_bodies || !check(TokenType::LeftBrace)) {
+        return nullptr;
+    }
+
+    // Braces only ever delimit blocks, so in a well-formed body the matching '}' ends the block. The body
+    // is the block alone unless an infix operator follows it.
+    const std::size_t open = current_;
+    std::size_t depth = 0;
+    std::size_t index = open;
+    for (; index < tokens_->size(); ++index) {
+        const TokenType type = (*tokens_)[index].type;
+        if (type == TokenType::LeftBrace) {
+            ++depth;
+        } else if (type == TokenType::RightBrace && --depth == 0) {
+            break;
+        } else if (type == TokenType::End) {
+            scanned_to_end_ = true;
+            return nullptr;
+        }
+    }
+    if (find_infix_rule((*tokens_)[index + 1].type)) {
+        return nullptr;
+    }
+
+    // The body's nodes take the next ids of the tree when it is parsed.
+    current_ = index + 1;
+    return std::make_unique<DeferredExpression>(
+        [tokens = tokens_, line_offsets = line_offsets_, line_base = line_base_, source_name = source_name_,
+         options = options_, open, ids = id_source_, depth = depth_, function_start]() {
+            Parser parser(tokens, line_offsets, source_name, options, open);
+            parser.line_base_ = line_base;
+            parser.id_source_ = ids;
+            parser.depth_ = depth;
+            parser.record_ids_ = true;
+            auto body = parser.parse_expression();
+            parser.assign_ids();
+            body->span = body->span.relative_to(function_start);
+            return body;
+        });
 }
 
 TypeAnnotation Parser::parse_type() {
@@ -449,8 +604,8 @@ ExpressionPtr Parser::parse_while(Token while_token) {
     auto condition = parse_expression();
     auto body = parse_expression();
     SourceSpan span{while_token.span.start, body->span.end};
-    Expression::While node{std::move(condition), std::move(body), span};
-    return std::make_unique<Expression>(std::move(node));
+    Expression::While node{std::move(condition), std::move(body)};
+    return make_node<Expression>(std::move(node), span);
 }
 
 ExpressionPtr Parser::parse_for(Token for_token) {
@@ -462,8 +617,8 @@ ExpressionPtr Parser::parse_for(Token for_token) {
     auto body = parse_expression();
 
     SourceSpan span{for_token.span.start, body->span.end};
-    Expression::For node{std::move(pattern), std::move(iterable), std::move(body), span};
-    return std::make_unique<Expression>(std::move(node));
+    Expression::For node{std::move(pattern), std::move(iterable), std::move(body)};
+    return make_node<Expression>(std::move(node), span);
 }
 
 }  // namespace sonar
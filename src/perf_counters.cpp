@@ -0,0 +1,179 @@
+#include "sonar/perf_counters.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace sonar {
+
+std::string_view to_string(PerfEvent event) {
+    switch (event) {
+        case PerfEvent::Cycles:
+            return "cycles";
+        case PerfEvent::Instructions:
+            return "instructions";
+        case PerfEvent::BranchMisses:
+            return "branch-misses";
+        case PerfEvent::L1dMisses:
+            return "L1d-misses";
+        case PerfEvent::LlcMisses:
+            return "LLC-misses";
+    }
+    return "unknown";
+}
+
+std::optional<double> PerfReading::ipc() const {
+    const auto cycles = (*this)[PerfEvent::Cycles];
+    const auto instructions = (*this)[PerfEvent::Instructions];
+    if (!cycles || !instructions || *cycles == 0) {
+        return std::nullopt;
+    }
+    return static_cast<double>(*instructions) / static_cast<double>(*cycles);
+}
+
+std::optional<double> PerfReading::per(PerfEvent event, double units) const {
+    const auto count = (*this)[event];
+    if (!count || units == 0) {
+        return std::nullopt;
+    }
+    return static_cast<double>(*count) / units;
+}
+
+PerfReading& PerfReading::operator+=(const PerfReading& other) {
+    for (std::size_t i = 0; i < kPerfEventCount; ++i) {
+        if (other.counts[i]) {
+            counts[i] = counts[i].value_or(0) + *other.counts[i];
+        }
+    }
+    return *this;
+}
+
+bool PerfCounters::any_available() const {
+    return std::any_of(fds_.begin(), fds_.end(), [](int fd) { return fd >= 0; });
+}
+
+#if defined(__linux__)
+
+namespace {
+
+perf_event_attr attributes(PerfEvent event) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    constexpr auto cache_read_miss = [](std::uint64_t cache) {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    };
+    switch (event) {
+        case PerfEvent::Cycles:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PerfEvent::Instructions:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PerfEvent::BranchMisses:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case PerfEvent::L1dMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache_read_miss(PERF_COUNT_HW_CACHE_L1D);
+            break;
+        case PerfEvent::LlcMisses:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+    }
+    return attr;
+}
+
+}  // namespace
+
+// Each counter is opened on its own rather than as a group, so one the hardware lacks does not take the
+// others with it; the kernel multiplexes them when there are more than registers.
+PerfCounters::PerfCounters() {
+    for (std::size_t i = 0; i < kPerfEventCount; ++i) {
+        const auto event = static_cast<PerfEvent>(i);
+        perf_event_attr attr = attributes(event);
+        fds_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+        if (fds_[i] < 0 && unavailable_reason_.empty()) {
+            const int error = errno;
+            unavailable_reason_ = "perf_event_open(" + std::string(to_string(event)) + "): " + std::strerror(error);
+            if (error == EACCES || error == EPERM) {
+                unavailable_reason_ += " (see /proc/sys/kernel/perf_event_paranoid)";
+            } else if (error == ENOENT || error == EOPNOTSUPP) {
+                unavailable_reason_ += " (no hardware counter for this event, as in many virtual machines)";
+            }
+        }
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : fds_) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+void PerfCounters::start() {
+    for (int fd : fds_) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+PerfReading PerfCounters::stop() {
+    for (int fd : fds_) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    PerfReading reading;
+    for (std::size_t i = 0; i < kPerfEventCount; ++i) {
+        // value, time enabled, time running
+        std::uint64_t values[3] = {};
+        if (fds_[i] < 0 || read(fds_[i], values, sizeof(values)) != static_cast<ssize_t>(sizeof(values)) ||
+            values[2] == 0) {
+            continue;
+        }
+        reading.counts[i] = values[2] == values[1]
+                                ? values[0]
+                                : static_cast<std::uint64_t>(static_cast<double>(values[0]) *
+                                                             static_cast<double>(values[1]) /
+                                                             static_cast<double>(values[2]));
+    }
+    return reading;
+}
+
+#else
+
+PerfCounters::PerfCounters() : unavailable_reason_("hardware counters are only read on Linux") {
+    fds_.fill(-1);
+}
+
+PerfCounters::~PerfCounters() = default;
+
+void PerfCounters::start() {}
+
+PerfReading PerfCounters::stop() { return {}; }
+
+#endif
+
+}  // namespace sonar
@@ -1,26 +1,30 @@
 #include "sonar/pretty_printer.hpp"
 
-#include <sstream>
+#include <charconv>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <variant>
+#include <vector>
+
+#include "sonar/event_parser.hpp"
+#include "sonar/metrics.hpp"
 
 namespace sonar {
 
 namespace {
 
-std::string render(const Expression& expression);
-std::string render(const Statement& statement);
-
-std::string format_number(double value) {
-    std::ostringstream oss;
-    oss << value;
-    return oss.str();
+template <typename String>
+void append_number(String& out, double value) {
+    // Matches `std::ostream << value`: %g with six significant digits, independent of the locale.
+    char buffer[32];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 6);
+    out.append(buffer, result.ptr);
 }
 
-std::string format_string_literal(const std::string& value) {
-    std::string result;
-    result.reserve(value.size() + 2);
-    result.push_back('"');
+template <typename String>
+void append_string_literal(String& out, std::string_view value) {
+    out.push_back('"');
 
     const char* digits = "0123456789ABCDEF";
 
@@ -28,145 +32,383 @@ std::string format_string_literal(const std::string& value) {
         const unsigned char uch = static_cast<unsigned char>(ch);
         switch (ch) {
             case '\\':
-                result += "\\\\";
+                out += "\\\\";
                 break;
             case '"':
-                result += "\\\"";
+                out += "\\\"";
                 break;
             case '\n':
-                result += "\\n";
+                out += "\\n";
                 break;
             case '\t':
-                result += "\\t";
+                out += "\\t";
                 break;
             case '\r':
-                result += "\\r";
+                out += "\\r";
                 break;
             default:
                 if (uch < 0x20) {
-                    result += "\\x";
-                    result.push_back(digits[(uch >> 4) & 0xF]);
-                    result.push_back(digits[uch & 0xF]);
+                    out += "\\x";
+                    out.push_back(digits[(uch >> 4) & 0xF]);
+                    out.push_back(digits[uch & 0xF]);
                 } else {
-                    result.push_back(static_cast<char>(ch));
+                    out.push_back(static_cast<char>(ch));
                 }
         }
     }
 
-    result.push_back('"');
-    return result;
+    out.push_back('"');
 }
 
-struct Printer {
-    std::string operator()(const Expression::Number& number) const {
-        return format_number(number.value);
-    }
+// Appends the whole tree to one buffer, so printing allocates only when that buffer or chain_ grows.
+template <typename String>
+class Printer {
+   public:
+    explicit Printer(String& out) : out_(out) {}
 
-    std::string operator()(const Expression::Boolean& boolean) const {
-        return boolean.value ? "true" : "false";
+    void print(const Expression& expression) {
+        std::visit([this](const auto& node) { (*this)(node); }, expression.node);
     }
 
-    std::string operator()(const Expression::String& string_literal) const {
-        return format_string_literal(string_literal.value);
+    void print(const Statement& statement) {
+        std::visit([this](const auto& node) { (*this)(node); }, statement.node);
     }
 
-    std::string operator()(const Expression::Prefix& prefix) const {
-        std::string result = "(" + to_string(prefix.op) + " " + render(*prefix.right) + ")";
-        return result;
-    }
+    void operator()(const Expression::Number& number) { append_number(out_, number.value); }
 
-    std::string operator()(const Expression::Infix& infix) const {
-        std::string result = "(" + to_string(infix.op) + " " + render(*infix.left) + " " + render(*infix.right) + ")";
-        return result;
-    }
+    void operator()(const Expression::Boolean& boolean) { out_ += boolean.value ? "true" : "false"; }
 
-    std::string operator()(const Expression::Grouping& grouping) const {
-        return "(group " + render(*grouping.expression) + ")";
+    void operator()(const Expression::String& string_literal) { append_string_literal(out_, string_literal.value); }
+
+    void operator()(const Expression::Prefix& prefix) {
+        out_ += "(";
+        out_ += to_string(prefix.op);
+        out_ += " ";
+        print(*prefix.right);
+        out_ += ")";
     }
 
-    std::string operator()(const Expression::Unit&) const {
-        return "(unit)";
+    // An operator chain nests its left operands as deeply as it is long, so the operators down its left
+    // spine are opened in one loop and closed in another, each after its right operand.
+    void operator()(const Expression::Infix& infix) {
+        const std::size_t base = chain_.size();
+        const Expression::Infix* link = &infix;
+        while (true) {
+            out_ += "(";
+            out_ += to_string(link->op);
+            out_ += " ";
+            chain_.push_back(link);
+            const auto* next = std::get_if<Expression::Infix>(&link->left->node);
+            if (next == nullptr) {
+                break;
+            }
+            link = next;
+        }
+        print(*link->left);
+        while (chain_.size() > base) {
+            out_ += " ";
+            print(*chain_.back()->right);
+            out_ += ")";
+            chain_.pop_back();
+        }
     }
 
-    std::string operator()(const Expression::Assign& assign) const {
-        return "(assign " + assign.name + " = " + render(*assign.value) + ")";
+    void operator()(const Expression::Grouping& grouping) {
+        out_ += "(group ";
+        print(*grouping.expression);
+        out_ += ")";
     }
 
-    std::string operator()(const Expression::Variable& variable) const {
-        return variable.name;
+    void operator()(const Expression::Unit&) { out_ += "(unit)"; }
+
+    void operator()(const Expression::Assign& assign) {
+        out_ += "(assign ";
+        out_ += assign.name();
+        out_ += " = ";
+        print(*assign.value);
+        out_ += ")";
     }
 
-    std::string operator()(const Expression::Block& block) const {
-        std::string result = "{ ";
+    void operator()(const Expression::Variable& variable) { out_ += variable.name; }
+
+    void operator()(const Expression::Block& block) {
+        out_ += "{ ";
         for (const auto& stmt : block.statements) {
-            result += render(*stmt) + " ";
+            print(*stmt);
+            out_ += " ";
         }
         if (block.value) {
-            result += render(*block.value) + " ";
+            print(*block.value);
+            out_ += " ";
         }
-        result += "}";
-        return result;
+        out_ += "}";
     }
 
-    std::string operator()(const Expression::If& if_expr) const {
-        std::string result = "(if " + render(*if_expr.condition) + " " + render(*if_expr.then);
+    void operator()(const Expression::If& if_expr) {
+        out_ += "(if ";
+        print(*if_expr.condition);
+        out_ += " ";
+        print(*if_expr.then);
         if (if_expr.else_branch) {
-            result += " else " + render(*if_expr.else_branch);
+            out_ += " else ";
+            print(*if_expr.else_branch);
         }
-        result += ")";
-        return result;
+        out_ += ")";
     }
 
-    std::string operator()(const Expression::While& while_expr) const {
-        return "(while " + render(*while_expr.condition) + " " + render(*while_expr.body) + ")";
+    void operator()(const Expression::While& while_expr) {
+        out_ += "(while ";
+        print(*while_expr.condition);
+        out_ += " ";
+        print(*while_expr.body);
+        out_ += ")";
     }
 
-    std::string operator()(const Expression::For& for_expr) const {
-        return "(for " + render(*for_expr.pattern) + " in " + render(*for_expr.iterable) + " " + render(*for_expr.body) + ")";
+    void operator()(const Expression::For& for_expr) {
+        out_ += "(for ";
+        print(*for_expr.pattern);
+        out_ += " in ";
+        print(*for_expr.iterable);
+        out_ += " ";
+        print(*for_expr.body);
+        out_ += ")";
     }
 
-    std::string operator()(const Expression::Function& fn_expr) const {
-        std::ostringstream oss;
-        oss << "(fn (";
-        for (std::size_t i = 0; i < fn_expr.parameters.size(); ++i) {
+    void operator()(const Expression::Function& fn_expr) {
+        out_ += "(fn (";
+        const auto& parameters = fn_expr.signature->parameters;
+        for (std::size_t i = 0; i < parameters.size(); ++i) {
             if (i > 0) {
-                oss << ' ';
+                out_ += " ";
             }
-            oss << fn_expr.parameters[i].name << ": " << fn_expr.parameters[i].type.name;
+            out_ += parameters[i].name;
+            out_ += ": ";
+            out_ += parameters[i].type.name;
         }
-        oss << ") -> " << fn_expr.return_type.name << ' ' << render(*fn_expr.body) << ")";
-        return oss.str();
+        out_ += ") -> ";
+        out_ += fn_expr.signature->return_type.name;
+        out_ += " ";
+        print(fn_expr.body_expression());
+        out_ += ")";
     }
-};
-
-std::string render(const Expression& expression) {
-    return std::visit(Printer{}, expression.node);
-}
 
-struct StatementPrinter {
-    std::string operator()(const Statement::Let& let) const {
-        std::ostringstream oss;
-        oss << "(let " << let.name;
+    void operator()(const Statement::Let& let) {
+        out_ += "(let ";
+        out_ += let.name;
         if (let.annotation) {
-            oss << ": " << let.annotation->name;
+            out_ += ": ";
+            out_ += let.annotation->name;
         }
-        oss << " = " << render(*let.initializer) << ")";
-        return oss.str();
+        out_ += " = ";
+        print(*let.initializer);
+        out_ += ")";
     }
 
-    std::string operator()(const Statement::Expression& expr_stmt) const {
-        return "(expr " + render(*expr_stmt.expression) + ")";
+    void operator()(const Statement::Expression& expr_stmt) {
+        out_ += "(expr ";
+        print(*expr_stmt.expression);
+        out_ += ")";
     }
+
+   private:
+    String& out_;
+    // Operators whose right operands are still to be printed; see operator()(Infix).
+    std::vector<const Expression::Infix*> chain_;
 };
 
-std::string render(const Statement& statement) {
-    return std::visit(StatementPrinter{}, statement.node);
+template <typename String, typename Node>
+String print_to(const Node& node, String out) {
+    const auto& metrics = metrics::frontend();
+    {
+        metrics::ScopedLatency latency(metrics.print_latency);
+        Printer<String>(out).print(node);
+    }
+    metrics.printed_bytes.add(out.size());
+    return out;
 }
 
+// Writes what `render` would for the tree the events describe. Each node opens with its head, every child
+// is preceded by a separator chosen by its parent, and the node closes once its children are done.
+class EventPrinter {
+   public:
+    void enter(const ParseEvent& event) {
+        if (!frames_.empty()) {
+            separate(frames_.back(), event.kind);
+        }
+        frames_.push_back(Frame{event.kind, 0});
+        open(event);
+    }
+
+    void leave(const ParseEvent& event) {
+        const Frame frame = frames_.back();
+        frames_.pop_back();
+        close(frame, event);
+        if (!frames_.empty()) {
+            ++frames_.back().children;
+        }
+    }
+
+    std::string take() { return std::move(out_); }
+
+   private:
+    struct Frame {
+        ParseEventKind kind;
+        std::size_t children;
+    };
+
+    void open(const ParseEvent& event) {
+        switch (event.kind) {
+            case ParseEventKind::Number:
+                append_number(out_, event.number);
+                break;
+            case ParseEventKind::Boolean:
+                out_ += event.boolean ? "true" : "false";
+                break;
+            case ParseEventKind::String:
+                append_string_literal(out_, event.text);
+                break;
+            case ParseEventKind::Variable:
+            case ParseEventKind::Type:
+            case ParseEventKind::Parameter:
+                out_ += event.text;
+                break;
+            case ParseEventKind::Prefix:
+            case ParseEventKind::Infix:
+                out_ += "(";
+                out_ += to_string(event.op);
+                break;
+            case ParseEventKind::Grouping:
+                out_ += "(group";
+                break;
+            case ParseEventKind::Unit:
+                out_ += "(unit)";
+                break;
+            case ParseEventKind::Assign:
+                out_ += "(assign";
+                break;
+            case ParseEventKind::Block:
+                out_ += "{";
+                break;
+            case ParseEventKind::If:
+                out_ += "(if";
+                break;
+            case ParseEventKind::While:
+                out_ += "(while";
+                break;
+            case ParseEventKind::For:
+                out_ += "(for";
+                break;
+            case ParseEventKind::Function:
+                out_ += "(fn (";
+                break;
+            case ParseEventKind::Let:
+                out_ += "(let ";
+                out_ += event.text;
+                break;
+            case ParseEventKind::ExpressionStatement:
+                out_ += "(expr";
+                break;
+            case ParseEventKind::Program:
+                break;
+        }
+    }
+
+    void separate(const Frame& parent, ParseEventKind child) {
+        switch (parent.kind) {
+            case ParseEventKind::Assign:
+                out_ += parent.children == 0 ? " " : " = ";
+                break;
+            case ParseEventKind::If:
+                out_ += parent.children == 2 ? " else " : " ";
+                break;
+            case ParseEventKind::For:
+                out_ += parent.children == 1 ? " in " : " ";
+                break;
+            case ParseEventKind::Function:
+                if (child == ParseEventKind::Type) {
+                    out_ += ") -> ";
+                } else if (child != ParseEventKind::Parameter || parent.children > 0) {
+                    out_ += " ";
+                }
+                break;
+            case ParseEventKind::Parameter:
+                out_ += ": ";
+                break;
+            case ParseEventKind::Let:
+                out_ += child == ParseEventKind::Type && parent.children == 0 ? ": " : " = ";
+                break;
+            case ParseEventKind::Program:
+                // The program prints as its value alone, or as a block once it has a statement.
+                if (parent.children == 0 && (child == ParseEventKind::Let || child == ParseEventKind::ExpressionStatement)) {
+                    out_ += "{";
+                    program_is_block_ = true;
+                }
+                if (program_is_block_) {
+                    out_ += " ";
+                }
+                break;
+            default:
+                out_ += " ";
+                break;
+        }
+    }
+
+    void close(const Frame& frame, const ParseEvent& event) {
+        switch (event.kind) {
+            case ParseEventKind::Prefix:
+            case ParseEventKind::Infix:
+            case ParseEventKind::Grouping:
+            case ParseEventKind::Assign:
+            case ParseEventKind::If:
+            case ParseEventKind::While:
+            case ParseEventKind::For:
+            case ParseEventKind::Function:
+            case ParseEventKind::Let:
+            case ParseEventKind::ExpressionStatement:
+                out_ += ")";
+                break;
+            case ParseEventKind::Block:
+                out_ += " }";
+                break;
+            case ParseEventKind::Program:
+                if (program_is_block_) {
+                    out_ += " }";
+                } else if (frame.children == 0) {
+                    out_ += "(unit)";
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    std::string out_;
+    std::vector<Frame> frames_;
+    bool program_is_block_{false};
+};
+
 }  // namespace
 
 std::string pretty_print(const Expression& expression) {
-    return render(expression);
+    return print_to(expression, std::string());
+}
+
+std::string pretty_print(const Statement& statement) {
+    return print_to(statement, std::string());
+}
+
+std::pmr::string pretty_print(const Expression& expression, std::pmr::memory_resource* resource) {
+    return print_to(expression, std::pmr::string(resource));
+}
+
+std::pmr::string pretty_print(const Statement& statement, std::pmr::memory_resource* resource) {
+    return print_to(statement, std::pmr::string(resource));
+}
+
+std::string pretty_print_events(EventParser& parser) {
+    EventPrinter printer;
+    parser.parse(printer);
+    return printer.take();
 }
 
 }  // namespace sonar
@@ -0,0 +1,480 @@
+#include "sonar/program_generator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "sonar/parser.hpp"
+
+namespace sonar {
+
+namespace {
+
+constexpr std::size_t kChunkBytes = 64 * 1024;
+
+constexpr std::array<std::string_view, 16> kWords = {"a",    "b",     "count", "total", "value", "items", "index", "left",
+                                                      "node", "acc",   "step",  "size",  "key",   "data",  "limit", "x"};
+constexpr std::array<std::string_view, 4> kTypes = {"number", "bool", "string", "list"};
+constexpr std::array<std::string_view, 5> kEscapes = {"\\n", "\\t", "\\r", "\\\\", "\\\""};
+constexpr std::array<std::string_view, 4> kArithmetic = {" + ", " - ", " * ", " / "};
+constexpr std::array<std::string_view, 2> kLogical = {" && ", " || "};
+constexpr std::array<std::string_view, 2> kBitwise = {" & ", " | "};
+
+// SplitMix64, so that a seed gives the same program whatever the standard library's distributions do.
+class Random {
+   public:
+    explicit Random(std::uint64_t seed) : state_(seed) {}
+
+    std::uint64_t next() {
+        std::uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [0, bound), bound > 0.
+    std::size_t below(std::size_t bound) { return static_cast<std::size_t>(next() % bound); }
+
+    // Uniform in [low, high].
+    std::size_t between(std::size_t low, std::size_t high) { return low + below(high - low + 1); }
+
+    bool chance(double probability) { return static_cast<double>(next() >> 11) * 0x1.0p-53 < probability; }
+
+    template <typename T, std::size_t N>
+    const T& pick(const std::array<T, N>& values) {
+        return values[below(N)];
+    }
+
+   private:
+    std::uint64_t state_;
+};
+
+class Generator {
+   public:
+    Generator(const GeneratorOptions& options, const std::function<void(std::string_view)>& write)
+        : options_(options), write_(write), random_(options.seed) {
+        const OperatorMix& mix = options.operators;
+        operator_weight_ = mix.arithmetic + mix.logical + mix.bitwise;
+        const double total = static_cast<double>(operator_weight_ + mix.prefix + mix.assignment);
+        prefix_chance_ = total == 0 ? 0.0 : mix.prefix / total;
+        assignment_chance_ = total == 0 ? 0.0 : mix.assignment / total;
+        statement_budget_ = kBytesPerLevel * options.width * (options.depth + 1);
+    }
+
+    void run() {
+        std::size_t written = 0;
+        while (written + out_.size() < options_.target_bytes) {
+            statement_start_ = out_.size();
+            statement(options_.depth, 0, true);
+            out_ += '\n';
+            if (out_.size() >= kChunkBytes) {
+                written += out_.size();
+                flush();
+            }
+        }
+        flush();
+    }
+
+   private:
+    // Nesting multiplies: a block of `width` statements, each holding a block of `width` statements, and so
+    // on. Once a top-level statement outgrows its budget, everything still to be generated in it is a leaf.
+    static constexpr std::size_t kBytesPerLevel = 48;
+
+    bool spent() const { return out_.size() - statement_start_ > statement_budget_; }
+
+    void flush() {
+        if (!out_.empty()) {
+            write_(out_);
+            out_.clear();
+        }
+    }
+
+    void name() {
+        out_ += random_.pick(kWords);
+        if (random_.chance(0.7)) {
+            out_ += std::to_string(random_.below(100));
+        }
+    }
+
+    void words(std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (i != 0) {
+                out_ += ' ';
+            }
+            out_ += random_.pick(kWords);
+        }
+    }
+
+    void newline(std::size_t indent) {
+        out_ += '\n';
+        out_.append(indent * 4, ' ');
+    }
+
+    void separator(std::size_t indent, bool multiline) {
+        if (multiline) {
+            newline(indent);
+        } else {
+            out_ += ' ';
+        }
+    }
+
+    // A comment before a statement; line comments only where a newline may follow.
+    void comment(std::size_t indent, bool multiline) {
+        if (multiline && random_.chance(0.6)) {
+            out_ += "// ";
+            words(random_.between(1, 6));
+            newline(indent);
+        } else if (multiline && random_.chance(0.2)) {
+            out_ += "/* ";
+            words(random_.between(1, 4));
+            newline(indent);
+            out_ += "   ";
+            words(random_.between(1, 4));
+            out_ += " */";
+            newline(indent);
+        } else {
+            out_ += "/* ";
+            words(random_.between(1, 4));
+            out_ += " */ ";
+        }
+    }
+
+    void number() {
+        const std::size_t integer = random_.below(1000);
+        switch (random_.below(8)) {
+            case 0:
+                out_ += std::to_string(integer) + "." + std::to_string(random_.below(100));
+                break;
+            case 1:
+                out_ += "." + std::to_string(random_.between(1, 99));
+                break;
+            case 2:
+                out_ += std::to_string(random_.between(1, 9)) + (random_.chance(0.5) ? "e" : "E") +
+                        (random_.chance(0.5) ? "-" : "") + std::to_string(random_.between(1, 12));
+                break;
+            default:
+                out_ += std::to_string(integer);
+                break;
+        }
+    }
+
+    void string() {
+        out_ += '"';
+        const std::size_t count = random_.between(1, 5);
+        for (std::size_t i = 0; i < count; ++i) {
+            out_ += random_.chance(0.25) ? random_.pick(kEscapes) : random_.pick(kWords);
+            if (i + 1 != count) {
+                out_ += ' ';
+            }
+        }
+        out_ += '"';
+    }
+
+    // With at least one '#', the text may hold quotes that do not close it; the delimiters never appear.
+    void raw_string() {
+        const std::size_t hashes = random_.below(3);
+        out_ += 'r';
+        out_.append(hashes, '#');
+        out_ += '"';
+        const std::size_t count = random_.between(1, 5);
+        for (std::size_t i = 0; i < count; ++i) {
+            out_ += random_.pick(kWords);
+            if (i + 1 != count) {
+                out_ += hashes != 0 && random_.chance(0.2) ? "\" " : random_.chance(0.1) ? "\n" : " ";
+            }
+        }
+        out_ += '"';
+        out_.append(hashes, '#');
+    }
+
+    void leaf() {
+        if (random_.chance(options_.string_ratio)) {
+            return string();
+        }
+        if (random_.chance(options_.raw_string_ratio)) {
+            return raw_string();
+        }
+        switch (random_.below(20)) {
+            case 0:
+            case 1:
+                out_ += random_.chance(0.5) ? "true" : "false";
+                break;
+            case 2:
+                out_ += "()";
+                break;
+            default:
+                if (random_.chance(0.5)) {
+                    number();
+                } else {
+                    name();
+                }
+                break;
+        }
+    }
+
+    std::string_view infix_operator() {
+        const OperatorMix& mix = options_.operators;
+        std::size_t roll = random_.below(operator_weight_);
+        if (roll < mix.arithmetic) {
+            return random_.pick(kArithmetic);
+        }
+        roll -= mix.arithmetic;
+        return roll < mix.logical ? random_.pick(kLogical) : random_.pick(kBitwise);
+    }
+
+    // Safe as an operand of any operator, a condition or an iterable: constructs whose last part is an
+    // expression, such as if or assignment, only appear inside parentheses.
+    void operand(std::size_t depth) {
+        if (random_.chance(prefix_chance_)) {
+            out_ += '-';
+        }
+        if (depth == 0 || spent()) {
+            return leaf();
+        }
+        switch (random_.below(8)) {
+            case 0:
+                out_ += '(';
+                expression(depth - 1);
+                out_ += ')';
+                break;
+            case 1:
+                inline_block(depth);
+                break;
+            default:
+                leaf();
+                break;
+        }
+    }
+
+    void chain(std::size_t depth, bool first_is_name) {
+        const std::size_t operands = random_.between(2, std::max<std::size_t>(options_.width, 2));
+        for (std::size_t i = 0; i < operands; ++i) {
+            if (i != 0) {
+                out_ += infix_operator();
+            }
+            if (i == 0 && first_is_name) {
+                name();
+            } else {
+                operand(depth - 1);
+            }
+        }
+    }
+
+    void assignment(std::size_t depth) {
+        name();
+        out_ += " = ";
+        expression(depth - 1);
+    }
+
+    void expression(std::size_t depth) {
+        if (depth == 0 || spent()) {
+            return leaf();
+        }
+        if (random_.chance(assignment_chance_)) {
+            return assignment(depth);
+        }
+        switch (random_.below(10)) {
+            case 0:
+                return if_expression(depth, 0, false);
+            case 1:
+                return random_.chance(0.5) ? while_expression(depth, 0, false) : for_expression(depth, 0, false);
+            case 2:
+                return function(depth, 0, false);
+            case 3:
+            case 4:
+            case 5:
+                if (operator_weight_ != 0) {
+                    return chain(depth, false);
+                }
+                [[fallthrough]];
+            default:
+                return operand(depth);
+        }
+    }
+
+    // An expression that starts a statement or is a block's value. It never starts with '-', which would
+    // continue a fn item's body before it.
+    void statement_expression(std::size_t depth, std::size_t indent, bool multiline) {
+        if (depth == 0 || spent()) {
+            return name();
+        }
+        if (random_.chance(assignment_chance_ * 2)) {
+            return assignment(depth);
+        }
+        switch (random_.below(10)) {
+            case 0:
+            case 1:
+                return if_expression(depth, indent, multiline);
+            case 2:
+                return while_expression(depth, indent, multiline);
+            case 3:
+                return for_expression(depth, indent, multiline);
+            case 4:
+                return function(depth, indent, multiline);
+            case 5:
+                return block(depth, indent, multiline);
+            default:
+                if (operator_weight_ != 0) {
+                    return chain(depth, true);
+                }
+                return name();
+        }
+    }
+
+    void if_expression(std::size_t depth, std::size_t indent, bool multiline) {
+        out_ += "if ";
+        operand(depth - 1);
+        out_ += ' ';
+        block(depth, indent, multiline);
+        if (random_.chance(0.6)) {
+            out_ += " else ";
+            if (depth > 1 && random_.chance(0.3)) {
+                if_expression(depth - 1, indent, multiline);
+            } else {
+                block(depth, indent, multiline);
+            }
+        }
+    }
+
+    void while_expression(std::size_t depth, std::size_t indent, bool multiline) {
+        out_ += "while ";
+        operand(depth - 1);
+        out_ += ' ';
+        block(depth, indent, multiline);
+    }
+
+    void for_expression(std::size_t depth, std::size_t indent, bool multiline) {
+        out_ += "for ";
+        name();
+        out_ += " in ";
+        operand(depth - 1);
+        out_ += ' ';
+        block(depth, indent, multiline);
+    }
+
+    void signature() {
+        out_ += '(';
+        const std::size_t parameters = random_.below(4);
+        for (std::size_t i = 0; i < parameters; ++i) {
+            if (i != 0) {
+                out_ += ", ";
+            }
+            name();
+            out_ += ": ";
+            out_ += random_.pick(kTypes);
+        }
+        out_ += ") -> ";
+        out_ += random_.pick(kTypes);
+        out_ += ' ';
+    }
+
+    // A function literal. Its body, unless a block, runs to the end of the enclosing expression.
+    void function(std::size_t depth, std::size_t indent, bool multiline) {
+        out_ += "fn";
+        signature();
+        if (random_.chance(0.6)) {
+            block(depth, indent, multiline);
+        } else {
+            expression(depth - 1);
+        }
+    }
+
+    void inline_block(std::size_t depth) { block(depth, 0, false); }
+
+    // `{ ... }` holding up to `width` statements and maybe a value, one per line when `multiline`.
+    void block(std::size_t depth, std::size_t indent, bool multiline) {
+        const std::size_t statements = spent() ? 0 : random_.below(options_.width + 1);
+        const bool value = random_.chance(0.5);
+        multiline = multiline && indent < 4 && statements + (value ? 1 : 0) > 1;
+        out_ += '{';
+        for (std::size_t i = 0; i < statements; ++i) {
+            separator(indent + 1, multiline);
+            statement(depth - 1, indent + 1, multiline);
+        }
+        if (value) {
+            separator(indent + 1, multiline);
+            statement_expression(depth - 1, indent + 1, multiline);
+        }
+        if (multiline) {
+            newline(indent);
+        } else if (statements != 0 || value) {
+            out_ += ' ';
+        }
+        out_ += '}';
+    }
+
+    void statement(std::size_t depth, std::size_t indent, bool multiline) {
+        if (random_.chance(options_.comment_ratio)) {
+            comment(indent, multiline);
+        }
+        if (random_.chance(options_.fn_density)) {
+            out_ += "fn ";
+            name();
+            signature();
+            if (depth == 0 || spent()) {
+                leaf();
+            } else {
+                block(depth, indent, multiline);
+            }
+            return;
+        }
+        if (random_.chance(options_.let_density)) {
+            out_ += "let ";
+            name();
+            if (random_.chance(0.3)) {
+                out_ += ": ";
+                out_ += random_.pick(kTypes);
+            }
+            out_ += " = ";
+            expression(depth);
+        } else {
+            statement_expression(depth, indent, multiline);
+        }
+        out_ += ';';
+    }
+
+    const GeneratorOptions& options_;
+    const std::function<void(std::string_view)>& write_;
+    Random random_;
+    std::string out_;
+    std::size_t statement_start_{0};
+    std::size_t statement_budget_{0};
+    std::size_t operator_weight_{0};
+    double prefix_chance_{0.0};
+    double assignment_chance_{0.0};
+};
+
+void check_ratio(double ratio, const char* name) {
+    if (!(ratio >= 0.0 && ratio <= 1.0)) {
+        throw std::invalid_argument(std::string(name) + " must be between 0 and 1");
+    }
+}
+
+}  // namespace
+
+void generate_program(const GeneratorOptions& options, const std::function<void(std::string_view chunk)>& write) {
+    if (options.width == 0) {
+        throw std::invalid_argument("width must be at least 1");
+    }
+    if (3 * (options.depth + 1) >= kMaxNestingDepth) {
+        throw std::invalid_argument("depth " + std::to_string(options.depth) + " could nest beyond the parser's limit");
+    }
+    check_ratio(options.fn_density, "fn_density");
+    check_ratio(options.let_density, "let_density");
+    check_ratio(options.string_ratio, "string_ratio");
+    check_ratio(options.raw_string_ratio, "raw_string_ratio");
+    check_ratio(options.comment_ratio, "comment_ratio");
+
+    Generator(options, write).run();
+}
+
+std::string generate_program(const GeneratorOptions& options) {
+    std::string program;
+    program.reserve(options.target_bytes + kChunkBytes);
+    generate_program(options, [&](std::string_view chunk) { program.append(chunk); });
+    return program;
+}
+
+}  // namespace sonar
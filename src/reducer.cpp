@@ -0,0 +1,233 @@
+#include "sonar/reducer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/visitor.hpp"
+
+namespace sonar {
+
+namespace {
+
+// Edits deleting runs of `count` units, halving the run length from count / 2 down to one. Unit i covers
+// [starts[i], starts[i + 1]).
+void add_runs(const std::vector<std::size_t>& starts, std::vector<TextEdit>& out) {
+    const std::size_t count = starts.size() - 1;
+    for (std::size_t length = std::max<std::size_t>(count / 2, 1);; length /= 2) {
+        for (std::size_t first = 0; first < count; first += length) {
+            const std::size_t last = std::min(first + length, count);
+            out.push_back(TextEdit{SourceSpan{starts[first], starts[last]}, ""});
+        }
+        if (length == 1) {
+            break;
+        }
+    }
+}
+
+class CandidateCollector : public AstWalker<CandidateCollector> {
+   public:
+    CandidateCollector(std::string_view source, const std::vector<Token>& tokens, std::vector<TextEdit>& out)
+        : source_(source), tokens_(tokens), out_(out) {}
+
+    template <typename Node>
+    void enter(const Expression& expression, const Node& node) {
+        const SourceSpan span = expression.span.offset_by(parent_start());
+        if constexpr (std::is_same_v<Node, Expression::Block>) {
+            add_statement_runs(span, node);
+            if (node.value) {
+                out_.push_back(TextEdit{node.value->span.offset_by(span.start), ""});
+            }
+        } else {
+            replace_by_children(span, node);
+        }
+
+        if constexpr (std::is_same_v<Node, Expression::Variable>) {
+            rename(span, "x");
+        } else if constexpr (std::is_same_v<Node, Expression::Number>) {
+            rename(span, "0");
+        } else if constexpr (std::is_same_v<Node, Expression::String>) {
+            rename(span, "\"\"");
+        }
+    }
+
+    template <typename Node>
+    void enter(const Statement& statement, const Node& node) {
+        const SourceSpan span = statement.span.offset_by(parent_start());
+        replace_by_children(span, node);
+        if constexpr (std::is_same_v<Node, Statement::Let>) {
+            rename(node.name_span.offset_by(span.start), "x");
+        }
+    }
+
+   private:
+    // Where the token after `offset` starts, past a ';' ending there, so a deleted statement takes its
+    // separator and the whitespace before the next token with it.
+    std::size_t statement_end(std::size_t offset) const {
+        auto it = std::lower_bound(tokens_.begin(), tokens_.end(), offset,
+                                   [](const Token& token, std::size_t value) { return token.span.start < value; });
+        if (it != tokens_.end() && it->type == TokenType::Semicolon) {
+            ++it;
+        }
+        return it == tokens_.end() ? source_.size() : it->span.start;
+    }
+
+    void add_statement_runs(SourceSpan span, const Expression::Block& block) {
+        if (block.statements.empty()) {
+            return;
+        }
+        std::vector<std::size_t> starts;
+        starts.reserve(block.statements.size() + 1);
+        for (const auto& statement : block.statements) {
+            starts.push_back(span.start + statement->span.start);
+        }
+        starts.push_back(statement_end(span.start + block.statements.back()->span.end));
+        add_runs(starts, out_);
+    }
+
+    // `span` is the node's own, in source offsets.
+    template <typename Node>
+    void replace_by_children(SourceSpan span, const Node& node) {
+        for_each_child(node, [&](const auto& child) {
+            const SourceSpan child_span = child.span.offset_by(span.start);
+            if (child_span != span) {
+                const std::size_t length = child_span.end - child_span.start;
+                out_.push_back(TextEdit{span, std::string(source_.substr(child_span.start, length))});
+            }
+            return true;
+        });
+    }
+
+    void rename(SourceSpan span, std::string_view canonical) {
+        if (source_.substr(span.start, span.end - span.start) != canonical) {
+            out_.push_back(TextEdit{span, std::string(canonical)});
+        }
+    }
+
+    std::string_view source_;
+    const std::vector<Token>& tokens_;
+    std::vector<TextEdit>& out_;
+};
+
+// Edits that only tidy up once the structure is gone: deleting a ';', and deleting the whitespace and
+// comments between two tokens or shrinking them to one space.
+void add_trivia(std::string_view source, const std::vector<Token>& tokens, std::vector<TextEdit>& out) {
+    std::size_t previous_end = 0;
+    for (const Token& token : tokens) {
+        const std::size_t start = token.type == TokenType::End ? source.size() : token.span.start;
+        if (start > previous_end) {
+            out.push_back(TextEdit{SourceSpan{previous_end, start}, ""});
+            if (start - previous_end > 1 && previous_end != 0 && token.type != TokenType::End) {
+                out.push_back(TextEdit{SourceSpan{previous_end, start}, " "});
+            }
+        }
+        if (token.type == TokenType::Semicolon) {
+            out.push_back(TextEdit{token.span, ""});
+        }
+        previous_end = token.span.end;
+    }
+}
+
+// Input that does not lex is cut by lines, then by bytes.
+std::vector<TextEdit> text_runs(std::string_view source) {
+    std::vector<std::size_t> starts{0};
+    for (std::size_t index = 0; index < source.size(); ++index) {
+        if (source[index] == '\n' && index + 1 < source.size()) {
+            starts.push_back(index + 1);
+        }
+    }
+    starts.push_back(source.size());
+    std::vector<TextEdit> out;
+    add_runs(starts, out);
+
+    starts.resize(source.size() + 1);
+    for (std::size_t index = 0; index <= source.size(); ++index) {
+        starts[index] = index;
+    }
+    add_runs(starts, out);
+    return out;
+}
+
+std::string apply_edit(std::string_view source, const TextEdit& edit) {
+    std::string result;
+    result.reserve(source.size() - (edit.range.end - edit.range.start) + edit.replacement.size());
+    result.append(source.substr(0, edit.range.start));
+    result.append(edit.replacement);
+    result.append(source.substr(edit.range.end));
+    return result;
+}
+
+}  // namespace
+
+std::vector<TextEdit> reduction_candidates(std::string_view source) {
+    if (source.empty()) {
+        return {};
+    }
+
+    LexResult lexed;
+    try {
+        lexed = Lexer{}.tokenize(source);
+    } catch (const std::runtime_error&) {
+        return text_runs(source);
+    }
+
+    std::vector<TextEdit> out;
+    try {
+        auto ast = Parser(lexed.tokens, lexed.line_offsets, "<reduce>").parse();
+        CandidateCollector(source, lexed.tokens, out).walk(*ast);
+        add_trivia(source, lexed.tokens, out);
+    } catch (const std::runtime_error&) {
+        // The last token is End; each token runs up to the start of the next.
+        std::vector<std::size_t> starts;
+        starts.reserve(lexed.tokens.size());
+        for (const Token& token : lexed.tokens) {
+            starts.push_back(starts.empty() ? 0 : token.span.start);
+        }
+        starts.back() = source.size();
+        if (starts.size() > 1) {
+            add_runs(starts, out);
+        }
+    }
+
+    std::stable_sort(out.begin(), out.end(), [](const TextEdit& a, const TextEdit& b) {
+        return a.range.end - a.range.start - a.replacement.size() > b.range.end - b.range.start - b.replacement.size();
+    });
+    return out;
+}
+
+std::string reduce(std::string source, const ReducePredicate& interesting, ReduceStats* stats) {
+    ReduceStats local;
+    ReduceStats& counts = stats ? *stats : local;
+    ++counts.attempts;
+    if (!interesting(source)) {
+        throw std::invalid_argument("The input to reduce does not satisfy the predicate");
+    }
+
+    bool reduced = true;
+    while (reduced) {
+        reduced = false;
+        auto candidates = reduction_candidates(source);
+        for (std::size_t index = 0; index < candidates.size(); ++index) {
+            std::string candidate = apply_edit(source, candidates[index]);
+            ++counts.attempts;
+            if (!interesting(candidate)) {
+                continue;
+            }
+            ++counts.reductions;
+            reduced = true;
+            source = std::move(candidate);
+            // The edits before `index` were just rejected on a larger input; resume after them.
+            candidates = reduction_candidates(source);
+            --index;
+        }
+    }
+    return source;
+}
+
+}  // namespace sonar
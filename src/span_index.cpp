@@ -0,0 +1,116 @@
+#include "sonar/span_index.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+#include "sonar/visitor.hpp"
+
+namespace sonar {
+
+// Walks the tree once, appending entries in preorder and cutting the offsets into segments: the offsets a
+// node covers that none of its children cover form its segments.
+class SpanIndex::Builder : public AstWalker<Builder> {
+   public:
+    Builder(std::vector<Entry>& entries, std::vector<Segment>& segments) : entries_(entries), segments_(segments) {}
+
+    template <typename Node>
+    void enter(const Expression& expression, const Node&) {
+        push(Entry{expression.span.offset_by(parent_start()), &expression, nullptr, kNoParent});
+    }
+
+    template <typename Node>
+    void enter(const Statement& statement, const Node&) {
+        push(Entry{statement.span.offset_by(parent_start()), nullptr, &statement, kNoParent});
+    }
+
+    template <typename Wrapper, typename Node>
+    void leave(const Wrapper&, const Node&) {
+        const std::uint32_t index = open_.back();
+        open_.pop_back();
+        const std::uint32_t end = entries_[index].span.end;
+        if (end > cursor_) {
+            cut(index);
+            cursor_ = end;
+        }
+    }
+
+    void finish() { cut(kNoParent); }
+
+   private:
+    void push(Entry entry) {
+        const std::uint32_t enclosing = open_.empty() ? kNoParent : open_.back();
+        if (entry.span.start > cursor_) {
+            cut(enclosing);
+            cursor_ = entry.span.start;
+        }
+        entry.parent = enclosing;
+        open_.push_back(static_cast<std::uint32_t>(entries_.size()));
+        entries_.push_back(entry);
+    }
+
+    // Assigns the offsets from the cursor onward to `entry`, until the next cut.
+    void cut(std::uint32_t entry) {
+        // A segment that would end where it starts is replaced, and neighbours with one entry are merged.
+        if (!segments_.empty() && segments_.back().start == cursor_) {
+            segments_.pop_back();
+        }
+        if (segments_.empty() || segments_.back().entry != entry) {
+            segments_.push_back(Segment{cursor_, entry});
+        }
+    }
+
+    std::vector<Entry>& entries_;
+    std::vector<Segment>& segments_;
+    std::vector<std::uint32_t> open_;
+    std::uint32_t cursor_{0};
+};
+
+void SpanIndex::build() const {
+    std::call_once(built_, [this]() {
+        Builder builder(entries_, segments_);
+        builder.walk(*root_);
+        builder.finish();
+    });
+}
+
+std::size_t SpanIndex::size() const {
+    build();
+    return entries_.size();
+}
+
+const SpanIndex::Entry* SpanIndex::innermost_at(std::size_t offset) const {
+    build();
+    auto it = std::upper_bound(segments_.begin(), segments_.end(), offset,
+                               [](std::size_t value, const Segment& segment) { return value < segment.start; });
+    if (it == segments_.begin() || std::prev(it)->entry == kNoParent) {
+        return nullptr;
+    }
+    return &entries_[std::prev(it)->entry];
+}
+
+const SpanIndex::Entry* SpanIndex::parent(const Entry& entry) const {
+    return entry.parent == kNoParent ? nullptr : &entries_[entry.parent];
+}
+
+std::vector<const SpanIndex::Entry*> SpanIndex::overlapping(SourceSpan range) const {
+    build();
+    // The nodes containing range.start form a chain up from the innermost one; every other overlapping node
+    // starts inside the range and follows them in preorder.
+    std::vector<const Entry*> result;
+    for (const Entry* entry = innermost_at(range.start); entry != nullptr; entry = parent(*entry)) {
+        result.push_back(entry);
+    }
+    std::reverse(result.begin(), result.end());
+
+    auto by_start = [](const Entry& entry, std::uint32_t offset) { return entry.span.start < offset; };
+    auto first = std::lower_bound(entries_.begin(), entries_.end(), range.start + 1, by_start);
+    auto last = std::lower_bound(first, entries_.end(), range.end, by_start);
+    for (auto it = first; it != last; ++it) {
+        if (it->span.end > it->span.start) {
+            result.push_back(&*it);
+        }
+    }
+    return result;
+}
+
+}  // namespace sonar
@@ -0,0 +1,94 @@
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+
+namespace sonar {
+
+ExpressionPtr Parser::parse_streaming(std::istream& input, std::string source_name,
+                                      const StatementCallback& on_statement, ParserOptions options) {
+    return measured([&]() -> ExpressionPtr {
+        TokenReader reader(input);
+        TopLevelScan scan;
+        const auto ids = std::make_shared<IdSource>();
+        // Tokens read but not parsed yet, which always end where the scan ended an item, and the token after them.
+        std::vector<Token> pending;
+        Token lookahead = reader.next();
+
+        const auto read_item = [&] {
+            while (lookahead.type != TokenType::End) {
+                Token next = reader.next();
+                const bool ends = scan.ends_item(lookahead.type, next.type);
+                pending.push_back(std::exchange(lookahead, std::move(next)));
+                if (ends) {
+                    return;
+                }
+            }
+        };
+
+        while (true) {
+            if (pending.empty()) {
+                if (lookahead.type == TokenType::End) {
+                    return nullptr;
+                }
+                read_item();
+            }
+            while (!pending.empty() && pending.front().type == TokenType::Semicolon) {
+                pending.erase(pending.begin());
+            }
+            if (pending.empty()) {
+                continue;
+            }
+
+            // The item is parsed from its tokens, the real token after them and, unless that ends the input, an
+            // End standing in for the rest. What the parser decides while looking no further than the real token
+            // is what a parse of the whole input decides; if it went further, the scan misjudged the item's end
+            // and the next item is read and parsed along with it.
+            const bool last = lookahead.type == TokenType::End;
+            const std::size_t count = pending.size();
+            auto tokens = std::make_shared<std::vector<Token>>(std::move(pending));
+            tokens->push_back(lookahead);
+            if (!last) {
+                tokens->push_back(Token{TokenType::End, "", SourceSpan{lookahead.span.end, lookahead.span.end}});
+            }
+            Parser parser(SharedTokens(tokens), std::make_shared<const std::vector<std::size_t>>(reader.line_offsets()),
+                          source_name, options, 0);
+            parser.line_base_ = reader.lines_before();
+            parser.id_source_ = ids;
+            parser.record_ids_ = true;
+
+            SequenceItem item;
+            bool trusted = true;
+            try {
+                item = parser.parse_sequence_item();
+            } catch (const ParseError&) {
+                if (last || (parser.current_ <= count && !parser.scanned_to_end_)) {
+                    throw;
+                }
+                trusted = false;
+            }
+            if (!trusted || (!last && (parser.current_ > count || parser.scanned_to_end_))) {
+                pending.assign(tokens->begin(), tokens->begin() + static_cast<std::ptrdiff_t>(count));
+                read_item();
+                continue;
+            }
+
+            parser.assign_ids();
+            if (!item.statement) {
+                parser.consume(TokenType::End, "Expected end of input");
+                return std::move(item.value);
+            }
+            // Deferred bodies of the statement may still read the tokens after it, so the rest is copied.
+            pending.assign(tokens->begin() + static_cast<std::ptrdiff_t>(parser.current_),
+                           tokens->begin() + static_cast<std::ptrdiff_t>(count));
+            on_statement(std::move(item.statement));
+            reader.release(pending.empty() ? lookahead.span.start : pending.front().span.start);
+        }
+    });
+}
+
+}  // namespace sonar
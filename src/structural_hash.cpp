@@ -0,0 +1,149 @@
+#include "sonar/structural_hash.hpp"
+
+#include <bit>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "sonar/hash.hpp"
+#include "sonar/node_map.hpp"
+#include "sonar/visitor.hpp"
+
+namespace sonar {
+
+namespace {
+
+// Distinguish an Expression alternative from the Statement alternative with the same index.
+constexpr std::uint64_t kExpressionSeed = 0x45787072;
+constexpr std::uint64_t kStatementSeed = 0x53746d74;
+
+// Zero marks a hash that has not been computed.
+constexpr std::uint64_t kNotComputed = 0;
+
+// The cached hash of a node, or null when there is no cache or the node has no id.
+template <typename Wrapper>
+std::uint64_t* cached_hash(NodeMap<std::uint64_t>* hashes, const Wrapper& wrapper) {
+    if (hashes == nullptr) {
+        return nullptr;
+    }
+    const NodeId id = node_id(wrapper);
+    return id != kNoNodeId ? &hashes->at_id(id) : nullptr;
+}
+
+std::uint64_t hash_type(std::uint64_t hash, const TypeAnnotation& type) {
+    return hash_bytes(type.name, hash);
+}
+
+template <typename Node>
+std::uint64_t hash_payload(std::uint64_t hash, const Node& node) {
+    if constexpr (std::is_same_v<Node, Expression::Number>) {
+        return hash_combine(hash, std::bit_cast<std::uint64_t>(node.value));
+    } else if constexpr (std::is_same_v<Node, Expression::Boolean>) {
+        return hash_combine(hash, node.value ? 1u : 0u);
+    } else if constexpr (std::is_same_v<Node, Expression::String>) {
+        return hash_bytes(node.value, hash);
+    } else if constexpr (std::is_same_v<Node, Expression::Variable>) {
+        return hash_bytes(node.name, hash);
+    } else if constexpr (std::is_same_v<Node, Expression::Prefix> || std::is_same_v<Node, Expression::Infix>) {
+        return hash_combine(hash, static_cast<std::uint64_t>(node.op));
+    } else if constexpr (std::is_same_v<Node, Expression::Function>) {
+        const auto& signature = *node.signature;
+        hash = hash_combine(hash, signature.parameters.size());
+        for (const auto& parameter : signature.parameters) {
+            hash = hash_type(hash_bytes(parameter.name, hash), parameter.type);
+        }
+        return hash_type(hash, signature.return_type);
+    } else if constexpr (std::is_same_v<Node, Statement::Let>) {
+        hash = hash_bytes(node.name, hash);
+        return node.annotation ? hash_type(hash_combine(hash, 1), *node.annotation) : hash_combine(hash, 0);
+    } else {
+        return hash;
+    }
+}
+
+std::uint64_t hash_expression(const Expression& expression, NodeMap<std::uint64_t>* hashes);
+
+// `known` is a child whose hash the caller already has, as `known_hash`.
+template <typename Wrapper>
+std::uint64_t hash_node(const Wrapper& wrapper, std::uint64_t seed, NodeMap<std::uint64_t>* hashes,
+                        const Expression* known = nullptr, std::uint64_t known_hash = 0) {
+    std::uint64_t* cached = cached_hash(hashes, wrapper);
+    if (cached != nullptr && *cached != kNotComputed) {
+        return *cached;
+    }
+
+    std::uint64_t hash = hash_combine(seed, wrapper.node.index());
+    std::visit(
+        [&](const auto& node) {
+            hash = hash_payload(hash, node);
+            // for_each_child skips absent children; the count keeps shapes with and without them apart.
+            std::uint64_t children = 0;
+            for_each_child(node, [&]<typename Child>(const Child& child) {
+                if constexpr (std::is_same_v<Child, Expression>) {
+                    hash = hash_combine(hash, &child == known ? known_hash : hash_expression(child, hashes));
+                } else {
+                    hash = hash_combine(hash, hash_node(child, kStatementSeed, hashes));
+                }
+                ++children;
+                return true;
+            });
+            hash = hash_combine(hash, children);
+        },
+        wrapper.node);
+
+    if (hash == kNotComputed) {
+        hash = 1;
+    }
+    // Hashing the children may have grown the map, so the slot is looked up again.
+    if (cached != nullptr) {
+        *cached_hash(hashes, wrapper) = hash;
+    }
+    return hash;
+}
+
+std::uint64_t hash_expression(const Expression& expression, NodeMap<std::uint64_t>* hashes) {
+    // An operator chain nests its left operands as deeply as it is long, so the operators down its left
+    // spine whose hashes are not cached are hashed bottom-up in a loop.
+    std::vector<const Expression*> chain;
+    const Expression* operand = &expression;
+    while (const auto* infix = std::get_if<Expression::Infix>(&operand->node)) {
+        const std::uint64_t* cached = cached_hash(hashes, *operand);
+        if (!infix->left || (cached != nullptr && *cached != kNotComputed)) {
+            break;
+        }
+        chain.push_back(operand);
+        operand = infix->left.get();
+    }
+    std::uint64_t hash = hash_node(*operand, kExpressionSeed, hashes);
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        hash = hash_node(**it, kExpressionSeed, hashes, operand, hash);
+        operand = *it;
+    }
+    return hash;
+}
+
+}  // namespace
+
+std::uint64_t structural_hash(const Expression& expression) {
+    return hash_expression(expression, nullptr);
+}
+
+std::uint64_t structural_hash(const Statement& statement) {
+    return hash_node(statement, kStatementSeed, nullptr);
+}
+
+std::uint64_t StructuralHashCache::hash(const Expression& expression) {
+    return hash_expression(expression, &hashes_);
+}
+
+std::uint64_t StructuralHashCache::hash(const Statement& statement) {
+    return hash_node(statement, kStatementSeed, &hashes_);
+}
+
+void StructuralHashCache::invalidate_id(NodeId id) noexcept {
+    if (id < hashes_.size()) {
+        hashes_.at_id(id) = kNotComputed;
+    }
+}
+
+}  // namespace sonar
@@ -0,0 +1,401 @@
+#include "sonar/syntax_interner.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "sonar/hash.hpp"
+
+namespace sonar {
+
+namespace {
+
+constexpr std::size_t kInitialTableSize = 1024;
+
+std::uint64_t number_bits(double value) {
+    return std::bit_cast<std::uint64_t>(value);
+}
+
+}  // namespace
+
+SyntaxInterner::SyntaxInterner() : table_(kInitialTableSize, kNoSyntax) {}
+
+InternedTree SyntaxInterner::intern(const Expression& expression) {
+    InternedTree tree;
+    tree.root = intern(expression, tree.spans);
+    return tree;
+}
+
+SyntaxId SyntaxInterner::intern(const Expression& expression, std::vector<SourceSpan>& spans) {
+    if (std::holds_alternative<Expression::Infix>(expression.node)) {
+        return intern_chain(expression, spans);
+    }
+    const std::size_t first_span = spans.size();
+    const std::size_t base = scratch_.size();
+    spans.push_back(expression.span);
+
+    auto child = [&](const ExpressionPtr& node) { scratch_.push_back(node ? intern(*node, spans) : kNoSyntax); };
+
+    SyntaxKind kind{};
+    TokenType op = TokenType::End;
+    double number = 0.0;
+    std::visit(
+        [&](const auto& node) {
+            using Node = std::decay_t<decltype(node)>;
+            if constexpr (std::is_same_v<Node, Expression::Number>) {
+                kind = SyntaxKind::Number;
+                number = node.value;
+            } else if constexpr (std::is_same_v<Node, Expression::Boolean>) {
+                kind = SyntaxKind::Boolean;
+                number = node.value ? 1.0 : 0.0;
+            } else if constexpr (std::is_same_v<Node, Expression::String>) {
+                kind = SyntaxKind::String;
+                scratch_.push_back(intern_symbol(node.value));
+            } else if constexpr (std::is_same_v<Node, Expression::Variable>) {
+                kind = SyntaxKind::Variable;
+                scratch_.push_back(intern_symbol(node.name));
+            } else if constexpr (std::is_same_v<Node, Expression::Prefix>) {
+                kind = SyntaxKind::Prefix;
+                op = node.op;
+                spans.push_back(node.op_span);
+                child(node.right);
+            } else if constexpr (std::is_same_v<Node, Expression::Grouping>) {
+                kind = SyntaxKind::Grouping;
+                child(node.expression);
+            } else if constexpr (std::is_same_v<Node, Expression::Unit>) {
+                kind = SyntaxKind::Unit;
+            } else if constexpr (std::is_same_v<Node, Expression::Assign>) {
+                kind = SyntaxKind::Assign;
+                child(node.target);
+                child(node.value);
+            } else if constexpr (std::is_same_v<Node, Expression::Block>) {
+                kind = SyntaxKind::Block;
+                for (const auto& statement : node.statements) {
+                    scratch_.push_back(intern(*statement, spans));
+                }
+                child(node.value);
+            } else if constexpr (std::is_same_v<Node, Expression::If>) {
+                kind = SyntaxKind::If;
+                child(node.condition);
+                child(node.then);
+                child(node.else_branch);
+            } else if constexpr (std::is_same_v<Node, Expression::While>) {
+                kind = SyntaxKind::While;
+                child(node.condition);
+                child(node.body);
+            } else if constexpr (std::is_same_v<Node, Expression::For>) {
+                kind = SyntaxKind::For;
+                child(node.pattern);
+                child(node.iterable);
+                child(node.body);
+            } else if constexpr (std::is_same_v<Node, Expression::Function>) {
+                kind = SyntaxKind::Function;
+                const auto& signature = *node.signature;
+                scratch_.push_back(intern_symbol(signature.return_type.name));
+                for (const auto& parameter : signature.parameters) {
+                    spans.push_back(parameter.name_span);
+                    spans.push_back(parameter.type.span);
+                    scratch_.push_back(intern_symbol(parameter.name));
+                    scratch_.push_back(intern_symbol(parameter.type.name));
+                }
+                spans.push_back(signature.return_type.span);
+                scratch_.push_back(intern(node.body_expression(), spans));
+            }
+        },
+        expression.node);
+
+    return finish(kind, op, number, base, spans.size() - first_span);
+}
+
+SyntaxId SyntaxInterner::intern(const Statement& statement, std::vector<SourceSpan>& spans) {
+    const std::size_t first_span = spans.size();
+    const std::size_t base = scratch_.size();
+    spans.push_back(statement.span);
+
+    if (const auto* let = std::get_if<Statement::Let>(&statement.node)) {
+        spans.push_back(let->name_span);
+        scratch_.push_back(intern_symbol(let->name));
+        if (let->annotation) {
+            spans.push_back(let->annotation->span);
+            scratch_.push_back(intern_symbol(let->annotation->name));
+        } else {
+            scratch_.push_back(kNoSyntax);
+        }
+        scratch_.push_back(intern(*let->initializer, spans));
+        return finish(SyntaxKind::Let, TokenType::End, 0.0, base, spans.size() - first_span);
+    }
+
+    scratch_.push_back(intern(*std::get<Statement::Expression>(statement.node).expression, spans));
+    return finish(SyntaxKind::ExpressionStatement, TokenType::End, 0.0, base, spans.size() - first_span);
+}
+
+// Positions are in preorder, so a chain's operators add theirs down its left spine, followed by the operand at
+// the bottom and each right operand from the bottom up. The chain nests its left operands as deeply as it is
+// long, so it is interned in loops rather than by recursion.
+SyntaxId SyntaxInterner::intern_chain(const Expression& top, std::vector<SourceSpan>& spans) {
+    // Each operator with the index of its first position.
+    std::vector<std::pair<const Expression::Infix*, std::size_t>> chain;
+    const Expression* operand = &top;
+    while (operand && std::holds_alternative<Expression::Infix>(operand->node)) {
+        const auto& infix = std::get<Expression::Infix>(operand->node);
+        chain.emplace_back(&infix, spans.size());
+        spans.push_back(operand->span);
+        spans.push_back(infix.op_span);
+        operand = infix.left.get();
+    }
+    SyntaxId left = operand ? intern(*operand, spans) : kNoSyntax;
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        const auto& [infix, first_span] = *it;
+        const std::size_t base = scratch_.size();
+        scratch_.push_back(left);
+        scratch_.push_back(infix->right ? intern(*infix->right, spans) : kNoSyntax);
+        left = finish(SyntaxKind::Infix, infix->op, 0.0, base, spans.size() - first_span);
+    }
+    return left;
+}
+
+SyntaxId SyntaxInterner::intern_block(std::span<const SyntaxId> statements, SyntaxId value) {
+    const std::size_t base = scratch_.size();
+    std::size_t span_total = 1;
+    for (SyntaxId statement : statements) {
+        scratch_.push_back(statement);
+        span_total += span_count(statement);
+    }
+    scratch_.push_back(value);
+    if (value != kNoSyntax) {
+        span_total += span_count(value);
+    }
+    return finish(SyntaxKind::Block, TokenType::End, 0.0, base, span_total);
+}
+
+std::span<const std::uint32_t> SyntaxInterner::operands(SyntaxId id) const {
+    const Node& node = nodes_[id];
+    return {operands_.data() + node.first_operand, node.operand_count};
+}
+
+std::size_t SyntaxInterner::memory_bytes() const noexcept {
+    std::size_t bytes = nodes_.capacity() * sizeof(Node) + operands_.capacity() * sizeof(std::uint32_t) +
+                        table_.capacity() * sizeof(SyntaxId) + symbol_views_.capacity() * sizeof(std::string_view);
+    for (const auto& text : symbol_storage_) {
+        bytes += sizeof(text) + text.capacity();
+    }
+    // Rough cost of a node-based hash map: one allocation per entry plus the bucket array.
+    bytes += symbols_.size() * (sizeof(std::pair<const std::string_view, std::uint32_t>) + 2 * sizeof(void*));
+    bytes += symbols_.bucket_count() * sizeof(void*);
+    return bytes;
+}
+
+std::uint32_t SyntaxInterner::intern_symbol(std::string_view text) {
+    if (auto it = symbols_.find(text); it != symbols_.end()) {
+        return it->second;
+    }
+    if (symbol_views_.size() >= kNoSyntax) {
+        throw std::length_error("Too many distinct symbols to intern");
+    }
+    const auto id = static_cast<std::uint32_t>(symbol_views_.size());
+    std::string_view stored = symbol_storage_.emplace_back(text);
+    symbol_views_.push_back(stored);
+    symbols_.emplace(stored, id);
+    return id;
+}
+
+SyntaxId SyntaxInterner::finish(SyntaxKind kind, TokenType op, double number, std::size_t operand_base,
+                                std::size_t span_count) {
+    const std::span<const std::uint32_t> node_operands{scratch_.data() + operand_base, scratch_.size() - operand_base};
+
+    std::uint64_t hash = hash_combine(static_cast<std::uint64_t>(kind), static_cast<std::uint64_t>(op));
+    hash = hash_combine(hash, number_bits(number));
+    for (std::uint32_t operand : node_operands) {
+        hash = hash_combine(hash, operand);
+    }
+
+    const std::size_t mask = table_.size() - 1;
+    std::size_t slot = static_cast<std::size_t>(hash) & mask;
+    for (; table_[slot] != kNoSyntax; slot = (slot + 1) & mask) {
+        const Node& candidate = nodes_[table_[slot]];
+        if (candidate.hash == hash && same_node(candidate, kind, op, number, node_operands)) {
+            scratch_.resize(operand_base);
+            return table_[slot];
+        }
+    }
+
+    if (nodes_.size() >= kNoSyntax) {
+        throw std::length_error("Too many distinct syntax nodes to intern");
+    }
+    const auto id = static_cast<SyntaxId>(nodes_.size());
+    nodes_.push_back(Node{kind, op, static_cast<std::uint32_t>(operands_.size()),
+                          static_cast<std::uint32_t>(node_operands.size()), static_cast<std::uint32_t>(span_count),
+                          number, hash});
+    operands_.insert(operands_.end(), node_operands.begin(), node_operands.end());
+    scratch_.resize(operand_base);
+
+    table_[slot] = id;
+    if (nodes_.size() * 2 > table_.size()) {
+        grow_table();
+    }
+    return id;
+}
+
+bool SyntaxInterner::same_node(const Node& node, SyntaxKind kind, TokenType op, double number,
+                               std::span<const std::uint32_t> node_operands) const {
+    if (node.kind != kind || node.op != op || number_bits(node.number) != number_bits(number) ||
+        node.operand_count != node_operands.size()) {
+        return false;
+    }
+    const std::uint32_t* stored = operands_.data() + node.first_operand;
+    return std::equal(node_operands.begin(), node_operands.end(), stored);
+}
+
+void SyntaxInterner::grow_table() {
+    std::vector<SyntaxId> table(table_.size() * 2, kNoSyntax);
+    const std::size_t mask = table.size() - 1;
+    for (SyntaxId id = 0; id < nodes_.size(); ++id) {
+        std::size_t slot = static_cast<std::size_t>(nodes_[id].hash) & mask;
+        while (table[slot] != kNoSyntax) {
+            slot = (slot + 1) & mask;
+        }
+        table[slot] = id;
+    }
+    table_ = std::move(table);
+}
+
+namespace {
+
+class Rebuilder {
+   public:
+    Rebuilder(const SyntaxInterner& interner, const std::vector<SourceSpan>& spans) : interner_(interner), spans_(spans) {}
+
+    ExpressionPtr expression(SyntaxId id) {
+        const SourceSpan span = take();
+        const auto operands = interner_.operands(id);
+        switch (interner_.kind(id)) {
+            case SyntaxKind::Number:
+                return make(Expression::Number{interner_.number(id)}, span);
+            case SyntaxKind::Boolean:
+                return make(Expression::Boolean{interner_.number(id) != 0.0}, span);
+            case SyntaxKind::String:
+                return make(Expression::String{std::string(interner_.symbol(operands[0]))}, span);
+            case SyntaxKind::Variable:
+                return make(Expression::Variable{std::string(interner_.symbol(operands[0]))}, span);
+            case SyntaxKind::Prefix: {
+                const SourceSpan op_span = take();
+                return make(Expression::Prefix{interner_.op(id), op_span, child(operands[0])}, span);
+            }
+            case SyntaxKind::Infix:
+                return chain(id, span);
+            case SyntaxKind::Grouping:
+                return make(Expression::Grouping{child(operands[0])}, span);
+            case SyntaxKind::Unit:
+                return make(Expression::Unit{}, span);
+            case SyntaxKind::Assign: {
+                auto target = child(operands[0]);
+                return make(Expression::Assign{std::move(target), child(operands[1])}, span);
+            }
+            case SyntaxKind::Block: {
+                Expression::Block block;
+                for (std::size_t i = 0; i + 1 < operands.size(); ++i) {
+                    block.statements.push_back(statement(operands[i]));
+                }
+                block.value = child(operands.back());
+                return make(std::move(block), span);
+            }
+            case SyntaxKind::If: {
+                auto condition = child(operands[0]);
+                auto then = child(operands[1]);
+                return make(Expression::If{std::move(condition), std::move(then), child(operands[2])}, span);
+            }
+            case SyntaxKind::While: {
+                auto condition = child(operands[0]);
+                return make(Expression::While{std::move(condition), child(operands[1])}, span);
+            }
+            case SyntaxKind::For: {
+                auto pattern = child(operands[0]);
+                auto iterable = child(operands[1]);
+                return make(Expression::For{std::move(pattern), std::move(iterable), child(operands[2])}, span);
+            }
+            case SyntaxKind::Function: {
+                auto signature = std::make_unique<Expression::Function::Signature>();
+                for (std::size_t i = 1; i + 2 < operands.size(); i += 2) {
+                    const SourceSpan name_span = take();
+                    const SourceSpan type_span = take();
+                    signature->parameters.push_back(Expression::Function::Parameter{
+                        std::string(interner_.symbol(operands[i])), name_span,
+                        TypeAnnotation{std::string(interner_.symbol(operands[i + 1])), type_span}});
+                }
+                const SourceSpan return_span = take();
+                signature->return_type = TypeAnnotation{std::string(interner_.symbol(operands[0])), return_span};
+                return make(Expression::Function{std::move(signature), child(operands.back()), nullptr}, span);
+            }
+            case SyntaxKind::Let:
+            case SyntaxKind::ExpressionStatement:
+                break;
+        }
+        throw std::invalid_argument("Interned statement used as an expression");
+    }
+
+    StatementPtr statement(SyntaxId id) {
+        const SourceSpan span = take();
+        const auto operands = interner_.operands(id);
+        if (interner_.kind(id) == SyntaxKind::Let) {
+            const SourceSpan name_span = take();
+            std::unique_ptr<TypeAnnotation> annotation;
+            if (operands[1] != kNoSyntax) {
+                annotation = std::make_unique<TypeAnnotation>(TypeAnnotation{std::string(interner_.symbol(operands[1])), take()});
+            }
+            Statement::Let let{std::string(interner_.symbol(operands[0])), name_span, std::move(annotation),
+                               expression(operands[2])};
+            return std::make_unique<Statement>(std::move(let), span);
+        }
+        return std::make_unique<Statement>(Statement::Expression{expression(operands[0])}, span);
+    }
+
+   private:
+    template <typename Node>
+    static ExpressionPtr make(Node node, SourceSpan span) {
+        return std::make_unique<Expression>(std::move(node), span);
+    }
+
+    ExpressionPtr child(SyntaxId id) { return id == kNoSyntax ? nullptr : expression(id); }
+
+    // Rebuilds a chain from the bottom of its left spine up, in a loop for the reason intern_chain uses one.
+    ExpressionPtr chain(SyntaxId top, SourceSpan top_span) {
+        struct Link {
+            SyntaxId id;
+            SourceSpan span;
+            SourceSpan op_span;
+        };
+        std::vector<Link> links{Link{top, top_span, take()}};
+        SyntaxId operand = interner_.operands(top)[0];
+        while (operand != kNoSyntax && interner_.kind(operand) == SyntaxKind::Infix) {
+            const SourceSpan span = take();
+            links.push_back(Link{operand, span, take()});
+            operand = interner_.operands(operand)[0];
+        }
+        auto left = child(operand);
+        for (auto it = links.rbegin(); it != links.rend(); ++it) {
+            auto right = child(interner_.operands(it->id)[1]);
+            left = make(Expression::Infix{interner_.op(it->id), it->op_span, std::move(left), std::move(right)}, it->span);
+        }
+        return left;
+    }
+
+    SourceSpan take() { return spans_[next_++]; }
+
+    const SyntaxInterner& interner_;
+    const std::vector<SourceSpan>& spans_;
+    std::size_t next_{0};
+};
+
+}  // namespace
+
+ExpressionPtr SyntaxInterner::rebuild(const InternedTree& tree) const {
+    if (tree.root >= nodes_.size() || tree.spans.size() != span_count(tree.root)) {
+        throw std::invalid_argument("Interned tree does not match its positions");
+    }
+    return Rebuilder(*this, tree.spans).expression(tree.root);
+}
+
+}  // namespace sonar
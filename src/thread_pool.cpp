@@ -0,0 +1,85 @@
+#include "sonar/thread_pool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace sonar {
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    const std::size_t workers = std::max<std::size_t>(threads, 1) - 1;
+    workers_.reserve(workers);
+    for (std::size_t i = 0; i < workers; ++i) {
+        workers_.emplace_back([this]() { worker_loop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    work_ready_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallel_for(std::size_t count, const std::function<void(std::size_t)>& task) {
+    std::lock_guard run_lock(run_mutex_);
+    {
+        std::lock_guard lock(mutex_);
+        task_ = &task;
+        count_ = count;
+        next_.store(0, std::memory_order_relaxed);
+        busy_workers_ = workers_.size();
+        error_ = nullptr;
+        ++generation_;
+    }
+    work_ready_.notify_all();
+
+    run_tasks();
+
+    std::unique_lock lock(mutex_);
+    work_done_.wait(lock, [this]() { return busy_workers_ == 0; });
+    task_ = nullptr;
+    if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+void ThreadPool::run_tasks() {
+    for (std::size_t index = next_.fetch_add(1, std::memory_order_relaxed); index < count_;
+         index = next_.fetch_add(1, std::memory_order_relaxed)) {
+        try {
+            (*task_)(index);
+        } catch (...) {
+            std::lock_guard lock(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+        }
+    }
+}
+
+void ThreadPool::worker_loop() {
+    std::uint64_t seen_generation = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            work_ready_.wait(lock, [&]() { return stopping_ || generation_ != seen_generation; });
+            if (stopping_) {
+                return;
+            }
+            seen_generation = generation_;
+        }
+
+        run_tasks();
+
+        std::lock_guard lock(mutex_);
+        if (--busy_workers_ == 0) {
+            work_done_.notify_one();
+        }
+    }
+}
+
+}  // namespace sonar
@@ -0,0 +1,182 @@
+#include "sonar/trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdio>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+namespace sonar {
+
+struct TraceRecorder::ThreadBuffer {
+    std::thread::id owner;
+    std::uint32_t index{0};
+    // Grows with the spans recorded until it holds `capacity_`, then wraps.
+    std::vector<TraceEvent> ring;
+    // Spans written so far; the newest is at (written - 1) & (capacity_ - 1).
+    std::size_t written{0};
+};
+
+namespace {
+
+// Recorders are told apart by id rather than address, so a thread's cached buffer is never mistaken for one
+// of a new recorder that reuses a destroyed one's address.
+std::atomic<std::uint64_t> next_recorder_id{1};
+
+struct ThreadCache {
+    std::uint64_t recorder{0};
+    void* buffer{nullptr};
+};
+
+thread_local ThreadCache thread_cache;
+
+// A thread's ring starts this large and doubles up to the recorder's capacity.
+constexpr std::size_t kFirstRingEvents = 64;
+
+void write_json_string(std::ostream& out, std::string_view text) {
+    out << '"';
+    for (const char c : text) {
+        switch (c) {
+            case '"':
+                out << "\\\"";
+                break;
+            case '\\':
+                out << "\\\\";
+                break;
+            case '\n':
+                out << "\\n";
+                break;
+            case '\t':
+                out << "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                    out << escaped;
+                } else {
+                    out << c;
+                }
+        }
+    }
+    out << '"';
+}
+
+// Trace-event timestamps are microseconds; nanosecond precision is kept as decimals.
+void write_microseconds(std::ostream& out, std::int64_t nanoseconds) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%lld.%03lld", static_cast<long long>(nanoseconds / 1000),
+                  static_cast<long long>(nanoseconds % 1000));
+    out << text;
+}
+
+}  // namespace
+
+TraceRecorder::TraceRecorder(std::size_t events_per_thread)
+    : id_(next_recorder_id.fetch_add(1, std::memory_order_relaxed)),
+      capacity_(std::bit_ceil(std::max<std::size_t>(events_per_thread, 1))),
+      epoch_(std::chrono::steady_clock::now()) {}
+
+TraceRecorder::~TraceRecorder() = default;
+
+TraceRecorder::ThreadBuffer& TraceRecorder::buffer_for_this_thread() {
+    if (thread_cache.recorder == id_) {
+        return *static_cast<ThreadBuffer*>(thread_cache.buffer);
+    }
+
+    std::lock_guard lock(mutex_);
+    const auto self = std::this_thread::get_id();
+    auto found = std::find_if(buffers_.begin(), buffers_.end(),
+                              [&](const std::unique_ptr<ThreadBuffer>& buffer) { return buffer->owner == self; });
+    ThreadBuffer* buffer = nullptr;
+    if (found != buffers_.end()) {
+        buffer = found->get();
+    } else {
+        auto created = std::make_unique<ThreadBuffer>();
+        created->owner = self;
+        created->index = static_cast<std::uint32_t>(buffers_.size());
+        buffer = created.get();
+        buffers_.push_back(std::move(created));
+    }
+    thread_cache = ThreadCache{id_, buffer};
+    return *buffer;
+}
+
+void TraceRecorder::record(const char* name, std::int64_t start, std::string detail) {
+    const std::int64_t end = now();
+    ThreadBuffer& buffer = buffer_for_this_thread();
+    if (buffer.ring.size() < capacity_) {
+        if (buffer.ring.size() == buffer.ring.capacity()) {
+            buffer.ring.reserve(
+                std::min(capacity_, std::max<std::size_t>(kFirstRingEvents, 2 * buffer.ring.size())));
+        }
+        buffer.ring.emplace_back();
+    }
+    TraceEvent& event = buffer.ring[buffer.written & (capacity_ - 1)];
+    event.name = name;
+    event.detail = std::move(detail);
+    event.thread = buffer.index;
+    event.start = start;
+    event.duration = end - start;
+    ++buffer.written;
+}
+
+std::size_t TraceRecorder::dropped() const {
+    std::lock_guard lock(mutex_);
+    std::size_t dropped = 0;
+    for (const auto& buffer : buffers_) {
+        dropped += buffer->written > capacity_ ? buffer->written - capacity_ : 0;
+    }
+    return dropped;
+}
+
+std::vector<TraceEvent> TraceRecorder::events() const {
+    std::lock_guard lock(mutex_);
+    std::vector<TraceEvent> events;
+    for (const auto& buffer : buffers_) {
+        const std::size_t first = events.size();
+        const std::size_t kept = std::min(buffer->written, capacity_);
+        for (std::size_t i = buffer->written - kept; i < buffer->written; ++i) {
+            events.push_back(buffer->ring[i & (capacity_ - 1)]);
+        }
+        // Spans are recorded when they end, so an enclosing span comes after the spans inside it.
+        std::stable_sort(events.begin() + static_cast<std::ptrdiff_t>(first), events.end(),
+                         [](const TraceEvent& a, const TraceEvent& b) { return a.start < b.start; });
+    }
+    return events;
+}
+
+void TraceRecorder::write_chrome_json(std::ostream& out) const {
+    const auto spans = events();
+    std::size_t threads = 0;
+    {
+        std::lock_guard lock(mutex_);
+        threads = buffers_.size();
+    }
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << R"({"name":"process_name","ph":"M","pid":1,"tid":0,"args":{"name":"sonar"}})";
+    for (std::size_t thread = 0; thread < threads; ++thread) {
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+            << ",\"args\":{\"name\":\"thread " << thread << "\"}}";
+    }
+    for (const TraceEvent& event : spans) {
+        out << ",\n{\"name\":";
+        write_json_string(out, event.name);
+        out << ",\"cat\":\"sonar\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":";
+        write_microseconds(out, event.start);
+        out << ",\"dur\":";
+        write_microseconds(out, event.duration);
+        if (!event.detail.empty()) {
+            out << ",\"args\":{\"detail\":";
+            write_json_string(out, event.detail);
+            out << "}";
+        }
+        out << "}";
+    }
+    out << "\n]}\n";
+}
+
+}  // namespace sonar
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "sonar/ast_binary.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/pretty_printer.hpp"
+#include "test_sources.hpp"
+
+namespace {
+
+sonar::ExpressionPtr parse(const std::string& source) {
+    sonar::Lexer lexer;
+    auto lex_result = lexer.tokenize(source);
+    sonar::Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), "<test>");
+    return parser.parse();
+}
+
+}  // namespace
+
+TEST(AstBinaryTest, RoundTripsThroughMaterialize) {
+    const char* sources[] = {
+        "",
+        "1.5 + 2 * -x",
+        "let x: number = (1 + 2);\nx = x - 1;\nx",
+        "fn add(a: number, b: number) -> number { a + b }\nlet s = \"hi\";\nif true { add } else { s }",
+        "while x { x = x - 1; };\nfor i in { i } { false }",
+        "{ let y = 1; fn() -> number { y } };",
+        "a - b - c * d - (e + f) + -g",
+    };
+
+    for (const char* source : sources) {
+        SCOPED_TRACE(source);
+        auto ast = parse(source);
+        const std::string bytes = sonar::serialize_ast(*ast);
+        sonar::BinaryAst binary(bytes);
+        auto loaded = sonar::materialize(binary.root());
+        EXPECT_EQ(sonar::pretty_print(*loaded), sonar::pretty_print(*ast));
+        // Byte-identical output means every span survived too.
+        EXPECT_EQ(sonar::serialize_ast(*loaded), bytes);
+    }
+}
+
+TEST(AstBinaryTest, RoundTripsLongOperatorChains) {
+    auto ast = parse(sonar::test::long_operator_chain(200000));
+    const std::string bytes = sonar::serialize_ast(*ast);
+    sonar::BinaryAst binary(bytes);
+    EXPECT_EQ(sonar::serialize_ast(*sonar::materialize(binary.root())), bytes);
+}
+
+TEST(AstBinaryTest, ReadsNodesInPlace) {
+    const std::string bytes = sonar::serialize_ast(*parse("let total: number = a + 2;\nfn f(n: bool) -> number { n }"));
+    sonar::BinaryAst binary(bytes);
+
+    const auto root = binary.root();
+    ASSERT_EQ(root.kind(), sonar::BinaryNodeKind::Block);
+    ASSERT_EQ(root.child_count(), 3u);
+    EXPECT_FALSE(root.child(2));
+
+    const auto let = root.child(0);
+    ASSERT_EQ(let.kind(), sonar::BinaryNodeKind::Let);
+    EXPECT_EQ(let.text(), "total");
+    EXPECT_EQ(let.name_span().start, 4u);
+    ASSERT_TRUE(let.has_annotation());
+    EXPECT_EQ(let.annotation().name, "number");
+
+    const auto sum = let.child(0);
+    ASSERT_EQ(sum.kind(), sonar::BinaryNodeKind::Infix);
+    EXPECT_EQ(sum.op(), sonar::TokenType::Plus);
+    // Positions count from the enclosing node, as in the tree: the sum from the let, its operator from the sum.
+    EXPECT_EQ(sum.span().start, 20u);
+    EXPECT_EQ(sum.op_span().start, 2u);
+    EXPECT_EQ(sum.child(0).text(), "a");
+    EXPECT_EQ(sum.child(1).number(), 2.0);
+
+    const auto function = root.child(1).child(0);
+    ASSERT_EQ(function.kind(), sonar::BinaryNodeKind::Function);
+    ASSERT_EQ(function.parameter_count(), 1u);
+    EXPECT_EQ(function.parameter(0).name, "n");
+    EXPECT_EQ(function.parameter(0).type.name, "bool");
+    EXPECT_EQ(function.return_type().name, "number");
+    EXPECT_EQ(function.child(0).kind(), sonar::BinaryNodeKind::Block);
+}
+
+TEST(AstBinaryTest, MapsWrittenFile) {
+    const auto path = (std::filesystem::temp_directory_path() / "sonar_ast_binary_test.bin").string();
+    auto ast = parse("let a = 1;\na");
+    sonar::write_ast_file(path, *ast, 0x1234);
+    {
+        sonar::BinaryAstFile file(path);
+        EXPECT_EQ(file.ast().source_hash(), 0x1234u);
+        EXPECT_EQ(sonar::pretty_print(*sonar::materialize(file.ast().root())), sonar::pretty_print(*ast));
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(AstBinaryTest, RejectsInvalidInput) {
+    const std::string bytes = sonar::serialize_ast(*parse("1 + 2"));
+    EXPECT_TRUE(sonar::is_binary_ast(bytes));
+    EXPECT_FALSE(sonar::is_binary_ast("1 + 2"));
+
+    EXPECT_THROW(sonar::BinaryAst("1 + 2"), std::runtime_error);
+    EXPECT_THROW(sonar::BinaryAst(std::string_view(bytes).substr(0, bytes.size() - 1)), std::runtime_error);
+
+    std::string wrong_version = bytes;
+    const std::uint32_t version = sonar::kBinaryAstVersion + 1;
+    std::memcpy(wrong_version.data() + 8, &version, sizeof(version));
+    EXPECT_THROW(sonar::BinaryAst{wrong_version}, std::runtime_error);
+
+    // Point the root's left operand back at the root.
+    std::string cyclic = bytes;
+    const std::uint32_t root = 0;
+    std::memcpy(cyclic.data() + 40 + 12, &root, sizeof(root));
+    sonar::BinaryAst binary(cyclic);
+    EXPECT_THROW(sonar::materialize(binary.root()), std::runtime_error);
+}
+
+TEST(AstBinaryTest, LoadsTheDeepestTreesTheParserBuilds) {
+    const auto nested = [](const std::string& open, const std::string& close, std::size_t levels) {
+        std::string source;
+        for (std::size_t i = 0; i < levels; ++i) {
+            source += open;
+        }
+        source += "1";
+        for (std::size_t i = 0; i < levels; ++i) {
+            source += close;
+        }
+        return source;
+    };
+    // Each shape nests one or two levels per repetition; the search finds the most that still parse.
+    const std::pair<std::string, std::string> shapes[] = {
+        {"(", ")"},   {"{ let a = ", "; a }"}, {"{ ", " }"},   {"-", ""},
+        {"x = ", ""}, {"if a { ", " }"},       {"fn() -> number { ", " }"}, {"for i in y { ", " }"},
+    };
+    for (const auto& [open, close] : shapes) {
+        std::size_t low = 0;
+        std::size_t high = sonar::kMaxNestingDepth + 1;
+        while (high - low > 1) {
+            const std::size_t middle = (low + high) / 2;
+            try {
+                parse(nested(open, close, middle));
+                low = middle;
+            } catch (const sonar::ParseError&) {
+                high = middle;
+            }
+        }
+        EXPECT_GE(low, sonar::kMaxNestingDepth / 2 - 1) << open;
+        const std::string bytes = sonar::serialize_ast(*parse(nested(open, close, low)));
+        sonar::BinaryAst binary(bytes);
+        EXPECT_EQ(sonar::serialize_ast(*sonar::materialize(binary.root())), bytes) << open;
+    }
+}
+
+TEST(AstBinaryTest, RejectsTreesNestedTooDeeply) {
+    // Built by hand, since the parser refuses to build them.
+    const auto nested = [](std::size_t levels, bool blocks) {
+        auto expression = std::make_unique<sonar::Expression>(sonar::Expression::Number{1}, sonar::SourceSpan{0, 1});
+        for (std::size_t i = 0; i < levels; ++i) {
+            if (blocks) {
+                sonar::Expression::Block block;
+                block.statements.push_back(std::make_unique<sonar::Statement>(
+                    sonar::Statement::Let{"a", sonar::SourceSpan{0, 1}, nullptr, std::move(expression)}, sonar::SourceSpan{0, 1}));
+                expression = std::make_unique<sonar::Expression>(std::move(block), sonar::SourceSpan{0, 1});
+            } else {
+                expression = std::make_unique<sonar::Expression>(sonar::Expression::Grouping{std::move(expression)},
+                                                                 sonar::SourceSpan{0, 1});
+            }
+        }
+        return sonar::serialize_ast(*expression);
+    };
+    for (const bool blocks : {false, true}) {
+        const std::string bytes = nested(4 * sonar::kMaxNestingDepth, blocks);
+        sonar::BinaryAst binary(bytes);
+        EXPECT_THROW(sonar::materialize(binary.root()), std::runtime_error) << blocks;
+    }
+}
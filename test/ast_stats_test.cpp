@@ -0,0 +1,36 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+
+#include "sonar/ast_stats.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+
+namespace {
+
+sonar::ExpressionPtr parse(const std::string& source) {
+    sonar::Lexer lexer;
+    auto lex_result = lexer.tokenize(source);
+    sonar::Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), "<test>");
+    return parser.parse();
+}
+
+}  // namespace
+
+TEST(AstStatsTest, CountsNodesAndOwnedMemory) {
+    auto ast = parse("let x = 1 + 2;\nx");
+    const auto stats = sonar::collect_ast_stats(*ast);
+    EXPECT_EQ(stats.statements, 1u);
+    EXPECT_EQ(stats.expressions, 5u);
+    EXPECT_GE(stats.bytes, stats.expressions * sizeof(sonar::Expression) + sizeof(sonar::Statement));
+}
+
+TEST(AstStatsTest, CountsBoxedSignature) {
+    auto plain = sonar::collect_ast_stats(*parse("{ 1 }"));
+    auto function = sonar::collect_ast_stats(*parse("fn(a: number) -> number { 1 }"));
+    EXPECT_EQ(function.nodes(), plain.nodes() + 1);
+    EXPECT_GE(function.bytes - plain.bytes,
+              sizeof(sonar::Expression) + sizeof(sonar::Expression::Function::Signature) +
+                  sizeof(sonar::Expression::Function::Parameter));
+}
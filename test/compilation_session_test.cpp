@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+
+#include "sonar/compilation_session.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/pretty_printer.hpp"
+
+namespace {
+
+std::string print_fresh(const std::string& source) {
+    sonar::Lexer lexer;
+    auto lex_result = lexer.tokenize(source);
+    sonar::Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), "<fresh>");
+    return sonar::pretty_print(*parser.parse());
+}
+
+}  // namespace
+
+TEST(CompilationSessionTest, ParsesLikeAFreshParserAndRecordsSources) {
+    const std::string sources[] = {
+        "let a = 1;\na + 2",
+        "fn f(x: number) -> number { x * 2 }\nf",
+        "for i in items { total = total + i; }",
+    };
+
+    sonar::CompilationSession session;
+    for (const auto& source : sources) {
+        auto ast = session.parse(source, "<" + std::to_string(session.sources().size()) + ">");
+        EXPECT_EQ(sonar::pretty_print(*ast), print_fresh(source));
+    }
+
+    const auto& registry = session.sources();
+    ASSERT_EQ(registry.size(), 3u);
+    EXPECT_EQ(registry[1].name, "<1>");
+    EXPECT_EQ(registry[1].text, sources[1]);
+    const auto location = registry.location(0, sources[0].find("a + 2"));
+    EXPECT_EQ(location.line, 2u);
+    EXPECT_EQ(location.column, 1u);
+}
+
+TEST(CompilationSessionTest, ResetKeepsCapacity) {
+    std::string source;
+    for (int i = 0; i < 200; ++i) {
+        source += "let v" + std::to_string(i) + " = { let t = " + std::to_string(i) + "; t * (t + 1) };\n";
+    }
+    source += "v0";
+
+    sonar::CompilationSession session(1024);
+    const std::string expected = print_fresh(source);
+    EXPECT_EQ(sonar::pretty_print(*session.parse(source, "<first>")), expected);
+    const std::size_t capacity = session.arena().capacity();
+    EXPECT_GT(session.arena().used(), 0u);
+
+    session.reset();
+    EXPECT_EQ(session.arena().used(), 0u);
+    EXPECT_EQ(session.arena().capacity(), capacity);
+    EXPECT_EQ(session.sources().size(), 0u);
+
+    EXPECT_EQ(sonar::pretty_print(*session.parse(source, "<second>")), expected);
+    EXPECT_EQ(session.arena().capacity(), capacity);
+    EXPECT_EQ(session.sources()[0].name, "<second>");
+}
+
+TEST(CompilationSessionTest, StaysUsableAfterAnError) {
+    sonar::CompilationSession session;
+    try {
+        session.parse("let = 1;", "<bad>");
+        FAIL() << "expected a parse error";
+    } catch (const sonar::ParseError& error) {
+        EXPECT_EQ(error.source_name(), "<bad>");
+        EXPECT_STREQ(error.what(), "Expected identifier after 'let'");
+    }
+    EXPECT_EQ(sonar::pretty_print(*session.parse("1 + 2", "<good>")), "(+ 1 2)");
+    EXPECT_EQ(session.sources().size(), 2u);
+}
+
+TEST(CompilationSessionTest, ArenaHonoursAlignment) {
+    sonar::ArenaResource arena(64);
+    for (std::size_t alignment : {1u, 8u, 16u, 64u, 256u}) {
+        void* pointer = arena.allocate(24, alignment);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(pointer) % alignment, 0u);
+    }
+    void* large = arena.allocate(4096, 8);
+    EXPECT_NE(large, nullptr);
+    EXPECT_GE(arena.capacity(), 4096u);
+}
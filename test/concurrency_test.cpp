@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "concurrent_scripts.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/pretty_printer.hpp"
+
+namespace {
+
+std::string print_or_error(const std::string& source, sonar::ParserOptions options = {}) {
+    try {
+        sonar::Lexer lexer;
+        auto lex_result = lexer.tokenize(source);
+        sonar::Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), "<test>", options);
+        return sonar::pretty_print(*parser.parse());
+    } catch (const std::exception& error) {
+        return std::string("error: ") + error.what();
+    }
+}
+
+std::vector<std::string> make_sources() {
+    std::vector<std::string> sources;
+    for (int i = 0; i < 64; ++i) {
+        const std::string n = std::to_string(i);
+        sources.push_back("let v" + n + " = " + n + " * (2 + x) - -y;\nfn f(a: number) -> number { if a { a } else { " +
+                          n + " } }\nwhile v" + n + " { v" + n + " = v" + n + " - 1; }; \"s" + n + "\\n\"");
+    }
+    sources.push_back("let = 1;");
+    sources.push_back("fn f() -> number { 1 + }");
+    sources.push_back("1 # 2");
+    return sources;
+}
+
+}  // namespace
+
+// Lexer, Parser and pretty_print keep no shared mutable state, so threads that parse at the same time get
+// exactly what a single thread gets. Run under ThreadSanitizer to check for races as well.
+TEST(ConcurrencyTest, ParsesTheSameOnManyThreads) {
+    const auto sources = make_sources();
+    std::vector<std::string> expected;
+    for (const auto& source : sources) {
+        expected.push_back(print_or_error(source));
+    }
+
+    const unsigned thread_count = std::max(4u, std::thread::hardware_concurrency());
+    std::vector<std::vector<std::string>> results(thread_count);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t]() {
+            sonar::ParserOptions options;
+            options.lazy_function_bodies = t % 2 == 1;
+            for (int round = 0; round < 20; ++round) {
+                for (std::size_t i = 0; i < sources.size(); ++i) {
+                    // Start each thread at a different source so that different rules run at the same time.
+                    const std::size_t index = (i + t * 7) % sources.size();
+                    auto printed = print_or_error(sources[index], options);
+                    if (round == 0) {
+                        results[t].push_back(std::move(printed));
+                    } else if (printed != results[t][i]) {
+                        results[t][i] = "mismatch: " + printed;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (unsigned t = 0; t < thread_count; ++t) {
+        ASSERT_EQ(results[t].size(), sources.size());
+        for (std::size_t i = 0; i < sources.size(); ++i) {
+            EXPECT_EQ(results[t][i], expected[(i + t * 7) % sources.size()]) << "thread " << t << ", source " << i;
+        }
+    }
+}
+
+// Throughput must grow with the thread count up to the physical cores; see concurrent_scripts.hpp. Each
+// measurement keeps the best of a few runs, so a short stall on a busy machine does not fail it.
+TEST(ConcurrencyTimingTest, ThroughputScalesUpToThePhysicalCores) {
+    const unsigned cores = sonar::bench::physical_cores();
+    if (cores < 2) {
+        GTEST_SKIP() << "needs at least two physical cores";
+    }
+    const auto best_of = [](unsigned threads) {
+        double best = 0.0;
+        for (int run = 0; run < 3; ++run) {
+            best = std::max(best, sonar::bench::concurrent_scripts_per_second(threads, std::chrono::milliseconds(300)));
+        }
+        return best;
+    };
+    const double baseline = best_of(1);
+    std::vector<unsigned> thread_counts;
+    for (unsigned threads = 2; threads < cores; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(cores);
+    for (const unsigned threads : thread_counts) {
+        const double efficiency = best_of(threads) / (baseline * threads);
+        EXPECT_GE(efficiency, sonar::bench::kMinScalingEfficiency) << threads << " threads";
+    }
+}
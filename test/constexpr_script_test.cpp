@@ -0,0 +1,288 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "sonar/constexpr_script.hpp"
+#include "sonar/event_parser.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/node_map.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/program_generator.hpp"
+#include "sonar/visitor.hpp"
+#include "test_sources.hpp"
+
+namespace {
+
+using sonar::ct::NodeKind;
+using sonar::ct::ValueKind;
+
+constexpr double number_of(std::string_view source) {
+    const auto value = sonar::ct::evaluate(source);
+    return value.kind == ValueKind::Number ? value.number : -1;
+}
+
+// Everything below is checked by the compiler.
+static_assert(number_of("1 + 2 * 3") == 7);
+static_assert(number_of("(1 + 2) * 3 - -1") == 10);
+static_assert(number_of("10 / 4") == 2.5);
+static_assert(number_of("6 & 3 | 8") == 10);
+static_assert(number_of("let a = 1; let b = { let a = 2; a * 10 }; a + b") == 21);
+static_assert(number_of("let a: number = 1; a = a + 1; a") == 2);
+static_assert(number_of("let go = true; let n = 0; while go { n = n + 1; go = false; }; n") == 1);
+static_assert(number_of("if true && false { 1 } else if true | false { 2 } else { 3 }") == 2);
+static_assert(number_of("fn f(x: number) -> number { x }\nlet g = f; 1.5e1 /* c */ // c") == 15);
+static_assert(sonar::ct::evaluate("fn f() -> number { 1 }\nf").kind == ValueKind::Function);
+static_assert(sonar::ct::evaluate("let a = 1;").kind == ValueKind::Unit);
+static_assert(sonar::ct::evaluate("").kind == ValueKind::Unit);
+static_assert(sonar::ct::evaluate("true || x").boolean);
+static_assert(sonar::ct::evaluate("false && x || true").boolean);
+static_assert(number_of("1 - 2 - 3 * 2 + 10 / 5 / 2") == -6);
+
+static_assert(sonar::ct::constant_value<"let a = 6; a * 7">.number == 42);
+
+static_assert(sonar::ct::tokenize("let s = r#\"a\"b\"#;").size() == 6);
+static_assert(sonar::ct::tokenize("\"q\\\"\"")[0].lexeme == "\"q\\\"\"");
+
+constexpr const auto& kAst = sonar::ct::static_ast<"let a: bool = true;\n{ a };">;
+static_assert(kAst.nodes.size() == 6);
+static_assert(kAst.root().kind == NodeKind::Block && !kAst.root().boolean);
+static_assert(kAst.nodes[kAst.root().first_child].kind == NodeKind::Let);
+static_assert(kAst.nodes[kAst.root().first_child].text == "a");
+static_assert(kAst.nodes[kAst.root().first_child].type == "bool");
+
+const std::string kSource =
+    "let a: number = 1 + 2 * b;\n"
+    "fn f(x: number, y: bool) -> number { if y { x } else { -x } }\n"
+    "while a { a = a - 1; };\n"
+    "for i in items { let t = (i); t };\n"
+    "let s = \"x\\n\" ; let r = r##\"raw \"# \"##; // comment\n"
+    "let n = .5 + 2.25e-3 + 1E2 + 0.1 + 123456789012; /* block\n comment */\n"
+    "{ let inner = { () }; inner }";
+
+// Literals a conversion that rounds more than once gets wrong, and ones std::stod reports out of range.
+const std::string kNumbers =
+    "0.30000000000000004441 1e-30 123456789012345678901234 1.7976931348623157e308 2.2250738585072014e-308\n"
+    "8.98846567431158e307 9007199254740993 0.1e-7 00012.50e+2 1e23 2.2250738585072013e-308 0e99999\n"
+    "4.9406564584124654e-324 2.2250738585072012e-308 1e-400 1e-320 1.797693134862315808e308 1e400";
+
+class SpanRecorder : public sonar::AstWalker<SpanRecorder> {
+   public:
+    explicit SpanRecorder(std::vector<sonar::SourceSpan>& spans, std::vector<double>* numbers = nullptr)
+        : spans_(spans), numbers_(numbers) {}
+
+    template <typename Wrapper, typename Node>
+    void enter(const Wrapper& wrapper, const Node& node) {
+        spans_[sonar::node_id(wrapper)] = wrapper.span.offset_by(parent_start());
+        if constexpr (std::is_same_v<Node, sonar::Expression::Number>) {
+            if (numbers_ != nullptr) {
+                numbers_->push_back(node.value);
+            }
+        }
+    }
+
+   private:
+    std::vector<sonar::SourceSpan>& spans_;
+    std::vector<double>* numbers_;
+};
+
+// The spans of a runtime tree's nodes, in source offsets, in the order the parser created them.
+std::vector<sonar::SourceSpan> runtime_spans(const std::string& source) {
+    auto lexed = sonar::Lexer{}.tokenize(source);
+    auto ast = sonar::Parser(std::move(lexed.tokens), std::move(lexed.line_offsets), "<test>").parse();
+
+    std::vector<sonar::SourceSpan> spans(sonar::node_id_bound(*ast));
+    SpanRecorder(spans).walk(*ast);
+    return spans;
+}
+
+std::string error_of(auto&& run) {
+    try {
+        run();
+    } catch (const sonar::ParseError& error) {
+        return "parse " + std::to_string(error.span().start) + " " + error.what();
+    } catch (const std::runtime_error& error) {
+        return error.what();
+    }
+    return "no error";
+}
+
+// What one front end made of a source: its nodes' spans in creation order where it has nodes, its Number
+// values in source order, and the error it stopped at.
+struct Outcome {
+    std::vector<sonar::SourceSpan> spans;
+    std::vector<double> numbers;
+    std::string error;
+};
+
+Outcome parse_at_run_time(const std::string& source) {
+    Outcome outcome;
+    outcome.error = error_of([&] {
+        auto lexed = sonar::Lexer{}.tokenize(source);
+        auto ast = sonar::Parser(std::move(lexed.tokens), std::move(lexed.line_offsets), "<embedded>").parse();
+        outcome.spans.resize(sonar::node_id_bound(*ast));
+        SpanRecorder(outcome.spans, &outcome.numbers).walk(*ast);
+    });
+    return outcome;
+}
+
+struct NumberCollector {
+    std::vector<double>& numbers;
+
+    void enter(const sonar::ParseEvent& event) {
+        if (event.kind == sonar::ParseEventKind::Number) {
+            numbers.push_back(event.number);
+        }
+    }
+    void leave(const sonar::ParseEvent&) {}
+};
+
+Outcome parse_events(const std::string& source) {
+    Outcome outcome;
+    outcome.error = error_of([&] {
+        const auto lexed = sonar::Lexer{}.tokenize(source);
+        NumberCollector collector{outcome.numbers};
+        sonar::EventParser(lexed.tokens, lexed.line_offsets, "<embedded>").parse(collector);
+    });
+    return outcome;
+}
+
+Outcome parse_flat(const std::string& source) {
+    Outcome outcome;
+    outcome.error = error_of([&] {
+        for (const auto& node : sonar::ct::parse(source)) {
+            outcome.spans.push_back(node.span);
+            if (node.kind == NodeKind::Number) {
+                outcome.numbers.push_back(node.number);
+            }
+        }
+    });
+    return outcome;
+}
+
+// Parser, EventParser and the constexpr parser must agree on every node, number and error. EventParser
+// delivers what it parsed before an error, so only the error is compared then.
+void expect_front_ends_agree(const std::string& source) {
+    const auto expected = parse_at_run_time(source);
+    const auto events = parse_events(source);
+    const auto flat = parse_flat(source);
+    EXPECT_EQ(events.error, expected.error);
+    EXPECT_EQ(flat.error, expected.error);
+    if (expected.error == "no error") {
+        EXPECT_TRUE(events.numbers == expected.numbers);
+        EXPECT_TRUE(flat.numbers == expected.numbers);
+        EXPECT_TRUE(flat.spans == expected.spans);
+    }
+}
+
+}  // namespace
+
+TEST(ConstexprScriptTest, TokensMatchLexer) {
+    for (const auto& source : {kSource, kNumbers}) {
+        const auto expected = sonar::Lexer{}.tokenize(source).tokens;
+        const auto actual = sonar::ct::tokenize(source);
+        ASSERT_EQ(actual.size(), expected.size());
+        for (std::size_t i = 0; i < actual.size(); ++i) {
+            EXPECT_EQ(actual[i].type, expected[i].type) << i;
+            EXPECT_EQ(actual[i].span, expected[i].span) << i;
+            if (actual[i].type != sonar::TokenType::Number) {
+                continue;
+            }
+            const auto value = sonar::ct::detail::parse_number(actual[i].lexeme);
+            try {
+                const double number = expected[i].as_number();
+                ASSERT_TRUE(value.has_value()) << expected[i].lexeme;
+                EXPECT_EQ(*value, number) << expected[i].lexeme;
+            } catch (const std::runtime_error&) {
+                EXPECT_FALSE(value.has_value()) << expected[i].lexeme;
+            }
+        }
+    }
+}
+
+TEST(ConstexprScriptTest, RejectsNumbersOutOfRange) {
+    static_assert(sonar::ct::detail::parse_number("1e-30") == 1e-30);
+    static_assert(!sonar::ct::detail::parse_number("1e-400"));
+    EXPECT_EQ(error_of([] { sonar::ct::parse("x + 1e-400"); }), "Failed to parse number at line 1, column 5");
+    EXPECT_EQ(error_of([] { sonar::ct::parse("x + 1e400"); }), "Failed to parse number at line 1, column 5");
+    EXPECT_EQ(parse_at_run_time("x + 1e-400").error.rfind("Failed to parse number '1e-400'", 0), 0u);
+}
+
+TEST(ConstexprScriptTest, NodesMatchParserInCreationOrder) {
+    for (const auto& source : {kSource, std::string("1"), std::string(""), std::string("a = b = -c * (d | e)")}) {
+        const auto nodes = sonar::ct::parse(source);
+        const auto expected = runtime_spans(source);
+        ASSERT_EQ(nodes.size(), expected.size()) << source;
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            EXPECT_EQ(nodes[i].span, expected[i]) << source << " node " << i;
+        }
+    }
+}
+
+TEST(ConstexprScriptTest, ErrorsMatchLexerAndParser) {
+    const std::string sources[] = {
+        "let = 2;", "1 +", "(1", "{ 1", "fn f() -> number { 1 };", "let a = 1 2", "1 = 2", "fn (x) -> n 1",
+        "let ;",    "\"open", "a $ b", "1e+", "/* open", "\"\\q\"", "r#\"open\"", ". 5", "for 1 in x {}", "let a: = 1;",
+        std::string(sonar::kMaxNestingDepth, '-') + "1",
+    };
+    for (const auto& source : sources) {
+        const std::string expected = error_of([&] {
+            auto lexed = sonar::Lexer{}.tokenize(source);
+            sonar::Parser(std::move(lexed.tokens), std::move(lexed.line_offsets), "<test>").parse();
+        });
+        EXPECT_NE(expected, "no error") << source;
+        EXPECT_EQ(error_of([&] { sonar::ct::parse(source); }), expected) << source;
+    }
+}
+
+TEST(ConstexprScriptTest, MatchesParsersOnGeneratedPrograms) {
+    for (std::uint64_t seed = 1; seed <= 8; ++seed) {
+        sonar::GeneratorOptions options;
+        options.seed = seed;
+        options.target_bytes = 4 * 1024;
+        options.depth = seed % 4 + 2;
+        const auto source = sonar::generate_program(options);
+        SCOPED_TRACE("seed " + std::to_string(seed));
+        expect_front_ends_agree(source);
+        expect_front_ends_agree(source.substr(0, source.size() / 2));
+    }
+    expect_front_ends_agree(kSource);
+    // The first two lines of kNumbers, which std::stod accepts, as one sum.
+    std::string sum = kNumbers.substr(0, kNumbers.rfind('\n'));
+    std::replace_if(sum.begin(), sum.end(), [](char c) { return c == ' ' || c == '\n'; }, '+');
+    expect_front_ends_agree(sum);
+}
+
+TEST(ConstexprScriptTest, MatchesParsersOnFuzzCorpus) {
+    for (const auto& entry : std::filesystem::directory_iterator(SONAR_FUZZ_CORPUS_DIR)) {
+        std::ifstream file(entry.path(), std::ios::binary);
+        const std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        SCOPED_TRACE(entry.path().filename().string());
+        expect_front_ends_agree(source);
+    }
+}
+
+TEST(ConstexprScriptTest, EvaluatesLongChains) {
+    EXPECT_EQ(number_of(sonar::test::long_operator_chain(200000, "1")), 200001);
+    EXPECT_EQ(error_of([] { sonar::ct::evaluate("1 + 2 - true * 3 - 4"); }), "Expected a number at line 1, column 9");
+}
+
+TEST(ConstexprScriptTest, EvaluationErrors) {
+    EXPECT_EQ(error_of([] { sonar::ct::evaluate("let a = 1;\nb"); }), "Unknown variable at line 2, column 1");
+    EXPECT_EQ(error_of([] { sonar::ct::evaluate("let a: bool = 1;"); }),
+              "Value does not match the type annotation at line 1, column 1");
+    EXPECT_EQ(error_of([] { sonar::ct::evaluate("1 / (2 - 2)"); }), "Division by zero at line 1, column 1");
+    EXPECT_EQ(error_of([] { sonar::ct::evaluate("1.5 & 1"); }), "Expected an integer at line 1, column 1");
+    EXPECT_EQ(error_of([] { sonar::ct::evaluate("if 1 { 2 }"); }), "Expected a boolean at line 1, column 4");
+    EXPECT_EQ(error_of([] { sonar::ct::evaluate("\"s\""); }), "Strings are not constant-folded at line 1, column 1");
+    EXPECT_EQ(error_of([] { sonar::ct::evaluate("for i in x { i }"); }), "'for' needs a runtime iterable at line 1, column 1");
+    EXPECT_EQ(error_of([] { sonar::ct::evaluate("let t = true; while t { }"); }).rfind("Evaluation step limit exceeded", 0),
+              0u);
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "sonar/event_parser.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/pretty_printer.hpp"
+
+namespace {
+
+std::string print_with_parser(const std::string& source) {
+    sonar::Lexer lexer;
+    auto lex_result = lexer.tokenize(source);
+    sonar::Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), "<test>");
+    return sonar::pretty_print(*parser.parse());
+}
+
+std::string print_with_events(const std::string& source) {
+    sonar::Lexer lexer;
+    auto lex_result = lexer.tokenize(source);
+    sonar::EventParser parser(lex_result.tokens, lex_result.line_offsets, "<test>");
+    return sonar::pretty_print_events(parser);
+}
+
+struct RecordingVisitor {
+    void enter(const sonar::ParseEvent& event) { log.push_back("+" + describe(event)); }
+
+    void leave(const sonar::ParseEvent& event) { log.push_back("-" + describe(event)); }
+
+    static std::string describe(const sonar::ParseEvent& event) {
+        return std::to_string(static_cast<int>(event.kind)) + "@" + std::to_string(event.span.start) + ":" +
+               std::to_string(event.span.end);
+    }
+
+    std::vector<std::string> log;
+};
+
+}  // namespace
+
+TEST(EventParserTest, PrintsLikeTheTreeParser) {
+    const std::vector<std::string> sources = {
+        "",
+        "42",
+        ";;",
+        "1 + 2 * 3 - 4 - 5",
+        "a = b = -c | d & e || f && g",
+        "let a: number = (1);\nlet s = \"q\\n\\\"\";\n()",
+        "fn add(a: number, b: number) -> number { a + b }\nfn unit() -> unit ()\nadd",
+        "let f = fn(x: number) -> number x * 2;\nf;",
+        "if a { 1 } else if b { 2 } else { let c = 3; c }",
+        "while x { x = x + 1; }; for i in xs { i; }",
+        "{ { } ; { 1 } }",
+        "true && false",
+    };
+
+    for (const auto& source : sources) {
+        EXPECT_EQ(print_with_events(source), print_with_parser(source)) << source;
+    }
+}
+
+TEST(EventParserTest, WrapsLeftOperandsOutermostFirst) {
+    sonar::Lexer lexer;
+    auto lex_result = lexer.tokenize("a - b - c;");
+    sonar::EventParser parser(lex_result.tokens, lex_result.line_offsets, "<test>");
+    RecordingVisitor visitor;
+    parser.parse(visitor);
+
+    const std::vector<std::string> expected = {
+        "+0@0:10", "+18@0:9", "+6@0:9", "+6@0:5", "+4@0:1", "-4@0:1", "+4@4:5", "-4@4:5",
+        "-6@0:5",  "+4@8:9",  "-4@8:9", "-6@0:9", "-18@0:9", "-0@0:10",
+    };
+    EXPECT_EQ(visitor.log, expected);
+}
+
+TEST(EventParserTest, ReportsTheParserErrors) {
+    const std::vector<std::string> sources = {
+        "let a = 1;\nlet = 2;", "1 +", "(1", "{ let a = 1 }", "1 = 2", "fn f() -> number 1;", "1 2", "for 1 in x {}", "}",
+    };
+
+    for (const auto& source : sources) {
+        std::string expected_message;
+        sonar::SourceLocation expected_location{};
+        bool expected_incomplete = false;
+        try {
+            print_with_parser(source);
+            ADD_FAILURE() << "Parser accepted " << source;
+            continue;
+        } catch (const sonar::ParseError& err) {
+            expected_message = err.what();
+            expected_location = err.location();
+            expected_incomplete = err.incomplete();
+        }
+
+        try {
+            print_with_events(source);
+            ADD_FAILURE() << "EventParser accepted " << source;
+        } catch (const sonar::ParseError& err) {
+            EXPECT_EQ(err.what(), expected_message) << source;
+            EXPECT_EQ(err.location().line, expected_location.line) << source;
+            EXPECT_EQ(err.location().column, expected_location.column) << source;
+            EXPECT_EQ(err.incomplete(), expected_incomplete) << source;
+        }
+    }
+}
+
+TEST(EventParserTest, DeliversStatementsBeforeAnError) {
+    sonar::Lexer lexer;
+    auto lex_result = lexer.tokenize("let a = 1;\nlet b = 2;\nlet = 3;");
+    sonar::EventParser parser(lex_result.tokens, lex_result.line_offsets, "<test>");
+    RecordingVisitor visitor;
+    EXPECT_THROW(parser.parse(visitor), sonar::ParseError);
+    // Program enter, then enter/leave for each let and its number.
+    EXPECT_EQ(visitor.log.size(), 9u);
+}
@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pipeline.hpp"
+
+namespace {
+
+// Every input in fuzz/corpus, the seeds and minimised findings of the parse fuzzer, with its file name.
+std::vector<std::pair<std::string, std::string>> corpus() {
+    std::vector<std::pair<std::string, std::string>> inputs;
+    for (const auto& entry : std::filesystem::directory_iterator(SONAR_FUZZ_CORPUS_DIR)) {
+        std::ifstream file(entry.path(), std::ios::binary);
+        inputs.emplace_back(entry.path().filename().string(),
+                            std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()));
+    }
+    return inputs;
+}
+
+}  // namespace
+
+// Each corpus input must still pass the fuzzer's deterministic checks: no crash, output within its size bound
+// and the same output from parse events.
+TEST(FuzzCorpusTest, ReplaysCorpus) {
+    const auto inputs = corpus();
+    for (const auto& [name, source] : inputs) {
+        SCOPED_TRACE(name);
+        const auto run = sonar::fuzz::run_pipeline(source);
+        EXPECT_EQ(sonar::fuzz::LinearBudget::check_output(source, run), "");
+        EXPECT_EQ(sonar::fuzz::print_events(source), run.output);
+    }
+    EXPECT_GT(inputs.size(), 0u);
+}
+
+// The fuzzer's timing check, which depends on the machine and its load. CMake runs the timing tests as their
+// own ctest entry, labelled `timing`, only with -DSONAR_TIMING_TESTS=ON.
+TEST(FuzzCorpusTimingTest, ReplaysCorpusWithinLinearBudget) {
+    const sonar::fuzz::LinearBudget budget;
+    for (const auto& [name, source] : corpus()) {
+        SCOPED_TRACE(name);
+        EXPECT_EQ(budget.check_time(source, sonar::fuzz::run_pipeline(source)), "");
+    }
+}
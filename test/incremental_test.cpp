@@ -0,0 +1,238 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/pretty_printer.hpp"
+
+namespace {
+
+void collect_spans(const sonar::Expression& expression, std::vector<std::size_t>& out);
+
+void collect_spans(const sonar::Statement& statement, std::vector<std::size_t>& out) {
+    out.push_back(statement.span.start);
+    out.push_back(statement.span.end);
+    if (const auto* let = std::get_if<sonar::Statement::Let>(&statement.node)) {
+        out.push_back(let->name_span.start);
+        collect_spans(*let->initializer, out);
+    } else {
+        collect_spans(*std::get<sonar::Statement::Expression>(statement.node).expression, out);
+    }
+}
+
+void collect_spans(const sonar::Expression& expression, std::vector<std::size_t>& out) {
+    out.push_back(expression.span.start);
+    out.push_back(expression.span.end);
+    auto child = [&](const sonar::ExpressionPtr& node) {
+        if (node) {
+            collect_spans(*node, out);
+        }
+    };
+    std::visit(
+        [&](const auto& node) {
+            using Node = std::decay_t<decltype(node)>;
+            if constexpr (std::is_same_v<Node, sonar::Expression::Infix>) {
+                out.push_back(node.op_span.start);
+                child(node.left);
+                child(node.right);
+            } else if constexpr (std::is_same_v<Node, sonar::Expression::Prefix>) {
+                child(node.right);
+            } else if constexpr (std::is_same_v<Node, sonar::Expression::Grouping>) {
+                child(node.expression);
+            } else if constexpr (std::is_same_v<Node, sonar::Expression::Assign>) {
+                child(node.target);
+                child(node.value);
+            } else if constexpr (std::is_same_v<Node, sonar::Expression::Block>) {
+                for (const auto& statement : node.statements) {
+                    collect_spans(*statement, out);
+                }
+                child(node.value);
+            } else if constexpr (std::is_same_v<Node, sonar::Expression::If>) {
+                child(node.condition);
+                child(node.then);
+                child(node.else_branch);
+            } else if constexpr (std::is_same_v<Node, sonar::Expression::While>) {
+                child(node.condition);
+                child(node.body);
+            } else if constexpr (std::is_same_v<Node, sonar::Expression::For>) {
+                child(node.pattern);
+                child(node.iterable);
+                child(node.body);
+            } else if constexpr (std::is_same_v<Node, sonar::Expression::Function>) {
+                for (const auto& parameter : node.signature->parameters) {
+                    out.push_back(parameter.type.span.start);
+                }
+                out.push_back(node.signature->return_type.span.end);
+                collect_spans(node.body_expression(), out);
+            }
+        },
+        expression.node);
+}
+
+struct EditResult {
+    sonar::ExpressionPtr reparsed;
+    sonar::ExpressionPtr expected;
+};
+
+// Applies `replacement` over [start, end) and checks retokenize/reparse against a from-scratch run.
+EditResult check_edit(const std::string& source, std::size_t start, std::size_t end, const std::string& replacement,
+                      const sonar::Statement** untouched = nullptr) {
+    SCOPED_TRACE(source);
+    sonar::Lexer lexer;
+    auto old_lex = lexer.tokenize(source);
+    sonar::Parser old_parser(old_lex.tokens, old_lex.line_offsets, "<test>");
+    auto old_ast = old_parser.parse();
+    if (untouched) {
+        *untouched = std::get<sonar::Expression::Block>(old_ast->node).statements.front().get();
+    }
+
+    sonar::TextEdit edit{sonar::SourceSpan{start, end}, replacement};
+    std::string edited = source.substr(0, start) + replacement + source.substr(end);
+
+    auto fresh = lexer.tokenize(edited);
+    auto& relexed = old_lex;
+    lexer.retokenize(relexed, edited, edit);
+    EXPECT_EQ(relexed.line_offsets, fresh.line_offsets);
+    EXPECT_EQ(relexed.tokens.size(), fresh.tokens.size());
+    for (std::size_t i = 0; i < std::min(relexed.tokens.size(), fresh.tokens.size()); ++i) {
+        EXPECT_EQ(relexed.tokens[i].type, fresh.tokens[i].type) << "token " << i;
+        EXPECT_EQ(relexed.tokens[i].lexeme, fresh.tokens[i].lexeme) << "token " << i;
+        EXPECT_EQ(relexed.tokens[i].span.start, fresh.tokens[i].span.start) << "token " << i;
+        EXPECT_EQ(relexed.tokens[i].span.end, fresh.tokens[i].span.end) << "token " << i;
+    }
+
+    EditResult result;
+    result.reparsed = sonar::Parser::reparse(std::move(old_ast), relexed, edit, "<test>");
+    sonar::Parser full(std::move(fresh.tokens), std::move(fresh.line_offsets), "<test>");
+    result.expected = full.parse();
+
+    EXPECT_EQ(sonar::pretty_print(*result.reparsed), sonar::pretty_print(*result.expected));
+    std::vector<std::size_t> actual_spans;
+    std::vector<std::size_t> expected_spans;
+    collect_spans(*result.reparsed, actual_spans);
+    collect_spans(*result.expected, expected_spans);
+    EXPECT_EQ(actual_spans, expected_spans);
+    return result;
+}
+
+}  // namespace
+
+TEST(IncrementalParserTest, ReparsesEditInsideNestedBlock) {
+    const std::string source = "let a = 1;\nlet b = { let c = 2; c + 3 };\nfn f(x: number) -> number { x }\na + b";
+    const sonar::Statement* first = nullptr;
+    auto result = check_edit(source, source.find('3'), source.find('3') + 1, "30 * (c - 1)", &first);
+    const auto& block = std::get<sonar::Expression::Block>(result.reparsed->node);
+    EXPECT_EQ(block.statements.front().get(), first);
+}
+
+TEST(IncrementalParserTest, ReparsesTopLevelStatement) {
+    const std::string source = "let a = 1;\nlet b = 2;\nwhile a { a = a - 1; };\na + b";
+    const sonar::Statement* first = nullptr;
+    auto result = check_edit(source, source.find('2'), source.find('2') + 1, "2 * 4 - a", &first);
+    const auto& block = std::get<sonar::Expression::Block>(result.reparsed->node);
+    EXPECT_EQ(block.statements.front().get(), first);
+}
+
+TEST(IncrementalParserTest, ReparsesTrailingValueAndDeletions) {
+    const std::string source = "let a = 1;\nlet b = 2;\na + b";
+    check_edit(source, source.size() - 1, source.size(), "b * a");
+    check_edit(source, 4, 5, "alpha");
+    check_edit(source, source.find("+ b"), source.size(), "");
+}
+
+TEST(IncrementalParserTest, FallsBackWhenEditCrossesBoundaries) {
+    const std::string source = "let a = { 1 };\nlet b = 2;\na";
+    check_edit(source, source.find('}'), source.find('}') + 1, "+ 2 }");
+    check_edit(source, source.find(";\nlet b"), source.find("2;") + 1, " + 5");
+    check_edit(source, 0, 0, "let z = 0;\n");
+    check_edit(source, source.find("2;"), source.find("2;"), "/* comment */ r\"raw\n\" + ");
+}
+
+TEST(IncrementalParserTest, RetokenizeHandlesCommentsAndStrings) {
+    const std::string source = "let a = \"x\";\n// note\nlet b = 2;\nb";
+    check_edit(source, source.find("note"), source.find("note") + 4, "longer note");
+    check_edit(source, source.find('x'), source.find('x') + 1, "multi word");
+}
+
+TEST(IncrementalParserTest, RetokenizeLeavesTokensAsTheyWereOnLexicalError) {
+    const std::string source = "let a = 1;\nlet b = 2;\nb";
+    sonar::Lexer lexer;
+    auto lexed = lexer.tokenize(source);
+    const auto before = lexed;
+    const std::size_t at = source.find('1');
+    std::string edited = source;
+    edited.insert(at, "\"");
+    EXPECT_THROW(lexer.retokenize(lexed, edited, sonar::TextEdit{sonar::SourceSpan{at, at}, "\""}), std::runtime_error);
+    EXPECT_EQ(lexed.line_offsets, before.line_offsets);
+    ASSERT_EQ(lexed.tokens.size(), before.tokens.size());
+    for (std::size_t i = 0; i < lexed.tokens.size(); ++i) {
+        EXPECT_EQ(lexed.tokens[i].lexeme, before.tokens[i].lexeme) << "token " << i;
+        EXPECT_EQ(lexed.tokens[i].span, before.tokens[i].span) << "token " << i;
+    }
+}
+
+TEST(IncrementalParserTest, MovesLaterStatementsButNotTheirSubtrees) {
+    const std::string source = "let a = 1;\nlet b = { a + 2 };\nb";
+    sonar::Lexer lexer;
+    auto lexed = lexer.tokenize(source);
+    auto ast = sonar::Parser(lexed.tokens, lexed.line_offsets, "<test>").parse();
+    const sonar::Statement* second = std::get<sonar::Expression::Block>(ast->node).statements[1].get();
+    const sonar::SourceSpan second_span = second->span;
+    const sonar::SourceSpan initializer_span = std::get<sonar::Statement::Let>(second->node).initializer->span;
+
+    const sonar::TextEdit edit{sonar::SourceSpan{8, 9}, "100"};
+    lexer.retokenize(lexed, "let a = 100;\nlet b = { a + 2 };\nb", edit);
+    ast = sonar::Parser::reparse(std::move(ast), lexed, edit, "<test>");
+
+    ASSERT_EQ(std::get<sonar::Expression::Block>(ast->node).statements[1].get(), second);
+    EXPECT_EQ(second->span, second_span.offset_by(2));
+    EXPECT_EQ(std::get<sonar::Statement::Let>(second->node).initializer->span, initializer_span);
+}
+
+TEST(IncrementalParserTest, ReportsSameErrorAsFullParse) {
+    const std::string source = "let a = { 1 };\na";
+    sonar::Lexer lexer;
+    auto old_lex = lexer.tokenize(source);
+    sonar::Parser old_parser(old_lex.tokens, old_lex.line_offsets, "<test>");
+    auto old_ast = old_parser.parse();
+
+    sonar::TextEdit edit{sonar::SourceSpan{10, 11}, "let"};
+    std::string edited = "let a = { let };\na";
+    lexer.retokenize(old_lex, edited, edit);
+    try {
+        auto ast = sonar::Parser::reparse(std::move(old_ast), old_lex, edit, "<test>");
+        ADD_FAILURE() << "Expected parse error but parsed: " << sonar::pretty_print(*ast);
+    } catch (const sonar::ParseError& err) {
+        EXPECT_STREQ("Expected identifier after 'let'", err.what());
+        EXPECT_EQ(err.location().column, 15u);
+    }
+}
+
+TEST(IncrementalParserTest, CountsNestingFromTheReparsedBlock) {
+    // The innermost block's value is as deep as the nesting limit allows: one level for the fn body, one for
+    // the right operand of the chain however long it is, one per parenthesis, one for the innermost block and
+    // one for its value.
+    const std::size_t parentheses = sonar::kMaxNestingDepth - 4;
+    const std::string source = "let v = 1;\nfn f() -> n a + b + { " + std::string(parentheses, '(') + "{ 1 }" +
+                               std::string(parentheses, ')') + " }\nv";
+    const std::size_t one = source.find("{ 1 }") + 2;
+    check_edit(source, one, one + 1, "2");
+
+    sonar::Lexer lexer;
+    auto old_lex = lexer.tokenize(source);
+    auto old_ast = sonar::Parser(old_lex.tokens, old_lex.line_offsets, "<test>").parse();
+    const sonar::TextEdit edit{sonar::SourceSpan{one, one + 1}, "(2)"};
+    lexer.retokenize(old_lex, source.substr(0, one) + "(2)" + source.substr(one + 1), edit);
+    try {
+        auto ast = sonar::Parser::reparse(std::move(old_ast), old_lex, edit, "<test>");
+        ADD_FAILURE() << "Expected parse error but parsed: " << sonar::pretty_print(*ast);
+    } catch (const sonar::ParseError& err) {
+        EXPECT_STREQ("Expression is nested too deeply", err.what());
+        EXPECT_EQ(err.span().start, one + 1);
+    }
+}
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/pretty_printer.hpp"
+
+namespace {
+
+sonar::ExpressionPtr parse(const std::string& source, bool lazy) {
+    sonar::Lexer lexer;
+    auto lex_result = lexer.tokenize(source);
+    sonar::Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), "<test>",
+                         sonar::ParserOptions{lazy});
+    return parser.parse();
+}
+
+const sonar::Expression& first_function_expression(const sonar::Expression& root) {
+    const auto& block = std::get<sonar::Expression::Block>(root.node);
+    const auto& let = std::get<sonar::Statement::Let>(block.statements.front()->node);
+    return *let.initializer;
+}
+
+const sonar::Expression::Function& first_function(const sonar::Expression& root) {
+    return std::get<sonar::Expression::Function>(first_function_expression(root).node);
+}
+
+}  // namespace
+
+TEST(LazyParseTest, MatchesEagerOutput) {
+    const char* sources[] = {
+        "fn add(a: number, b: number) -> number { a + b }\nadd",
+        "let f = fn(x: number) -> number { let y = { x }; fn(z: number) -> number { y + z } };\nf",
+        "fn f() -> number { 1 } + { 2 }\nf",
+        "fn f() -> number 1 + 2\nf",
+        "{ fn inner(a: bool) -> bool { if a { a } else { false } } inner }",
+    };
+
+    for (const char* source : sources) {
+        SCOPED_TRACE(source);
+        EXPECT_EQ(sonar::pretty_print(*parse(source, true)), sonar::pretty_print(*parse(source, false)));
+    }
+}
+
+TEST(LazyParseTest, SkipsBodyUntilFirstAccess) {
+    auto ast = parse("fn broken() -> number { let = }\nbroken", true);
+    const auto& function = first_function(*ast);
+    ASSERT_NE(function.deferred_body, nullptr);
+    EXPECT_EQ(function.body, nullptr);
+    EXPECT_EQ(first_function_expression(*ast).span.end, 31u);
+
+    try {
+        function.body_expression();
+        ADD_FAILURE() << "Expected the deferred body to fail to parse";
+    } catch (const sonar::ParseError& err) {
+        EXPECT_STREQ("Expected identifier after 'let'", err.what());
+        EXPECT_EQ(err.location().column, 29u);
+    }
+}
+
+TEST(LazyParseTest, CountsNestingFromTheFunction) {
+    // The let initializer and the body are a level each, and every block another.
+    auto nested_body = [](std::size_t blocks) {
+        return "let f = fn() -> number " + std::string(blocks, '{') + "1" + std::string(blocks, '}') + ";\nf";
+    };
+    const std::string deepest = nested_body(sonar::kMaxNestingDepth - 2);
+    EXPECT_EQ(sonar::pretty_print(*parse(deepest, true)), sonar::pretty_print(*parse(deepest, false)));
+
+    const std::string too_deep = nested_body(sonar::kMaxNestingDepth - 1);
+    EXPECT_THROW(parse(too_deep, false), sonar::ParseError);
+    auto ast = parse(too_deep, true);
+    try {
+        first_function(*ast).body_expression();
+        ADD_FAILURE() << "Expected the deferred body to fail to parse";
+    } catch (const sonar::ParseError& err) {
+        EXPECT_STREQ("Expression is nested too deeply", err.what());
+    }
+}
+
+TEST(LazyParseTest, KeepsTrailingOperatorsEager) {
+    auto ast = parse("fn f() -> number { 1 } + 2\nf", true);
+    const auto& function = first_function(*ast);
+    EXPECT_EQ(function.deferred_body, nullptr);
+    ASSERT_NE(function.body, nullptr);
+}
+
+TEST(LazyParseTest, ForcesBodyOnceAcrossThreads) {
+    auto ast = parse("fn f(x: number) -> number { x * 2 + { x } }\nf", true);
+    const auto& function = first_function(*ast);
+
+    std::vector<const sonar::Expression*> seen(8, nullptr);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < seen.size(); ++i) {
+        threads.emplace_back([&, i]() { seen[i] = &function.body_expression(); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (const auto* body : seen) {
+        EXPECT_EQ(body, seen.front());
+    }
+    EXPECT_EQ(sonar::pretty_print(*seen.front()), "{ (+ (* x 2) { x }) }");
+}
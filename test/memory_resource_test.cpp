@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <variant>
+
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/pretty_printer.hpp"
+
+namespace {
+
+// Forwards to the default resource and tracks what is outstanding.
+class CountingResource : public std::pmr::memory_resource {
+   public:
+    std::size_t allocations{0};
+    std::size_t outstanding_bytes{0};
+
+   private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        ++allocations;
+        outstanding_bytes += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override {
+        outstanding_bytes -= bytes;
+        std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+sonar::ExpressionPtr parse(const std::string& source, std::pmr::memory_resource* resource) {
+    sonar::Lexer lexer;
+    auto lex_result = lexer.tokenize(source);
+    sonar::ParserOptions options;
+    options.memory_resource = resource;
+    sonar::Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), "<test>", options);
+    return parser.parse();
+}
+
+const std::string kSource =
+    "let a: number = 1 + 2;\nfn f(x: number) -> number { if x { x } else { -x } }\nwhile a { a = a - 1; }; \"s\"";
+
+}  // namespace
+
+TEST(MemoryResourceTest, AllocatesNodesFromTheResource) {
+    CountingResource resource;
+    auto ast = parse(kSource, &resource);
+    EXPECT_GT(resource.allocations, 20u);
+    EXPECT_GT(resource.outstanding_bytes, 0u);
+    EXPECT_EQ(sonar::pretty_print(*ast), sonar::pretty_print(*parse(kSource, nullptr)));
+
+    // Nodes go back to the resource they came from.
+    ast.reset();
+    EXPECT_EQ(resource.outstanding_bytes, 0u);
+}
+
+TEST(MemoryResourceTest, ParsesAndPrintsIntoAMonotonicBuffer) {
+    std::pmr::monotonic_buffer_resource buffer(std::size_t{1} << 16);
+    auto ast = parse(kSource, &buffer);
+    const std::pmr::string printed = sonar::pretty_print(*ast, &buffer);
+    EXPECT_EQ(printed.get_allocator().resource(), &buffer);
+    EXPECT_EQ(std::string(printed), sonar::pretty_print(*parse(kSource, nullptr)));
+}
+
+TEST(MemoryResourceTest, PrintsIntoTheGivenResource) {
+    CountingResource resource;
+    auto ast = parse(kSource, nullptr);
+    const auto printed = sonar::pretty_print(*ast, &resource);
+    EXPECT_EQ(std::string(printed), sonar::pretty_print(*ast));
+    EXPECT_GT(resource.allocations, 0u);
+}
+
+TEST(MemoryResourceTest, LexesIntoTheGivenResource) {
+    CountingResource resource;
+    const auto lexed = sonar::Lexer{}.tokenize(kSource, &resource);
+    const auto expected = sonar::Lexer{}.tokenize(kSource);
+    EXPECT_EQ(lexed.tokens.get_allocator().resource(), &resource);
+    EXPECT_GT(resource.allocations, 0u);
+    ASSERT_EQ(lexed.tokens.size(), expected.tokens.size());
+    for (std::size_t i = 0; i < lexed.tokens.size(); ++i) {
+        EXPECT_EQ(lexed.tokens[i].type, expected.tokens[i].type);
+        EXPECT_EQ(lexed.tokens[i].lexeme, expected.tokens[i].lexeme);
+        EXPECT_EQ(lexed.tokens[i].span.start, expected.tokens[i].span.start);
+    }
+    EXPECT_TRUE(std::equal(lexed.line_offsets.begin(), lexed.line_offsets.end(), expected.line_offsets.begin(),
+                           expected.line_offsets.end()));
+}
+
+TEST(MemoryResourceTest, AllocatesParameterListsFromTheResource) {
+    std::pmr::monotonic_buffer_resource buffer;
+    auto ast = parse("fn f(x: number, y: bool) -> number { x }", &buffer);
+    const auto& block = std::get<sonar::Expression::Block>(ast->node);
+    const auto& let = std::get<sonar::Statement::Let>(block.statements.front()->node);
+    const auto& function = std::get<sonar::Expression::Function>(let.initializer->node);
+    EXPECT_EQ(function.signature->parameters.get_allocator().resource(), &buffer);
+    EXPECT_EQ(function.signature->parameters.size(), 2u);
+}
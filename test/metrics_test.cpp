@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "sonar/ast_stats.hpp"
+#include "sonar/lexer.hpp"
+#include "sonar/metrics.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/pretty_printer.hpp"
+
+using namespace std::chrono_literals;
+
+TEST(MetricsTest, CounterSumsEveryThread) {
+    sonar::metrics::Counter counter;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&counter] {
+            for (int i = 0; i < 10000; ++i) {
+                counter.add();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(counter.value(), 80000u);
+}
+
+TEST(MetricsTest, CounterBatchHandsOverItsTotalOnce) {
+    sonar::metrics::Counter counter;
+    {
+        sonar::metrics::CounterBatch batch(counter);
+        batch.add(3);
+        batch.add();
+        EXPECT_EQ(counter.value(), 0u);
+        sonar::metrics::CounterBatch moved(std::move(batch));
+        moved.flush();
+        EXPECT_EQ(counter.value(), 4u);
+        moved.add(2);
+    }
+    EXPECT_EQ(counter.value(), 6u);
+}
+
+TEST(MetricsTest, HistogramBucketsAreCumulativeAndInclusive) {
+    sonar::metrics::LatencyHistogram histogram({1ms, 10ms});
+    histogram.observe(500us);
+    histogram.observe(1ms);
+    histogram.observe(5ms);
+    histogram.observe(1s);
+    const auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.cumulative, (std::vector<std::uint64_t>{2, 3, 4}));
+    EXPECT_EQ(snapshot.count(), 4u);
+    EXPECT_EQ(snapshot.sum, 1006500us);
+
+    EXPECT_THROW(sonar::metrics::LatencyHistogram(std::vector<std::chrono::nanoseconds>{}), std::invalid_argument);
+    EXPECT_THROW(sonar::metrics::LatencyHistogram({2ms, 2ms}), std::invalid_argument);
+}
+
+TEST(MetricsTest, RegistryReturnsOneMetricPerNameAndLabels) {
+    sonar::metrics::Registry registry;
+    auto& lex = registry.counter("errors_total", "Errors.", {{"kind", "lex"}});
+    EXPECT_EQ(&lex, &registry.counter("errors_total", "Errors.", {{"kind", "lex"}}));
+    EXPECT_NE(&lex, &registry.counter("errors_total", "Errors.", {{"kind", "syntax"}}));
+
+    EXPECT_THROW(registry.latency_histogram("errors_total", "Errors."), std::invalid_argument);
+    EXPECT_THROW(registry.counter("2xx", "Bad name."), std::invalid_argument);
+    EXPECT_THROW(registry.counter("ok_total", "Bad label.", {{"le", "1"}}), std::invalid_argument);
+}
+
+TEST(MetricsTest, WritesPrometheusText) {
+    sonar::metrics::Registry registry;
+    registry.counter("requests_total", "Requests\nserved.", {{"path", "a\"b"}}).add(7);
+    registry.latency_histogram("latency_seconds", "Latency.", {}, {1ms, 250ms}).observe(2ms);
+    std::ostringstream out;
+    registry.write_prometheus(out);
+    EXPECT_EQ(out.str(),
+              "# HELP latency_seconds Latency.\n"
+              "# TYPE latency_seconds histogram\n"
+              "latency_seconds_bucket{le=\"0.001\"} 0\n"
+              "latency_seconds_bucket{le=\"0.25\"} 1\n"
+              "latency_seconds_bucket{le=\"+Inf\"} 1\n"
+              "latency_seconds_sum 0.002\n"
+              "latency_seconds_count 1\n"
+              "# HELP requests_total Requests\\nserved.\n"
+              "# TYPE requests_total counter\n"
+              "requests_total{path=\"a\\\"b\"} 7\n");
+}
+
+TEST(MetricsTest, FrontendReportsLexingParsingAndPrinting) {
+    const auto& metrics = sonar::metrics::frontend();
+    const auto tokens = metrics.lexed_tokens.value();
+    const auto nodes = metrics.ast_nodes.value();
+    const auto parses = metrics.parse_latency.snapshot().count();
+    const auto printed = metrics.printed_bytes.value();
+
+    sonar::Lexer lexer;
+    auto lex_result = lexer.tokenize("let x = 1 + 2; x * 3");
+    const auto token_count = lex_result.tokens.size();
+    sonar::ExpressionPtr ast;
+    {
+        sonar::Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), "<test>");
+        ast = parser.parse();
+    }
+    const std::string text = sonar::pretty_print(*ast);
+
+    EXPECT_EQ(metrics.lexed_tokens.value() - tokens, token_count);
+    EXPECT_EQ(metrics.ast_nodes.value() - nodes, sonar::collect_ast_stats(*ast).nodes());
+    EXPECT_EQ(metrics.parse_latency.snapshot().count() - parses, 1u);
+    EXPECT_EQ(metrics.printed_bytes.value() - printed, text.size());
+
+    const auto lex_errors = metrics.lex_errors.value();
+    const auto syntax_errors = metrics.syntax_errors.value();
+    const auto incomplete_errors = metrics.incomplete_errors.value();
+    EXPECT_THROW(lexer.tokenize("\"unterminated"), std::runtime_error);
+    for (const char* source : {"let = 1;", "1 +"}) {
+        auto lexed = lexer.tokenize(source);
+        sonar::Parser parser(std::move(lexed.tokens), std::move(lexed.line_offsets), "<test>");
+        EXPECT_THROW(parser.parse(), sonar::ParseError);
+    }
+    EXPECT_EQ(metrics.lex_errors.value() - lex_errors, 1u);
+    EXPECT_EQ(metrics.syntax_errors.value() - syntax_errors, 1u);
+    EXPECT_EQ(metrics.incomplete_errors.value() - incomplete_errors, 1u);
+}
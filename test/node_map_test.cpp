@@ -0,0 +1,236 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "sonar/lexer.hpp"
+#include "sonar/node_map.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/thread_pool.hpp"
+#include "sonar/visitor.hpp"
+
+namespace {
+
+sonar::ExpressionPtr parse(const std::string& source, sonar::ParserOptions options = {}) {
+    sonar::Lexer lexer;
+    auto lex_result = lexer.tokenize(source);
+    sonar::Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), "<test>", options);
+    return parser.parse();
+}
+
+// Every node's id in preorder. In a fresh parse each parent's id is above its children's.
+class IdCollector : public sonar::AstWalker<IdCollector> {
+   public:
+    explicit IdCollector(bool parse_order) : parse_order_(parse_order) {}
+
+    std::vector<sonar::NodeId> ids;
+
+    template <typename Wrapper, typename Node>
+    void enter(const Wrapper& wrapper, const Node&) {
+        ids.push_back(sonar::node_id(wrapper));
+        if (parse_order_ && !parents_.empty()) {
+            EXPECT_LT(ids.back(), parents_.back());
+        }
+        parents_.push_back(ids.back());
+    }
+
+    template <typename Wrapper, typename Node>
+    void leave(const Wrapper&, const Node&) {
+        parents_.pop_back();
+    }
+
+   private:
+    bool parse_order_;
+    std::vector<sonar::NodeId> parents_;
+};
+
+std::vector<sonar::NodeId> ids_of(const sonar::Expression& root, bool parse_order = true) {
+    IdCollector collector(parse_order);
+    collector.walk(root);
+    return collector.ids;
+}
+
+template <typename Visit>
+class ExpressionVisitor : public sonar::AstWalker<ExpressionVisitor<Visit>> {
+   public:
+    explicit ExpressionVisitor(Visit& visit) : visit_(visit) {}
+
+    template <typename Node>
+    void enter(const sonar::Expression& expression, const Node&) {
+        visit_(expression);
+    }
+
+   private:
+    Visit& visit_;
+};
+
+// Calls `visit` on every Expression under `root`, parsing deferred bodies.
+template <typename Root, typename Visit>
+void for_each_expression(const Root& root, Visit visit) {
+    ExpressionVisitor<Visit>(visit).walk(root);
+}
+
+// Every id from zero to the bound is used once. Parses deferred bodies.
+void expect_dense_ids(const sonar::Expression& root) {
+    auto ids = ids_of(root, false);
+    std::sort(ids.begin(), ids.end());
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        ASSERT_EQ(ids[i], i);
+    }
+    EXPECT_EQ(sonar::node_id_bound(root), ids.size());
+}
+
+sonar::ExpressionPtr reparse(sonar::ExpressionPtr ast, const std::string& source, sonar::SourceSpan range,
+                             const std::string& replacement) {
+    const sonar::TextEdit edit{range, replacement};
+    const std::string edited = source.substr(0, range.start) + replacement + source.substr(range.end);
+    sonar::Lexer lexer;
+    auto lexed = lexer.tokenize(source);
+    lexer.retokenize(lexed, edited, edit);
+    return sonar::Parser::reparse(std::move(ast), lexed, edit, "<test>");
+}
+
+const std::string kSource =
+    "let a: number = 1 + 2 * b;\n"
+    "fn f(x: number, y: bool) -> number { if y { x } else { -x } }\n"
+    "while a { a = a - 1; };\n"
+    "for i in items { let t = (i); t };\n"
+    "{ let inner = { 1 }; inner }";
+
+}  // namespace
+
+TEST(NodeMapTest, IdsAreDenseInParseOrder) {
+    auto ast = parse(kSource);
+    const auto ids = ids_of(*ast);
+
+    auto sorted = ids;
+    std::sort(sorted.begin(), sorted.end());
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        ASSERT_EQ(sorted[i], i);
+    }
+    EXPECT_EQ(sonar::node_id_bound(*ast), ids.size());
+
+    // Renumbering in postorder reproduces the parser's numbering.
+    EXPECT_EQ(sonar::number_nodes(*ast), ids.size());
+    EXPECT_EQ(ids_of(*ast), ids);
+}
+
+TEST(NodeMapTest, DeferredBodiesTakeTheNextIdsWhenParsed) {
+    const std::string source = kSource + ";\nfn g() -> number { let z = 2; z * 3 }\nfn h() -> number { 4 }\ng";
+    auto ast = parse(source, sonar::ParserOptions{true});
+
+    // Reading the bodies, here last to first, extends the ids without leaving gaps.
+    const sonar::NodeId bound = sonar::node_id_bound(*ast);
+    const auto& statements = std::get<sonar::Expression::Block>(ast->node).statements;
+    for (auto it = statements.rbegin(); it != statements.rend(); ++it) {
+        for_each_expression(**it, [](const sonar::Expression&) {});
+    }
+    EXPECT_GT(sonar::node_id_bound(*ast), bound);
+    expect_dense_ids(*ast);
+
+    // Bodies already read keep their ids.
+    const auto before = ids_of(*ast, false);
+    for_each_expression(*ast, [](const sonar::Expression&) {});
+    EXPECT_EQ(ids_of(*ast, false), before);
+}
+
+TEST(NodeMapTest, ParallelParsesNumberLikeSequentialOnes) {
+    std::string program;
+    for (int i = 0; i < 40; ++i) {
+        program += kSource + ";\n";
+    }
+    sonar::ThreadPool pool(4);
+    sonar::Lexer lexer;
+    auto lexed = lexer.tokenize(program);
+    auto parallel = sonar::Parser(lexed.tokens, lexed.line_offsets, "<test>").parse_parallel(pool);
+    auto sequential = sonar::Parser(lexed.tokens, lexed.line_offsets, "<test>").parse();
+    EXPECT_EQ(ids_of(*parallel), ids_of(*sequential));
+    EXPECT_EQ(sonar::node_id_bound(*parallel), sonar::node_id_bound(*sequential));
+    expect_dense_ids(*parallel);
+}
+
+TEST(NodeMapTest, ReparseKeepsIdsOfNodesItMovesOver) {
+    const std::string source = "let a = 1;\nlet b = { let c = 3; c };\na + b";
+    const std::size_t at = source.find('3');
+
+    auto ast = parse(source);
+    std::map<const void*, sonar::NodeId> before;
+    for_each_expression(*ast, [&](const sonar::Expression& expression) { before[&expression] = sonar::node_id(expression); });
+
+    auto reparsed = reparse(std::move(ast), source, sonar::SourceSpan{at, at + 1}, "30 * (c - 1)");
+    std::size_t kept = 0;
+    for_each_expression(*reparsed, [&](const sonar::Expression& expression) {
+        auto it = before.find(&expression);
+        if (it != before.end()) {
+            EXPECT_EQ(sonar::node_id(expression), it->second);
+            ++kept;
+        }
+    });
+    EXPECT_GT(kept, 0u);
+    expect_dense_ids(*reparsed);
+}
+
+TEST(NodeMapTest, ReparseKeepsIdsDenseAcrossEdits) {
+    // Growing and shrinking the same statement many times neither leaves gaps nor grows the bound.
+    std::string source = "let a = 1;\nlet b = { let c = 3; c };\na + b";
+    auto ast = parse(source);
+    const sonar::NodeId bound = sonar::node_id_bound(*ast);
+    for (int round = 0; round < 20; ++round) {
+        const std::size_t at = source.find('3');
+        const bool grow = round % 2 == 0;
+        const std::string replacement = grow ? "3 * (c - 1) + -c" : "3";
+        const std::size_t length = grow ? 1 : std::string("3 * (c - 1) + -c").size();
+        ast = reparse(std::move(ast), source, sonar::SourceSpan{at, at + length}, replacement);
+        source = source.substr(0, at) + replacement + source.substr(at + length);
+        expect_dense_ids(*ast);
+    }
+    EXPECT_EQ(sonar::node_id_bound(*ast), bound);
+
+    // Removing a whole statement moves the nodes with the highest ids into the ones freed.
+    const std::size_t at = source.find("a + b");
+    ast = reparse(std::move(ast), source, sonar::SourceSpan{at, at + 5}, "a");
+    expect_dense_ids(*ast);
+    EXPECT_EQ(sonar::node_id_bound(*ast), bound - 2);
+}
+
+TEST(NodeMapTest, AttachesDataByNode) {
+    auto ast = parse(kSource);
+    sonar::NodeMap<int> depth(*ast);
+    EXPECT_EQ(depth.size(), sonar::node_id_bound(*ast));
+
+    std::size_t variables = 0;
+    for_each_expression(*ast, [&](const sonar::Expression& expression) {
+        if (std::holds_alternative<sonar::Expression::Variable>(expression.node)) {
+            depth[expression] = 1;
+            ++variables;
+        }
+    });
+    std::size_t marked = 0;
+    for_each_expression(*ast, [&](const sonar::Expression& expression) {
+        const int* value = depth.find(expression);
+        ASSERT_NE(value, nullptr);
+        marked += static_cast<std::size_t>(*value);
+    });
+    EXPECT_EQ(marked, variables);
+
+    sonar::NodeMap<std::string> names;
+    names[*ast] = "root";
+    EXPECT_EQ(names.size(), sonar::node_id(*ast) + 1u);
+    EXPECT_EQ(*names.find(*ast), "root");
+
+    // A tree built by hand is unnumbered until number_nodes is called.
+    auto owned = std::make_unique<sonar::Expression>(sonar::Expression::Grouping{nullptr}, sonar::SourceSpan{});
+    std::get<sonar::Expression::Grouping>(owned->node).expression = parse("2");
+    EXPECT_EQ(sonar::node_id(*owned), sonar::kNoNodeId);
+    EXPECT_EQ(names.find(*owned), nullptr);
+    EXPECT_THROW(names[*owned], std::invalid_argument);
+    EXPECT_EQ(sonar::number_nodes(*owned), 2u);
+    EXPECT_EQ(sonar::node_id(*owned), 1u);
+    EXPECT_EQ(sonar::node_id(*std::get<sonar::Expression::Grouping>(owned->node).expression), 0u);
+}
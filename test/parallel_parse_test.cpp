@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/pretty_printer.hpp"
+#include "sonar/thread_pool.hpp"
+
+namespace {
+
+std::string parse_with(const std::string& source, sonar::ThreadPool* pool) {
+    sonar::Lexer lexer;
+    auto lex_result = lexer.tokenize(source);
+    sonar::Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), "<test>");
+    try {
+        auto ast = pool ? parser.parse_parallel(*pool) : parser.parse();
+        return sonar::pretty_print(*ast);
+    } catch (const sonar::ParseError& err) {
+        const auto location = err.location();
+        return "error " + std::to_string(location.line) + ":" + std::to_string(location.column) + " " + err.what();
+    }
+}
+
+std::string make_program(std::size_t items) {
+    std::string source;
+    for (std::size_t i = 0; i < items; ++i) {
+        const std::string n = std::to_string(i);
+        source += "let v" + n + " = (" + n + " + 1) * { let t = " + n + "; t };\n";
+        source += "fn f" + n + "(a: number) -> number { if a { a - " + n + " } else { 0 } }\n";
+        source += "while v" + n + " { v" + n + " = v" + n + " - 1; };\n";
+    }
+    return source;
+}
+
+void expect_same(const std::string& source, sonar::ThreadPool& pool) {
+    SCOPED_TRACE(source.substr(0, 80));
+    EXPECT_EQ(parse_with(source, &pool), parse_with(source, nullptr));
+}
+
+}  // namespace
+
+TEST(ParallelParseTest, MatchesSequentialParse) {
+    sonar::ThreadPool pool(4);
+    expect_same(make_program(50), pool);
+    expect_same(make_program(50) + "v1 + v2", pool);
+    expect_same(make_program(3) + "fn g() -> number 1 + 2\nlet x = fn() -> number { 1 } + 2;;\nx", pool);
+    expect_same("", pool);
+    expect_same("1 + 2", pool);
+}
+
+TEST(ParallelParseTest, ReportsFirstSequentialError) {
+    sonar::ThreadPool pool(4);
+    std::string source = make_program(20);
+    const std::string broken = make_program(20).insert(source.size() / 2, "let ;");
+    expect_same(broken, pool);
+    expect_same(source + "let = 2;\n" + source + "let ;", pool);
+    expect_same(source + "fn late() -> number { 1 };\n" + source, pool);
+    expect_same(source + "1 2;\n" + source, pool);
+    expect_same(source + "}\n" + source, pool);
+}
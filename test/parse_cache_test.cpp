@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sonar/parse_cache.hpp"
+#include "sonar/pretty_printer.hpp"
+
+TEST(ParseCacheTest, ReturnsSharedTreeOnHit) {
+    sonar::ParseCache cache;
+    auto first = cache.parse("let a = 1;\na + 2", "<a>");
+    auto second = cache.parse("let a = 1;\na + 2", "<b>");
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(sonar::pretty_print(*first), "{ (let a = 1) (+ a 2) }");
+
+    auto other = cache.parse("let a = 1;\na + 3", "<a>");
+    EXPECT_NE(other, first);
+
+    const auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.entries, 2u);
+}
+
+TEST(ParseCacheTest, KeysOnParserOptions) {
+    sonar::ParseCache cache;
+    auto eager = cache.parse("fn f() -> number { 1 }\nf", "<a>");
+    auto lazy = cache.parse("fn f() -> number { 1 }\nf", "<a>", sonar::ParserOptions{true});
+    EXPECT_NE(eager, lazy);
+}
+
+TEST(ParseCacheTest, CachesErrorsPerSourceName) {
+    sonar::ParseCache cache;
+    auto message = [&](const std::string& name) {
+        try {
+            cache.parse("let = 1;", name);
+        } catch (const sonar::ParseError& err) {
+            return err.source_name() + ": " + err.what();
+        }
+        return std::string("no error");
+    };
+
+    EXPECT_EQ(message("<a>"), "<a>: Expected identifier after 'let'");
+    EXPECT_EQ(message("<a>"), "<a>: Expected identifier after 'let'");
+    EXPECT_EQ(message("<b>"), "<b>: Expected identifier after 'let'");
+
+    const auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+}
+
+TEST(ParseCacheTest, EvictsLeastRecentlyUsedWithinBudget) {
+    sonar::ParseCache probe;
+    probe.parse("1 + 2 + 3", "<a>");
+    const std::size_t entry_bytes = probe.stats().bytes;
+
+    sonar::ParseCache cache(entry_bytes * 2);
+    auto a = cache.parse("1 + 2 + 3", "<a>");
+    auto b = cache.parse("4 + 5 + 6", "<b>");
+    EXPECT_EQ(cache.parse("1 + 2 + 3", "<a>"), a);
+
+    cache.parse("7 + 8 + 9", "<c>");
+    const auto stats = cache.stats();
+    EXPECT_EQ(stats.entries, 2u);
+    EXPECT_LE(stats.bytes, entry_bytes * 2);
+    EXPECT_EQ(cache.parse("1 + 2 + 3", "<a>"), a);
+    EXPECT_NE(cache.parse("4 + 5 + 6", "<b>"), b);
+}
+
+TEST(ParseCacheTest, SharesAcrossThreads) {
+    sonar::ParseCache cache;
+    const std::string source = "let x = { 1 + 2 };\nx * x";
+    auto expected = cache.parse(source, "<main>");
+
+    std::vector<std::thread> threads;
+    std::vector<char> same(8, 0);
+    for (std::size_t i = 0; i < same.size(); ++i) {
+        threads.emplace_back([&, i]() { same[i] = cache.parse(source, "<worker>") == expected; });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (char value : same) {
+        EXPECT_TRUE(value);
+    }
+}
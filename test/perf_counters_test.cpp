@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "sonar/perf_counters.hpp"
+
+TEST(PerfCountersTest, CountsWorkOrSaysWhyNot) {
+    sonar::PerfCounters counters;
+    volatile std::uint64_t sum = 0;
+    const auto reading = counters.measure([&] {
+        for (std::uint64_t i = 0; i < 1000000; ++i) {
+            sum = sum + i;
+        }
+    });
+
+    if (!counters.any_available()) {
+        EXPECT_FALSE(counters.unavailable_reason().empty());
+    }
+    for (std::size_t i = 0; i < sonar::kPerfEventCount; ++i) {
+        const auto event = static_cast<sonar::PerfEvent>(i);
+        if (!counters.available(event)) {
+            EXPECT_FALSE(reading[event].has_value()) << sonar::to_string(event);
+        }
+    }
+    if (const auto instructions = reading[sonar::PerfEvent::Instructions]) {
+        EXPECT_GT(*instructions, 1000000u);
+    }
+}
+
+TEST(PerfCountersTest, DerivesRatesFromAvailableCounts) {
+    sonar::PerfReading reading;
+    EXPECT_FALSE(reading.ipc().has_value());
+    EXPECT_FALSE(reading.per(sonar::PerfEvent::BranchMisses, 10).has_value());
+
+    reading.counts[static_cast<std::size_t>(sonar::PerfEvent::Cycles)] = 200;
+    reading.counts[static_cast<std::size_t>(sonar::PerfEvent::Instructions)] = 500;
+    reading.counts[static_cast<std::size_t>(sonar::PerfEvent::BranchMisses)] = 5;
+    EXPECT_DOUBLE_EQ(*reading.ipc(), 2.5);
+    EXPECT_DOUBLE_EQ(*reading.per(sonar::PerfEvent::BranchMisses, 10), 0.5);
+    EXPECT_FALSE(reading.per(sonar::PerfEvent::BranchMisses, 0).has_value());
+    EXPECT_FALSE(reading.per(sonar::PerfEvent::LlcMisses, 10).has_value());
+
+    sonar::PerfReading more;
+    more.counts[static_cast<std::size_t>(sonar::PerfEvent::Cycles)] = 100;
+    more.counts[static_cast<std::size_t>(sonar::PerfEvent::LlcMisses)] = 7;
+    reading += more;
+    EXPECT_EQ(reading[sonar::PerfEvent::Cycles], 300u);
+    EXPECT_EQ(reading[sonar::PerfEvent::Instructions], 500u);
+    EXPECT_EQ(reading[sonar::PerfEvent::LlcMisses], 7u);
+    EXPECT_FALSE(reading[sonar::PerfEvent::L1dMisses].has_value());
+}
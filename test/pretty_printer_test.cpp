@@ -101,3 +101,35 @@ TEST(ParserTypeAnnotationTest, ReportsMissingTypeName) {
 TEST(ParserTypeAnnotationTest, ReportsMissingEqualsAfterAnnotation) {
     expect_parse_error("let value: number 1;", "Expected '=' after identifier (or type annotation)");
 }
+
+TEST(ParserNestingTest, RejectsNestingBeyondTheLimit) {
+    const std::size_t limit = sonar::kMaxNestingDepth;
+    const std::string deepest = std::string(limit - 1, '-') + "1";
+    std::string printed;
+    for (std::size_t i = 1; i < limit; ++i) {
+        printed += "(- ";
+    }
+    printed += "1" + std::string(limit - 1, ')');
+    expect_golden({deepest.c_str(), printed.c_str()});
+    expect_parse_error(std::string(limit, '-') + "1", "Expression is nested too deeply");
+    expect_parse_error(std::string(limit, '(') + "1" + std::string(limit, ')'), "Expression is nested too deeply");
+    expect_parse_error(std::string(limit, '{') + "1", "Expression is nested too deeply");
+}
+
+TEST(ParserNestingTest, AcceptsOperatorChainsOfAnyLength) {
+    // The tree nests a chain's left operands, far deeper than the stack could recurse; parsing, printing and
+    // destroying it must all loop instead.
+    const std::size_t operators = 200000;
+    std::string chain = "1";
+    std::string printed;
+    for (std::size_t i = 0; i < operators; ++i) {
+        chain += i % 2 == 0 ? "+2" : "-2";
+        printed += (operators - 1 - i) % 2 == 0 ? "(+ " : "(- ";
+    }
+    printed += "1";
+    for (std::size_t i = 0; i < operators; ++i) {
+        printed += " 2)";
+    }
+    EXPECT_TRUE(parse_and_print(chain) == printed);
+    EXPECT_EQ(parse_and_print("1 + 2 * (3 - 4) - 5"), "(- (+ 1 (* 2 (group (- 3 4)))) 5)");
+}
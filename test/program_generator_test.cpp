@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/program_generator.hpp"
+#include "sonar/visitor.hpp"
+
+namespace {
+
+sonar::ExpressionPtr parse(const std::string& source) {
+    auto lexed = sonar::Lexer{}.tokenize(source);
+    return sonar::Parser(std::move(lexed.tokens), std::move(lexed.line_offsets), "<test>").parse();
+}
+
+// The kinds of node a tree holds, by name.
+class ConstructCollector : public sonar::AstWalker<ConstructCollector> {
+   public:
+    template <typename Node>
+    void enter(const sonar::Expression&, const Node& node) {
+        using E = sonar::Expression;
+        if constexpr (std::is_same_v<Node, E::Number>) {
+            kinds.insert("number");
+        } else if constexpr (std::is_same_v<Node, E::Boolean>) {
+            kinds.insert("boolean");
+        } else if constexpr (std::is_same_v<Node, E::String>) {
+            kinds.insert("string");
+        } else if constexpr (std::is_same_v<Node, E::Prefix>) {
+            kinds.insert("prefix");
+        } else if constexpr (std::is_same_v<Node, E::Infix>) {
+            kinds.insert("infix " + std::to_string(static_cast<int>(node.op)));
+        } else if constexpr (std::is_same_v<Node, E::Grouping>) {
+            kinds.insert("grouping");
+        } else if constexpr (std::is_same_v<Node, E::Unit>) {
+            kinds.insert("unit");
+        } else if constexpr (std::is_same_v<Node, E::Assign>) {
+            kinds.insert("assign");
+        } else if constexpr (std::is_same_v<Node, E::Variable>) {
+            kinds.insert("variable");
+        } else if constexpr (std::is_same_v<Node, E::Block>) {
+            kinds.insert(node.value ? "block with value" : "block");
+        } else if constexpr (std::is_same_v<Node, E::If>) {
+            kinds.insert(node.else_branch ? "if else" : "if");
+        } else if constexpr (std::is_same_v<Node, E::While>) {
+            kinds.insert("while");
+        } else if constexpr (std::is_same_v<Node, E::For>) {
+            kinds.insert("for");
+        } else if constexpr (std::is_same_v<Node, E::Function>) {
+            kinds.insert(node.signature->parameters.empty() ? "function" : "function with parameters");
+        }
+    }
+
+    void enter(const sonar::Statement&, const sonar::Statement::Let& let) {
+        if (std::holds_alternative<sonar::Expression::Function>(let.initializer->node)) {
+            kinds.insert("fn item or let of a function");
+        }
+        kinds.insert(let.annotation ? "let with annotation" : "let");
+    }
+
+    void enter(const sonar::Statement&, const sonar::Statement::Expression&) { kinds.insert("expression statement"); }
+
+    std::set<std::string> kinds;
+};
+
+}  // namespace
+
+TEST(ProgramGeneratorTest, IsDeterministicForASeed) {
+    sonar::GeneratorOptions options;
+    options.seed = 42;
+    options.target_bytes = 16 * 1024;
+    const std::string program = sonar::generate_program(options);
+    EXPECT_EQ(sonar::generate_program(options), program);
+
+    std::string streamed;
+    std::size_t chunks = 0;
+    options.target_bytes = 256 * 1024;
+    sonar::generate_program(options, [&](std::string_view chunk) {
+        streamed.append(chunk);
+        ++chunks;
+    });
+    EXPECT_GT(chunks, 1u);
+    EXPECT_EQ(streamed.substr(0, program.size()), program);
+
+    options.seed = 43;
+    options.target_bytes = 16 * 1024;
+    EXPECT_NE(sonar::generate_program(options), program);
+}
+
+// Pins the output, which the header promises is the same everywhere; update it when the generator changes
+// on purpose.
+TEST(ProgramGeneratorTest, OutputIsStable) {
+    sonar::GeneratorOptions options;
+    options.target_bytes = 1;
+    options.depth = 2;
+    options.width = 2;
+    EXPECT_EQ(sonar::generate_program(options),
+              "if 870.22 {\n"
+              "    data43 - \"step key key b key\";\n"
+              "    count && 168.91\n"
+              "} else {\n"
+              "    let key18: list = acc93 = total82;\n"
+              "    fn acc79(acc: bool, limit80: number) -> string {}\n"
+              "};\n");
+}
+
+TEST(ProgramGeneratorTest, ProgramsParseAndReachTheirSize) {
+    const std::pair<std::size_t, std::size_t> shapes[] = {{5, 6}, {0, 1}, {2, 20}, {40, 2}, {300, 2}};
+    for (const auto& [depth, width] : shapes) {
+        for (std::uint64_t seed = 1; seed <= 20; ++seed) {
+            sonar::GeneratorOptions options;
+            options.seed = seed;
+            options.depth = depth;
+            options.width = width;
+            options.target_bytes = 4096;
+            const std::string program = sonar::generate_program(options);
+            EXPECT_GE(program.size(), options.target_bytes);
+            EXPECT_NO_THROW(parse(program)) << "depth " << depth << " width " << width << " seed " << seed;
+        }
+    }
+}
+
+TEST(ProgramGeneratorTest, UsesEveryConstruct) {
+    sonar::GeneratorOptions options;
+    options.target_bytes = 32 * 1024;
+    const std::string program = sonar::generate_program(options);
+    ConstructCollector collector;
+    collector.walk(*parse(program));
+
+    const std::set<std::string> expected = {
+        "number", "boolean", "string", "prefix", "grouping", "unit", "assign", "variable", "block",
+        "block with value", "if", "if else", "while", "for", "function", "function with parameters",
+        "fn item or let of a function", "let", "let with annotation", "expression statement",
+        "infix " + std::to_string(static_cast<int>(sonar::TokenType::Plus)),
+        "infix " + std::to_string(static_cast<int>(sonar::TokenType::Minus)),
+        "infix " + std::to_string(static_cast<int>(sonar::TokenType::Star)),
+        "infix " + std::to_string(static_cast<int>(sonar::TokenType::Slash)),
+        "infix " + std::to_string(static_cast<int>(sonar::TokenType::AndAnd)),
+        "infix " + std::to_string(static_cast<int>(sonar::TokenType::OrOr)),
+        "infix " + std::to_string(static_cast<int>(sonar::TokenType::Ampersand)),
+        "infix " + std::to_string(static_cast<int>(sonar::TokenType::Pipe)),
+    };
+    for (const auto& kind : expected) {
+        EXPECT_TRUE(collector.kinds.contains(kind)) << kind;
+    }
+    EXPECT_NE(program.find("r#\""), std::string::npos);
+    EXPECT_NE(program.find("//"), std::string::npos);
+    EXPECT_NE(program.find("/*"), std::string::npos);
+    EXPECT_NE(program.find("\\n"), std::string::npos);
+}
+
+TEST(ProgramGeneratorTest, LeavesOutOperatorsWithoutWeight) {
+    sonar::GeneratorOptions options;
+    options.target_bytes = 16 * 1024;
+    options.operators = sonar::OperatorMix{1, 0, 0, 0, 0};
+    options.string_ratio = 0;
+    options.raw_string_ratio = 0;
+    options.comment_ratio = 0;
+    ConstructCollector collector;
+    collector.walk(*parse(sonar::generate_program(options)));
+
+    EXPECT_TRUE(collector.kinds.contains("infix " + std::to_string(static_cast<int>(sonar::TokenType::Plus))));
+    EXPECT_FALSE(collector.kinds.contains("infix " + std::to_string(static_cast<int>(sonar::TokenType::AndAnd))));
+    EXPECT_FALSE(collector.kinds.contains("infix " + std::to_string(static_cast<int>(sonar::TokenType::Pipe))));
+    EXPECT_FALSE(collector.kinds.contains("prefix"));
+    EXPECT_FALSE(collector.kinds.contains("assign"));
+    EXPECT_FALSE(collector.kinds.contains("string"));
+}
+
+TEST(ProgramGeneratorTest, RejectsOptionsThatCouldNotParse) {
+    sonar::GeneratorOptions options;
+    options.depth = 400;
+    options.width = 2;
+    EXPECT_THROW(sonar::generate_program(options), std::invalid_argument);
+    options.depth = 3;
+    options.width = 0;
+    EXPECT_THROW(sonar::generate_program(options), std::invalid_argument);
+    options.width = 3;
+    options.comment_ratio = 1.5;
+    EXPECT_THROW(sonar::generate_program(options), std::invalid_argument);
+}
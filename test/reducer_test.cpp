@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/reducer.hpp"
+
+namespace {
+
+bool parses(std::string_view source) {
+    try {
+        auto lexed = sonar::Lexer{}.tokenize(source);
+        sonar::Parser(std::move(lexed.tokens), std::move(lexed.line_offsets), "<test>").parse();
+        return true;
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+}
+
+}  // namespace
+
+TEST(ReducerTest, ShrinksToTheStatementThatMatters) {
+    const std::string source =
+        "let secret = \"password\";\n"
+        "fn helper(a: number) -> number { a * 2 }\n"
+        "let total = { let t = secret; (t + 1) * 42 };\n"
+        "while ready { count = count - 1; };\n"
+        "for item in items { item }\n";
+    // Interesting: still parses and still contains a while loop.
+    auto interesting = [](std::string_view candidate) {
+        return candidate.find("while") != std::string_view::npos && parses(candidate);
+    };
+
+    sonar::ReduceStats stats;
+    const std::string reduced = sonar::reduce(source, interesting, &stats);
+    EXPECT_EQ(reduced, "while x{}");
+    EXPECT_GT(stats.reductions, 0u);
+    EXPECT_GT(stats.attempts, stats.reductions);
+}
+
+TEST(ReducerTest, RemovesNamesAndLiteralsOfTheOriginal) {
+    auto interesting = [](std::string_view candidate) {
+        return candidate.find('*') != std::string_view::npos && parses(candidate);
+    };
+    EXPECT_EQ(sonar::reduce("let secret = 1234 * \"token\";", interesting), "0*\"\"");
+}
+
+TEST(ReducerTest, ReducesInputThatDoesNotParse) {
+    auto interesting = [](std::string_view candidate) {
+        return candidate.find("$") != std::string_view::npos;
+    };
+    EXPECT_EQ(sonar::reduce("let a = 1;\nlet b = $;\nlet c = 3;\n", interesting), "$");
+
+    auto unparseable = [](std::string_view candidate) {
+        return candidate.find("let") != std::string_view::npos && !parses(candidate);
+    };
+    EXPECT_EQ(sonar::reduce("let a = 1; let b = ; let c = 3;", unparseable), "let ");
+}
+
+TEST(ReducerTest, RejectsUninterestingInput) {
+    EXPECT_THROW(sonar::reduce("1 + 2", [](std::string_view) { return false; }), std::invalid_argument);
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/span_index.hpp"
+#include "sonar/visitor.hpp"
+
+namespace {
+
+sonar::ExpressionPtr parse(const std::string& source, sonar::ParserOptions options = {}) {
+    sonar::Lexer lexer;
+    auto lex_result = lexer.tokenize(source);
+    sonar::Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), "<test>", options);
+    return parser.parse();
+}
+
+struct Node {
+    sonar::SourceSpan span;
+    const void* address;
+    std::size_t depth;
+};
+
+// Every node with its depth, in preorder, for brute-force answers.
+class Flattener : public sonar::AstWalker<Flattener> {
+   public:
+    std::vector<Node> nodes;
+
+    template <typename Wrapper, typename Alternative>
+    void enter(const Wrapper& wrapper, const Alternative&) {
+        nodes.push_back(Node{wrapper.span.offset_by(parent_start()), &wrapper, depth_++});
+    }
+
+    template <typename Wrapper, typename Alternative>
+    void leave(const Wrapper&, const Alternative&) {
+        --depth_;
+    }
+
+   private:
+    std::size_t depth_{0};
+};
+
+const void* address_of(const sonar::SpanIndex::Entry* entry) {
+    if (entry == nullptr) {
+        return nullptr;
+    }
+    return entry->expression ? static_cast<const void*>(entry->expression) : static_cast<const void*>(entry->statement);
+}
+
+const std::string kSource =
+    "let a: number = 1 + 2 * b;\n"
+    "fn f(x: number, y: bool) -> number { if y { x } else { -x } }\n"
+    "while a { a = a - 1; };\n"
+    "for i in items { let t = (i); t };\n"
+    "{ let inner = { 1 }; inner }  ";
+
+}  // namespace
+
+TEST(SpanIndexTest, InnermostMatchesBruteForce) {
+    auto ast = parse(kSource);
+    Flattener flattener;
+    flattener.walk(*ast);
+    sonar::SpanIndex index(*ast);
+    EXPECT_EQ(index.size(), flattener.nodes.size());
+
+    for (std::size_t offset = 0; offset <= kSource.size() + 1; ++offset) {
+        const Node* expected = nullptr;
+        for (const auto& node : flattener.nodes) {
+            if (node.span.start <= offset && offset < node.span.end && (!expected || node.depth > expected->depth)) {
+                expected = &node;
+            }
+        }
+        EXPECT_EQ(address_of(index.innermost_at(offset)), expected ? expected->address : nullptr) << "offset " << offset;
+    }
+}
+
+TEST(SpanIndexTest, OverlappingMatchesBruteForce) {
+    auto ast = parse(kSource);
+    Flattener flattener;
+    flattener.walk(*ast);
+    sonar::SpanIndex index(*ast);
+
+    for (std::size_t start = 0; start <= kSource.size(); start += 3) {
+        for (std::size_t end = start; end <= kSource.size(); end += 7) {
+            std::vector<const void*> expected;
+            for (const auto& node : flattener.nodes) {
+                const bool overlaps = start == end ? node.span.start <= start && start < node.span.end
+                                                   : node.span.start < end && start < node.span.end;
+                if (overlaps) {
+                    expected.push_back(node.address);
+                }
+            }
+            std::vector<const void*> actual;
+            for (const auto* entry : index.overlapping(sonar::SourceSpan{start, end})) {
+                actual.push_back(address_of(entry));
+            }
+            EXPECT_EQ(actual, expected) << "range " << start << ".." << end;
+        }
+    }
+}
+
+TEST(SpanIndexTest, ReachesIntoDeferredBodiesAndParents) {
+    const std::string source = "fn f(x: number) -> number { x * 2 }\nf";
+    auto ast = parse(source, sonar::ParserOptions{true});
+    sonar::SpanIndex index(*ast);
+
+    const auto* variable = index.innermost_at(source.find("x *"));
+    ASSERT_NE(variable, nullptr);
+    ASSERT_NE(variable->expression, nullptr);
+    EXPECT_TRUE(std::holds_alternative<sonar::Expression::Variable>(variable->expression->node));
+
+    const auto* infix = index.parent(*variable);
+    ASSERT_NE(infix, nullptr);
+    EXPECT_TRUE(std::holds_alternative<sonar::Expression::Infix>(infix->expression->node));
+    EXPECT_EQ(index.innermost_at(source.find('*')), infix);
+
+    std::size_t ancestors = 0;
+    for (const auto* entry = variable; entry != nullptr; entry = index.parent(*entry)) {
+        ++ancestors;
+    }
+    // Variable, Infix, body Block, Function, Let, program Block.
+    EXPECT_EQ(ancestors, 6u);
+}
@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/pretty_printer.hpp"
+#include "sonar/program_generator.hpp"
+
+namespace {
+
+sonar::Parser make_parser(const std::string& source) {
+    sonar::Lexer lexer;
+    auto lex_result = lexer.tokenize(source);
+    return sonar::Parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), "<test>");
+}
+
+// The statements parse_streaming delivers and the value it returns, one per line, or the error it throws.
+std::string stream_tokens(const std::string& source, sonar::ParserOptions options = {}) {
+    std::string printed;
+    try {
+        sonar::Lexer lexer;
+        auto lex_result = lexer.tokenize(source);
+        sonar::Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), "<test>", options);
+        auto value = parser.parse_streaming(
+            [&](sonar::StatementPtr statement) { printed += sonar::pretty_print(*statement) + "\n"; });
+        if (value) {
+            printed += sonar::pretty_print(*value);
+        }
+    } catch (const sonar::ParseError& err) {
+        printed += std::string(err.what()) + " at " + std::to_string(err.location().line) + ":" +
+                   std::to_string(err.location().column);
+    }
+    return printed;
+}
+
+// The same from the input stream overload.
+std::string stream_input(const std::string& source, sonar::ParserOptions options = {}) {
+    std::string printed;
+    std::istringstream input(source);
+    try {
+        auto value = sonar::Parser::parse_streaming(
+            input, "<test>", [&](sonar::StatementPtr statement) { printed += sonar::pretty_print(*statement) + "\n"; },
+            options);
+        if (value) {
+            printed += sonar::pretty_print(*value);
+        }
+    } catch (const sonar::ParseError& err) {
+        printed += std::string(err.what()) + " at " + std::to_string(err.location().line) + ":" +
+                   std::to_string(err.location().column);
+    }
+    return printed;
+}
+
+// Counts the bytes read through it.
+class CountingBuffer : public std::streambuf {
+   public:
+    explicit CountingBuffer(const std::string& text) : text_(text) {}
+
+    std::size_t bytes_read() const { return position_; }
+
+   protected:
+    int_type underflow() override {
+        if (position_ == text_.size()) {
+            return traits_type::eof();
+        }
+        // One small block at a time, like a pipe.
+        const std::size_t block = std::min<std::size_t>(4096, text_.size() - position_);
+        char* begin = const_cast<char*>(text_.data()) + position_;
+        setg(begin, begin, begin + block);
+        position_ += block;
+        return traits_type::to_int_type(*begin);
+    }
+
+   private:
+    const std::string& text_;
+    std::size_t position_{0};
+};
+
+}  // namespace
+
+TEST(StreamingParseTest, DeliversTheStatementsOfParse) {
+    const std::string source = "let a = 1;;\nfn f(x: number) -> number { x }\nf;\nwhile a { a = a - 1; };\na + 1";
+
+    auto expected = make_parser(source).parse();
+    const auto& block = std::get<sonar::Expression::Block>(expected->node);
+
+    std::vector<std::string> printed;
+    auto parser = make_parser(source);
+    auto value = parser.parse_streaming([&](sonar::StatementPtr statement) { printed.push_back(sonar::pretty_print(*statement)); });
+
+    ASSERT_EQ(printed.size(), block.statements.size());
+    for (std::size_t i = 0; i < printed.size(); ++i) {
+        EXPECT_EQ(printed[i], sonar::pretty_print(*block.statements[i]));
+    }
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(sonar::pretty_print(*value), "(+ a 1)");
+}
+
+TEST(StreamingParseTest, ReturnsNullWithoutTrailingValue) {
+    auto parser = make_parser("let a = 1;");
+    std::size_t count = 0;
+    EXPECT_EQ(parser.parse_streaming([&](sonar::StatementPtr) { ++count; }), nullptr);
+    EXPECT_EQ(count, 1u);
+
+    auto empty = make_parser("");
+    EXPECT_EQ(empty.parse_streaming([&](sonar::StatementPtr) { ++count; }), nullptr);
+    EXPECT_EQ(count, 1u);
+}
+
+TEST(StreamingParseTest, DeliversStatementsBeforeAnError) {
+    auto parser = make_parser("let a = 1;\nlet b = 2;\nlet = 3;");
+    std::vector<std::string> printed;
+    try {
+        parser.parse_streaming([&](sonar::StatementPtr statement) { printed.push_back(sonar::pretty_print(*statement)); });
+        ADD_FAILURE() << "Expected a parse error";
+    } catch (const sonar::ParseError& err) {
+        EXPECT_STREQ(err.what(), "Expected identifier after 'let'");
+    }
+    EXPECT_EQ(printed, (std::vector<std::string>{"(let a = 1)", "(let b = 2)"}));
+}
+
+TEST(StreamingParseTest, ParsesAnInputStreamLikeItsTokens) {
+    std::vector<std::string> sources = {
+        "",
+        ";;",
+        "let a = 1;;\nfn f(x: number) -> number { x }\nf;\nwhile a { a = a - 1; };\na + 1",
+        "fn f() -> number { 1 } + 2;\nfn g() -> number { 2 }\n(g)",
+        "let a = 1;\nlet b = 2;\nlet = 3;",
+        // The scan ends these items before the parser does.
+        "fn f() -> number { 1 };",
+        "fn f() -> number { ) ; ; }",
+        "a; b c;",
+        "{ let a = 1",
+    };
+    for (std::uint64_t seed = 1; seed <= 4; ++seed) {
+        // Longer than the blocks the input is read in, so items and lines straddle them.
+        sonar::GeneratorOptions generator;
+        generator.seed = seed;
+        generator.target_bytes = 200 * 1024;
+        std::string source = sonar::generate_program(generator);
+        sources.push_back(source);
+        source.insert(source.find(";\n", source.size() / 2) + 2, "let = 1;\n");
+        sources.push_back(source);
+    }
+    for (const auto& source : sources) {
+        SCOPED_TRACE(source.substr(0, 80));
+        for (const bool lazy : {false, true}) {
+            sonar::ParserOptions options;
+            options.lazy_function_bodies = lazy;
+            EXPECT_EQ(stream_input(source, options), stream_tokens(source, options));
+        }
+    }
+}
+
+TEST(StreamingParseTest, ThrowsLexerErrorsWhenReadingReachesThem) {
+    std::istringstream input("let a = 1;\nlet b = #;");
+    std::vector<std::string> printed;
+    try {
+        sonar::Parser::parse_streaming(input, "<test>", [&](sonar::StatementPtr statement) {
+            printed.push_back(sonar::pretty_print(*statement));
+        });
+        ADD_FAILURE() << "Expected a lexer error";
+    } catch (const sonar::ParseError&) {
+        ADD_FAILURE() << "Expected a lexer error";
+    } catch (const std::runtime_error& err) {
+        EXPECT_STREQ(err.what(), "Unexpected character '#' at line 2, column 9");
+    }
+    EXPECT_EQ(printed, (std::vector<std::string>{"(let a = 1)"}));
+}
+
+TEST(StreamingParseTest, DeliversTheFirstStatementBeforeReadingTheRest) {
+    std::string source;
+    for (int i = 0; i < 100000; ++i) {
+        source += "let v" + std::to_string(i) + " = " + std::to_string(i) + ";\n";
+    }
+    CountingBuffer buffer(source);
+    std::istream input(&buffer);
+    std::size_t statements = 0;
+    std::size_t read_at_first = 0;
+    sonar::Parser::parse_streaming(input, "<test>", [&](sonar::StatementPtr) {
+        if (statements++ == 0) {
+            read_at_first = buffer.bytes_read();
+        }
+    });
+    EXPECT_EQ(statements, 100000u);
+    EXPECT_EQ(buffer.bytes_read(), source.size());
+    EXPECT_LT(read_at_first, source.size() / 10);
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <variant>
+
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/structural_hash.hpp"
+#include "test_sources.hpp"
+
+namespace {
+
+sonar::ExpressionPtr parse(const std::string& source, sonar::ParserOptions options = {}) {
+    sonar::Lexer lexer;
+    auto lex_result = lexer.tokenize(source);
+    sonar::Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), "<test>", options);
+    return parser.parse();
+}
+
+std::uint64_t hash_of(const std::string& source) {
+    return sonar::structural_hash(*parse(source));
+}
+
+}  // namespace
+
+TEST(StructuralHashTest, IgnoresPositionsButNotStructure) {
+    EXPECT_EQ(hash_of("let a: number = 1 + b;\na"), hash_of("let   a : number=\n  1+b ;  a"));
+    EXPECT_EQ(hash_of("fn f(x: number) -> bool { x }"), hash_of("fn f(x:number)->bool{x}"));
+
+    const std::string base = "let a: number = 1 + b;\na";
+    const std::string variants[] = {
+        "let a: number = 2 + b;\na",   "let a: number = 1 - b;\na", "let a: bool = 1 + b;\na",
+        "let a = 1 + b;\na",           "let c: number = 1 + b;\na", "let a: number = (1 + b);\na",
+        "let a: number = 1 + b;\na;", "let a: number = b + 1;\na",
+    };
+    for (const auto& variant : variants) {
+        EXPECT_NE(hash_of(base), hash_of(variant)) << variant;
+    }
+    EXPECT_NE(hash_of("fn f(x: number) -> bool { x }"), hash_of("fn f(y: number) -> bool { x }"));
+    EXPECT_NE(hash_of("fn f(x: number) -> bool { x }"), hash_of("fn f(x: bool) -> bool { x }"));
+    EXPECT_NE(hash_of("if a { b } else { c }"), hash_of("if a { b }"));
+    EXPECT_NE(hash_of("\"a\""), hash_of("a"));
+}
+
+TEST(StructuralHashTest, EqualSubtreesHashEqual) {
+    auto ast = parse("let a = { x * 2 };\nlet b = { x * 2 };\nlet c = { x * 3 };");
+    const auto& statements = std::get<sonar::Expression::Block>(ast->node).statements;
+    EXPECT_NE(sonar::structural_hash(*statements[0]), sonar::structural_hash(*statements[1]));
+    const auto initializer = [&](std::size_t index) -> const sonar::Expression& {
+        return *std::get<sonar::Statement::Let>(statements[index]->node).initializer;
+    };
+    EXPECT_EQ(sonar::structural_hash(initializer(0)), sonar::structural_hash(initializer(1)));
+    EXPECT_NE(sonar::structural_hash(initializer(0)), sonar::structural_hash(initializer(2)));
+}
+
+TEST(StructuralHashTest, HashesLongOperatorChains) {
+    const std::string chain = sonar::test::long_operator_chain(200000);
+    EXPECT_EQ(hash_of(chain), hash_of(chain));
+    EXPECT_NE(hash_of(chain), hash_of(chain + " + x"));
+    EXPECT_NE(hash_of(chain), hash_of("y" + chain.substr(1)));
+}
+
+TEST(StructuralHashTest, DeferredBodiesHashLikeParsedOnes) {
+    const std::string source = "fn f(x: number) -> number { let y = x * 2; y + 1 }\nf";
+    EXPECT_EQ(sonar::structural_hash(*parse(source, sonar::ParserOptions{true})), hash_of(source));
+}
+
+TEST(StructuralHashTest, DeferredBodyErrorsAreThrown) {
+    auto ast = parse("fn f() -> number { 1 + }\nf", sonar::ParserOptions{true});
+    EXPECT_THROW(sonar::structural_hash(*ast), sonar::ParseError);
+    sonar::StructuralHashCache cache;
+    EXPECT_THROW(cache.hash(*ast), sonar::ParseError);
+}
+
+TEST(StructuralHashTest, CacheHashesNodesWithoutIds) {
+    // structural_hash needs no allocation header at all; the cache hashes a tree that was never numbered
+    // without caching anything.
+    const sonar::Expression variable(sonar::Expression::Variable{"x"}, sonar::SourceSpan{0, 1});
+    EXPECT_EQ(sonar::structural_hash(variable), hash_of("x"));
+
+    auto sum = std::make_unique<sonar::Expression>(
+        sonar::Expression::Infix{sonar::TokenType::Plus, sonar::SourceSpan{2, 3},
+                                 std::make_unique<sonar::Expression>(sonar::Expression::Variable{"x"}, sonar::SourceSpan{0, 1}),
+                                 std::make_unique<sonar::Expression>(sonar::Expression::Number{2}, sonar::SourceSpan{4, 5})},
+        sonar::SourceSpan{0, 5});
+    ASSERT_EQ(sonar::node_id(*sum), sonar::kNoNodeId);
+    sonar::StructuralHashCache cache;
+    EXPECT_EQ(cache.hash(*sum), hash_of("x + 2"));
+    EXPECT_EQ(cache.hash(*sum), hash_of("x + 2"));
+}
+
+TEST(StructuralHashTest, ReparseInvalidatesThePathToTheEdit) {
+    const std::string source = "let a = 1;\nlet b = { let c = 2; c + 3 };\nfn f(x: number) -> number { x }\na + b";
+    const std::size_t at = source.find('3');
+    const sonar::TextEdit edit{sonar::SourceSpan{at, at + 1}, "30 * (c - 1)"};
+    const std::string edited = source.substr(0, at) + edit.replacement + source.substr(at + 1);
+
+    sonar::Lexer lexer;
+    auto old_lex = lexer.tokenize(source);
+    sonar::Parser old_parser(old_lex.tokens, old_lex.line_offsets, "<test>");
+    auto ast = old_parser.parse();
+    sonar::StructuralHashCache cache;
+    const std::uint64_t before = cache.hash(*ast);
+    const auto& old_statements = std::get<sonar::Expression::Block>(ast->node).statements;
+    const sonar::Statement* untouched = old_statements.front().get();
+    const std::uint64_t untouched_hash = cache.hash(*untouched);
+
+    lexer.retokenize(old_lex, edited, edit);
+    auto reparsed = sonar::Parser::reparse(std::move(ast), old_lex, edit, "<test>", {}, &cache);
+
+    const auto& statements = std::get<sonar::Expression::Block>(reparsed->node).statements;
+    ASSERT_EQ(statements.front().get(), untouched);
+    EXPECT_EQ(cache.hash(*untouched), untouched_hash);
+    EXPECT_NE(cache.hash(*reparsed), before);
+    EXPECT_EQ(cache.hash(*reparsed), hash_of(edited));
+    auto expected = parse(edited);
+    const auto& expected_statements = std::get<sonar::Expression::Block>(expected->node).statements;
+    EXPECT_EQ(cache.hash(*statements[1]), sonar::structural_hash(*expected_statements[1]));
+}
+
+TEST(StructuralHashTest, CacheFollowsReparsesThatReuseIds) {
+    // Shrinking edits hand the ids of removed nodes to nodes elsewhere in the tree.
+    std::string source = "let a = 1;\nlet b = { let c = 2; c + 3 };\nlet d = { c * 4 };\na + b";
+    sonar::Lexer lexer;
+    auto lexed = lexer.tokenize(source);
+    auto ast = sonar::Parser(lexed.tokens, lexed.line_offsets, "<test>").parse();
+    sonar::StructuralHashCache cache;
+    cache.hash(*ast);
+
+    const std::size_t at = source.find("c + 3");
+    std::size_t length = 5;
+    const std::string replacements[] = {"(c - 1) * -c + 3", "3", "{ 3 }", "c", "b + { a }"};
+    for (const auto& replacement : replacements) {
+        const sonar::TextEdit edit{sonar::SourceSpan{at, at + length}, replacement};
+        const std::size_t end = at + length;
+        length = replacement.size();
+        source = source.substr(0, at) + replacement + source.substr(end);
+        lexer.retokenize(lexed, source, edit);
+        ast = sonar::Parser::reparse(std::move(ast), lexed, edit, "<test>", {}, &cache);
+
+        EXPECT_EQ(cache.hash(*ast), hash_of(source)) << source;
+        const auto& statements = std::get<sonar::Expression::Block>(ast->node).statements;
+        EXPECT_EQ(cache.hash(*statements[2]), sonar::structural_hash(*statements[2])) << source;
+    }
+}
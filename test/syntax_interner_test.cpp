@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+#include <variant>
+
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/pretty_printer.hpp"
+#include "sonar/syntax_interner.hpp"
+#include "test_sources.hpp"
+
+namespace {
+
+sonar::Parser make_parser(const std::string& source) {
+    sonar::Lexer lexer;
+    auto lex_result = lexer.tokenize(source);
+    return sonar::Parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), "<test>");
+}
+
+sonar::ExpressionPtr parse(const std::string& source) {
+    return make_parser(source).parse();
+}
+
+const char* const kSources[] = {
+    "1 + 2 * 3",
+    "",
+    "let x: number = -(1 + 2);\nx = x * 2;\nx",
+    "fn add(a: number, b: number) -> number { a + b }\nlet s = \"hi\";\nif true { add } else { s }",
+    "while x { x = x - 1; };\nfor i in { i } { false }",
+    "{ let y = 1; fn() -> number { y } };",
+    "a - b - c * d - (e + f) + -g",
+};
+
+}  // namespace
+
+TEST(SyntaxInternerTest, RebuildsTheInternedTree) {
+    for (const char* source : kSources) {
+        SCOPED_TRACE(source);
+        sonar::SyntaxInterner interner;
+        auto ast = parse(source);
+        auto tree = interner.intern(*ast);
+        ASSERT_EQ(tree.spans.size(), interner.span_count(tree.root));
+
+        auto rebuilt = interner.rebuild(tree);
+        EXPECT_EQ(sonar::pretty_print(*rebuilt), sonar::pretty_print(*ast));
+
+        auto again = interner.intern(*rebuilt);
+        EXPECT_EQ(again.root, tree.root);
+        EXPECT_EQ(again.spans, tree.spans);
+    }
+}
+
+TEST(SyntaxInternerTest, InternsLongOperatorChains) {
+    const std::string source = sonar::test::long_operator_chain(200000);
+    sonar::SyntaxInterner interner;
+    auto ast = parse(source);
+    auto tree = interner.intern(*ast);
+    ASSERT_EQ(tree.spans.size(), interner.span_count(tree.root));
+    EXPECT_EQ(sonar::pretty_print(*interner.rebuild(tree)), sonar::pretty_print(*ast));
+}
+
+TEST(SyntaxInternerTest, ParseInternedMatchesParse) {
+    for (const char* source : kSources) {
+        SCOPED_TRACE(source);
+        sonar::SyntaxInterner interner;
+        auto expected = interner.intern(*parse(source));
+        auto parser = make_parser(source);
+        auto actual = parser.parse_interned(interner);
+        EXPECT_EQ(actual.root, expected.root);
+        EXPECT_EQ(actual.spans, expected.spans);
+    }
+}
+
+TEST(SyntaxInternerTest, SharesIdenticalSubtreesAcrossPositions) {
+    sonar::SyntaxInterner interner;
+    auto tree = interner.intern(*parse("(x + 1) * (x + 1)"));
+
+    ASSERT_EQ(interner.kind(tree.root), sonar::SyntaxKind::Infix);
+    const auto operands = interner.operands(tree.root);
+    EXPECT_EQ(operands[0], operands[1]);
+    // x, 1, x + 1, (x + 1) and the product.
+    EXPECT_EQ(interner.size(), 5u);
+    // Each Infix has its own span and its operator's, then its operands' entries. Spans are relative, so each
+    // `x + 1` starts one byte into its grouping.
+    EXPECT_EQ(tree.spans.size(), 12u);
+    EXPECT_EQ(tree.spans[3].start, 1u);
+    EXPECT_EQ(tree.spans[7].start, 10u);
+    EXPECT_EQ(tree.spans[8].start, 1u);
+}
+
+TEST(SyntaxInternerTest, DistinguishesStructure) {
+    sonar::SyntaxInterner interner;
+    auto id = [&](const char* source) { return interner.intern(*parse(source)).root; };
+
+    EXPECT_EQ(id("a + b"), id("  a  +  b"));
+    EXPECT_NE(id("a + b"), id("a - b"));
+    EXPECT_NE(id("a + b"), id("(a + b)"));
+    EXPECT_NE(id("\"a\""), id("a"));
+    EXPECT_NE(id("1"), id("true"));
+    EXPECT_NE(id("fn(a: number) -> number { a }"), id("fn(a: bool) -> number { a }"));
+    EXPECT_NE(id("{ let a = 1; }"), id("{ let a: number = 1; }"));
+    EXPECT_NE(id("if a { 1 }"), id("if a { 1 } else { 1 }"));
+}
+
+TEST(SyntaxInternerTest, GrowsWithDistinctStructureOnly) {
+    std::string source;
+    for (int i = 0; i < 1000; ++i) {
+        source += "let total = { let a = 1; a * (a + 2) };\n";
+    }
+    sonar::SyntaxInterner interner;
+    auto parser = make_parser(source);
+    auto tree = parser.parse_interned(interner);
+
+    const auto& block = std::get<sonar::Expression::Block>(interner.rebuild(tree)->node);
+    EXPECT_EQ(block.statements.size(), 1000u);
+    EXPECT_LT(interner.size(), 16u);
+    EXPECT_EQ(interner.span_count(tree.root), tree.spans.size());
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace sonar::test {
+
+// `operand + operand + ...` with `operators` additions; see kMaxNestingDepth for why any length must work.
+inline std::string long_operator_chain(std::size_t operators, std::string_view operand = "x") {
+    std::string chain(operand);
+    chain.reserve((operators + 1) * (operand.size() + 3));
+    for (std::size_t i = 0; i < operators; ++i) {
+        chain += " + ";
+        chain += operand;
+    }
+    return chain;
+}
+
+}  // namespace sonar::test
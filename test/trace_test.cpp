@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <latch>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/thread_pool.hpp"
+#include "sonar/trace.hpp"
+
+TEST(TraceTest, RecordsNestedSpansInStartOrder) {
+    sonar::TraceRecorder trace;
+    {
+        sonar::TraceSpan outer(&trace, "file", "a.sonar");
+        { sonar::TraceSpan inner(&trace, "lex"); }
+        { sonar::TraceSpan inner(&trace, "parse"); }
+    }
+    const auto events = trace.events();
+    ASSERT_EQ(events.size(), 3u);
+    EXPECT_STREQ(events[0].name, "file");
+    EXPECT_EQ(events[0].detail, "a.sonar");
+    EXPECT_STREQ(events[1].name, "lex");
+    EXPECT_STREQ(events[2].name, "parse");
+    EXPECT_LE(events[1].start + events[1].duration, events[2].start);
+    EXPECT_GE(events[0].start + events[0].duration, events[2].start + events[2].duration);
+    EXPECT_EQ(trace.dropped(), 0u);
+
+    sonar::TraceSpan ignored(nullptr, "nothing", "ignored");
+}
+
+TEST(TraceTest, KeepsTheNewestSpansOfEachThread) {
+    sonar::TraceRecorder trace(3);
+    // Threads wait for each other so none can exit and hand its id to a later one.
+    std::latch started(3);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; ++t) {
+        threads.emplace_back([&] {
+            started.arrive_and_wait();
+            for (int i = 0; i < 10; ++i) {
+                sonar::TraceSpan span(&trace, "work", std::to_string(i));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // Rounded up to 4 spans per thread.
+    const auto events = trace.events();
+    ASSERT_EQ(events.size(), 12u);
+    EXPECT_EQ(trace.dropped(), 18u);
+    std::set<std::uint32_t> ids;
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        ids.insert(events[i].thread);
+        EXPECT_EQ(events[i].detail, std::to_string(6 + i % 4));
+    }
+    EXPECT_EQ(ids.size(), 3u);
+}
+
+TEST(TraceTest, GrowsARingUntilItWraps) {
+    sonar::TraceRecorder trace(256);
+    for (int i = 0; i < 100; ++i) {
+        sonar::TraceSpan span(&trace, "work", std::to_string(i));
+    }
+    EXPECT_EQ(trace.events().size(), 100u);
+    EXPECT_EQ(trace.dropped(), 0u);
+
+    for (int i = 100; i < 300; ++i) {
+        sonar::TraceSpan span(&trace, "work", std::to_string(i));
+    }
+    const auto events = trace.events();
+    ASSERT_EQ(events.size(), 256u);
+    EXPECT_EQ(trace.dropped(), 44u);
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        EXPECT_EQ(events[i].detail, std::to_string(44 + i));
+    }
+}
+
+TEST(TraceTest, TracesParallelParseChunksOnPoolThreads) {
+    std::string source;
+    for (int i = 0; i < 200; ++i) {
+        source += "let v" + std::to_string(i) + " = " + std::to_string(i) + " * 2;\n";
+    }
+    sonar::TraceRecorder trace;
+    sonar::Lexer lexer;
+    auto lex_result = lexer.tokenize(source);
+    sonar::ParserOptions options;
+    options.trace = &trace;
+    sonar::Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), "<test>", options);
+    sonar::ThreadPool pool(2);
+    parser.parse_parallel(pool);
+
+    const auto events = trace.events();
+    EXPECT_EQ(events.size(), 8u);
+    for (const auto& event : events) {
+        EXPECT_STREQ(event.name, "parse chunk");
+        EXPECT_EQ(event.detail.rfind("tokens ", 0), 0u);
+    }
+}
+
+TEST(TraceTest, WritesChromeTraceEvents) {
+    sonar::TraceRecorder trace;
+    { sonar::TraceSpan span(&trace, "read", "dir/\"quoted\"\n.sonar"); }
+    std::ostringstream out;
+    trace.write_chrome_json(out);
+    const std::string json = out.str();
+    EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0), 0u);
+    EXPECT_NE(json.find(R"("name":"thread_name","ph":"M","pid":1,"tid":0)"), std::string::npos);
+    EXPECT_NE(json.find(R"({"name":"read","cat":"sonar","ph":"X","pid":1,"tid":0,"ts":)"), std::string::npos);
+    EXPECT_NE(json.find(R"("args":{"detail":"dir/\"quoted\"\n.sonar"}})"), std::string::npos);
+    EXPECT_EQ(json.substr(json.size() - 4), "\n]}\n");
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/visitor.hpp"
+#include "test_sources.hpp"
+
+namespace {
+
+sonar::ExpressionPtr parse(const std::string& source, sonar::ParserOptions options = {}) {
+    sonar::Lexer lexer;
+    auto lex_result = lexer.tokenize(source);
+    sonar::Parser parser(std::move(lex_result.tokens), std::move(lex_result.line_offsets), "<test>", options);
+    return parser.parse();
+}
+
+// Records "+start" on enter and "-start" on leave for every node, with `start` in source offsets.
+class OrderRecorder : public sonar::AstWalker<OrderRecorder> {
+   public:
+    template <typename Wrapper, typename Node>
+    void enter(const Wrapper& wrapper, const Node&) {
+        log.push_back("+" + std::to_string(wrapper.span.offset_by(parent_start()).start));
+    }
+
+    template <typename Wrapper, typename Node>
+    void leave(const Wrapper& wrapper, const Node&) {
+        log.push_back("-" + std::to_string(wrapper.span.offset_by(parent_start()).start));
+    }
+
+    std::vector<std::string> log;
+};
+
+// Collects variable names, skipping function bodies and stopping at the first name `stop_at`.
+class VariableCollector : public sonar::AstWalker<VariableCollector> {
+   public:
+    explicit VariableCollector(std::string stop_at) : stop_at_(std::move(stop_at)) {}
+
+    sonar::WalkAction enter(const sonar::Expression&, const sonar::Expression::Variable& variable) {
+        names.push_back(variable.name);
+        return variable.name == stop_at_ ? sonar::WalkAction::Stop : sonar::WalkAction::Continue;
+    }
+
+    sonar::WalkAction enter(const sonar::Expression&, const sonar::Expression::Function&) {
+        return sonar::WalkAction::SkipChildren;
+    }
+
+    void leave(const sonar::Expression&, const sonar::Expression::Function&) { ++functions; }
+
+    std::vector<std::string> names;
+    int functions{0};
+
+   private:
+    std::string stop_at_;
+};
+
+// Collects variable names outside products.
+class SumCollector : public sonar::AstWalker<SumCollector> {
+   public:
+    sonar::WalkAction enter(const sonar::Expression&, const sonar::Expression::Infix& infix) {
+        return infix.op == sonar::TokenType::Star ? sonar::WalkAction::SkipChildren : sonar::WalkAction::Continue;
+    }
+
+    void enter(const sonar::Expression&, const sonar::Expression::Variable& variable) { names.push_back(variable.name); }
+
+    std::vector<std::string> names;
+};
+
+class ShallowCounter : public sonar::AstWalker<ShallowCounter> {
+   public:
+    static constexpr bool parse_deferred_bodies = false;
+
+    template <typename Node>
+    void enter(const sonar::Expression&, const Node&) {
+        ++expressions;
+    }
+
+    int expressions{0};
+};
+
+}  // namespace
+
+TEST(VisitorTest, VisitsChildrenInSourceOrder) {
+    auto ast = parse("let a = b + c;\nd");
+    OrderRecorder recorder;
+    EXPECT_TRUE(recorder.walk(*ast));
+    const std::vector<std::string> expected = {"+0", "+0", "+8", "+8", "-8", "+12", "-12", "-8", "-0", "+15", "-15", "-0"};
+    EXPECT_EQ(recorder.log, expected);
+}
+
+TEST(VisitorTest, SkipsChildrenAndStopsEarly) {
+    auto ast = parse("a + fn(x: number) -> number x + b;\nc = d;\ne");
+
+    VariableCollector all("");
+    EXPECT_TRUE(all.walk(*ast));
+    EXPECT_EQ(all.names, (std::vector<std::string>{"a", "c", "d", "e"}));
+    EXPECT_EQ(all.functions, 1);
+
+    VariableCollector stopped("c");
+    EXPECT_FALSE(stopped.walk(*ast));
+    EXPECT_EQ(stopped.names, (std::vector<std::string>{"a", "c"}));
+}
+
+TEST(VisitorTest, WalksOperatorChainsInOrder) {
+    auto ast = parse("a + b * c - d");
+    OrderRecorder recorder;
+    EXPECT_TRUE(recorder.walk(*ast));
+    const std::vector<std::string> expected = {"+0", "+0", "+0", "-0", "+4", "+4", "-4", "+8", "-8", "-4",
+                                               "-0", "+12", "-12", "-0"};
+    EXPECT_EQ(recorder.log, expected);
+
+    SumCollector sums;
+    EXPECT_TRUE(sums.walk(*parse("a * b + c * d - e")));
+    EXPECT_EQ(sums.names, (std::vector<std::string>{"e"}));
+
+    VariableCollector stopped("c");
+    EXPECT_FALSE(stopped.walk(*parse("a + b * c - d - e")));
+    EXPECT_EQ(stopped.names, (std::vector<std::string>{"a", "b", "c"}));
+
+    VariableCollector all("");
+    EXPECT_TRUE(all.walk(*parse(sonar::test::long_operator_chain(200000))));
+    EXPECT_EQ(all.names.size(), 200001u);
+}
+
+TEST(VisitorTest, LeavesDeferredBodiesUnparsedWhenAsked) {
+    sonar::ParserOptions options;
+    options.lazy_function_bodies = true;
+    auto ast = parse("fn f() -> number { 1 + }", options);
+
+    ShallowCounter counter;
+    EXPECT_TRUE(counter.walk(*ast));
+    EXPECT_EQ(counter.expressions, 2);
+
+    OrderRecorder recorder;
+    EXPECT_THROW(recorder.walk(*ast), sonar::ParseError);
+}
@@ -0,0 +1,153 @@
+// sonar-gen: writes a seeded synthetic program of a given size and shape, for scaling benchmarks from
+// kilobytes to gigabytes. The same arguments give the same bytes on every platform.
+
+#include <argparse/argparse.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "sonar/program_generator.hpp"
+
+namespace {
+
+// "4096", "64K", "16M" or "1G", in binary units.
+std::size_t parse_size(const std::string& text) {
+    std::size_t digits = 0;
+    const unsigned long long value = std::stoull(text, &digits);
+    const std::string_view suffix = std::string_view(text).substr(digits);
+    unsigned shift = 0;
+    if (suffix == "K" || suffix == "k") {
+        shift = 10;
+    } else if (suffix == "M" || suffix == "m") {
+        shift = 20;
+    } else if (suffix == "G" || suffix == "g") {
+        shift = 30;
+    } else if (!suffix.empty()) {
+        throw std::invalid_argument("unknown size suffix '" + std::string(suffix) + "'");
+    }
+    return static_cast<std::size_t>(value) << shift;
+}
+
+}  // namespace
+
+int main(int argc, const char* const argv[]) {
+    argparse::ArgumentParser program(argv[0], SONAR_VERSION, argparse::default_arguments::all, false);
+
+    const sonar::GeneratorOptions defaults;
+
+    program.add_argument("-o", "--output")
+        .help("Write the program to PATH instead of stdout")
+        .metavar("PATH");
+
+    program.add_argument("--size")
+        .help("Generate at least SIZE bytes; K, M and G suffixes are binary units")
+        .metavar("SIZE")
+        .default_value(std::string("64K"));
+
+    program.add_argument("--seed")
+        .help("Seed of the generator")
+        .metavar("N")
+        .default_value(defaults.seed)
+        .scan<'u', std::uint64_t>();
+
+    program.add_argument("--width")
+        .help("The most statements in a block and operands in an operator chain")
+        .metavar("N")
+        .default_value(defaults.width)
+        .scan<'u', std::size_t>();
+
+    program.add_argument("--depth")
+        .help("How deeply blocks and compound expressions may nest")
+        .metavar("N")
+        .default_value(defaults.depth)
+        .scan<'u', std::size_t>();
+
+    const std::pair<const char*, unsigned> weights[] = {
+        {"--arithmetic", defaults.operators.arithmetic}, {"--logical", defaults.operators.logical},
+        {"--bitwise", defaults.operators.bitwise},       {"--prefix", defaults.operators.prefix},
+        {"--assignment", defaults.operators.assignment},
+    };
+    for (const auto& [name, weight] : weights) {
+        program.add_argument(name)
+            .help("Relative weight of these operators; 0 leaves them out")
+            .metavar("W")
+            .default_value(weight)
+            .scan<'u', unsigned>();
+    }
+
+    const std::pair<const char*, double> ratios[] = {
+        {"--fn-density", defaults.fn_density},     {"--let-density", defaults.let_density},
+        {"--strings", defaults.string_ratio},      {"--raw-strings", defaults.raw_string_ratio},
+        {"--comments", defaults.comment_ratio},
+    };
+    for (const auto& [name, ratio] : ratios) {
+        program.add_argument(name)
+            .help("Share between 0 and 1; see GeneratorOptions in sonar/program_generator.hpp")
+            .metavar("P")
+            .default_value(ratio)
+            .scan<'g', double>();
+    }
+
+    try {
+        program.parse_args(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        std::cerr << program;
+        return 1;
+    }
+
+    if (program["--version"] == true || program["--help"] == true) {
+        return 0;
+    }
+
+    sonar::GeneratorOptions options;
+    try {
+        options.target_bytes = parse_size(program.get<std::string>("--size"));
+    } catch (const std::exception& ex) {
+        std::cerr << "error: invalid --size: " << ex.what() << std::endl;
+        return 1;
+    }
+    options.seed = program.get<std::uint64_t>("--seed");
+    options.width = program.get<std::size_t>("--width");
+    options.depth = program.get<std::size_t>("--depth");
+    options.operators.arithmetic = program.get<unsigned>("--arithmetic");
+    options.operators.logical = program.get<unsigned>("--logical");
+    options.operators.bitwise = program.get<unsigned>("--bitwise");
+    options.operators.prefix = program.get<unsigned>("--prefix");
+    options.operators.assignment = program.get<unsigned>("--assignment");
+    options.fn_density = program.get<double>("--fn-density");
+    options.let_density = program.get<double>("--let-density");
+    options.string_ratio = program.get<double>("--strings");
+    options.raw_string_ratio = program.get<double>("--raw-strings");
+    options.comment_ratio = program.get<double>("--comments");
+
+    std::ofstream file;
+    if (const auto path = program.present<std::string>("--output")) {
+        file.open(*path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "error: failed to open '" << *path << "'" << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = file.is_open() ? static_cast<std::ostream&>(file) : std::cout;
+
+    try {
+        sonar::generate_program(options, [&](std::string_view chunk) {
+            out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        });
+    } catch (const std::invalid_argument& ex) {
+        std::cerr << "error: " << ex.what() << std::endl;
+        return 1;
+    }
+    out.flush();
+    if (!out) {
+        std::cerr << "error: failed to write the program" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,265 @@
+// sonar-reduce: shrinks an input while it still shows some behaviour, such as parsing slower per byte than a
+// threshold, so a slow fuzzer finding or production file becomes a test case a few lines long.
+
+#include <argparse/argparse.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "sonar/lexer.hpp"
+#include "sonar/parser.hpp"
+#include "sonar/pretty_printer.hpp"
+#include "sonar/reducer.hpp"
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+namespace {
+
+enum class Phase { Lex, Parse, Print };
+
+// How long the front end up to `phase` takes on `source`, rejected input included.
+std::chrono::nanoseconds time_once(std::string_view source, Phase phase) {
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        auto lexed = sonar::Lexer{}.tokenize(source);
+        if (phase != Phase::Lex) {
+            auto ast = sonar::Parser(std::move(lexed.tokens), std::move(lexed.line_offsets), "<reduce>").parse();
+            if (phase == Phase::Print) {
+                const std::string printed = sonar::pretty_print(*ast);
+            }
+        }
+    } catch (const std::runtime_error&) {
+    }
+    return std::chrono::steady_clock::now() - start;
+}
+
+// The fastest of `repeat` runs, since a single run may be descheduled.
+std::chrono::nanoseconds time_best(std::string_view source, Phase phase, std::size_t repeat) {
+    auto best = std::chrono::nanoseconds::max();
+    for (std::size_t i = 0; i < repeat; ++i) {
+        best = std::min(best, time_once(source, phase));
+    }
+    return best;
+}
+
+// A directory only this process can write to, created fresh under the system temporary directory and
+// removed with its contents on destruction, so concurrent runs cannot clobber each other's candidates and no
+// other user can plant a link where a candidate is written.
+class ScratchDirectory {
+   public:
+    ScratchDirectory() {
+        const auto base = std::filesystem::temp_directory_path();
+#if !defined(_WIN32)
+        std::string name = (base / "sonar-reduce-XXXXXX").string();
+        if (::mkdtemp(name.data()) == nullptr) {
+            throw std::runtime_error("failed to create a directory under '" + base.string() + "'");
+        }
+        path_ = name;
+#else
+        std::random_device random;
+        for (int attempt = 0; path_.empty(); ++attempt) {
+            auto candidate = base / ("sonar-reduce-" + std::to_string(random()));
+            if (std::filesystem::create_directory(candidate)) {
+                path_ = std::move(candidate);
+            } else if (attempt == 100) {
+                throw std::runtime_error("failed to create a directory under '" + base.string() + "'");
+            }
+        }
+#endif
+    }
+
+    ScratchDirectory(const ScratchDirectory&) = delete;
+    ScratchDirectory& operator=(const ScratchDirectory&) = delete;
+
+    ~ScratchDirectory() {
+        std::error_code ignored;
+        std::filesystem::remove_all(path_, ignored);
+    }
+
+    const std::filesystem::path& path() const noexcept { return path_; }
+
+   private:
+    std::filesystem::path path_;
+};
+
+// `argument` as one word of a std::system command line.
+std::string shell_quote(const std::string& argument) {
+#if !defined(_WIN32)
+    std::string quoted = "'";
+    for (const char c : argument) {
+        quoted += c == '\'' ? std::string("'\\''") : std::string(1, c);
+    }
+    return quoted + "'";
+#else
+    // cmd.exe has no escape for '"', which a Windows path cannot contain anyway.
+    return '"' + argument + '"';
+#endif
+}
+
+bool run_command(const std::string& command, const std::filesystem::path& path, std::string_view source) {
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(source.data(), static_cast<std::streamsize>(source.size()));
+        if (!out) {
+            throw std::runtime_error("failed to write '" + path.string() + "'");
+        }
+    }
+    return std::system((command + " " + shell_quote(path.string())).c_str()) == 0;
+}
+
+std::optional<Phase> phase_named(const std::string& name) {
+    if (name == "lex") {
+        return Phase::Lex;
+    }
+    if (name == "parse") {
+        return Phase::Parse;
+    }
+    if (name == "print") {
+        return Phase::Print;
+    }
+    return std::nullopt;
+}
+
+}  // namespace
+
+int main(int argc, const char* const argv[]) {
+    argparse::ArgumentParser program(argv[0], SONAR_VERSION, argparse::default_arguments::all, false);
+
+    program.add_argument("input")
+        .help("The input to reduce")
+        .metavar("INPUT");
+
+    program.add_argument("-o", "--output")
+        .help("Write the reduced input to PATH instead of stdout")
+        .metavar("PATH");
+
+    program.add_argument("--ns-per-byte")
+        .help("Keep candidates on which PHASE takes more than X ns per byte, after subtracting its cost on "
+              "empty input")
+        .metavar("X")
+        .scan<'g', double>();
+
+    program.add_argument("--ms")
+        .help("Keep candidates on which PHASE takes more than X milliseconds")
+        .metavar("X")
+        .scan<'g', double>();
+
+    program.add_argument("--command")
+        .help("Keep candidates for which CMD, run through the shell with the candidate's path appended, exits "
+              "with status 0")
+        .metavar("CMD");
+
+    program.add_argument("--phase")
+        .help("What is timed: lex, parse (lex and parse) or print (lex, parse and pretty-print)")
+        .metavar("PHASE")
+        .default_value(std::string("parse"));
+
+    program.add_argument("--repeat")
+        .help("Time each candidate as the fastest of N runs")
+        .metavar("N")
+        .default_value(std::size_t{3})
+        .scan<'u', std::size_t>();
+
+    try {
+        program.parse_args(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        std::cerr << program;
+        return 1;
+    }
+
+    if (program["--version"] == true || program["--help"] == true) {
+        return 0;
+    }
+
+    const auto ns_per_byte = program.present<double>("--ns-per-byte");
+    const auto ms = program.present<double>("--ms");
+    const auto command = program.present<std::string>("--command");
+    if (static_cast<int>(ns_per_byte.has_value()) + static_cast<int>(ms.has_value()) +
+            static_cast<int>(command.has_value()) != 1) {
+        std::cerr << "error: give exactly one of --ns-per-byte, --ms and --command" << std::endl;
+        return 1;
+    }
+    const auto phase = phase_named(program.get<std::string>("--phase"));
+    if (!phase) {
+        std::cerr << "error: --phase must be lex, parse or print" << std::endl;
+        return 1;
+    }
+    const std::size_t repeat = std::max<std::size_t>(program.get<std::size_t>("--repeat"), 1);
+
+    const auto path = program.get<std::string>("input");
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        std::cerr << "error: failed to open '" << path << "'" << std::endl;
+        return 1;
+    }
+    std::ostringstream contents;
+    contents << input.rdbuf();
+
+    // The fixed cost of a run, which would otherwise dominate the time per byte of a short candidate.
+    const auto baseline = time_best("", *phase, std::max<std::size_t>(repeat, 16));
+    std::optional<ScratchDirectory> scratch;
+    std::filesystem::path candidate;
+    if (command) {
+        try {
+            scratch.emplace();
+        } catch (const std::exception& ex) {
+            std::cerr << "error: " << ex.what() << std::endl;
+            return 1;
+        }
+        candidate = scratch->path() / "candidate.sonar";
+    }
+
+    sonar::ReducePredicate interesting = [&](std::string_view source) {
+        if (command) {
+            return run_command(*command, candidate, source);
+        }
+        const auto elapsed = time_best(source, *phase, repeat);
+        if (ms) {
+            return std::chrono::duration<double, std::milli>(elapsed).count() > *ms;
+        }
+        if (source.empty()) {
+            return false;
+        }
+        const auto net = std::max(elapsed - baseline, std::chrono::nanoseconds(0));
+        return static_cast<double>(net.count()) / static_cast<double>(source.size()) > *ns_per_byte;
+    };
+
+    sonar::ReduceStats stats;
+    std::string reduced;
+    try {
+        reduced = sonar::reduce(contents.str(), interesting, &stats);
+    } catch (const std::exception& ex) {
+        std::cerr << path << ": error: " << ex.what() << std::endl;
+        return 1;
+    }
+    scratch.reset();
+
+    std::cerr << "sonar-reduce: " << contents.str().size() << " -> " << reduced.size() << " bytes, "
+              << stats.reductions << " of " << stats.attempts << " candidates kept" << std::endl;
+
+    if (const auto output = program.present<std::string>("--output")) {
+        std::ofstream out(*output, std::ios::binary | std::ios::trunc);
+        out << reduced;
+        if (!out) {
+            std::cerr << "error: failed to write '" << *output << "'" << std::endl;
+            return 1;
+        }
+    } else {
+        std::cout << reduced;
+    }
+    return 0;
+}